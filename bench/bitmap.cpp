@@ -1,10 +1,12 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <vector>
 #include <benchmark/benchmark.h>
 #include <rect.h>
 #include <bitmap.h>
 #include <pixel_format.h>
 #include <transform.h>
+#include <bitmap_tone.h>
 
 constexpr auto opacity_100 = Opacity::Opaque();
 constexpr auto opacity_0 = Opacity(0);
@@ -278,6 +280,42 @@ static void BM_ToneBlit(benchmark::State& state) {
 
 BENCHMARK(BM_ToneBlit);
 
+static void BM_ToneBlitMode(benchmark::State& state, Tone tone, bool check_alpha) {
+	Bitmap::SetFormat(format);
+	auto dest = Bitmap::Create(320, 240);
+	auto src = Bitmap::Create(320, 240);
+	auto rect = src->GetRect();
+	dest->Fill(Color(40, 80, 160, 255));
+	for (auto _: state) {
+		// tone the bitmap in place, like the tilemap and Game_Screen tint do
+		dest->ToneBlit(0, 0, *dest, rect, tone, opacity, check_alpha);
+	}
+	state.SetLabel(BitmapTone::GetKernelName());
+}
+
+BENCHMARK_CAPTURE(BM_ToneBlitMode, Color, Tone(255,128,0,128), false);
+BENCHMARK_CAPTURE(BM_ToneBlitMode, Gray, Tone(128,128,128,0), false);
+BENCHMARK_CAPTURE(BM_ToneBlitMode, Saturate, Tone(128,128,128,255), false);
+BENCHMARK_CAPTURE(BM_ToneBlitMode, GrayColor, Tone(200,100,50,60), false);
+BENCHMARK_CAPTURE(BM_ToneBlitMode, GrayColorCheckAlpha, Tone(200,100,50,60), true);
+
+static void BM_ToneKernel(benchmark::State& state, bool scalar) {
+	std::vector<uint32_t> pixels(320 * 240, 0xFF336699u);
+	auto params = BitmapTone::MakeParams(Tone(200,100,50,60), true, 0, 8, 16, 24);
+	for (auto _: state) {
+		if (scalar) {
+			BitmapTone::ApplyScalar(pixels.data(), pixels.size(), params);
+		} else {
+			BitmapTone::Apply(pixels.data(), pixels.size(), params);
+		}
+		benchmark::DoNotOptimize(pixels.data());
+	}
+	state.SetLabel(scalar ? "scalar" : BitmapTone::GetKernelName());
+}
+
+BENCHMARK_CAPTURE(BM_ToneKernel, Scalar, true);
+BENCHMARK_CAPTURE(BM_ToneKernel, Dispatched, false);
+
 static void BM_BlendBlit(benchmark::State& state) {
 	Bitmap::SetFormat(format);
 	auto dest = Bitmap::Create(320, 240);
@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fmt/core.h>
+#include "filefinder.h"
+#include "filesystem.h"
+
+namespace {
+	constexpr int num_dirs = 64;
+	constexpr int files_per_dir = 400;
+	const std::string zip_path = "bench_filesystem_zip.zip";
+
+	void Put(std::vector<char>& out, uint32_t value, int bytes) {
+		for (int i = 0; i < bytes; ++i) {
+			out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+		}
+	}
+
+	// Only the fields read by ZipFilesystem are filled, all files are empty
+	void WriteZip() {
+		std::vector<std::string> names;
+		for (int d = 0; d < num_dirs; ++d) {
+			names.push_back(fmt::format("Folder{}/", d));
+			for (int f = 0; f < files_per_dir; ++f) {
+				names.push_back(fmt::format("Folder{}/file{}.png", d, f));
+			}
+		}
+
+		std::vector<char> data;
+		std::vector<char> central;
+		for (const auto& name : names) {
+			uint32_t offset = data.size();
+			Put(data, 0x04034b50, 4);
+			Put(data, 0, 22);
+			Put(data, name.size(), 2);
+			Put(data, 0, 2);
+			data.insert(data.end(), name.begin(), name.end());
+
+			Put(central, 0x02014b50, 4);
+			Put(central, 0, 4);
+			Put(central, 0x800, 2);
+			Put(central, 0, 18);
+			Put(central, name.size(), 2);
+			Put(central, 0, 12);
+			Put(central, offset, 4);
+			central.insert(central.end(), name.begin(), name.end());
+		}
+
+		uint32_t central_offset = data.size();
+		data.insert(data.end(), central.begin(), central.end());
+		Put(data, 0x06054b50, 4);
+		Put(data, 0, 6);
+		Put(data, names.size(), 2);
+		Put(data, central.size(), 4);
+		Put(data, central_offset, 4);
+		Put(data, 0, 2);
+
+		std::ofstream(zip_path, std::ios::binary).write(data.data(), data.size());
+	}
+}
+
+// Mounting the archive and listing all folders, like the game browser and FileFinder do at startup
+static void BM_ZipMountAndList(benchmark::State& state) {
+	WriteZip();
+
+	for (auto _: state) {
+		auto fs = FileFinder::Root().Create(zip_path);
+		for (int d = 0; d < num_dirs; ++d) {
+			benchmark::DoNotOptimize(fs.ListDirectory(fmt::format("Folder{}", d)));
+		}
+	}
+
+	std::remove(zip_path.c_str());
+}
+
+BENCHMARK(BM_ZipMountAndList);
+
+BENCHMARK_MAIN();
@@ -53,4 +53,34 @@ static void BM_Render(benchmark::State& state) {
 
 BENCHMARK(BM_Render);
 
+// Cycles through more distinct CJK glyphs than a text box shows, range(0) is the number of glyphs
+static void BM_GlyphCJK(benchmark::State& state) {
+	auto font = Font::Default();
+	const int count = state.range(0);
+	int i = 0;
+	for (auto _: state) {
+		auto bm = font->Glyph(U'\u4E00' + i);
+		(void)bm;
+		i = (i + 1) % count;
+	}
+}
+
+BENCHMARK(BM_GlyphCJK)->Arg(64)->Arg(512)->Arg(4096);
+
+static void BM_RenderStr(benchmark::State& state) {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	auto surface = Bitmap::Create(width, height);
+	auto system = Cache::SystemOrBlack();
+
+	auto font = Font::Default();
+	for (auto _: state) {
+		int x = 0;
+		for (char32_t ch: text) {
+			x += font->Render(*surface, x, 0, *system, 0, ch).width;
+		}
+	}
+}
+
+BENCHMARK(BM_RenderStr);
+
 BENCHMARK_MAIN();
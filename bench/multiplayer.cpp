@@ -0,0 +1,417 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+#include <lcf/data.h>
+#include "bitmap.h"
+#include "drawable_list.h"
+#include "drawable_mgr.h"
+#include "game_actors.h"
+#include "game_map.h"
+#include "game_party.h"
+#include "game_pictures.h"
+#include "game_player.h"
+#include "game_screen.h"
+#include "game_switches.h"
+#include "game_system.h"
+#include "game_variables.h"
+#include "main_data.h"
+#include "output.h"
+#include "spriteset_map.h"
+#include "game_multiplayer_connection.h"
+#include "game_multiplayer_interest.h"
+#include "game_multiplayer_main_loop.h"
+#include "game_multiplayer_nametags.h"
+#include "game_multiplayer_other_player.h"
+#include "game_multiplayer_protocol.h"
+#include "game_multiplayer_senders.h"
+#include "game_multiplayer_transport_loopback.h"
+
+/*
+	Headless multiplayer load test.
+
+	A loopback server stands in for the game server and feeds objectSync streams for N other
+	players into the real client code. Every benchmark iteration is one frame like Scene_Map runs it:
+	server packets -> PollConnection -> Game_Multiplayer::Update -> Spriteset_Map::Update
+	-> map (tilemap, characters, other players) and nametags drawn.
+
+	Reported counters:
+	- p50/p95/p99/max: frame time in microseconds
+	- draw_p50/draw_p95: time of the draw part of the frame in microseconds
+	- allocs/frame: operator new calls per frame
+	- sent/frame: frames the client wrote to the server
+
+	Set MP_BENCH_REPLAY to a recording to replay it instead of the synthetic stream.
+	The recording holds one json packet per line, an empty line ends a frame.
+
+	Runs natively, no browser or server needed:
+	cmake -DPLAYER_ENABLE_BENCHMARKS=ON, build bench_multiplayer and run it.
+*/
+
+static std::atomic<uint64_t> num_allocs { 0 };
+
+void* operator new(std::size_t size) {
+	++num_allocs;
+	if (void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+namespace {
+
+constexpr int map_width = 40;
+constexpr int map_height = 30;
+
+// Minimal game state, enough for Game_Map, the main player and the other players
+class BenchGame {
+public:
+	BenchGame() {
+		Output::SetLogLevel(LogLevel::Error);
+
+		lcf::Data::terrains.push_back({});
+		lcf::rpg::Chipset chipset;
+		chipset.passable_data_lower.resize(162, 0xF);
+		chipset.passable_data_upper.resize(162, 0xF);
+		chipset.terrain_data.resize(144, 1);
+		lcf::Data::chipsets.push_back(chipset);
+
+		lcf::Data::treemap = {};
+		lcf::Data::treemap.maps.push_back(lcf::rpg::MapInfo());
+		lcf::Data::treemap.maps.back().type = lcf::rpg::TreeMap::MapType_root;
+		lcf::Data::treemap.maps.push_back(lcf::rpg::MapInfo());
+		lcf::Data::treemap.maps.back().ID = 1;
+		lcf::Data::treemap.maps.back().type = lcf::rpg::TreeMap::MapType_map;
+
+		Main_Data::game_actors = std::make_unique<Game_Actors>();
+		Main_Data::game_party = std::make_unique<Game_Party>();
+		Game_Map::Init();
+		Main_Data::game_system = std::make_unique<Game_System>();
+		Main_Data::game_switches = std::make_unique<Game_Switches>();
+		Main_Data::game_variables = std::make_unique<Game_Variables>(Game_Variables::min_2k3, Game_Variables::max_2k3);
+		Main_Data::game_pictures = std::make_unique<Game_Pictures>();
+		Main_Data::game_screen = std::make_unique<Game_Screen>();
+		Main_Data::game_player = std::make_unique<Game_Player>();
+		Main_Data::game_player->SetMapId(1);
+
+		auto map = std::make_unique<lcf::rpg::Map>();
+		map->width = map_width;
+		map->height = map_height;
+		map->lower_layer.resize(map_width * map_height, BLOCK_E);
+		map->upper_layer.resize(map_width * map_height, BLOCK_F);
+		Game_Map::Setup(std::move(map));
+
+		DrawableMgr::SetLocalList(&drawables);
+		spriteset = std::make_unique<Spriteset_Map>();
+	}
+
+	~BenchGame() {
+		DrawableMgr::SetLocalList(&drawables);
+		spriteset.reset();
+		Game_Multiplayer::Disconnect();
+		Game_Multiplayer::ClearPlayers();
+		nameTagRenderer.reset();
+		DrawableMgr::SetLocalList(nullptr);
+
+		Main_Data::game_switches = {};
+		Main_Data::game_variables = {};
+		Main_Data::game_player = {};
+		Main_Data::game_screen = {};
+		Main_Data::game_pictures = {};
+		Game_Map::Quit();
+		lcf::Data::data = {};
+		Main_Data::game_party.reset();
+	}
+
+	// Draws the map, the other players and the nametags like Scene_Map, they are all in the local list
+	void Draw(Bitmap& dst) {
+		if (spriteset->RequireClear(drawables)) {
+			dst.Clear();
+		}
+		drawables.Draw(dst);
+	}
+
+	DrawableList drawables;
+	std::unique_ptr<Spriteset_Map> spriteset;
+};
+
+// Local stand-in for the game server
+class BenchServer {
+public:
+	BenchServer(int num_players, bool binary) : num_players(num_players), binary(binary) {
+		if (const char* path = std::getenv("MP_BENCH_REPLAY")) {
+			LoadReplay(path);
+		}
+	}
+
+	// Connects the client and runs the handshake
+	void Start() {
+		Game_Multiplayer::ConnectionData::host = "loopback://bench";
+		Game_Multiplayer::ConnectToGame();
+		conn = listener.Accept();
+
+		if (binary) {
+			std::vector<uint8_t> frame;
+			Game_Multiplayer::Protocol::Writer w(frame);
+			w.WriteByte(Game_Multiplayer::Protocol::MessageTypes::hello);
+			w.WriteVarint(Game_Multiplayer::Protocol::version);
+			w.WriteVarint(Game_Multiplayer::Protocol::Features::supported);
+			conn->Send(frame.data(), frame.size());
+
+			for (int i = 0; i < num_players; ++i) {
+				frame.clear();
+				Game_Multiplayer::Protocol::EncodeUidIntern(frame, i + 1, Uid(i));
+				conn->Send(frame.data(), frame.size());
+			}
+		}
+		Game_Multiplayer::PollConnection();
+	}
+
+	// Sends the packets of one frame and drops whatever the client sent
+	void SendFrame() {
+		if (!replay.empty()) {
+			SendReplayFrame();
+		} else if (binary) {
+			SendBinaryFrame();
+		} else {
+			SendJsonFrame();
+		}
+		++frame_count;
+
+		Game_Multiplayer::Transport::Event ev;
+		while (conn->Poll(ev)) {
+			if (ev.type == Game_Multiplayer::Transport::Event::Type::Message) {
+				++received;
+			}
+		}
+	}
+
+	uint64_t received = 0;
+
+private:
+	static std::string Uid(int i) {
+		return "player" + std::to_string(i);
+	}
+
+	// Every player walks a small square and changes facing, names are sent once
+	void FillSync(int i, Game_Multiplayer::Protocol::ObjectSync& sync) {
+		using namespace Game_Multiplayer::Protocol;
+		sync.Clear();
+
+		int step = (frame_count + i) % 16;
+		int x = (i * 3) % map_width + (step < 8 ? step / 2 : 0);
+		int y = (i * 7) % map_height + (step >= 8 ? (step - 8) / 2 : 0);
+		sync.AddPosition(x, y);
+		sync.Set(Fields::pos);
+		sync.facing = (step / 4) + 1;
+		sync.Set(Fields::facing);
+
+		if (frame_count == 0) {
+			name = Uid(i);
+			sync.name = name;
+			sync.Set(Fields::name);
+			sync.sprite_sheet = "bench";
+			sync.sprite_id = i % 8;
+			sync.Set(Fields::sprite);
+		}
+	}
+
+	void SendBinaryFrame() {
+		Game_Multiplayer::Protocol::ObjectSync sync;
+		for (int i = 0; i < num_players; ++i) {
+			FillSync(i, sync);
+			frame.clear();
+			Game_Multiplayer::Protocol::EncodeObjectSync(frame, i + 1, sync);
+			conn->Send(frame.data(), frame.size());
+		}
+	}
+
+	void SendJsonFrame() {
+		Game_Multiplayer::Protocol::ObjectSync sync;
+		for (int i = 0; i < num_players; ++i) {
+			FillSync(i, sync);
+			json = "{\"type\":\"objectSync\",\"uid\":\"" + Uid(i) + "\",\"pos\":{\"x\":" + std::to_string(sync.path[0].x)
+				+ ",\"y\":" + std::to_string(sync.path[0].y) + "},\"facing\":" + std::to_string(sync.facing);
+			if (frame_count == 0) {
+				json += ",\"name\":\"" + Uid(i) + "\",\"sprite\":{\"sheet\":\"bench\",\"id\":" + std::to_string(sync.sprite_id) + "}";
+			}
+			json += "}";
+			SendText(json);
+		}
+	}
+
+	void SendReplayFrame() {
+		for (auto& packet : replay[frame_count % replay.size()]) {
+			SendText(packet);
+		}
+	}
+
+	void SendText(const std::string& text) {
+		static_cast<Game_Multiplayer::LoopbackTransport&>(*conn).SendText(text.data(), text.size());
+	}
+
+	void LoadReplay(const char* path) {
+		std::ifstream in(path);
+		if (!in) {
+			Output::Error("Cannot open replay {}", path);
+		}
+		replay.emplace_back();
+		for (std::string line; std::getline(in, line);) {
+			if (line.empty()) {
+				if (!replay.back().empty()) {
+					replay.emplace_back();
+				}
+			} else {
+				replay.back().push_back(line);
+			}
+		}
+		if (replay.back().empty()) {
+			replay.pop_back();
+		}
+	}
+
+	Game_Multiplayer::LoopbackListener listener { "bench" };
+	std::unique_ptr<Game_Multiplayer::Transport> conn;
+	int num_players;
+	bool binary;
+	int frame_count = 0;
+
+	std::vector<uint8_t> frame;
+	std::string json;
+	std::string name;
+	std::vector<std::vector<std::string>> replay;
+};
+
+double Percentile(std::vector<double>& v, double p) {
+	if (v.empty()) {
+		return 0.0;
+	}
+	size_t i = std::min(v.size() - 1, static_cast<size_t>(p * v.size()));
+	std::nth_element(v.begin(), v.begin() + i, v.end());
+	return v[i];
+}
+
+void RunFrames(benchmark::State& state, bool binary) {
+	BenchGame game;
+	BenchServer server(state.range(0), binary);
+	server.Start();
+
+	auto screen = Bitmap::Create(320, 240, false);
+	std::vector<double> frame_us;
+	std::vector<double> draw_us;
+	uint64_t allocs = 0;
+
+	for (auto _: state) {
+		auto start = std::chrono::steady_clock::now();
+		auto allocs_before = num_allocs.load();
+
+		server.SendFrame();
+		Game_Multiplayer::PollConnection();
+		Game_Multiplayer::Update();
+		game.spriteset->Update();
+
+		auto draw_start = std::chrono::steady_clock::now();
+		game.Draw(*screen);
+		auto end = std::chrono::steady_clock::now();
+		Main_Data::game_system->IncFrameCounter();
+
+		allocs += num_allocs.load() - allocs_before;
+		frame_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+		draw_us.push_back(std::chrono::duration<double, std::micro>(end - draw_start).count());
+	}
+
+	state.counters["p50"] = Percentile(frame_us, 0.50);
+	state.counters["p95"] = Percentile(frame_us, 0.95);
+	state.counters["p99"] = Percentile(frame_us, 0.99);
+	state.counters["max"] = frame_us.empty() ? 0.0 : *std::max_element(frame_us.begin(), frame_us.end());
+	state.counters["draw_p50"] = Percentile(draw_us, 0.50);
+	state.counters["draw_p95"] = Percentile(draw_us, 0.95);
+	state.counters["allocs/frame"] = benchmark::Counter(allocs, benchmark::Counter::kAvgIterations);
+	state.counters["sent/frame"] = benchmark::Counter(server.received, benchmark::Counter::kAvgIterations);
+	state.counters["players"] = Game_Multiplayer::other_players.size();
+	state.counters["active"] = Game_Multiplayer::GetInterestStats().active;
+}
+
+} // namespace
+
+static void BM_MultiplayerFrameBinary(benchmark::State& state) {
+	RunFrames(state, true);
+}
+
+BENCHMARK(BM_MultiplayerFrameBinary)->Arg(50)->Arg(100)->Arg(200);
+
+static void BM_MultiplayerFrameJson(benchmark::State& state) {
+	RunFrames(state, false);
+}
+
+BENCHMARK(BM_MultiplayerFrameJson)->Arg(50)->Arg(100)->Arg(200);
+
+// Event AI: every event looks for the closest player on each move decision
+template <typename F>
+static void BM_ClosestPlayerOp(benchmark::State& state, F&& closest) {
+	constexpr int num_events = 200;
+
+	BenchGame game;
+	if (!nameTagRenderer) {
+		nameTagRenderer = std::make_unique<DrawableNameTags>();
+	}
+
+	std::vector<std::pair<int,int>> events;
+	for (int i = 0; i < num_events; ++i) {
+		events.emplace_back((i * 13) % map_width, (i * 17) % map_height);
+	}
+	for (int i = 0; i < state.range(0); ++i) {
+		auto handle = Game_Multiplayer::GetPlayerOrCreate("player" + std::to_string(i));
+		Game_Multiplayer::SetPlayerPosition(Game_Multiplayer::other_players.DenseIndex(handle), (i * 7) % map_width, (i * 11) % map_height);
+	}
+
+	int x = 0, y = 0;
+	for (auto _: state) {
+		for (auto& ev : events) {
+			closest(ev.first, ev.second, x, y);
+		}
+		benchmark::DoNotOptimize(x + y);
+	}
+	state.SetItemsProcessed(state.iterations() * num_events);
+}
+
+static void BM_ClosestPlayerGrid(benchmark::State& state) {
+	BM_ClosestPlayerOp(state, Game_Multiplayer::GetClosestPlayerCoords);
+}
+
+BENCHMARK(BM_ClosestPlayerGrid)->Arg(100)->Arg(200);
+
+// The linear scan GetClosestPlayerCoords did before the grid, for comparison
+static void BM_ClosestPlayerLinear(benchmark::State& state) {
+	BM_ClosestPlayerOp(state, [](int x, int y, int& outx, int& outy) {
+		const auto& grid = Game_Multiplayer::player_grid;
+		int best = grid.Distance(x, y, Main_Data::game_player->GetX(), Main_Data::game_player->GetY());
+		outx = Main_Data::game_player->GetX();
+		outy = Main_Data::game_player->GetY();
+		for (auto& p : Game_Multiplayer::other_players.Positions()) {
+			int d = grid.Distance(x, y, p.x, p.y);
+			if (d < best) {
+				best = d;
+				outx = p.x;
+				outy = p.y;
+			}
+		}
+	});
+}
+
+BENCHMARK(BM_ClosestPlayerLinear)->Arg(100)->Arg(200);
+
+BENCHMARK_MAIN();
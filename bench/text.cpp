@@ -36,6 +36,20 @@ static void BM_TextDrawStrColor(benchmark::State& state) {
 
 BENCHMARK(BM_TextDrawStrColor);
 
+static void BM_TextDrawStrCJK(benchmark::State& state) {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	auto font = Font::Default();
+	auto surface = Bitmap::Create(width, height);
+	auto system = Cache::SysBlack();
+	const std::string cjk_text = "アレックスの攻撃！スライムに大ダメージを与えた！";
+
+	for (auto _: state) {
+		Text::Draw(*surface, 0, 0, *font, *system, 0, cjk_text, Text::AlignLeft);
+	}
+}
+
+BENCHMARK(BM_TextDrawStrCJK);
+
 void DrawCharSystemWrap(benchmark::State& state, char32_t ch, bool is_exfont) {
 	Bitmap::SetFormat(format_R8G8B8A8_a().format());
 	auto font = Font::Default();
@@ -261,12 +261,13 @@ void FileRequestAsync::Start() {
 
 	auto it = file_mapping.find(modified_path);
 	if (it != file_mapping.end()) {
-		request_path += it->second;
+		download_path = it->second;
 	} else {
 		// Fall through if not found, will fail in the ajax request
 		Output::Debug("{} not in index.json", modified_path);
-		request_path += path;
+		download_path = path;
 	}
+	request_path += download_path;
 
 	// URL encode %, # and +
 	request_path = Utils::ReplaceAll(request_path, "%", "%25");
@@ -275,7 +276,7 @@ void FileRequestAsync::Start() {
 
 	emscripten_async_wget2(
 		request_path.c_str(),
-		(it != file_mapping.end() ? it->second : path).c_str(),
+		download_path.c_str(),
 		"GET",
 		NULL,
 		this,
@@ -334,6 +335,11 @@ void FileRequestAsync::CallListeners(bool success) {
 }
 
 void FileRequestAsync::DownloadDone(bool success) {
+	if (decoding) {
+		// DecodeDone finishes the request
+		return;
+	}
+
 	if (IsReady()) {
 		// Change to real success state when already finished before
 		success = state == State_DoneSuccess;
@@ -344,11 +350,20 @@ void FileRequestAsync::DownloadDone(bool success) {
 		if (state == State_Pending) {
 			// Update directory structure (new file was added)
 			if (FileFinder::Game()) {
-				FileFinder::Game().ClearCache();
+				FileFinder::Game().AddFileToCache(download_path);
 			}
 		}
 #endif
 
+#if defined(EMSCRIPTEN) || defined(EP_DEBUG_SIMULATE_ASYNC)
+		// Images are decoded in the background before the listeners need them.
+		// With synchronous IO the request must finish in Start, the listeners decode it.
+		if (state == State_Pending && Cache::DecodeAsync(directory, file, [this]() { DecodeDone(); })) {
+			decoding = true;
+			return;
+		}
+#endif
+
 		state = State_DoneSuccess;
 
 		CallListeners(true);
@@ -359,3 +374,10 @@ void FileRequestAsync::DownloadDone(bool success) {
 		CallListeners(false);
 	}
 }
+
+void FileRequestAsync::DecodeDone() {
+	decoding = false;
+	state = State_DoneSuccess;
+
+	CallListeners(true);
+}
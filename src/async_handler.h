@@ -198,6 +198,7 @@ public:
 
 	// don't call these directly
 	void DownloadDone(bool success);
+	void DecodeDone();
 	void UpdateProgress();
 private:
 	void CallListeners(bool success);
@@ -206,9 +207,12 @@ private:
 	std::string directory;
 	std::string file;
 	std::string path;
+	/** Where the downloaded file is stored, the real name from index.json */
+	std::string download_path;
 	int state = State_DoneFailure;
 	bool important = false;
 	bool graphic = false;
+	bool decoding = false;
 };
 
 /**
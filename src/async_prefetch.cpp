@@ -0,0 +1,325 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include "async_prefetch.h"
+#include "async_handler.h"
+#include "filefinder.h"
+#include "game_map.h"
+#include "game_player.h"
+#include "main_data.h"
+#include "player.h"
+#include <lcf/data.h>
+#include <lcf/lmu/reader.h>
+#include <lcf/reader_util.h>
+#include <lcf/rpg/map.h>
+
+namespace {
+	using Cmd = lcf::rpg::EventCommand::Code;
+
+	// Prefetch requests running at the same time
+	constexpr size_t max_requests = 4;
+	// Frames without any pending request before the maps around the player are prefetched
+	constexpr int idle_frames = 120;
+	// Maps prefetched around the current map
+	constexpr size_t max_adjacent_maps = 8;
+
+#ifdef EMSCRIPTEN
+	constexpr bool enabled = true;
+#else
+	// Files are read synchronously when they are needed, nothing to gain
+	constexpr bool enabled = false;
+#endif
+
+	struct Item {
+		AsyncPrefetch::File file;
+		// when set this is the map file, urgent maps queue their files after the download
+		int map_id = 0;
+		// files of a reserved teleport, they are started even when important files are pending
+		bool urgent = false;
+	};
+
+	struct Running {
+		FileRequestAsync* request;
+		int map_id;
+		bool urgent;
+	};
+
+	std::deque<Item> queue;
+	std::vector<Running> running;
+	// maps that were queued once and whether they were urgent, the requests remember their files
+	std::unordered_map<int, bool> prefetched_maps;
+	// the last urgent map, parsed once for the prefetch and handed to Game_Map by TakeMap
+	int parsed_map_id = 0;
+	std::unique_ptr<lcf::rpg::Map> parsed_map;
+	// map whose adjacent maps were queued
+	int idle_map_id = 0;
+	int idle_count = 0;
+
+	void Enqueue(Item item) {
+		if (item.urgent) {
+			queue.push_front(std::move(item));
+		} else {
+			queue.push_back(std::move(item));
+		}
+	}
+
+	void OnMapReady(int map_id, bool urgent) {
+		if (!urgent) {
+			// Only the raw bytes of idle maps are fetched, parsing them and decoding
+			// their graphics would cost main thread time and bitmap cache space for
+			// maps that are maybe never entered
+			return;
+		}
+
+		auto map_file = FileFinder::Game().FindFile(Game_Map::ConstructMapName(map_id, false));
+		if (map_file.empty()) {
+			return;
+		}
+
+		auto map_stream = FileFinder::Game().OpenInputStream(map_file);
+		if (!map_stream) {
+			return;
+		}
+
+		auto map = lcf::LMU_Reader::Load(map_stream, Player::encoding);
+		if (!map) {
+			return;
+		}
+
+		auto files = AsyncPrefetch::CollectMapFiles(map_id, *map);
+		// pushed to the front, keep the order
+		std::reverse(files.begin(), files.end());
+		for (auto& file : files) {
+			Item item;
+			item.file = std::move(file);
+			item.urgent = true;
+			Enqueue(std::move(item));
+		}
+
+		parsed_map_id = map_id;
+		parsed_map = std::move(map);
+	}
+
+	// An idle map becomes urgent when a teleport to it is reserved
+	void PromoteMap(int map_id) {
+		auto queued = std::find_if(queue.begin(), queue.end(), [&](const Item& item) { return item.map_id == map_id; });
+		if (queued != queue.end()) {
+			Item item = std::move(*queued);
+			queue.erase(queued);
+			item.urgent = true;
+			Enqueue(std::move(item));
+			return;
+		}
+
+		auto run = std::find_if(running.begin(), running.end(), [&](const Running& r) { return r.map_id == map_id; });
+		if (run != running.end()) {
+			run->urgent = true;
+			return;
+		}
+
+		// Already downloaded
+		OnMapReady(map_id, true);
+	}
+
+	void QueueMap(int map_id, bool urgent) {
+		if (map_id <= 0) {
+			return;
+		}
+
+		auto it = prefetched_maps.find(map_id);
+		if (it != prefetched_maps.end()) {
+			if (urgent && !it->second) {
+				it->second = true;
+				PromoteMap(map_id);
+			}
+			return;
+		}
+		prefetched_maps[map_id] = urgent;
+
+		Item item;
+		item.file = { ".", Game_Map::ConstructMapName(map_id, false) };
+		item.map_id = map_id;
+		item.urgent = urgent;
+		Enqueue(std::move(item));
+	}
+
+	std::vector<int> CollectTeleportTargets() {
+		std::vector<int> maps;
+		for (auto& ev : Game_Map::GetEvents()) {
+			for (int i = 1; ev.GetPage(i) != nullptr; ++i) {
+				for (auto& com : ev.GetPage(i)->event_commands) {
+					if (static_cast<Cmd>(com.code) != Cmd::Teleport || com.parameters.empty()) {
+						continue;
+					}
+
+					int map_id = com.parameters[0];
+					if (map_id != Game_Map::GetMapId() && std::find(maps.begin(), maps.end(), map_id) == maps.end()) {
+						maps.push_back(map_id);
+					}
+				}
+			}
+		}
+		return maps;
+	}
+
+	void UpdateIdle() {
+		if (!running.empty() || !queue.empty() || Main_Data::game_player->IsPendingTeleport() ||
+				AsyncHandler::IsFilePending(false, false)) {
+			idle_count = 0;
+			return;
+		}
+
+		if (Game_Map::GetMapId() == idle_map_id || ++idle_count < idle_frames) {
+			return;
+		}
+
+		idle_map_id = Game_Map::GetMapId();
+		idle_count = 0;
+
+		auto maps = CollectTeleportTargets();
+		if (maps.size() > max_adjacent_maps) {
+			maps.resize(max_adjacent_maps);
+		}
+		for (int map_id : maps) {
+			QueueMap(map_id, false);
+		}
+	}
+}
+
+std::vector<AsyncPrefetch::File> AsyncPrefetch::CollectMapFiles(int map_id, const lcf::rpg::Map& map) {
+	std::vector<File> files;
+	std::unordered_set<std::string> paths;
+
+	auto add = [&](const char* folder, StringView name) {
+		if (name.empty() || !paths.insert(FileFinder::MakePath(folder, name)).second) {
+			return;
+		}
+		files.push_back({ folder, ToString(name) });
+	};
+
+	auto add_music = [&](StringView name) {
+		// (OFF) means play nothing
+		if (name != "(OFF)") {
+			add("Music", name);
+		}
+	};
+
+	auto* chipset = lcf::ReaderUtil::GetElement(lcf::Data::chipsets, map.chipset_id);
+	if (chipset) {
+		add("ChipSet", chipset->chipset_name);
+	}
+
+	if (map.parallax_flag) {
+		add("Panorama", map.parallax_name);
+	}
+
+	// Same lookup as Game_Map::PlayBgm, maps can inherit the BGM of the parent
+	int index = Game_Map::GetMapIndex(map_id);
+	while (index > 0 && lcf::Data::treemap.maps[index].music_type == 0 &&
+			Game_Map::GetMapIndex(lcf::Data::treemap.maps[index].parent_map) != index) {
+		index = Game_Map::GetMapIndex(lcf::Data::treemap.maps[index].parent_map);
+	}
+	if (index > 0 && lcf::Data::treemap.maps[index].music_type == 2) {
+		add_music(lcf::Data::treemap.maps[index].music.name);
+	}
+
+	for (auto& ev : map.events) {
+		for (auto& page : ev.pages) {
+			add("CharSet", page.character_name);
+
+			for (auto& com : page.event_commands) {
+				switch (static_cast<Cmd>(com.code)) {
+					case Cmd::ShowPicture:
+						add("Picture", com.string);
+						break;
+					case Cmd::PlayBGM:
+						add_music(com.string);
+						break;
+					default:
+						break;
+				}
+			}
+		}
+	}
+
+	return files;
+}
+
+void AsyncPrefetch::PrefetchMap(int map_id) {
+	if (!enabled) {
+		return;
+	}
+
+	QueueMap(map_id, true);
+}
+
+std::unique_ptr<lcf::rpg::Map> AsyncPrefetch::TakeMap(int map_id) {
+	if (map_id != parsed_map_id) {
+		return nullptr;
+	}
+	parsed_map_id = 0;
+	return std::move(parsed_map);
+}
+
+void AsyncPrefetch::Update() {
+	if (!enabled) {
+		return;
+	}
+
+	for (auto it = running.begin(); it != running.end();) {
+		if (!it->request->IsReady()) {
+			++it;
+			continue;
+		}
+
+		Running done = *it;
+		it = running.erase(it);
+		if (done.map_id > 0) {
+			OnMapReady(done.map_id, done.urgent);
+		}
+	}
+
+	bool important_pending = AsyncHandler::IsImportantFilePending();
+
+	while (running.size() < max_requests && !queue.empty()) {
+		if (important_pending && !queue.front().urgent) {
+			// The game waits for a file, don't compete with it
+			break;
+		}
+
+		Item item = std::move(queue.front());
+		queue.pop_front();
+
+		FileRequestAsync* request = AsyncHandler::RequestFile(item.file.folder, item.file.name);
+		if (request->IsReady()) {
+			if (item.map_id > 0) {
+				OnMapReady(item.map_id, item.urgent);
+			}
+			continue;
+		}
+
+		request->Start();
+		running.push_back({ request, item.map_id, item.urgent });
+	}
+
+	UpdateIdle();
+}
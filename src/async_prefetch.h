@@ -0,0 +1,87 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_ASYNC_PREFETCH_H
+#define EP_ASYNC_PREFETCH_H
+
+// Headers
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lcf {
+namespace rpg {
+	class Map;
+}
+}
+
+/**
+ * Downloads the files of maps the player will probably enter before the
+ * transfer requests them, on platforms with asynchronous file requests
+ * (e.g. Emscripten).
+ * Only a few prefetch requests run at the same time and they wait while
+ * the game waits for an important file.
+ * Of the maps around the player only the map files are fetched, the files
+ * used by a map are fetched when a teleport to it is reserved.
+ */
+namespace AsyncPrefetch {
+	/** A file of the game */
+	struct File {
+		/** folder of the file, "." for the game directory */
+		std::string folder;
+		/** name of the file without extension */
+		std::string name;
+	};
+
+	/**
+	 * Collects the files that are requested when the player enters a map:
+	 * Chipset, panorama and BGM of the map and the charsets, pictures and
+	 * BGMs used by the event pages.
+	 *
+	 * @param map_id ID of the map, used to find the BGM in the map tree
+	 * @param map the map
+	 * @return files in the order they are needed, without duplicates
+	 */
+	std::vector<File> CollectMapFiles(int map_id, const lcf::rpg::Map& map);
+
+	/**
+	 * Prefetches a map and its files before the files of other maps,
+	 * e.g. when a teleport to it is reserved.
+	 * A map already queued by the idle prefetch is moved to the front.
+	 *
+	 * @param map_id ID of the map
+	 */
+	void PrefetchMap(int map_id);
+
+	/**
+	 * Hands out the map parsed by PrefetchMap, so the transfer does not
+	 * parse it a second time.
+	 *
+	 * @param map_id ID of the map
+	 * @return the parsed map or nullptr when this map was not parsed
+	 */
+	std::unique_ptr<lcf::rpg::Map> TakeMap(int map_id);
+
+	/**
+	 * Starts queued requests. When the player idles on a map the maps
+	 * reached by the teleports of its events are prefetched.
+	 * Called every frame by Scene_Map.
+	 */
+	void Update();
+}
+
+#endif
@@ -114,6 +114,20 @@ int Background::Scale(int x) {
 	return x > 0 ? x / 64 : -(-x / 64);
 }
 
+bool Background::GetDamageState(DamageState& state) const {
+	state.SetFullScreen();
+	state.Add(bg_bitmap);
+	state.Add(bg_x);
+	state.Add(bg_y);
+	state.Add(fg_bitmap);
+	state.Add(fg_x);
+	state.Add(fg_y);
+	state.Add(tone_effect);
+	state.Add(Main_Data::game_screen->GetShakeOffsetX());
+	state.Add(Main_Data::game_screen->GetShakeOffsetY());
+	return true;
+}
+
 void Background::Draw(Bitmap& dst) {
 	Rect dst_rect = dst.GetRect();
 
@@ -31,6 +31,7 @@ public:
 	Background(int terrain_id);
 
 	void Draw(Bitmap& dst) override;
+	bool GetDamageState(DamageState& state) const override;
 	void Update();
 	Tone GetTone() const;
 	void SetTone(Tone tone);
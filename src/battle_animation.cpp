@@ -90,6 +90,11 @@ void BattleAnimation::OnBattle2SpriteReady(FileRequestResult* result) {
 	SetSrcRect(Rect(0, 0, 0, 0));
 }
 
+bool BattleAnimation::GetDamageState(DamageState&) const {
+	// The cells of the frame are placed while drawing
+	return IsOnlySound();
+}
+
 void BattleAnimation::DrawAt(Bitmap& dst, int x, int y) {
 	if (IsDone()) {
 		return;
@@ -62,6 +62,8 @@ public:
 	/** @return true if the animation only plays audio and doesn't display **/
 	bool IsOnlySound() const;
 
+	bool GetDamageState(DamageState& state) const override;
+
 	/**
 	 * @return the animation cell width
 	 */
@@ -39,6 +39,7 @@
 #include "output.h"
 #include "util_macro.h"
 #include "bitmap_hslrgb.h"
+#include "bitmap_tone.h"
 #include <iostream>
 
 BitmapRef Bitmap::Create(int width, int height, const Color& color) {
@@ -48,6 +49,16 @@ BitmapRef Bitmap::Create(int width, int height, const Color& color) {
 }
 
 BitmapRef Bitmap::Create(Filesystem_Stream::InputStream stream, bool transparent, uint32_t flags) {
+	auto memory = stream.GetMemory();
+	if (!memory.empty()) {
+		// e.g. uncompressed files of a mapped archive, decoded without copying them
+		BitmapRef bmp = Create(memory.data(), memory.size(), transparent, flags);
+		if (bmp) {
+			bmp->filename = ToString(stream.GetName());
+		}
+		return bmp;
+	}
+
 	BitmapRef bmp = std::make_shared<Bitmap>(std::move(stream), transparent, flags);
 
 	if (!bmp->pixels()) {
@@ -148,7 +159,7 @@ Bitmap::Bitmap(const uint8_t* data, unsigned bytes, bool transparent, uint32_t f
 	else if (bytes > 2 && strncmp((char*) data, "BM", 2) == 0)
 		img_okay = ImageBMP::ReadBMP(data, bytes, transparent, w, h, pixels);
 	else if (bytes > 4 && strncmp((char*)(data + 1), "PNG", 3) == 0)
-		img_okay = ImagePNG::ReadPNG((const void*) data, transparent, w, h, pixels);
+		img_okay = ImagePNG::ReadPNG((const void*) data, bytes, transparent, w, h, pixels);
 	else
 		Output::Warning("Unsupported image (Magic: {:02X})", bytes >= 4 ? *reinterpret_cast<const uint32_t*>(data) : 0);
 
@@ -296,8 +307,16 @@ void Bitmap::HueChangeBlit(int x, int y, Bitmap const& src, Rect const& src_rect
 	Bitmap bmp(reinterpret_cast<void*>(&pixels.front()), src_rect.width, src_rect.height, src_rect.width * 4, format);
 	bmp.Blit(0, 0, src, src_rect, Opacity::Opaque());
 
+	// Graphics repeat colors a lot, so the result of the last converted pixel is reused.
+	// 0 is transparent and stays unchanged, which makes it a valid start value.
+	uint32_t last_in = 0;
+	uint32_t last_out = 0;
 	for (std::vector<uint32_t>::iterator p = pixels.begin(); p != pixels.end(); ++p) {
 		uint32_t pixel = *p;
+		if (pixel == last_in) {
+			*p = last_out;
+			continue;
+		}
 		uint8_t r = (pixel>>24) & 0xFF;
 		uint8_t g = (pixel>>16) & 0xFF;
 		uint8_t b = (pixel>> 8) & 0xFF;
@@ -305,6 +324,8 @@ void Bitmap::HueChangeBlit(int x, int y, Bitmap const& src, Rect const& src_rect
 		if (a > 0)
 			RGB_adjust_HSL(r, g, b, hue);
 		*p = ((uint32_t) r << 24) | ((uint32_t) g << 16) | ((uint32_t) b << 8) | (uint32_t) a;
+		last_in = pixel;
+		last_out = *p;
 	}
 
 	Blit(dst_rect.x, dst_rect.y, bmp, bmp.GetRect(), Opacity::Opaque());
@@ -495,6 +516,56 @@ void Bitmap::Init(int width, int height, void* data, int pitch, bool destroy) {
 		pixman_image_set_destroy_function(bitmap.get(), destroy_func, data);
 }
 
+bool Bitmap::SharePixels(Bitmap& source) {
+	if (&source == this || (shared_pixels && shared_pixels == source.shared_pixels)) {
+		return true;
+	}
+
+	// 8 bit images point to the palette of their bitmap
+	if (!bitmap || !source.bitmap || format.bits == 8 || pixman_format != source.pixman_format ||
+			width() != source.width() || height() != source.height() || pitch() != source.pitch()) {
+		return false;
+	}
+
+	shared_pixels = source.GetPixelsOwner().lock();
+
+	// Every bitmap keeps its own image, the clip is not shared
+	Init(width(), height(), source.pixels(), pitch(), false);
+	if (!clip_rects.empty()) {
+		SetClipRects(clip_rects);
+	}
+	return true;
+}
+
+std::weak_ptr<pixman_image_t> Bitmap::GetPixelsOwner() {
+	if (!shared_pixels && bitmap) {
+		shared_pixels.reset(pixman_image_ref(bitmap.get()), pixman_image_unref);
+	}
+	return shared_pixels;
+}
+
+void Bitmap::Unshare() {
+	// The last bitmap using the pixels only keeps them when they belong to its image
+	if (shared_pixels.use_count() > 1 || shared_pixels.get() != bitmap.get()) {
+		const int w = width();
+		const int h = height();
+		const int src_pitch = pitch();
+		auto* src = static_cast<const uint8_t*>(pixels());
+
+		Init(w, h, nullptr, src_pitch);
+		auto* dst = static_cast<uint8_t*>(pixels());
+		for (int y = 0; y < h; ++y) {
+			memcpy(dst + y * pitch(), src + y * src_pitch, w * format.bytes);
+		}
+
+		if (!clip_rects.empty()) {
+			SetClipRects(clip_rects);
+		}
+	}
+
+	shared_pixels.reset();
+}
+
 void Bitmap::ConvertImage(int& width, int& height, void*& pixels, bool transparent) {
 	const DynamicFormat& img_format = transparent ? image_format : opaque_image_format;
 
@@ -572,6 +643,8 @@ namespace {
 } // anonymous namespace
 
 void Bitmap::Blit(int x, int y, Bitmap const& src, Rect const& src_rect, Opacity const& opacity, Bitmap::BlendMode blend_mode) {
+	BeginWrite();
+
 	if (opacity.IsTransparent()) {
 		return;
 	}
@@ -588,6 +661,8 @@ void Bitmap::Blit(int x, int y, Bitmap const& src, Rect const& src_rect, Opacity
 }
 
 void Bitmap::BlitFast(int x, int y, Bitmap const & src, Rect const & src_rect, Opacity const & opacity) {
+	BeginWrite();
+
 	if (opacity.IsTransparent()) {
 		return;
 	}
@@ -612,6 +687,8 @@ void Bitmap::TiledBlit(Rect const& src_rect, Bitmap const& src, Rect const& dst_
 }
 
 void Bitmap::TiledBlit(int ox, int oy, Rect const& src_rect, Bitmap const& src, Rect const& dst_rect, Opacity const& opacity, Bitmap::BlendMode blend_mode) {
+	BeginWrite();
+
 	if (opacity.IsTransparent()) {
 		return;
 	}
@@ -640,6 +717,8 @@ void Bitmap::StretchBlit(Bitmap const&  src, Rect const& src_rect, Opacity const
 }
 
 void Bitmap::StretchBlit(Rect const& dst_rect, Bitmap const& src, Rect const& src_rect, Opacity const& opacity, Bitmap::BlendMode blend_mode) {
+	BeginWrite();
+
 	if (opacity.IsTransparent()) {
 		return;
 	}
@@ -664,6 +743,8 @@ void Bitmap::StretchBlit(Rect const& dst_rect, Bitmap const& src, Rect const& sr
 }
 
 void Bitmap::WaverBlit(int x, int y, double zoom_x, double zoom_y, Bitmap const& src, Rect const& src_rect, int depth, double phase, Opacity const& opacity, Bitmap::BlendMode blend_mode) {
+	BeginWrite();
+
 	if (opacity.IsTransparent()) {
 		return;
 	}
@@ -709,6 +790,8 @@ static pixman_color_t PixmanColor(const Color &color) {
 }
 
 void Bitmap::Fill(const Color &color) {
+	BeginWrite();
+
 	pixman_color_t pcolor = PixmanColor(color);
 
 	pixman_box32_t box = { 0, 0, width(), height() };
@@ -717,6 +800,8 @@ void Bitmap::Fill(const Color &color) {
 }
 
 void Bitmap::FillRect(Rect const& dst_rect, const Color &color) {
+	BeginWrite();
+
 	pixman_color_t pcolor = PixmanColor(color);
 
 	auto timage = PixmanImagePtr{pixman_image_create_solid_fill(&pcolor)};
@@ -735,10 +820,39 @@ void Bitmap::Clear() {
 		return;
 	}
 
+	if (!clip_rects.empty()) {
+		ClearRect(GetRect());
+		return;
+	}
+
+	BeginWrite();
+
 	memset(pixels(), '\0', height() * pitch());
 }
 
+void Bitmap::SetClipRects(const std::vector<Rect>& rects) {
+	clip_rects = rects;
+
+	if (clip_rects.empty()) {
+		pixman_image_set_clip_region32(bitmap.get(), nullptr);
+		return;
+	}
+
+	std::vector<pixman_box32_t> boxes;
+	boxes.reserve(clip_rects.size());
+	for (auto& rect : clip_rects) {
+		boxes.push_back({ rect.x, rect.y, rect.x + rect.width, rect.y + rect.height });
+	}
+
+	pixman_region32_t region;
+	pixman_region32_init_rects(&region, boxes.data(), boxes.size());
+	pixman_image_set_clip_region32(bitmap.get(), &region);
+	pixman_region32_fini(&region);
+}
+
 void Bitmap::ClearRect(Rect const& dst_rect) {
+	BeginWrite();
+
 	pixman_color_t pcolor = {};
 	pixman_box32_t box = {
 		dst_rect.x,
@@ -750,61 +864,9 @@ void Bitmap::ClearRect(Rect const& dst_rect) {
 	pixman_image_fill_boxes(PIXMAN_OP_CLEAR, bitmap.get(), &pcolor, 1, &box);
 }
 
-// Hard light lookup table mapping source color to destination color
-// FIXME: Replace this with std::array<std::array<uint8_t,256>,256> when we have C++17
-struct HardLightTable {
-	uint8_t table[256][256] = {};
-};
-
-static constexpr HardLightTable make_hard_light_lookup() {
-	HardLightTable hl;
-	for (int i = 0; i < 256; ++i) {
-		for (int j = 0; j < 256; ++j) {
-			int res = 0;
-			if (i <= 128)
-				res = (2 * i * j) / 255;
-			else
-				res = 255 - 2 * (255 - i) * (255 - j) / 255;
-			hl.table[i][j] = res > 255 ? 255 : res < 0 ? 0 : res;
-		}
-	}
-	return hl;
-}
-
-constexpr auto hard_light = make_hard_light_lookup();
-
-// Saturation Tone Inline: Changes a pixel saturation
-static inline void saturation_tone(uint32_t &src_pixel, int saturation, int rs, int gs, int bs, int as) {
-	// Algorithm from OpenPDN (MIT license)
-	// Transformation in Y'CbCr color space
-	uint8_t r = (src_pixel >> rs) & 0xFF;
-	uint8_t g = (src_pixel >> gs) & 0xFF;
-	uint8_t b = (src_pixel >> bs) & 0xFF;
-	uint8_t a = (src_pixel >> as) & 0xFF;
-
-	// Y' = 0.299 R' + 0.587 G' + 0.114 B'
-	uint8_t lum = (7471 * b + 38470 * g + 19595 * r) >> 16;
-
-	// Scale Cb/Cr by scale factor "sat"
-	int red = ((lum * 1024 + (r - lum) * saturation) >> 10);
-	red = red > 255 ? 255 : red < 0 ? 0 : red;
-	int green = ((lum * 1024 + (g - lum) * saturation) >> 10);
-	green = green > 255 ? 255 : green < 0 ? 0 : green;
-	int blue = ((lum * 1024 + (b - lum) * saturation) >> 10);
-	blue = blue > 255 ? 255 : blue < 0 ? 0 : blue;
-
-	src_pixel = ((uint32_t)red << rs) | ((uint32_t)green << gs) | ((uint32_t)blue << bs) | ((uint32_t)a << as);
-}
-
-// Color Tone Inline: Changes color of a pixel by hard light table
-static inline void color_tone(uint32_t &src_pixel, Tone tone, int rs, int gs, int bs, int as) {
-	src_pixel = ((uint32_t)hard_light.table[tone.red][(src_pixel >> rs) & 0xFF] << rs)
-		| ((uint32_t)hard_light.table[tone.green][(src_pixel >> gs) & 0xFF] << gs)
-		| ((uint32_t)hard_light.table[tone.blue][(src_pixel >> bs) & 0xFF] << bs)
-		| ((uint32_t)((src_pixel >> as) & 0xFF) << as);
-}
-
 void Bitmap::ToneBlit(int x, int y, Bitmap const& src, Rect const& src_rect, const Tone &tone, Opacity const& opacity, bool check_alpha) {
+	BeginWrite();
+
 	if (opacity.IsTransparent()) {
 		return;
 	}
@@ -829,96 +891,42 @@ void Bitmap::ToneBlit(int x, int y, Bitmap const& src, Rect const& src_rect, con
 		x, y,
 		src_rect.width, src_rect.height);
 
-	int as = pixel_format.a.shift;
-	int rs = pixel_format.r.shift;
-	int gs = pixel_format.g.shift;
-	int bs = pixel_format.b.shift;
-	int next_row = pitch() / sizeof(uint32_t);
-	uint32_t* pixels = (uint32_t*)this->pixels();
-	pixels = pixels + (y - 1) * next_row + x;
-
-	uint16_t limit_height = std::min<uint16_t>(src_rect.height, height());
-	uint16_t limit_width = std::min<uint16_t>(src_rect.width, width());
-
-	// If Saturation + Color:
-	if (tone.gray != 128 && (tone.red != 128 || tone.green != 128 || tone.blue != 128)) {
-		int sat = tone.gray > 128 ? 1024 + (tone.gray - 128) * 16 : tone.gray * 8;
-
-		if (&src != this || check_alpha) {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					if ((uint8_t)((pixels[j] >> as) & 0xFF) == 0)
-						continue;
-
-					saturation_tone(pixels[j], sat, rs, gs, bs, as);
-					color_tone(pixels[j], tone, rs, gs, bs, as);
-				}
-			}
-		}
-		else {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					saturation_tone(pixels[j], sat, rs, gs, bs, as);
-					color_tone(pixels[j], tone, rs, gs, bs, as);
-				}
-			}
-		}
+	auto params = BitmapTone::MakeParams(tone, &src != this || check_alpha,
+		pixel_format.r.shift, pixel_format.g.shift, pixel_format.b.shift, pixel_format.a.shift);
+	if (!params.saturation && !params.color) {
+		return;
 	}
 
-	// If Only Saturation:
-	else if (tone.gray != 128) {
-		int sat = tone.gray > 128 ? 1024 + (tone.gray - 128) * 16 : tone.gray * 8;
+	int next_row = pitch() / sizeof(uint32_t);
 
-		if (&src != this || check_alpha) {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					if ((uint8_t)((pixels[j] >> as) & 0xFF) == 0)
-						continue;
+	auto apply = [&](Rect const& rect) {
+		uint32_t* pixels = (uint32_t*)this->pixels();
+		pixels = pixels + rect.y * next_row + rect.x;
 
-					saturation_tone(pixels[j], sat, rs, gs, bs, as);
-				}
-			}
-		}
-		else {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					saturation_tone(pixels[j], sat, rs, gs, bs, as);
-				}
-			}
+		for (int i = 0; i < rect.height; ++i) {
+			BitmapTone::Apply(pixels, rect.width, params);
+			pixels += next_row;
 		}
+	};
+
+	Rect rect(x, y, std::min<uint16_t>(src_rect.width, width()), std::min<uint16_t>(src_rect.height, height()));
+	if (clip_rects.empty()) {
+		apply(rect);
+		return;
 	}
 
-	// If Only Color:
-	else if (tone.red != 128 || tone.green != 128 || tone.blue != 128) {
-		if (&src != this || check_alpha) {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					if ((uint8_t)((pixels[j] >> as) & 0xFF) == 0)
-						continue;
-
-					color_tone(pixels[j], tone, rs, gs, bs, as);
-				}
-			}
-		}
-		else {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					color_tone(pixels[j], tone, rs, gs, bs, as);
-				}
-			}
+	// The tone is applied in place, pixels outside of the clip would get it twice
+	for (auto clip : clip_rects) {
+		clip.Adjust(rect);
+		if (!clip.IsEmpty()) {
+			apply(clip);
 		}
-
 	}
-
 }
 
 void Bitmap::BlendBlit(int x, int y, Bitmap const& src, Rect const& src_rect, const Color& color, Opacity const& opacity) {
+	BeginWrite();
+
 	if (opacity.IsTransparent()) {
 		return;
 	}
@@ -977,6 +985,8 @@ void Bitmap::FlipBlit(int x, int y, Bitmap const& src, Rect const& src_rect, boo
 }
 
 void Bitmap::Flip(bool horizontal, bool vertical) {
+	BeginWrite();
+
 	if (!horizontal && !vertical) {
 		return;
 	}
@@ -1001,6 +1011,8 @@ void Bitmap::Flip(bool horizontal, bool vertical) {
 }
 
 void Bitmap::MaskedBlit(Rect const& dst_rect, Bitmap const& mask, int mx, int my, Color const& color) {
+	BeginWrite();
+
 	pixman_color_t tcolor = {
 		static_cast<uint16_t>(color.red << 8),
 		static_cast<uint16_t>(color.green << 8),
@@ -1018,6 +1030,8 @@ void Bitmap::MaskedBlit(Rect const& dst_rect, Bitmap const& mask, int mx, int my
 }
 
 void Bitmap::MaskedBlit(Rect const& dst_rect, Bitmap const& mask, int mx, int my, Bitmap const& src, int sx, int sy) {
+	BeginWrite();
+
 	pixman_image_composite32(PIXMAN_OP_OVER,
 							 src.bitmap.get(), mask.bitmap.get(), bitmap.get(),
 							 sx, sy,
@@ -1027,6 +1041,8 @@ void Bitmap::MaskedBlit(Rect const& dst_rect, Bitmap const& mask, int mx, int my
 }
 
 void Bitmap::Blit2x(Rect const& dst_rect, Bitmap const& src, Rect const& src_rect) {
+	BeginWrite();
+
 	Transform xform = Transform::Scale(0.5, 0.5);
 
 	pixman_image_set_transform(src.bitmap.get(), &xform.matrix);
@@ -1073,6 +1089,8 @@ void Bitmap::RotateZoomOpacityBlit(int x, int y, int ox, int oy,
 		Bitmap const& src, Rect const& src_rect,
 		double angle, double zoom_x, double zoom_y, Opacity const& opacity, Bitmap::BlendMode blend_mode)
 {
+	BeginWrite();
+
 	if (opacity.IsTransparent()) {
 		return;
 	}
@@ -1178,6 +1196,8 @@ pixman_op_t Bitmap::GetOperator(pixman_image_t* mask, Bitmap::BlendMode blend_mo
 }
 
 void Bitmap::EdgeMirrorBlit(int x, int y, Bitmap const& src, Rect const& src_rect, bool mirror_x, bool mirror_y, Opacity const& opacity) {
+	BeginWrite();
+
 	if (opacity.IsTransparent())
 		return;
 
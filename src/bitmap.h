@@ -21,6 +21,7 @@
 // Headers
 #include <string>
 #include <map>
+#include <memory>
 #include <vector>
 #include <cassert>
 #include <pixman.h>
@@ -223,6 +224,44 @@ public:
 	 */
 	StringView GetFilename() const;
 
+	/**
+	 * Counts the changes to the pixels of the bitmap, every drawing operation
+	 * increases it. Writes through pixels() are not counted.
+	 *
+	 * @return change counter
+	 */
+	uint32_t GetGeneration() const;
+
+	/**
+	 * Makes the bitmap use the pixels of another bitmap instead of its own.
+	 * Both must have the same size, format and content. The pixels are copied
+	 * again before a drawing operation changes one of the bitmaps, writes
+	 * through pixels() must not happen while they are shared.
+	 *
+	 * @param source bitmap with the same content
+	 * @return false when the bitmaps are not compatible, nothing is shared then
+	 */
+	bool SharePixels(Bitmap& source);
+
+	/** @return whether the pixels are shared with other bitmaps */
+	bool IsSharingPixels() const;
+
+	/**
+	 * Returns the image owning the pixels, all bitmaps sharing the pixels
+	 * return the same owner. Unlike the address of the pixels it identifies
+	 * them even after they were freed.
+	 *
+	 * @return owner of the pixels
+	 */
+	std::weak_ptr<pixman_image_t> GetPixelsOwner();
+
+	/**
+	 * Restricts all drawing operations on the bitmap to the given rectangles.
+	 *
+	 * @param rects clip rectangles, an empty list removes the clip.
+	 */
+	void SetClipRects(const std::vector<Rect>& rects);
+
 	void CheckPixels(uint32_t flags);
 
 	/**
@@ -588,11 +627,18 @@ protected:
 
 	std::string filename;
 
+	/** Image owning the pixels, common to all bitmaps sharing them. */
+	std::shared_ptr<pixman_image_t> shared_pixels;
+
 	/** Bitmap data. */
 	PixmanImagePtr bitmap;
 	pixman_format_code_t pixman_format;
 
 	void Init(int width, int height, void* data, int pitch = 0, bool destroy = true);
+	/** Called by the drawing operations before they change the pixels. */
+	void BeginWrite();
+	/** Gives the bitmap its own copy of shared pixels. */
+	void Unshare();
 	void ConvertImage(int& width, int& height, void*& pixels, bool transparent);
 
 	static PixmanImagePtr GetSubimage(Bitmap const& src, const Rect& src_rect);
@@ -623,6 +669,9 @@ protected:
 	 */
 	pixman_op_t GetOperator(pixman_image_t* mask = nullptr, BlendMode blend_mode = BlendMode::Default) const;
 	bool read_only = false;
+
+	uint32_t generation = 0;
+	std::vector<Rect> clip_rects;
 };
 
 inline ImageOpacity Bitmap::GetImageOpacity() const {
@@ -661,4 +710,19 @@ inline StringView Bitmap::GetFilename() const {
 	return filename;
 }
 
+inline uint32_t Bitmap::GetGeneration() const {
+	return generation;
+}
+
+inline bool Bitmap::IsSharingPixels() const {
+	return shared_pixels.use_count() > 1;
+}
+
+inline void Bitmap::BeginWrite() {
+	++generation;
+	if (shared_pixels) {
+		Unshare();
+	}
+}
+
 #endif
@@ -0,0 +1,329 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include "bitmap_tone.h"
+
+// SSE2 is part of every x86_64 CPU, Emscripten maps it to wasm simd128 when built with -msse2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define EP_TONE_SSE2
+#  include <emmintrin.h>
+#endif
+
+// AVX2 is detected at runtime, this needs the target attribute of GCC and Clang
+#if defined(EP_TONE_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(__EMSCRIPTEN__)
+#  define EP_TONE_AVX2
+#  include <immintrin.h>
+#endif
+
+namespace {
+
+// Hard light lookup table mapping source color to destination color
+// FIXME: Replace this with std::array<std::array<uint8_t,256>,256> when we have C++17
+struct HardLightTable {
+	uint8_t table[256][256] = {};
+};
+
+constexpr HardLightTable make_hard_light_lookup() {
+	HardLightTable hl;
+	for (int i = 0; i < 256; ++i) {
+		for (int j = 0; j < 256; ++j) {
+			int res = 0;
+			if (i <= 128)
+				res = (2 * i * j) / 255;
+			else
+				res = 255 - 2 * (255 - i) * (255 - j) / 255;
+			hl.table[i][j] = res > 255 ? 255 : res < 0 ? 0 : res;
+		}
+	}
+	return hl;
+}
+
+constexpr auto hard_light = make_hard_light_lookup();
+
+// Saturation Tone Inline: Changes a pixel saturation
+inline void saturation_tone(uint32_t &src_pixel, int saturation, int rs, int gs, int bs, int as) {
+	// Algorithm from OpenPDN (MIT license)
+	// Transformation in Y'CbCr color space
+	uint8_t r = (src_pixel >> rs) & 0xFF;
+	uint8_t g = (src_pixel >> gs) & 0xFF;
+	uint8_t b = (src_pixel >> bs) & 0xFF;
+	uint8_t a = (src_pixel >> as) & 0xFF;
+
+	// Y' = 0.299 R' + 0.587 G' + 0.114 B'
+	uint8_t lum = (7471 * b + 38470 * g + 19595 * r) >> 16;
+
+	// Scale Cb/Cr by scale factor "sat"
+	int red = ((lum * 1024 + (r - lum) * saturation) >> 10);
+	red = red > 255 ? 255 : red < 0 ? 0 : red;
+	int green = ((lum * 1024 + (g - lum) * saturation) >> 10);
+	green = green > 255 ? 255 : green < 0 ? 0 : green;
+	int blue = ((lum * 1024 + (b - lum) * saturation) >> 10);
+	blue = blue > 255 ? 255 : blue < 0 ? 0 : blue;
+
+	src_pixel = ((uint32_t)red << rs) | ((uint32_t)green << gs) | ((uint32_t)blue << bs) | ((uint32_t)a << as);
+}
+
+// Color Tone Inline: Changes color of a pixel by hard light table
+inline void color_tone(uint32_t &src_pixel, Tone tone, int rs, int gs, int bs, int as) {
+	src_pixel = ((uint32_t)hard_light.table[tone.red][(src_pixel >> rs) & 0xFF] << rs)
+		| ((uint32_t)hard_light.table[tone.green][(src_pixel >> gs) & 0xFF] << gs)
+		| ((uint32_t)hard_light.table[tone.blue][(src_pixel >> bs) & 0xFF] << bs)
+		| ((uint32_t)((src_pixel >> as) & 0xFF) << as);
+}
+
+// The vector kernels compute the hard light table instead of looking it up:
+//   i <= 128: 2 * i * j / 255
+//   i >  128: 255 - 2 * (255 - i) * (255 - j) / 255
+// 255 - v is v ^ 0xFF for bytes, so both cases are (((j ^ inv) * mul) / 255) ^ inv.
+// The product never exceeds 65280, where (x + 1 + (x >> 8)) >> 8 equals x / 255.
+// Only i = 128, j = 255 exceeds 255 and is clamped like in the table.
+struct HardLightChannel {
+	int mul;
+	int inv;
+};
+
+HardLightChannel MakeHardLightChannel(int i) {
+	if (i <= 128) {
+		return { 2 * i, 0 };
+	}
+	return { 2 * (255 - i), 0xFF };
+}
+
+// Y' weights split so every factor fits into a signed 16 bit lane of madd: 38470 = 2 * 19235
+constexpr int lum_r = 19595;
+constexpr int lum_g = 19235;
+constexpr int lum_b = 7471;
+
+#ifdef EP_TONE_SSE2
+inline __m128i SaturateChannelSse2(__m128i c, __m128i lum, __m128i lum_hi, __m128i sat) {
+	// (c - lum) * sat + lum * 1024 in one madd, both products are pairs of 16 bit lanes
+	__m128i diff = _mm_and_si128(_mm_sub_epi32(c, lum), _mm_set1_epi32(0xFFFF));
+	__m128i v = _mm_srai_epi32(_mm_madd_epi16(_mm_or_si128(diff, lum_hi), sat), 10);
+	// clamp to 0..255 through 16 bit lanes, SSE2 has no 32 bit min/max
+	__m128i t = _mm_packs_epi32(v, v);
+	t = _mm_min_epi16(_mm_max_epi16(t, _mm_setzero_si128()), _mm_set1_epi16(255));
+	return _mm_unpacklo_epi16(t, _mm_setzero_si128());
+}
+
+inline __m128i HardLightChannelSse2(__m128i c, __m128i mul, __m128i inv) {
+	// the high half of every 32 bit lane is 0, so mullo_epi16 yields the full product
+	__m128i x = _mm_mullo_epi16(_mm_xor_si128(c, inv), mul);
+	x = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(x, _mm_set1_epi32(1)), _mm_srli_epi32(x, 8)), 8);
+	// the high halves stay 0, min_epi16 clamps the low half
+	x = _mm_min_epi16(x, _mm_set1_epi32(255));
+	return _mm_xor_si128(x, inv);
+}
+
+void ApplySse2(uint32_t* pixels, int count, const BitmapTone::Params& p) {
+	const __m128i byte_mask = _mm_set1_epi32(0xFF);
+	const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xFFu << p.as));
+	const __m128i rs = _mm_cvtsi32_si128(p.rs);
+	const __m128i gs = _mm_cvtsi32_si128(p.gs);
+	const __m128i bs = _mm_cvtsi32_si128(p.bs);
+
+	const __m128i lum_rb = _mm_set1_epi32(lum_r | (lum_b << 16));
+	const __m128i lum_gg = _mm_set1_epi32(lum_g | (lum_g << 16));
+	const __m128i sat = _mm_set1_epi32(p.sat | (1024 << 16));
+
+	const auto hl_r = MakeHardLightChannel(p.tone.red);
+	const auto hl_g = MakeHardLightChannel(p.tone.green);
+	const auto hl_b = MakeHardLightChannel(p.tone.blue);
+	const __m128i mul_r = _mm_set1_epi32(hl_r.mul);
+	const __m128i mul_g = _mm_set1_epi32(hl_g.mul);
+	const __m128i mul_b = _mm_set1_epi32(hl_b.mul);
+	const __m128i inv_r = _mm_set1_epi32(hl_r.inv);
+	const __m128i inv_g = _mm_set1_epi32(hl_g.inv);
+	const __m128i inv_b = _mm_set1_epi32(hl_b.inv);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+		__m128i r = _mm_and_si128(_mm_srl_epi32(px, rs), byte_mask);
+		__m128i g = _mm_and_si128(_mm_srl_epi32(px, gs), byte_mask);
+		__m128i b = _mm_and_si128(_mm_srl_epi32(px, bs), byte_mask);
+
+		if (p.saturation) {
+			__m128i lum = _mm_add_epi32(
+				_mm_madd_epi16(_mm_or_si128(r, _mm_slli_epi32(b, 16)), lum_rb),
+				_mm_madd_epi16(_mm_or_si128(g, _mm_slli_epi32(g, 16)), lum_gg));
+			lum = _mm_srli_epi32(lum, 16);
+			__m128i lum_hi = _mm_slli_epi32(lum, 16);
+			r = SaturateChannelSse2(r, lum, lum_hi, sat);
+			g = SaturateChannelSse2(g, lum, lum_hi, sat);
+			b = SaturateChannelSse2(b, lum, lum_hi, sat);
+		}
+
+		if (p.color) {
+			r = HardLightChannelSse2(r, mul_r, inv_r);
+			g = HardLightChannelSse2(g, mul_g, inv_g);
+			b = HardLightChannelSse2(b, mul_b, inv_b);
+		}
+
+		__m128i out = _mm_or_si128(
+			_mm_or_si128(_mm_and_si128(px, alpha_mask), _mm_sll_epi32(r, rs)),
+			_mm_or_si128(_mm_sll_epi32(g, gs), _mm_sll_epi32(b, bs)));
+
+		if (p.check_alpha) {
+			__m128i keep = _mm_cmpeq_epi32(_mm_and_si128(px, alpha_mask), _mm_setzero_si128());
+			out = _mm_or_si128(_mm_and_si128(keep, px), _mm_andnot_si128(keep, out));
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), out);
+	}
+
+	BitmapTone::ApplyScalar(pixels + i, count - i, p);
+}
+#endif
+
+#ifdef EP_TONE_AVX2
+#define EP_TARGET_AVX2 __attribute__((target("avx2")))
+
+EP_TARGET_AVX2 inline __m256i SaturateChannelAvx2(__m256i c, __m256i lum, __m256i lum_hi, __m256i sat) {
+	__m256i diff = _mm256_and_si256(_mm256_sub_epi32(c, lum), _mm256_set1_epi32(0xFFFF));
+	__m256i v = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_or_si256(diff, lum_hi), sat), 10);
+	return _mm256_min_epi32(_mm256_max_epi32(v, _mm256_setzero_si256()), _mm256_set1_epi32(255));
+}
+
+EP_TARGET_AVX2 inline __m256i HardLightChannelAvx2(__m256i c, __m256i mul, __m256i inv) {
+	__m256i x = _mm256_mullo_epi16(_mm256_xor_si256(c, inv), mul);
+	x = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(x, _mm256_set1_epi32(1)), _mm256_srli_epi32(x, 8)), 8);
+	x = _mm256_min_epi32(x, _mm256_set1_epi32(255));
+	return _mm256_xor_si256(x, inv);
+}
+
+EP_TARGET_AVX2 void ApplyAvx2(uint32_t* pixels, int count, const BitmapTone::Params& p) {
+	const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+	const __m256i alpha_mask = _mm256_set1_epi32(static_cast<int>(0xFFu << p.as));
+	const __m128i rs = _mm_cvtsi32_si128(p.rs);
+	const __m128i gs = _mm_cvtsi32_si128(p.gs);
+	const __m128i bs = _mm_cvtsi32_si128(p.bs);
+
+	const __m256i lum_rb = _mm256_set1_epi32(lum_r | (lum_b << 16));
+	const __m256i lum_gg = _mm256_set1_epi32(lum_g | (lum_g << 16));
+	const __m256i sat = _mm256_set1_epi32(p.sat | (1024 << 16));
+
+	const auto hl_r = MakeHardLightChannel(p.tone.red);
+	const auto hl_g = MakeHardLightChannel(p.tone.green);
+	const auto hl_b = MakeHardLightChannel(p.tone.blue);
+	const __m256i mul_r = _mm256_set1_epi32(hl_r.mul);
+	const __m256i mul_g = _mm256_set1_epi32(hl_g.mul);
+	const __m256i mul_b = _mm256_set1_epi32(hl_b.mul);
+	const __m256i inv_r = _mm256_set1_epi32(hl_r.inv);
+	const __m256i inv_g = _mm256_set1_epi32(hl_g.inv);
+	const __m256i inv_b = _mm256_set1_epi32(hl_b.inv);
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + i));
+		__m256i r = _mm256_and_si256(_mm256_srl_epi32(px, rs), byte_mask);
+		__m256i g = _mm256_and_si256(_mm256_srl_epi32(px, gs), byte_mask);
+		__m256i b = _mm256_and_si256(_mm256_srl_epi32(px, bs), byte_mask);
+
+		if (p.saturation) {
+			__m256i lum = _mm256_add_epi32(
+				_mm256_madd_epi16(_mm256_or_si256(r, _mm256_slli_epi32(b, 16)), lum_rb),
+				_mm256_madd_epi16(_mm256_or_si256(g, _mm256_slli_epi32(g, 16)), lum_gg));
+			lum = _mm256_srli_epi32(lum, 16);
+			__m256i lum_hi = _mm256_slli_epi32(lum, 16);
+			r = SaturateChannelAvx2(r, lum, lum_hi, sat);
+			g = SaturateChannelAvx2(g, lum, lum_hi, sat);
+			b = SaturateChannelAvx2(b, lum, lum_hi, sat);
+		}
+
+		if (p.color) {
+			r = HardLightChannelAvx2(r, mul_r, inv_r);
+			g = HardLightChannelAvx2(g, mul_g, inv_g);
+			b = HardLightChannelAvx2(b, mul_b, inv_b);
+		}
+
+		__m256i out = _mm256_or_si256(
+			_mm256_or_si256(_mm256_and_si256(px, alpha_mask), _mm256_sll_epi32(r, rs)),
+			_mm256_or_si256(_mm256_sll_epi32(g, gs), _mm256_sll_epi32(b, bs)));
+
+		if (p.check_alpha) {
+			__m256i keep = _mm256_cmpeq_epi32(_mm256_and_si256(px, alpha_mask), _mm256_setzero_si256());
+			out = _mm256_blendv_epi8(out, px, keep);
+		}
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + i), out);
+	}
+
+	ApplySse2(pixels + i, count - i, p);
+}
+#endif
+
+using Kernel = void (*)(uint32_t*, int, const BitmapTone::Params&);
+
+struct KernelChoice {
+	Kernel kernel;
+	const char* name;
+};
+
+KernelChoice SelectKernel() {
+#ifdef EP_TONE_AVX2
+	if (__builtin_cpu_supports("avx2")) {
+		return { ApplyAvx2, "avx2" };
+	}
+#endif
+#ifdef EP_TONE_SSE2
+	return { ApplySse2, "sse2" };
+#else
+	return { BitmapTone::ApplyScalar, "scalar" };
+#endif
+}
+
+const KernelChoice& GetKernel() {
+	static const KernelChoice choice = SelectKernel();
+	return choice;
+}
+
+} // anonymous namespace
+
+BitmapTone::Params BitmapTone::MakeParams(const Tone& tone, bool check_alpha, int rs, int gs, int bs, int as) {
+	Params p;
+	p.tone = tone;
+	p.saturation = tone.gray != 128;
+	p.color = tone.red != 128 || tone.green != 128 || tone.blue != 128;
+	p.sat = tone.gray > 128 ? 1024 + (tone.gray - 128) * 16 : tone.gray * 8;
+	p.check_alpha = check_alpha;
+	p.rs = rs;
+	p.gs = gs;
+	p.bs = bs;
+	p.as = as;
+	return p;
+}
+
+void BitmapTone::ApplyScalar(uint32_t* pixels, int count, const Params& p) {
+	for (int j = 0; j < count; ++j) {
+		if (p.check_alpha && (uint8_t)((pixels[j] >> p.as) & 0xFF) == 0)
+			continue;
+
+		if (p.saturation)
+			saturation_tone(pixels[j], p.sat, p.rs, p.gs, p.bs, p.as);
+		if (p.color)
+			color_tone(pixels[j], p.tone, p.rs, p.gs, p.bs, p.as);
+	}
+}
+
+void BitmapTone::Apply(uint32_t* pixels, int count, const Params& params) {
+	GetKernel().kernel(pixels, count, params);
+}
+
+const char* BitmapTone::GetKernelName() {
+	return GetKernel().name;
+}
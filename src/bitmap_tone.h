@@ -0,0 +1,77 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_BITMAP_TONE_H
+#define EP_BITMAP_TONE_H
+
+// Headers
+#include <cstdint>
+#include "tone.h"
+
+/**
+ * Pixel kernels of Bitmap::ToneBlit.
+ *
+ * The scalar kernel is the reference, the vector kernels produce the same output bit by bit.
+ * The fastest kernel supported by the CPU is picked on first use.
+ */
+namespace BitmapTone {
+	/** Tone change of one blit */
+	struct Params {
+		/** Color part of the tone (hard light), unchanged when all channels are 128 */
+		Tone tone;
+		/** Saturation factor (1024 = unchanged), only applied when saturation is set */
+		int sat = 1024;
+		bool saturation = false;
+		bool color = false;
+		/** Leave pixels with alpha 0 alone */
+		bool check_alpha = false;
+		/** Channel shifts of the pixel format */
+		int rs = 0;
+		int gs = 0;
+		int bs = 0;
+		int as = 0;
+	};
+
+	/**
+	 * Builds the parameters for a tone.
+	 *
+	 * @param tone tone of the blit
+	 * @param check_alpha whether pixels with alpha 0 are skipped
+	 * @param rs red shift
+	 * @param gs green shift
+	 * @param bs blue shift
+	 * @param as alpha shift
+	 */
+	Params MakeParams(const Tone& tone, bool check_alpha, int rs, int gs, int bs, int as);
+
+	/**
+	 * Applies the tone to a row of pixels with the best kernel available.
+	 *
+	 * @param pixels row of 32 bit pixels, changed in place
+	 * @param count number of pixels
+	 * @param params tone parameters
+	 */
+	void Apply(uint32_t* pixels, int count, const Params& params);
+
+	/** Reference implementation of Apply */
+	void ApplyScalar(uint32_t* pixels, int count, const Params& params);
+
+	/** @return name of the kernel used by Apply ("scalar", "sse2" or "avx2") */
+	const char* GetKernelName();
+}
+
+#endif
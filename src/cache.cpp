@@ -20,10 +20,16 @@
 #  pragma warning(disable: 4003)
 #endif
 
+#include <algorithm>
 #include <map>
+#include <list>
+#include <set>
 #include <tuple>
 #include <chrono>
 #include <cassert>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "async_handler.h"
 #include "cache.h"
@@ -35,6 +41,8 @@
 #include "player.h"
 #include <lcf/data.h>
 #include "game_clock.h"
+#include "image_decoder.h"
+#include "utils.h"
 
 using namespace std::chrono_literals;
 
@@ -69,74 +77,366 @@ namespace {
 		return key.data() + offset;
 	}
 
+	using key_type = std::string;
+
 	struct CacheItem {
 		BitmapRef bitmap;
 		Game_Clock::time_point last_access;
+		// folder of the image for the memory report
+		const char* folder;
+		// owner of the pixels the item was counted with in cache_size
+		std::weak_ptr<pixman_image_t> pixels;
+		// statistics of the folder
+		Cache::MaterialStats* stats;
+		// number of loads, for LFU eviction
+		uint32_t uses;
+		// position in cache_lru
+		std::list<key_type>::iterator lru;
 	};
 
-	using key_type = std::string;
 	std::unordered_map<key_type, CacheItem> cache;
+	// most recently used first
+	std::list<key_type> cache_lru;
+
+	// keys of images that are kept while they are unused
+	std::unordered_set<key_type> pinned;
+
+	// by folder, kept when the cache is cleared
+	std::map<std::string, Cache::MaterialStats> material_stats;
+
+	// images being decoded by the ImageDecoder, value is the id of the decode
+	std::unordered_map<key_type, int> pending_decodes;
 
 	using tile_key_type = std::string;
 	std::unordered_map<tile_key_type, std::weak_ptr<Bitmap>> cache_tiles;
 
-	// rect, flip_x, flip_y, tone, blend
-	using effect_key_type = std::tuple<BitmapRef, Rect, bool, bool, Tone, Color>;
-	std::map<effect_key_type, std::weak_ptr<Bitmap>> cache_effects;
+	struct EffectKey {
+		// The source is only compared by address, the entry holds a weak reference to
+		// notice when it was freed. The generation catches changes of its pixels.
+		const Bitmap* src_bitmap;
+		uint32_t src_generation;
+		Rect rect;
+		bool flip_x;
+		bool flip_y;
+		Tone tone;
+		Color blend;
+
+		bool operator==(const EffectKey& o) const {
+			return src_bitmap == o.src_bitmap && src_generation == o.src_generation && rect == o.rect &&
+				flip_x == o.flip_x && flip_y == o.flip_y && tone == o.tone && blend == o.blend;
+		}
+	};
+
+	struct EffectKeyHash {
+		size_t operator()(const EffectKey& key) const {
+			size_t h = std::hash<const Bitmap*>()(key.src_bitmap);
+			auto add = [&h](int value) {
+				h ^= std::hash<int>()(value) + 0x9e3779b9 + (h << 6) + (h >> 2);
+			};
+			add(key.src_generation);
+			add(key.rect.x);
+			add(key.rect.y);
+			add(key.rect.width);
+			add(key.rect.height);
+			add(key.flip_x | (key.flip_y << 1));
+			add(key.tone.red);
+			add(key.tone.green);
+			add(key.tone.blue);
+			add(key.tone.gray);
+			add(key.blend.red);
+			add(key.blend.green);
+			add(key.blend.blue);
+			add(key.blend.alpha);
+			return h;
+		}
+	};
+
+	struct EffectItem {
+		std::weak_ptr<Bitmap> src_bitmap;
+		BitmapRef bitmap;
+		// position in cache_effects_lru
+		std::list<EffectKey>::iterator lru;
+	};
+
+	std::unordered_map<EffectKey, EffectItem, EffectKeyHash> cache_effects;
+	// most recently used first
+	std::list<EffectKey> cache_effects_lru;
+	Cache::EffectStats effect_stats;
+
+	// Effect bitmaps no sprite uses anymore are kept until the cache holds more than this.
+	// Bitmaps in use are never dropped, they don't cost extra memory.
+	constexpr size_t effect_cache_limit = 4 * 1024 * 1024;
+
+	void EraseEffect(std::unordered_map<EffectKey, EffectItem, EffectKeyHash>::iterator it) {
+		effect_stats.bytes -= it->second.bitmap->GetSize();
+		cache_effects_lru.erase(it->second.lru);
+		cache_effects.erase(it);
+	}
+
+	void FreeEffectMemory() {
+		auto lru_it = cache_effects_lru.end();
+		while (lru_it != cache_effects_lru.begin() && effect_stats.bytes > effect_cache_limit) {
+			auto prev = std::prev(lru_it);
+			auto it = cache_effects.find(*prev);
+			if (it->second.bitmap.use_count() == 1) {
+				EraseEffect(it);
+			} else {
+				lru_it = prev;
+			}
+		}
+		effect_stats.entries = cache_effects.size();
+	}
+
+	// Takes the least recently used bitmap with this size that no sprite uses anymore
+	BitmapRef ReuseEffectBitmap(int width, int height) {
+		for (auto lru_it = cache_effects_lru.rbegin(); lru_it != cache_effects_lru.rend(); ++lru_it) {
+			auto it = cache_effects.find(*lru_it);
+			auto& bitmap = it->second.bitmap;
+			if (bitmap.use_count() == 1 && bitmap->width() == width && bitmap->height() == height) {
+				BitmapRef reused = bitmap;
+				EraseEffect(it);
+				reused->Clear();
+				return reused;
+			}
+		}
+		return nullptr;
+	}
 
 	std::string system_name;
 
 	std::string system2_name;
 
-	constexpr int cache_limit = 10 * 1024 * 1024;
+	size_t cache_limit = 10 * 1024 * 1024;
 	size_t cache_size = 0;
+	Cache::Eviction eviction = Cache::Eviction::LRU;
 
-	void FreeBitmapMemory() {
-		auto cur_ticks = Game_Clock::GetFrameTime();
+	// Images used during the last 3 frames are kept, they are likely needed again.
+	constexpr auto eviction_grace = 50ms;
 
-		for (auto it = cache.begin(); it != cache.end();) {
-			if (it->second.bitmap.use_count() != 1) {
-				// Bitmap is referenced
-				++it;
+	// Decoded images by a hash of their size, format and pixels. An equal image loaded under
+	// another key, e.g. with a differently cased name, shares the pixels of the stored one.
+	std::unordered_multimap<size_t, std::weak_ptr<Bitmap>> pixel_store;
+
+	// Number of cache items using the pixels, shared pixels are only counted once in cache_size.
+	// Keyed by the owner and not by the address, the address of freed pixels can be reused.
+	using PixelsOwner = std::weak_ptr<pixman_image_t>;
+	std::map<PixelsOwner, int, std::owner_less<PixelsOwner>> cached_pixels;
+
+	size_t HashPixels(const Bitmap& bmp) {
+		uint64_t h = 14695981039346656037ull;
+		auto add = [&h](uint64_t value) {
+			h = (h ^ value) * 1099511628211ull;
+		};
+		add(bmp.width());
+		add(bmp.height());
+		add(bmp.pitch());
+		add(bmp.GetTransparent());
+
+		auto* data = static_cast<const uint8_t*>(bmp.pixels());
+		const size_t size = bmp.GetSize();
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+			uint64_t value;
+			std::memcpy(&value, data + i, sizeof(value));
+			add(value);
+		}
+		for (; i < size; ++i) {
+			add(data[i]);
+		}
+
+		return static_cast<size_t>(h ^ (h >> 32));
+	}
+
+	// Lets the bitmap share the pixels of an equal stored image, or stores it
+	void StorePixels(const BitmapRef& bmp) {
+		if (!bmp->pixels()) {
+			return;
+		}
+
+		const size_t size = bmp->GetSize();
+		const size_t hash = HashPixels(*bmp);
+		auto range = pixel_store.equal_range(hash);
+		for (auto it = range.first; it != range.second;) {
+			auto stored = it->second.lock();
+			if (!stored) {
+				it = pixel_store.erase(it);
 				continue;
 			}
 
-			auto last_access = cur_ticks - it->second.last_access;
-			bool cache_exhausted = cache_size > cache_limit;
-			if (cache_exhausted) {
-				if (last_access <= 50ms) {
-					// Used during the last 3 frames, must be important, keep it.
-					++it;
-					continue;
-				}
-			} else if (last_access <= 3s) {
-				++it;
-				continue;
+			if (stored->GetSize() == size && std::memcmp(stored->pixels(), bmp->pixels(), size) == 0 &&
+					bmp->SharePixels(*stored)) {
+				return;
 			}
+			++it;
+		}
+
+		pixel_store.emplace(hash, bmp);
+	}
+
+	void AddPixels(const CacheItem& item) {
+		if (item.bitmap && cached_pixels[item.pixels]++ == 0) {
+			cache_size += item.bitmap->GetSize();
+		}
+	}
 
+	void RemovePixels(const CacheItem& item) {
+		auto it = cached_pixels.find(item.pixels);
+		if (!item.bitmap || it == cached_pixels.end()) {
+			return;
+		}
+
+		if (--it->second == 0) {
+			cache_size -= item.bitmap->GetSize();
+			cached_pixels.erase(it);
+		}
+	}
+
+	void EraseItem(std::unordered_map<key_type, CacheItem>::iterator it) {
 #ifdef CACHE_DEBUG
-			Output::Debug("Freeing memory of {}/{}", std::get<0>(i.first), std::get<1>(i.first));
+		Output::Debug("Freeing memory of {}", it->first);
 #endif
+		++it->second.stats->evictions;
+		RemovePixels(it->second);
+		cache_lru.erase(it->second.lru);
+		cache.erase(it);
+	}
+
+	void TouchItem(CacheItem& item) {
+		item.last_access = Game_Clock::GetFrameTime();
+		cache_lru.splice(cache_lru.begin(), cache_lru, item.lru);
+	}
 
-			cache_size -= it->second.bitmap->GetSize();
+	BitmapRef LoadFromCache(CacheItem& item) {
+		++item.uses;
+		++item.stats->hits;
+		TouchItem(item);
+		return item.bitmap;
+	}
 
-			it = cache.erase(it);
+	bool IsEvictable(const std::string& key, const CacheItem& item, Game_Clock::time_point now) {
+		return item.bitmap.use_count() == 1 && now - item.last_access > eviction_grace && pinned.count(key) == 0;
+	}
+
+	void EvictLRU() {
+		auto now = Game_Clock::GetFrameTime();
+
+		// Every item is visited at most once, images in use are moved to the front.
+		// Their last access stays, so the list is not ordered by it and the whole
+		// list is searched.
+		auto next = cache_lru.end();
+		for (size_t n = cache_lru.size(); n > 0 && cache_size > cache_limit; --n) {
+			auto lru_it = std::prev(next);
+			next = lru_it;
+			auto it = cache.find(*lru_it);
+			auto& item = it->second;
+
+			if (item.bitmap.use_count() != 1 || pinned.count(it->first) != 0) {
+				// Referenced (used right now) or pinned
+				next = std::next(lru_it);
+				cache_lru.splice(cache_lru.begin(), cache_lru, lru_it);
+				continue;
+			}
+
+			if (now - item.last_access <= eviction_grace) {
+				continue;
+			}
+
+			next = std::next(lru_it);
+			EraseItem(it);
+		}
+	}
+
+	void EvictLFU() {
+		auto now = Game_Clock::GetFrameTime();
+
+		struct Candidate {
+			double score;
+			std::unordered_map<key_type, CacheItem>::iterator it;
+		};
+		std::vector<Candidate> candidates;
+
+		// Oldest first, so that equal scores are evicted in LRU order
+		for (auto lru_it = cache_lru.rbegin(); lru_it != cache_lru.rend(); ++lru_it) {
+			auto it = cache.find(*lru_it);
+			if (IsEvictable(it->first, it->second, now)) {
+				// Uses per MiB, a big image must be used more often to stay
+				double mib = std::max<size_t>(it->second.bitmap->GetSize(), 1) / (1024.0 * 1024.0);
+				candidates.push_back({ it->second.uses / mib, it });
+			}
+		}
+
+		std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+			return a.score < b.score;
+		});
+
+		for (auto& c : candidates) {
+			if (cache_size <= cache_limit) {
+				break;
+			}
+			EraseItem(c.it);
+		}
+	}
+
+	void FreeBitmapMemory() {
+		if (cache_size > cache_limit) {
+			switch (eviction) {
+				case Cache::Eviction::LRU:
+					EvictLRU();
+					break;
+				case Cache::Eviction::LFU:
+					EvictLFU();
+					break;
+			}
+		}
+
+		// Freed images are only noticed here, sweep when most entries could be stale
+		if (pixel_store.size() > 2 * cache.size() + 16) {
+			for (auto it = pixel_store.begin(); it != pixel_store.end();) {
+				if (it->second.expired()) {
+					it = pixel_store.erase(it);
+				} else {
+					++it;
+				}
+			}
 		}
 
 #ifdef CACHE_DEBUG
 		Output::Debug("Bitmap cache size: {}", cache_size / 1024.0 / 1024);
+		for (auto& stats : Cache::GetMaterialStats()) {
+			Output::Debug("{}: {} images, {} KiB, {} KiB shared, {} hits, {} misses, {} evictions",
+				stats.folder, stats.images, stats.bytes / 1024, stats.shared_bytes / 1024,
+				stats.hits, stats.misses, stats.evictions);
+		}
 #endif
 	}
 
-	BitmapRef AddToCache(const std::string& key, BitmapRef bmp) {
+	BitmapRef AddToCache(const std::string& key, BitmapRef bmp, const char* folder) {
 		if (bmp) {
-			cache_size += bmp->GetSize();
+			StorePixels(bmp);
+		}
+
+		auto& stats = material_stats[folder];
+		stats.folder = folder;
+		++stats.misses;
+
+		auto it = cache.find(key);
+		if (it == cache.end()) {
+			cache_lru.push_front(key);
+			it = cache.emplace(key, CacheItem{}).first;
+		} else {
+			RemovePixels(it->second);
+			cache_lru.splice(cache_lru.begin(), cache_lru, it->second.lru);
+		}
+
+		auto& item = it->second;
+		item = { bmp, Game_Clock::GetFrameTime(), folder, bmp ? bmp->GetPixelsOwner() : PixelsOwner(), &stats, 1, cache_lru.begin() };
+		AddPixels(item);
+
 #ifdef CACHE_DEBUG
-			Output::Debug("Bitmap cache size (Add): {}", cache_size / 1024.0 / 1024.0);
+		Output::Debug("Bitmap cache size (Add): {}", cache_size / 1024.0 / 1024.0);
 #endif
-		}
 
-		return (cache[key] = {bmp, Game_Clock::GetFrameTime()}).bitmap;
+		return item.bitmap;
 	}
 
 	struct Material {
@@ -234,10 +534,26 @@ namespace {
 		return s.dummy_renderer();
 	}
 
+	uint32_t GetBitmapFlags(Material::Type type) {
+		return Bitmap::Flag_ReadOnly | (
+				type == Material::Chipset ? Bitmap::Flag_Chipset :
+				type == Material::System ? Bitmap::Flag_System : 0);
+	}
+
 	template<Material::Type T>
 	BitmapRef LoadBitmap(StringView filename, bool transparent) {
 		static_assert(Material::REND < T && T < Material::END, "Invalid material.");
 		const Spec& s = spec[T];
+		const auto key = MakeHashKey(s.directory, filename, transparent);
+
+		// Needed before the decoder handed it over, this finishes the request too.
+		// A picture decoded with the other transparency is finished for the request.
+		for (bool t : { transparent, !transparent }) {
+			auto pending = pending_decodes.find(MakeHashKey(s.directory, filename, t));
+			if (pending != pending_decodes.end()) {
+				ImageDecoder::Finish(pending->second);
+			}
+		}
 
 #ifndef NDEBUG
 		// Test if the file was requested asynchronously before.
@@ -249,7 +565,6 @@ namespace {
 
 		BitmapRef bmp;
 
-		const auto key = MakeHashKey(s.directory, filename, transparent);
 		auto it = cache.find(key);
 		if (it == cache.end()) {
 			if (filename == CACHE_DEFAULT_BITMAP) {
@@ -269,10 +584,7 @@ namespace {
 						bmp = CreateEmpty<T>();
 					}
 				} else {
-					auto flags = Bitmap::Flag_ReadOnly | (
-							T == Material::Chipset ? Bitmap::Flag_Chipset :
-							T == Material::System ? Bitmap::Flag_System : 0);
-					bmp = Bitmap::Create(std::move(is), transparent, flags);
+					bmp = Bitmap::Create(std::move(is), transparent, GetBitmapFlags(T));
 					if (!bmp) {
 						Output::Warning("Invalid image: {}/{}", s.directory, filename);
 					}
@@ -284,10 +596,9 @@ namespace {
 				bmp = LoadDummyBitmap<T>(s.directory, filename, transparent);
 			}
 
-			bmp = AddToCache(key, bmp);
+			bmp = AddToCache(key, bmp, s.directory);
 		} else {
-			it->second.last_access = Game_Clock::GetFrameTime();
-			bmp = it->second.bitmap;
+			bmp = LoadFromCache(it->second);
 		}
 
 		assert(bmp);
@@ -405,10 +716,9 @@ BitmapRef Cache::Exfont() {
 			exfont_img = Bitmap::Create(exfont_h, sizeof(exfont_h), true);
 		}
 
-		return AddToCache(key, exfont_img);
+		return AddToCache(key, exfont_img, "ExFont");
 	} else {
-		it->second.last_access = Game_Clock::GetFrameTime();
-		return it->second.bitmap;
+		return LoadFromCache(it->second);
 	}
 }
 
@@ -445,9 +755,51 @@ BitmapRef Cache::Tile(StringView filename, int tile_id) {
 	} else { return it->second.lock(); }
 }
 
+bool Cache::DecodeAsync(StringView folder_name, StringView filename, std::function<void()> done) {
+	if (filename == CACHE_DEFAULT_BITMAP) {
+		return false;
+	}
+
+	auto spec_it = std::find_if(std::begin(spec), std::end(spec), [&folder_name](const Spec& s) {
+		return Utils::StrICmp(s.directory, folder_name) == 0;
+	});
+	if (spec_it == std::end(spec)) {
+		// Not an image
+		return false;
+	}
+	const Spec& s = *spec_it;
+	const auto type = static_cast<Material::Type>(spec_it - std::begin(spec));
+
+	// Pictures are requested before it is known whether they use the transparent color,
+	// the cache loads them again when the guess was wrong
+	const auto key = MakeHashKey(s.directory, filename, s.transparent);
+	if (cache.find(key) != cache.end() || pending_decodes.find(key) != pending_decodes.end()) {
+		return false;
+	}
+
+	auto is = FileFinder::OpenImage(s.directory, filename);
+	if (!is) {
+		return false;
+	}
+
+	auto data = Utils::ReadStream(is);
+	pending_decodes[key] = ImageDecoder::Decode(std::move(data), s.transparent, GetBitmapFlags(type), [key, done, folder = s.directory](BitmapRef bmp) {
+		pending_decodes.erase(key);
+		if (bmp) {
+			// Invalid images are loaded again by LoadBitmap to report them and to create the placeholder
+			FreeBitmapMemory();
+			AddToCache(key, std::move(bmp), folder);
+		}
+		done();
+	});
+
+	return true;
+}
+
 BitmapRef Cache::SpriteEffect(const BitmapRef& src_bitmap, const Rect& rect, bool flip_x, bool flip_y, const Tone& tone, const Color& blend) {
-	const effect_key_type key {
-		src_bitmap,
+	const EffectKey key {
+		src_bitmap.get(),
+		src_bitmap->GetGeneration(),
 		rect,
 		flip_x,
 		flip_y,
@@ -455,12 +807,26 @@ BitmapRef Cache::SpriteEffect(const BitmapRef& src_bitmap, const Rect& rect, boo
 		blend
 	};
 
-	const auto it = cache_effects.find(key);
+	auto it = cache_effects.find(key);
+	if (it != cache_effects.end() && it->second.src_bitmap.expired()) {
+		// Another bitmap was created at the address of a freed one
+		EraseEffect(it);
+		it = cache_effects.end();
+	}
+
+	if (it == cache_effects.end()) {
+		++effect_stats.misses;
 
-	if (it == cache_effects.end() || it->second.expired()) {
 		BitmapRef bitmap_effects;
 
+		// During tone and flash fades every frame needs a new effect bitmap,
+		// the one of the last frame is usually unused by now
 		auto create = [&rect] () -> BitmapRef {
+			auto bitmap = ReuseEffectBitmap(rect.width, rect.height);
+			if (bitmap) {
+				++effect_stats.reused;
+				return bitmap;
+			}
 			return Bitmap::Create(rect.width, rect.height, true);
 		};
 
@@ -491,14 +857,99 @@ BitmapRef Cache::SpriteEffect(const BitmapRef& src_bitmap, const Rect& rect, boo
 
 		assert(bitmap_effects && "Effect cache used but no effect applied!");
 
-		return(cache_effects[key] = bitmap_effects).lock();
-	} else { return it->second.lock(); }
+		cache_effects_lru.push_front(key);
+		cache_effects[key] = { src_bitmap, bitmap_effects, cache_effects_lru.begin() };
+		effect_stats.bytes += bitmap_effects->GetSize();
+		FreeEffectMemory();
+
+		return bitmap_effects;
+	}
+
+	++effect_stats.hits;
+	cache_effects_lru.splice(cache_effects_lru.begin(), cache_effects_lru, it->second.lru);
+	return it->second.bitmap;
+}
+
+const Cache::EffectStats& Cache::GetEffectStats() {
+	return effect_stats;
+}
+
+void Cache::SetEvictionPolicy(size_t limit, Eviction policy) {
+	cache_limit = limit;
+	eviction = policy;
+	FreeBitmapMemory();
+}
+
+bool Cache::ParseEviction(StringView name, Eviction& policy) {
+	if (Utils::StrICmp(name, "LRU") == 0) {
+		policy = Eviction::LRU;
+		return true;
+	}
+	if (Utils::StrICmp(name, "LFU") == 0) {
+		policy = Eviction::LFU;
+		return true;
+	}
+	return false;
+}
+
+void Cache::Pin(StringView folder_name, StringView filename) {
+	// The folder must be spelled like the spec, the same as for the cache keys
+	auto spec_it = std::find_if(std::begin(spec), std::end(spec), [&folder_name](const Spec& s) {
+		return Utils::StrICmp(s.directory, folder_name) == 0;
+	});
+	if (spec_it == std::end(spec)) {
+		return;
+	}
+
+	pinned.insert(MakeHashKey(spec_it->directory, filename, true));
+	pinned.insert(MakeHashKey(spec_it->directory, filename, false));
+}
+
+void Cache::UnpinAll() {
+	pinned.clear();
+}
+
+std::vector<Cache::MaterialStats> Cache::GetMaterialStats() {
+	std::map<std::string, MaterialStats> result_stats = material_stats;
+	for (auto& kv : result_stats) {
+		kv.second.images = 0;
+		kv.second.bytes = 0;
+		kv.second.shared_bytes = 0;
+	}
+
+	std::set<PixelsOwner, std::owner_less<PixelsOwner>> counted;
+	for (auto& kv : cache) {
+		auto& item = kv.second;
+		if (!item.bitmap) {
+			continue;
+		}
+
+		auto& stats = result_stats[item.folder];
+		++stats.images;
+		if (counted.insert(item.pixels).second) {
+			stats.bytes += item.bitmap->GetSize();
+		} else {
+			stats.shared_bytes += item.bitmap->GetSize();
+		}
+	}
+
+	std::vector<MaterialStats> result;
+	for (auto& kv : result_stats) {
+		result.push_back(std::move(kv.second));
+	}
+	return result;
 }
 
 void Cache::Clear() {
 	cache_effects.clear();
+	cache_effects_lru.clear();
+	effect_stats.bytes = 0;
+	effect_stats.entries = 0;
 	cache.clear();
+	cache_lru.clear();
 	cache_size = 0;
+	cached_pixels.clear();
+	pixel_store.clear();
 
 	for (auto& kv : cache_tiles) {
 		auto& key = kv.first;
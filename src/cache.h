@@ -19,6 +19,8 @@
 #define EP_CACHE_H
 
 // Headers
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -55,8 +57,95 @@ namespace Cache {
 	BitmapRef System2(StringView filename);
 
 	BitmapRef Tile(StringView filename, int tile_id);
+
+	/**
+	 * Starts decoding a downloaded image in the background, so that it is
+	 * already cached when it is loaded.
+	 *
+	 * @param folder_name folder of the image
+	 * @param filename name of the image
+	 * @param done called on the main thread once the image is decoded
+	 * @return false when the file is no image, is already cached or can't be opened.
+	 *         done is not called then.
+	 */
+	bool DecodeAsync(StringView folder_name, StringView filename, std::function<void()> done);
 	BitmapRef SpriteEffect(const BitmapRef& src_bitmap, const Rect& rect, bool flip_x, bool flip_y, const Tone& tone, const Color& blend);
 
+	/** Counters of the sprite effect cache */
+	struct EffectStats {
+		/** Lookups that found a cached bitmap */
+		int64_t hits = 0;
+		/** Lookups that had to render the effect */
+		int64_t misses = 0;
+		/** Misses that rendered into an unused bitmap instead of allocating one */
+		int64_t reused = 0;
+		/** Memory of all cached effect bitmaps */
+		size_t bytes = 0;
+		/** Number of cached effect bitmaps */
+		size_t entries = 0;
+	};
+
+	/** @return counters of the sprite effect cache */
+	const EffectStats& GetEffectStats();
+
+	/** How the cache chooses the unused images it frees when it is over its limit */
+	enum class Eviction {
+		/** Least recently used first */
+		LRU,
+		/** Least frequently used first, big images go before small ones with as many uses */
+		LFU
+	};
+
+	/**
+	 * Configures how many images the cache keeps.
+	 *
+	 * @param limit bytes of images the cache holds, images in use are counted too
+	 * @param policy order in which unused images are freed
+	 */
+	void SetEvictionPolicy(size_t limit, Eviction policy);
+
+	/**
+	 * Parses the name of an eviction policy, e.g. "LRU" or "lfu".
+	 *
+	 * @param name name of the policy
+	 * @param policy set to the parsed policy
+	 * @return false when the name is unknown
+	 */
+	bool ParseEviction(StringView name, Eviction& policy);
+
+	/**
+	 * Keeps an image cached while it is unused, e.g. because the current map will show it again.
+	 * Pinned images still count against the limit.
+	 *
+	 * @param folder_name folder of the image
+	 * @param filename name of the image
+	 */
+	void Pin(StringView folder_name, StringView filename);
+
+	/** Allows the cache to free all pinned images again. */
+	void UnpinAll();
+
+	/** Statistics of the cached images of one folder */
+	struct MaterialStats {
+		/** Folder of the images, e.g. "Picture" */
+		std::string folder;
+		/** Number of cached images */
+		int images = 0;
+		/** Memory of the pixels, pixels shared by several images are counted once */
+		size_t bytes = 0;
+		/** Memory saved because images share the pixels of an equal image */
+		size_t shared_bytes = 0;
+		/** Loads that found the image in the cache */
+		int64_t hits = 0;
+		/** Loads that decoded the image */
+		int64_t misses = 0;
+		/** Images freed to stay below the limit */
+		int64_t evictions = 0;
+	};
+
+	/** @return statistics of the cached images, sorted by folder */
+	std::vector<MaterialStats> GetMaterialStats();
+
 	void Clear();
 
 	/** @return the configured system bitmap, or nullptr if there is no system */
@@ -1,6 +1,9 @@
 #include "chat_multiplayer.h"
+#include <algorithm>
 #include <memory>
+#ifdef EMSCRIPTEN
 #include <emscripten/emscripten.h>
+#endif
 #include <vector>
 #include <utility>
 #include <regex>
@@ -16,7 +19,9 @@
 #include "player.h"
 #include "compiler.h"
 #include "game_map.h"
+#include "game_multiplayer_chat_log.h"
 #include "game_multiplayer_my_data.h"
+#include "game_multiplayer_type_layout.h"
 #include "transition.h"
 
 using namespace Game_Multiplayer;
@@ -29,6 +34,8 @@ namespace {
 		CV_GLOBAL =	2
 	};
 
+	const unsigned int MAXMESSAGES = 2000; // messages kept in the chat log, only their layout is kept until they are drawn
+
 	struct ChatEntry {
 		std::string colorA;
 		std::string colorB;
@@ -55,14 +62,35 @@ namespace {
 		const unsigned int labelPaddingVert = 6; // top margin between label text and bounds
 		const unsigned int labelMargin = 40; // left margin for type box to make space for the label
 
-		BitmapRef typeText;
+		BitmapRef typeText; // rendered type text, wider than the text so typing doesn't reallocate it
+		BitmapRef typeTextBack; // second buffer for edits which move the text behind them
+		unsigned int typeTextWidth = 1; // width of the text in typeText, including shadow
+		FontRef typeFont; // font typeLayout was measured with
+		std::unique_ptr<TypeLayout> typeLayout;
 		BitmapRef label;
 		BitmapRef caret;
 		unsigned int caretIndexTail = 0;
 		unsigned int caretIndexHead = 0;
-		std::vector<unsigned int> typeCharOffsets; // cumulative x offsets for each character in the type box. Used for rendering the caret
 		unsigned int scroll = 0; // horizontal scrolling of type box
 
+		const std::vector<int>& typeCharOffsets() { // cumulative x offsets for each character in the type box. Used for rendering the caret
+			return typeLayout->GetOffsets();
+		}
+
+		// draws the glyphs starting between characters first and last
+		void drawTypeGlyphs(Bitmap& dst, size_t first, size_t last) {
+			const auto& text = typeLayout->GetText();
+			const auto& offsets = typeCharOffsets();
+			for(size_t i = first; i < last; i = typeLayout->NextGlyph(i)) {
+				int exfont = typeLayout->GetExFont(i);
+				if(exfont >= 0) {
+					Text::Draw(dst, offsets[i], 0, *typeFont, *Cache::SystemOrBlack(), 0, exfont, true);
+				} else {
+					Text::Draw(dst, offsets[i], 0, *typeFont, *Cache::SystemOrBlack(), 0, text[i], false);
+				}
+			}
+		}
+
 		unsigned int getLabelMargin() {
 			return (label->GetRect().width>1) ? labelMargin : 0;
 		}
@@ -86,41 +114,103 @@ namespace {
 			const unsigned int labelPad = getLabelMargin();
 			const unsigned int typeVisibleWidth = BOUNDS.width-typePaddingHorz*2-labelPad;
 			auto rect = typeText->GetRect();
-			Rect cutoffRect = Rect(scroll-typeBleed, rect.y, std::min<int>(typeVisibleWidth, rect.width-scroll)+typeBleed*2, rect.height); // crop type text to stay within padding
+			Rect cutoffRect = Rect(scroll-typeBleed, rect.y, std::min<int>(typeVisibleWidth, typeTextWidth-scroll)+typeBleed*2, rect.height); // crop type text to stay within padding
 
 			// draw contents
 			dst.Blit(BOUNDS.x+labelPad+typePaddingHorz-typeBleed, BOUNDS.y+typePaddingVert, *typeText, cutoffRect, Opacity::Opaque());
 			// draw caret
-			dst.Blit(BOUNDS.x+labelPad+typePaddingHorz+typeCharOffsets[caretIndexHead]-scroll, BOUNDS.y+typePaddingVert, *caret, caret->GetRect(), Opacity::Opaque());
+			dst.Blit(BOUNDS.x+labelPad+typePaddingHorz+typeCharOffsets()[caretIndexHead]-scroll, BOUNDS.y+typePaddingVert, *caret, caret->GetRect(), Opacity::Opaque());
 			// draw label
 			dst.Blit(BOUNDS.x+labelPaddingHorz, BOUNDS.y+labelPaddingVert, *label, label->GetRect(), Opacity::Opaque());
 			// draw selection
 			const unsigned int caretStart = std::min<unsigned int>(caretIndexTail, caretIndexHead);
 			const unsigned int caretEnd = std::max<unsigned int>(caretIndexTail, caretIndexHead);
-			const unsigned int selectStart = BOUNDS.x+labelPad+typePaddingHorz+std::max<int>(typeCharOffsets[caretStart]-scroll, -typeBleed);
-			const unsigned int selectEnd = BOUNDS.x+labelPad+typePaddingHorz+std::min<int>(typeCharOffsets[caretEnd]-scroll, typeVisibleWidth+typeBleed);
+			const unsigned int selectStart = BOUNDS.x+labelPad+typePaddingHorz+std::max<int>(typeCharOffsets()[caretStart]-scroll, -typeBleed);
+			const unsigned int selectEnd = BOUNDS.x+labelPad+typePaddingHorz+std::min<int>(typeCharOffsets()[caretEnd]-scroll, typeVisibleWidth+typeBleed);
 			Rect selectedRect = Rect(selectStart, BOUNDS.y+typePaddingVert, selectEnd-selectStart, BOUNDS.height-typePaddingVert*2);
 			dst.FillRect(selectedRect, Color(255, 255, 255, 100));
 		};
 
+		bool GetDamageState(DamageState& state) const override {
+			state.bounds = BOUNDS;
+			state.Add(typeText);
+			state.Add(typeTextWidth);
+			state.Add(label);
+			state.Add(caretIndexTail);
+			state.Add(caretIndexHead);
+			state.Add(scroll);
+			return true;
+		}
+
 		void refreshTheme() { }
 
 		void updateTypeText(std::u32string text) {
-			// get char offsets for each character in type box, for caret positioning
-			typeCharOffsets.clear();
-			Rect accumulatedRect;
-			const unsigned int nChars = text.size();
-			for(int k = 0; k <= nChars; k++) {
-				// for every substring of sizes 0 to N, inclusive, starting at the left
-				std::u32string textSoFar = text.substr(0, k);
-				accumulatedRect = Font::Default()->GetSize(Utils::EncodeUTF(textSoFar)); // absolute offset of character at this point (considering kerning of all previous ones)
-				typeCharOffsets.push_back(accumulatedRect.width);
+			auto font = Font::Default();
+			if(font != typeFont || !typeLayout) {
+				// glyph widths depend on the font, start over
+				typeFont = font;
+				typeLayout = std::make_unique<TypeLayout>([font](char32_t ch) {
+					return font->GetSize(ch).width;
+				}, Font::exfont->GetSize(" ").width);
+				typeText.reset();
+			}
+
+			// only the changed part of the text is measured and drawn again
+			const size_t oldChars = typeLayout->GetText().size();
+			const unsigned int oldWidth = typeTextWidth;
+			const auto edit = typeLayout->SetText(std::move(text));
+			const auto& offsets = typeCharOffsets();
+			const size_t nChars = typeLayout->GetText().size();
+			typeTextWidth = offsets.back()+1; // +1 for the shadow
+			const int height = caret->height();
+
+			if(!typeText) {
+				typeText = Bitmap::Create(std::max<int>(typeTextWidth, 256), height, true);
+				drawTypeGlyphs(*typeText, 0, nChars);
+				return;
+			}
+			if(edit.IsEmpty()) {
+				return;
+			}
+			if(edit.first == oldChars && (int)typeTextWidth <= typeText->width()) {
+				// appended at the end: the columns behind the old text are still empty, draw in place
+				drawTypeGlyphs(*typeText, edit.first, nChars);
+				return;
+			}
+
+			// the glyph in front of the edit casts its shadow into the first edited column and
+			// the first glyph behind it gets the shadow of the edited ones, so both are drawn again
+			auto hasWidth = [&](size_t i) {
+				return offsets[typeLayout->NextGlyph(i)] > offsets[i];
+			};
+			size_t first = edit.first;
+			while(first > 0) {
+				first = typeLayout->GlyphStart(first-1);
+				if(hasWidth(first)) break;
+			}
+			size_t last = edit.new_last;
+			while(last < nChars && !hasWidth(last)) {
+				last = typeLayout->NextGlyph(last);
+			}
+			const int keepLeft = offsets[edit.first]; // columns in front of this are unchanged
+			const int keepRight = last < nChars ? offsets[last]+1 : typeTextWidth; // columns from here on only moved by delta
+			if(last < nChars) {
+				last = typeLayout->NextGlyph(last);
 			}
 
-			// final value assigned to accumulatedRect is whole type string
-			// create Bitmap graphic for text
-			typeText = Bitmap::Create(accumulatedRect.width+1, accumulatedRect.height+1, true);
-			Text::Draw(*typeText, 0, 0, *Font::Default(), *Cache::SystemOrBlack(), 0, Utils::EncodeUTF(text));
+			// draw the edited glyphs into the other buffer and copy the rest around them
+			if(!typeTextBack || typeTextBack->width() < (int)typeTextWidth) {
+				typeTextBack = Bitmap::Create(std::max<int>(typeTextWidth, typeText->width()*2), height, true);
+			} else {
+				typeTextBack->Clear();
+			}
+			drawTypeGlyphs(*typeTextBack, first, last);
+			typeTextBack->BlitFast(0, 0, *typeText, Rect(0, 0, keepLeft, height), Opacity::Opaque());
+			const int oldKeepRight = keepRight-edit.delta;
+			if(oldKeepRight < (int)oldWidth) {
+				typeTextBack->BlitFast(keepRight, 0, *typeText, Rect(oldKeepRight, 0, oldWidth-oldKeepRight, height), Opacity::Opaque());
+			}
+			std::swap(typeText, typeTextBack);
 		}
 
 		void seekCaret(unsigned int seekTail, unsigned int seekHead) {
@@ -129,7 +219,7 @@ namespace {
 			// adjust type box horizontal scrolling based on caret position (always keep it in-bounds)
 			const unsigned int labelPad = getLabelMargin();
 			const unsigned int typeVisibleWidth = BOUNDS.width-typePaddingHorz*2-labelPad;
-			const unsigned int caretOffset = typeCharOffsets[caretIndexHead]; // absolute offset of caret in relation to type text contents
+			const unsigned int caretOffset = typeCharOffsets()[caretIndexHead]; // absolute offset of caret in relation to type text contents
 			const int relativeOffset = caretOffset-scroll; // caret's position relative to viewable portion of type box
 			if(relativeOffset < 0) {
 				// caret escapes from left side. adjust
@@ -179,6 +269,13 @@ namespace {
 			dst.Blit(BOUNDS.x+BOUNDS.width-paddingHorz-rRect.width, BOUNDS.y+paddingVert, *roomStatus, rRect, Opacity::Opaque());
 		};
 
+		bool GetDamageState(DamageState& state) const override {
+			state.bounds = BOUNDS;
+			state.Add(connStatus);
+			state.Add(roomStatus);
+			return true;
+		}
+
 		void refreshTheme() { }
 
 		void setConnectionStatus(bool status) {
@@ -219,15 +316,10 @@ namespace {
 	////////////////
 
 	class DrawableChatLog : public Drawable {
-		struct DrawableChatEntry {
-			ChatEntry* messageData;
-			BitmapRef renderGraphic;
-			bool dirty; // need to redraw? (for when UI skin changes)
-			DrawableChatEntry(ChatEntry* msg) {
-				messageData = msg;
-				renderGraphic = nullptr;
-				dirty = true;
-			}
+		// graphic of a message drawn in the last frame
+		struct RenderedMessage {
+			uint32_t id;
+			BitmapRef graphic;
 		};
 
 		Rect BOUNDS;
@@ -237,20 +329,19 @@ namespace {
 		const unsigned int scrollBleed = 16; // how much to stretch right edge of scroll box offscreen (so only left frame shows)
 
 		Window_Base scrollBox; // box used as rendered design for a scrollbar
-		std::vector<DrawableChatEntry> messages;
+		ChatHistory messages; // layout of every message, graphics are only kept for the visible ones
+		std::vector<RenderedMessage> rendered; // graphics of the messages drawn in the last frame
+		std::vector<RenderedMessage> renderedNext;
 		int scrollPosition = 0;
 		unsigned int scrollContentHeight = 0; // total height of scrollable message log
 		unsigned short visibilityFlags = CV_LOCAL | CV_GLOBAL;
 		BitmapRef currentTheme; // system graphic for the current theme
 
-		void buildMessageGraphic(DrawableChatEntry& msg) {
-			struct Glyph {
-				Utils::TextRet data;
-				Rect dims;
-				unsigned short color;
-			};
-			using GlyphLine = std::vector<Glyph>;
-			auto extractGlyphs = [](StringView str, unsigned short color, GlyphLine& line, unsigned int& width) {
+		ChatLayout buildMessageLayout(const ChatEntry& msg) {
+			ChatLayout layout;
+			// break down whole message string into glyphs for processing.
+			// glyph lookup is performed only at this stage, and their dimensions are saved for line wrapping and drawing.
+			auto extractGlyphs = [&layout](StringView str, uint8_t color) {
 				const auto* iter = str.data();
 				const auto* end = str.data() + str.size();
 				while(iter != end) {
@@ -261,113 +352,50 @@ namespace {
 					if(resp.is_exfont) 	chRect = Font::exfont->GetSize(" ");
 					else 				chRect = Font::Tiny()->GetSize(resp.ch);
 
-					line.push_back({resp, chRect, color});
-					width += chRect.width;
-				}
-			};
-			auto findFirstGlyphOf = [](GlyphLine& line, char32_t ch) -> int {
-				unsigned int nGlyphs = line.size();
-				for(int i = 0; i < nGlyphs; i++) {
-					if(line[i].data.ch == ch) {
-						return i;
-					}
+					ChatGlyph glyph;
+					glyph.ch = resp.ch;
+					glyph.width = chRect.width;
+					glyph.height = chRect.height;
+					glyph.color = color;
+					glyph.is_exfont = resp.is_exfont;
+					layout.glyphs.push_back(glyph);
 				}
-				return -1;
-			};
-			auto findLastGlyphOf = [](GlyphLine& line, char32_t ch) -> int {
-				unsigned int nGlyphs = line.size();
-				for(int i = nGlyphs-1; i >= 0; i--) {
-					if(line[i].data.ch == ch) {
-						return i;
-					}
-				}
-				return -1;
-			};
-			auto moveGlyphsToNext = [](GlyphLine& curr, GlyphLine& next, unsigned int& currWidth, unsigned int& nextWidth, unsigned int amount) {
-				for(int i = 0; i < amount; i++) {
-					auto& glyph = curr.back();
-					unsigned int deltaWidth = glyph.dims.width;
-					next.insert(next.begin(), glyph);
-					nextWidth += deltaWidth;
-					curr.pop_back();
-					currWidth -= deltaWidth;
-				}
-			};
-			auto getLineHeight = [](GlyphLine& line) -> unsigned int {
-				unsigned int height = 0;
-				unsigned int nGlyphs = line.size();
-				for(int i = 0; i < nGlyphs; i++) {
-					height = std::max<unsigned int>(height, line[i].dims.height);
-				}
-				return height;
 			};
+			extractGlyphs(msg.colorA, 1);
+			extractGlyphs(msg.colorB, 2);
+			extractGlyphs(msg.colorC, 0);
 
 			// manual text wrapping
-			const unsigned int maxWidth = BOUNDS.width-scrollFrame-messageMargin*2;
-
-			std::vector<std::pair<GlyphLine, unsigned int>> lines; // individual lines saved so far, along with their y offset
-			unsigned int totalWidth = 0; // maximum width between all lines
-			unsigned int totalHeight = 0; // accumulated height from all lines
-
-			GlyphLine glyphsCurrent; // list of glyphs and their dimensions on current line
-			GlyphLine glyphsNext; // stores glyphs moved down to line below
-			unsigned int widthCurrent = 0; // total width of glyphs on current line
-			unsigned int widthNext = 0; // total width of glyphs on next line
+			layout.Wrap(BOUNDS.width-scrollFrame-messageMargin*2);
+			return layout;
+		}
 
-			// break down whole message string into glyphs for processing.
-			// glyph lookup is performed only at this stage, and their dimensions are saved for subsequent line width recalculations.
-			extractGlyphs(msg.messageData->colorA, 1, glyphsCurrent, widthCurrent);
-			extractGlyphs(msg.messageData->colorB, 2, glyphsCurrent, widthCurrent);
-			extractGlyphs(msg.messageData->colorC, 0, glyphsCurrent, widthCurrent);
-
-			// break down message into fitting lines
-			do {
-				while(widthCurrent > maxWidth) {
-					// as long as current line exceeds maximum width,
-					// move one word from this line down to the next one
-					int lastSpace = findLastGlyphOf(glyphsCurrent, ' ');
-					if(lastSpace != -1 && lastSpace < glyphsCurrent.size()-1) {
-						// there is a word that can be moved down
-						moveGlyphsToNext(glyphsCurrent, glyphsNext, widthCurrent, widthNext, glyphsCurrent.size()-lastSpace-1);
-					} else {
-						// there is not a whole word that can be moved down, so move individual characters.
-						// this case happens when last character in current line is a space,
-						// or when there are no spaces in the current line
-						moveGlyphsToNext(glyphsCurrent, glyphsNext, widthCurrent, widthNext, 1);
-					}
-				}
-				// once line fits, check for line breaks
-				int lineBreak = findFirstGlyphOf(glyphsCurrent, '\n');
-				if(lineBreak != -1) {
-					moveGlyphsToNext(glyphsCurrent, glyphsNext, widthCurrent, widthNext, glyphsCurrent.size()-lineBreak-1);
-				}
-				// save line
-				lines.push_back(std::make_pair(glyphsCurrent, totalHeight));
-				totalWidth = std::max<unsigned int>(totalWidth, widthCurrent);
-				totalHeight += getLineHeight(glyphsCurrent);
-				// repeat this work on the exceeding portion moved down to the line below
-				glyphsCurrent = glyphsNext;
-				glyphsNext.clear();
-				widthCurrent = widthNext;
-				widthNext = 0;
-			} while(glyphsCurrent.size() > 0);
-
-			// once all lines have been saved
-			// render them into a bitmap
-			BitmapRef text_img = Bitmap::Create(totalWidth+1, totalHeight+1, true);
-			int nLines = lines.size();
-			for(int i = 0; i < nLines; i++) {
-				auto& line = lines[i];
+		BitmapRef buildMessageGraphic(const ChatLayout& layout) {
+			BitmapRef text_img = Bitmap::Create(layout.width, layout.height, true);
+			for(size_t i = 0; i < layout.lines.size(); i++) {
 				int glyphOffset = 0;
-				for(int j = 0; j < line.first.size(); j++) {
-					auto& glyph = line.first[j];
-					auto ret = glyph.data;
-					if(EP_UNLIKELY(!ret)) continue;
-					glyphOffset += Text::Draw(*text_img, glyphOffset, line.second, *Font::Tiny(), *currentTheme, glyph.color, ret.ch, ret.is_exfont).width;
+				for(size_t j = layout.lines[i].first; j < layout.LineEnd(i); j++) {
+					auto& glyph = layout.glyphs[j];
+					if(EP_LIKELY(glyph.ch != 0 || glyph.is_exfont)) {
+						Text::Draw(*text_img, glyphOffset, layout.lines[i].y, *Font::Tiny(), *currentTheme, glyph.color, glyph.ch, glyph.is_exfont);
+					}
+					glyphOffset += glyph.width;
 				}
 			}
-			msg.renderGraphic = text_img;
-			msg.dirty = false;
+			return text_img;
+		}
+
+		// graphic of a message that is about to be drawn, kept for the next frame
+		const BitmapRef& getMessageGraphic(const ChatHistory::Message& msg) {
+			auto it = std::find_if(rendered.begin(), rendered.end(), [&msg](const RenderedMessage& r) {
+				return r.id == msg.id;
+			});
+			if(it != rendered.end()) {
+				renderedNext.push_back(std::move(*it));
+			} else {
+				renderedNext.push_back({ msg.id, buildMessageGraphic(msg.layout) });
+			}
+			return renderedNext.back().graphic;
 		}
 
 		void assertScrollBounds() {
@@ -399,11 +427,11 @@ namespace {
 			updateScrollBar();
 		}
 
-		bool messageVisible(DrawableChatEntry& msg, unsigned short v) {
-			return (msg.messageData->visibility & v) > 0;
+		bool messageVisible(const ChatHistory::Message& msg, unsigned short v) {
+			return (msg.visibility & v) > 0;
 		}
 	public:
-		DrawableChatLog(int x, int y, int w, int h) : Drawable(2106632960, Drawable::Flags::Global), BOUNDS(x, y, w, h), scrollBox(0, 0, scrollFrame+scrollBleed, 0, Drawable::Flags::Global) {
+		DrawableChatLog(int x, int y, int w, int h, unsigned int maxMessages) : Drawable(2106632960, Drawable::Flags::Global), BOUNDS(x, y, w, h), scrollBox(0, 0, scrollFrame+scrollBleed, 0, Drawable::Flags::Global), messages(maxMessages) {
 			DrawableMgr::Register(this);
 
 			scrollBox.SetZ(2106632960);
@@ -419,64 +447,68 @@ namespace {
 
 		void Draw(Bitmap& dst) {
 			int nextHeight = -scrollPosition; // y offset to draw next message, from bottom of log panel
-			unsigned int nMessages = messages.size();
-			for(int i = nMessages-1; i >= 0; i--) {
-				DrawableChatEntry& dmsg = messages[i];
+			const size_t nMessages = messages.Size();
+			for(size_t i = 0; i < nMessages; i++) {
+				auto& msg = messages.FromNewest(i);
 				//skip drawing hidden messages
-				if(!messageVisible(dmsg, visibilityFlags)) continue;
+				if(!messageVisible(msg, visibilityFlags)) continue;
 				//
-				auto rect = dmsg.renderGraphic->GetRect();
+				const int msgHeight = msg.layout.height;
 				// accumulate y offset
-				nextHeight += rect.height;
+				nextHeight += msgHeight;
 				// skip drawing offscreen messages, but still accumulate y offset (bottom offscreen)
 				if(nextHeight <= 0) continue;
 				// cutoff message graphic so text does not bleed out of bounds
 				const unsigned int topOffscreen = std::max<int>(nextHeight-BOUNDS.height, 0);
-				Rect cutoffRect = Rect(rect.x, rect.y+topOffscreen, rect.width, std::min<unsigned int>(rect.height, nextHeight)-topOffscreen);
-				// rebuild message graphic if needed
-				if(messages[i].dirty) buildMessageGraphic(dmsg);
+				Rect cutoffRect = Rect(0, topOffscreen, msg.layout.width, std::min<unsigned int>(msgHeight, nextHeight)-topOffscreen);
+				// graphics are only built for messages on screen
+				auto& graphic = getMessageGraphic(msg);
 				//draw
-				dst.Blit(BOUNDS.x+messageMargin, BOUNDS.y+BOUNDS.height-nextHeight+topOffscreen, *(dmsg.renderGraphic), cutoffRect, Opacity::Opaque());
+				dst.Blit(BOUNDS.x+messageMargin, BOUNDS.y+BOUNDS.height-nextHeight+topOffscreen, *graphic, cutoffRect, Opacity::Opaque());
 				// stop drawing offscreen messages (top offscreen)
 				if(nextHeight > BOUNDS.height) break;
 			}
+			// graphics of messages that scrolled out of view are dropped
+			rendered.swap(renderedNext);
+			renderedNext.clear();
 		};
 
+		bool GetDamageState(DamageState& state) const override {
+			// messages never change once added, the newest id tells whether one was added
+			state.bounds = BOUNDS;
+			state.Add(messages.Size());
+			if(messages.Size() > 0) {
+				state.Add(messages.FromNewest(0).id);
+			}
+			state.Add(scrollPosition);
+			state.Add(visibilityFlags);
+			state.Add(currentTheme);
+			return true;
+		}
+
 		void refreshTheme() {
 			auto newTheme = Cache::SystemOrBlack();
 			if(newTheme == currentTheme) return; // do nothing if theme hasn't changed
 
 			currentTheme = newTheme;
 			scrollBox.SetWindowskin(currentTheme);
-			for(int i = 0; i < messages.size(); i++) {
-				messages[i].dirty = true; // all messages now need to be redrawn with different UI skin
-			}
+			rendered.clear(); // visible messages are redrawn with the new UI skin when drawn next, the layout stays
 		}
 
-		void addChatEntry(ChatEntry* messageData) {
-			DrawableChatEntry dMsg = DrawableChatEntry(messageData);
-			buildMessageGraphic(dMsg);
-			messages.push_back(dMsg);
-
-			if(messageVisible(dMsg, visibilityFlags)) {
-				scrollContentHeight += dMsg.renderGraphic->GetRect().height;
-				refreshScroll();
+		void addChatEntry(const ChatEntry& messageData) {
+			if(messages.Full()) {
+				// the oldest message is dropped
+				auto& oldest = messages.Oldest();
+				if(messageVisible(oldest, visibilityFlags)) {
+					scrollContentHeight -= oldest.layout.height;
+				}
 			}
-		}
+			auto& msg = messages.Push(messageData.visibility, buildMessageLayout(messageData));
 
-		void removeChatEntry(ChatEntry* messageData) {
-			unsigned int nMsgs = messages.size();
-			for(int i = 0; i < nMsgs; i++) {
-				DrawableChatEntry& dMsg = messages[i];
-				if(dMsg.messageData == messageData) {
-					if(messageVisible(dMsg, visibilityFlags)) {
-						scrollContentHeight -= dMsg.renderGraphic->GetRect().height;
-						refreshScroll();
-					}
-					messages.erase(messages.begin()+i);
-					break;
-				}
+			if(messageVisible(msg, visibilityFlags)) {
+				scrollContentHeight += msg.layout.height;
 			}
+			refreshScroll();
 		}
 
 		void setScroll(int s) {
@@ -508,10 +540,11 @@ namespace {
 			int postAnchorY = -scrollPosition;
 			bool anchored = false; // if true, anchor has been found, so stop accumulating message heights
 			//
-			for(int i = messages.size()-1; i >= 0; i--) {
-				bool preVis = messageVisible(messages[i], visibilityFlags); // is message visible with previous visibility mask?
-				bool postVis = messageVisible(messages[i], newVisibilityFlags); // is message visible with new visibility mask?
-				unsigned int msgHeight = messages[i].renderGraphic->GetRect().height;
+			for(size_t i = 0; i < messages.Size(); i++) {
+				auto& msg = messages.FromNewest(i);
+				bool preVis = messageVisible(msg, visibilityFlags); // is message visible with previous visibility mask?
+				bool postVis = messageVisible(msg, newVisibilityFlags); // is message visible with new visibility mask?
+				unsigned int msgHeight = msg.layout.height;
 				// accumulate total content height for new visibility flags
 				if(postVis) newContentHeight += msgHeight;
 
@@ -564,7 +597,7 @@ namespace {
 		DrawableChat() : Drawable(2106632960, Drawable::Flags::Global),
 		// stretch 16px at right, top and bottom sides so the edge frame only shows on left
 		backPanel(SCREEN_TARGET_WIDTH, -panelBleed, CHAT_TARGET_WIDTH+panelBleed, SCREEN_TARGET_HEIGHT+panelBleed*2, Drawable::Flags::Global),
-		dLog(SCREEN_TARGET_WIDTH+panelFrame, statusHeight, CHAT_TARGET_WIDTH-panelFrame, SCREEN_TARGET_HEIGHT-statusHeight),
+		dLog(SCREEN_TARGET_WIDTH+panelFrame, statusHeight, CHAT_TARGET_WIDTH-panelFrame, SCREEN_TARGET_HEIGHT-statusHeight, MAXMESSAGES),
 		dType(SCREEN_TARGET_WIDTH+panelFrame, SCREEN_TARGET_HEIGHT-typeHeight, CHAT_TARGET_WIDTH-panelFrame, typeHeight),
 		dStatus(SCREEN_TARGET_WIDTH+panelFrame, 0, CHAT_TARGET_WIDTH-panelFrame-fullscreenIconMargin, statusHeight)
 		{
@@ -576,12 +609,13 @@ namespace {
 
 		void Draw(Bitmap& dst) { }
 
-		void addLogEntry(ChatEntry* msg) {
-			dLog.addChatEntry(msg);
+		bool GetDamageState(DamageState& state) const override {
+			// draws nothing itself
+			return true;
 		}
 
-		void removeLogEntry(ChatEntry* msg) {
-			dLog.removeChatEntry(msg);
+		void addLogEntry(const ChatEntry& msg) {
+			dLog.addChatEntry(msg);
 		}
 
 		void setStatusConnection(bool conn) {
@@ -647,29 +681,25 @@ namespace {
 	const unsigned int MAXCHARSINPUT_TRIPCODE = 256;
 	const unsigned int MAXCHARSINPUT_MESSAGE = 200;
 
-	const unsigned int MAXMESSAGES = 100;
-
 	// TODO: have name and tripcode be on the same step (one typebox under another)
 	std::string cacheName = ""; // name and tripcode are input in separate steps. Save it to send them together.
 	std::u32string preloadTrip; // saved tripcode preference to load into trip type box once name has been sent.
 	std::unique_ptr<DrawableChat> chatBox; //chat renderer
-	std::vector<std::unique_ptr<ChatEntry>> chatLog;
 
 	void addLogEntry(std::string a, std::string b, std::string c, VisibilityType v) {
-		chatLog.push_back(std::make_unique<ChatEntry>(a, b, c, v));
-		chatBox->addLogEntry(chatLog.back().get());
-		if(chatLog.size() > MAXMESSAGES) {
-			chatBox->removeLogEntry(chatLog.front().get());
-			chatLog.erase(chatLog.begin());
-		}
+		chatBox->addLogEntry(ChatEntry(a, b, c, v));
 	}
 
 	void setTypeText(std::u32string text) {
+		#ifdef EMSCRIPTEN
 		EM_ASM({ setTypeText(UTF8ToString($0)); }, Utils::EncodeUTF(text).c_str());
+		#endif
 	}
 
 	void setTypeMaxChars(unsigned int c) {
+		#ifdef EMSCRIPTEN
 		EM_ASM({ setTypeMaxChars($0); }, c);
+		#endif
 	}
 
 	void processAndSendMessage(std::string utf8text) {
@@ -715,7 +745,9 @@ namespace {
 				}
 			} else { //inputting trip
 				// send
+				#ifdef EMSCRIPTEN
 				EM_ASM({ SendProfileInfo(UTF8ToString($0), UTF8ToString($1)); }, cacheName.c_str(), utf8text.c_str());
+				#endif
 				// reset typebox
 				setTypeText(std::u32string());
 				// change chatbox state to allow for chat
@@ -737,6 +769,7 @@ namespace {
 			chatBox->showTypeLabel("Name");
 		}
 
+		#ifdef EMSCRIPTEN
 		// load saved user profile preferences from JS side (name)
 		char* configNameStr = (char*)EM_ASM_INT({
 			var str = getProfileConfigName();
@@ -760,6 +793,10 @@ namespace {
 		std::string cfgTripStr = configTripStr;
 		preloadTrip = Utils::DecodeUTF32(cfgTripStr);
 		free(configTripStr);
+		#else
+		// no saved profile outside of the browser
+		setTypeMaxChars(MAXCHARSINPUT_NAME);
+		#endif
 
 		if (Player::IsCP936()) {
 			addLogEntry("", "输入法现已支持！", "", CV_LOCAL);
@@ -835,7 +872,9 @@ namespace {
 		Input::setGameFocus(!focused);
 		chatBox->setFocus(focused);
 
+		#ifdef EMSCRIPTEN
 		EM_ASM({ setChatFocus($0); }, focused);
+		#endif
 	}
 
 	void inputsFocusUnfocus() {
@@ -0,0 +1,174 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <algorithm>
+#include "compositor.h"
+#include "drawable_list.h"
+
+namespace {
+	Rect Clip(Rect rect, const Rect& screen) {
+		rect.Adjust(screen);
+		return rect.IsEmpty() ? Rect() : rect;
+	}
+
+	Rect Union(const Rect& a, const Rect& b) {
+		int x = std::min(a.x, b.x);
+		int y = std::min(a.y, b.y);
+		int right = std::max(a.x + a.width, b.x + b.width);
+		int bottom = std::max(a.y + a.height, b.y + b.height);
+		return Rect(x, y, right - x, bottom - y);
+	}
+
+	int64_t Area(const Rect& rect) {
+		return static_cast<int64_t>(rect.width) * rect.height;
+	}
+}
+
+void Compositor::SetEnabled(bool enabled) {
+	if (this->enabled != enabled) {
+		this->enabled = enabled;
+		entries.clear();
+		invalidated = true;
+	}
+}
+
+bool Compositor::Collect(const DrawableList& list, const Rect& screen, uint64_t frame_key, bool force_full) {
+	damage.clear();
+
+	if (!enabled) {
+		repainted_pixels = Area(screen);
+		return false;
+	}
+
+	bool full = force_full || invalidated || screen != last_screen || frame_key != last_frame_key;
+	invalidated = false;
+	last_screen = screen;
+	last_frame_key = frame_key;
+
+	next_entries.clear();
+	for (auto* drawable : list) {
+		Entry entry = { drawable, Rect(), 0 };
+		if (drawable->IsVisible()) {
+			Drawable::DamageState state;
+			if (drawable->GetDamageState(state)) {
+				state.Add(drawable->GetZ());
+				entry.bounds = Clip(state.bounds, screen);
+				entry.key = state.key;
+			} else {
+				// Drawn every frame, when it gets tracked the whole screen is damaged once
+				full = true;
+				entry.bounds = screen;
+			}
+		}
+		next_entries.push_back(entry);
+	}
+
+	// Entries are matched by address. A new drawable at the address of a deleted one
+	// with the same state draws the same pixels, so it needs no redraw either.
+	auto by_address = [](const Entry& l, const Entry& r) { return l.drawable < r.drawable; };
+	std::sort(next_entries.begin(), next_entries.end(), by_address);
+
+	if (!full) {
+		auto old_it = entries.begin();
+		auto new_it = next_entries.begin();
+		while (old_it != entries.end() || new_it != next_entries.end()) {
+			if (new_it == next_entries.end() || (old_it != entries.end() && old_it->drawable < new_it->drawable)) {
+				AddDamage(old_it->bounds);
+				++old_it;
+			} else if (old_it == entries.end() || new_it->drawable < old_it->drawable) {
+				AddDamage(new_it->bounds);
+				++new_it;
+			} else {
+				if (old_it->bounds != new_it->bounds || old_it->key != new_it->key) {
+					AddDamage(old_it->bounds);
+					AddDamage(new_it->bounds);
+				}
+				++old_it;
+				++new_it;
+			}
+		}
+	}
+	entries.swap(next_entries);
+
+	int64_t area = 0;
+	if (!full) {
+		MergeRects(damage, screen);
+		for (auto& rect : damage) {
+			area += Area(rect);
+		}
+		full = area * 100 > Area(screen) * max_area_percent;
+	}
+
+	if (full) {
+		damage.clear();
+		repainted_pixels = Area(screen);
+		return false;
+	}
+
+	repainted_pixels = area;
+	return true;
+}
+
+void Compositor::AddDamage(const Rect& rect) {
+	if (!rect.IsEmpty()) {
+		damage.push_back(rect);
+	}
+}
+
+void Compositor::MergeRects(std::vector<Rect>& rects, const Rect& screen) {
+	for (auto& rect : rects) {
+		rect = Clip(rect, screen);
+	}
+	rects.erase(std::remove_if(rects.begin(), rects.end(), [](const Rect& rect) { return rect.IsEmpty(); }), rects.end());
+
+	auto collapse = [&rects]() {
+		Rect all = rects.front();
+		for (auto& rect : rects) {
+			all = Union(all, rect);
+		}
+		rects.assign(1, all);
+	};
+
+	// Merging is quadratic, with this many changes the bounding box is close enough
+	if (rects.size() > max_rects * 4) {
+		collapse();
+		return;
+	}
+
+	// The union of two overlapping rectangles can overlap others, repeat until all are disjoint
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (size_t i = 0; i < rects.size(); ++i) {
+			for (size_t j = i + 1; j < rects.size();) {
+				if (!rects[i].IsOutOfBounds(rects[j])) {
+					rects[i] = Union(rects[i], rects[j]);
+					rects[j] = rects.back();
+					rects.pop_back();
+					merged = true;
+				} else {
+					++j;
+				}
+			}
+		}
+	}
+
+	if (rects.size() > max_rects) {
+		collapse();
+	}
+}
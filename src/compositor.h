@@ -0,0 +1,121 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_COMPOSITOR_H
+#define EP_COMPOSITOR_H
+
+// Headers
+#include <cstdint>
+#include <vector>
+#include "drawable.h"
+#include "rect.h"
+
+class DrawableList;
+
+/**
+ * Finds the parts of the screen that changed since the last frame.
+ *
+ * Every frame the damage state of all drawables is compared with the one of
+ * the last frame. The old and the new area of every drawable that changed,
+ * appeared or disappeared is damaged. Only the damaged areas must be redrawn
+ * as long as the screen still holds the last frame.
+ */
+class Compositor {
+public:
+	/** Damaged rectangles before they are merged into one */
+	static constexpr size_t max_rects = 16;
+	/** Share of the screen in percent above which the whole screen is redrawn */
+	static constexpr int max_area_percent = 60;
+
+	/**
+	 * Enables the damage tracking. When disabled every frame is a full redraw.
+	 *
+	 * @param enabled whether to track damage
+	 */
+	void SetEnabled(bool enabled);
+
+	/** @return whether damage is tracked */
+	bool IsEnabled() const;
+
+	/**
+	 * Redraws the whole screen in the next frame, e.g. after something else
+	 * has drawn to it.
+	 */
+	void Invalidate();
+
+	/**
+	 * Compares the drawables with the last frame and collects the damage.
+	 *
+	 * @param list drawables of the frame
+	 * @param screen rectangle of the screen
+	 * @param frame_key hash of everything else the frame depends on
+	 * @param force_full redraw the whole screen, the drawables are still compared for the next frame
+	 * @return true when only the rectangles of GetDamage() must be redrawn,
+	 * false when the whole screen must be redrawn
+	 */
+	bool Collect(const DrawableList& list, const Rect& screen, uint64_t frame_key, bool force_full = false);
+
+	/** @return disjoint rectangles to redraw, only valid when Collect returned true */
+	const std::vector<Rect>& GetDamage() const;
+
+	/** @return number of pixels redrawn in the last frame */
+	int64_t GetRepaintedPixels() const;
+
+	/**
+	 * Merges overlapping rectangles and clips them to the screen.
+	 *
+	 * @param rects rectangles to merge
+	 * @param screen rectangle of the screen
+	 */
+	static void MergeRects(std::vector<Rect>& rects, const Rect& screen);
+
+private:
+	struct Entry {
+		const Drawable* drawable;
+		Rect bounds;
+		uint64_t key;
+	};
+
+	void AddDamage(const Rect& rect);
+
+	std::vector<Entry> entries;
+	std::vector<Entry> next_entries;
+	std::vector<Rect> damage;
+	Rect last_screen;
+	uint64_t last_frame_key = 0;
+	int64_t repainted_pixels = 0;
+	bool enabled = false;
+	bool invalidated = true;
+};
+
+inline bool Compositor::IsEnabled() const {
+	return enabled;
+}
+
+inline void Compositor::Invalidate() {
+	invalidated = true;
+}
+
+inline const std::vector<Rect>& Compositor::GetDamage() const {
+	return damage;
+}
+
+inline int64_t Compositor::GetRepaintedPixels() const {
+	return repainted_pixels;
+}
+
+#endif
@@ -138,6 +138,38 @@ void DirectoryTree::ClearCache(StringView path) const {
 	}
 }
 
+void DirectoryTree::AddFile(StringView path) const {
+	DebugLog("AddFile: {}", path);
+
+	std::string dir, name;
+	std::tie(dir, name) = FileFinder::GetPathAndFilename(FileFinder::MakeCanonical(path, 0));
+	if (name.empty()) {
+		return;
+	}
+
+	AddEntry(dir, name, FileType::Regular);
+}
+
+void DirectoryTree::AddEntry(StringView dir, StringView name, FileType type) const {
+	auto dir_key = make_key(dir);
+	auto fs_it = fs_cache.find(dir_key);
+	if (fs_it == fs_cache.end()) {
+		// Listing the directory later will find the entry.
+		// The directory itself could be new and missing in the listing of the parent.
+		if (!dir.empty()) {
+			std::string parent_dir, child_dir;
+			std::tie(parent_dir, child_dir) = FileFinder::GetPathAndFilename(dir);
+			AddEntry(parent_dir, child_dir, FileType::Directory);
+		}
+		return;
+	}
+
+	auto name_key = make_key(name);
+	if (fs_it->second.find(name_key) == fs_it->second.end()) {
+		fs_it->second.emplace(std::move(name_key), Entry(ToString(name), type));
+	}
+}
+
 std::string DirectoryTree::FindFile(StringView filename, Span<StringView> exts) const {
 	return FindFile({ ToString(filename), exts });
 }
@@ -128,7 +128,18 @@ public:
 
 	void ClearCache(StringView path) const;
 
+	/**
+	 * Adds a new file to the cached listing of its directory.
+	 * Directories of the path that are not listed yet are added to the
+	 * listing of their parent directory.
+	 *
+	 * @param path Path of the file relative to the filesystem root
+	 */
+	void AddFile(StringView path) const;
+
 private:
+	void AddEntry(StringView dir, StringView name, FileType type) const;
+
 	Filesystem* fs = nullptr;
 
 	/** lowered dir (full path from root) -> <map of> lowered file -> Entry */
@@ -16,7 +16,9 @@
  */
 
 #include "drawable.h"
+#include <cstring>
 #include <lcf/rpg/savepicture.h>
+#include "bitmap.h"
 #include "drawable_mgr.h"
 
 Drawable::~Drawable() {
@@ -28,6 +30,48 @@ void Drawable::SetZ(int nz) {
 	_z = nz;
 }
 
+bool Drawable::GetDamageState(DamageState&) const {
+	return false;
+}
+
+void Drawable::DamageState::SetFullScreen() {
+	bounds = Rect(-0x8000, -0x8000, 0x10000, 0x10000);
+}
+
+void Drawable::DamageState::Add(double value) {
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	Add(bits);
+}
+
+void Drawable::DamageState::Add(const Rect& rect) {
+	Add(rect.x);
+	Add(rect.y);
+	Add(rect.width);
+	Add(rect.height);
+}
+
+void Drawable::DamageState::Add(const Color& color) {
+	Add(color.red);
+	Add(color.green);
+	Add(color.blue);
+	Add(color.alpha);
+}
+
+void Drawable::DamageState::Add(const Tone& tone) {
+	Add(tone.red);
+	Add(tone.green);
+	Add(tone.blue);
+	Add(tone.gray);
+}
+
+void Drawable::DamageState::Add(const Bitmap* bitmap) {
+	Add(reinterpret_cast<uintptr_t>(bitmap));
+	if (bitmap) {
+		Add(bitmap->GetGeneration());
+	}
+}
+
 int Drawable::GetPriorityForMapLayer(int which) {
 	switch (which) {
 		case lcf::rpg::SavePicture::MapLayer_parallax:
@@ -20,6 +20,10 @@
 
 #include <cstdint>
 #include <memory>
+#include <type_traits>
+#include "color.h"
+#include "rect.h"
+#include "tone.h"
 
 class Bitmap;
 class Drawable;
@@ -68,6 +72,30 @@ public:
 		Default = None
 	};
 
+	/**
+	 * Screen area covered by a drawable and a hash of everything that decides
+	 * what it draws there. Used to only redraw the parts of the screen that changed.
+	 */
+	struct DamageState {
+		/** Area the drawable draws to, empty when it draws nothing */
+		Rect bounds;
+		/** Hash of the drawing state */
+		uint64_t key = 0;
+
+		/** Sets bounds to an area larger than every screen */
+		void SetFullScreen();
+
+		template <typename T, typename = std::enable_if_t<std::is_integral<T>::value || std::is_enum<T>::value>>
+		void Add(T value);
+		void Add(double value);
+		void Add(const Rect& rect);
+		void Add(const Color& color);
+		void Add(const Tone& tone);
+		/** Adds the identity and the generation of a bitmap */
+		void Add(const Bitmap* bitmap);
+		void Add(const std::shared_ptr<Bitmap>& bitmap);
+	};
+
 	Drawable(int z, Flags flags = Flags::Default);
 
 	Drawable(const Drawable&) = delete;
@@ -77,6 +105,16 @@ public:
 
 	virtual void Draw(Bitmap& dst) = 0;
 
+	/**
+	 * Describes what the drawable will draw in the next Draw call.
+	 * Drawables which can't tell this in advance keep the default, the whole
+	 * screen is redrawn while they are visible.
+	 *
+	 * @param state filled with the area and the hash of the drawing state
+	 * @return false when the drawable doesn't track its damage
+	 */
+	virtual bool GetDamageState(DamageState& state) const;
+
 	int GetZ() const;
 
 	void SetZ(int z);
@@ -137,6 +175,16 @@ inline Drawable::Drawable(int z, Flags flags)
 {
 }
 
+template <typename T, typename>
+inline void Drawable::DamageState::Add(T value) {
+	// boost::hash_combine with a 64 bit constant
+	key ^= static_cast<uint64_t>(value) + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+}
+
+inline void Drawable::DamageState::Add(const std::shared_ptr<Bitmap>& bitmap) {
+	Add(bitmap.get());
+}
+
 inline int Drawable::GetZ() const {
 	return _z;
 }
@@ -22,6 +22,7 @@
 #include "filefinder.h"
 #include "utils.h"
 #include "output.h"
+#include "platform.h"
 #include "player.h"
 #include <lcf/reader_util.h>
 #include <algorithm>
@@ -34,8 +35,12 @@ Filesystem::Filesystem(std::string base_path, FilesystemView parent_fs) : base_p
 };
 
 Filesystem_Stream::InputStream Filesystem::OpenInputStream(StringView name, std::ios_base::openmode m) const {
-	std::streambuf* buf = CreateInputStreambuffer(name, m | std::ios_base::in);
+	Span<const uint8_t> memory;
+	std::streambuf* buf = CreateInputStreambuffer(name, m | std::ios_base::in, memory);
 	Filesystem_Stream::InputStream is(buf, ToString(name));
+	if (buf) {
+		is.SetMemory(memory);
+	}
 	return is;
 }
 
@@ -49,10 +54,18 @@ Filesystem_Stream::OutputStream Filesystem::OpenOutputStream(StringView name, st
 	return os;
 }
 
+std::unique_ptr<Platform::MappedFile> Filesystem::MapFile(StringView) const {
+	return nullptr;
+}
+
 void Filesystem::ClearCache(StringView path) const {
 	tree->ClearCache(path);
 }
 
+void Filesystem::AddFileToCache(StringView path) const {
+	tree->AddFile(path);
+}
+
 FilesystemView Filesystem::Create(StringView path) const {
 	// Determine the proper file system to use
 
@@ -203,6 +216,11 @@ void FilesystemView::ClearCache() const {
 	fs->ClearCache(GetSubPath());
 }
 
+void FilesystemView::AddFileToCache(StringView path) const {
+	assert(fs);
+	fs->AddFileToCache(MakePath(path));
+}
+
 std::string FilesystemView::FindFile(StringView name, Span<StringView> exts) const {
 	assert(fs);
 	std::string found = fs->FindFile(MakePath(name), exts);
@@ -304,9 +322,9 @@ Filesystem_Stream::OutputStream FilesystemView::OpenOutputStream(StringView name
 	return fs->OpenOutputStream(MakePath(name), m);
 }
 
-std::streambuf* FilesystemView::CreateInputStreambuffer(StringView path, std::ios_base::openmode mode) const {
+std::streambuf* FilesystemView::CreateInputStreambuffer(StringView path, std::ios_base::openmode mode, Span<const uint8_t>& memory) const {
 	assert(fs);
-	return fs->CreateInputStreambuffer(MakePath(path), mode);
+	return fs->CreateInputStreambuffer(MakePath(path), mode, memory);
 }
 
 std::streambuf* FilesystemView::CreateOutputStreambuffer(StringView path, std::ios_base::openmode mode) const {
@@ -314,6 +332,11 @@ std::streambuf* FilesystemView::CreateOutputStreambuffer(StringView path, std::i
 	return fs->CreateOutputStreambuffer(MakePath(path), mode);
 }
 
+std::unique_ptr<Platform::MappedFile> FilesystemView::MapFile(StringView path) const {
+	assert(fs);
+	return fs->MapFile(MakePath(path));
+}
+
 FilesystemView FilesystemView::Create(StringView p) const {
 	assert(fs);
 	return fs->Create(MakePath(p));
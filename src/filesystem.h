@@ -33,6 +33,9 @@ namespace Filesystem_Stream {
 	class InputStream;
 	class OutputStream;
 }
+namespace Platform {
+	class MappedFile;
+}
 
 /**
  * The base class for a filesystem abstraction.
@@ -115,6 +118,15 @@ public:
 	 */
 	void ClearCache(StringView path) const;
 
+	/**
+	 * Adds a file that was created outside of the filesystem API (e.g. a
+	 * download) to the filesystem cache. Unlike ClearCache the other cached
+	 * directories stay valid.
+	 *
+	 * @param path Path of the new file
+	 */
+	void AddFileToCache(StringView path) const;
+
 	/**
 	 * Creates a new appropriate filesystem from the specified path.
 	 * The path is processed to initialize the proper virtual filesystem handler.
@@ -218,10 +230,25 @@ protected:
 	 */
 	/** @{ */
 	virtual bool GetDirectoryContent(StringView path, std::vector<DirectoryTree::Entry>& entries) const = 0;
-	virtual std::streambuf* CreateInputStreambuffer(StringView path, std::ios_base::openmode mode) const = 0;
+	/**
+	 * Opens a streambuffer for reading.
+	 * When the streambuffer reads directly from memory, e.g. an uncompressed
+	 * file of a memory mapped archive, memory is set to the content of the file.
+	 * The memory stays valid as long as the streambuffer exists.
+	 */
+	virtual std::streambuf* CreateInputStreambuffer(StringView path, std::ios_base::openmode mode, Span<const uint8_t>& memory) const = 0;
 	virtual std::streambuf* CreateOutputStreambuffer(StringView path, std::ios_base::openmode mode) const;
 	/** @} */
 
+	/**
+	 * Maps a file read-only into memory.
+	 * Only filesystems of the host system can implement this.
+	 *
+	 * @param path a path relative to the filesystems root
+	 * @return the mapping or nullptr when mapping is not supported or failed
+	 */
+	virtual std::unique_ptr<Platform::MappedFile> MapFile(StringView path) const;
+
 	/**
 	 * Creates a new filesystem
 	 *
@@ -276,6 +303,15 @@ public:
 	 */
 	void ClearCache() const;
 
+	/**
+	 * Adds a file that was created outside of the filesystem API (e.g. a
+	 * download) to the filesystem cache. Unlike ClearCache the other cached
+	 * directories stay valid.
+	 *
+	 * @param path Path of the new file
+	 */
+	void AddFileToCache(StringView path) const;
+
 	/**
 	 * Does a case insensitive search for the file.
 	 *
@@ -404,9 +440,10 @@ public:
 	 * @see OpenInputStream
 	 * @param path filename.
 	 * @param mode stream mode.
+	 * @param memory set to the content of the file when the stream reads from memory.
 	 * @return A Stream. The stream is invalid when the open failed.
 	 */
-	std::streambuf* CreateInputStreambuffer(StringView path, std::ios_base::openmode mode) const;
+	std::streambuf* CreateInputStreambuffer(StringView path, std::ios_base::openmode mode, Span<const uint8_t>& memory) const;
 
 	/**
 	 * Creates stream from filename for writing.
@@ -419,6 +456,15 @@ public:
 	 */
 	std::streambuf* CreateOutputStreambuffer(StringView path, std::ios_base::openmode mode) const;
 
+	/**
+	 * Maps a file read-only into memory.
+	 * Only supported for files of the host system on Linux and macOS.
+	 *
+	 * @param path filename.
+	 * @return the mapping or nullptr when mapping is not supported or failed
+	 */
+	std::unique_ptr<Platform::MappedFile> MapFile(StringView path) const;
+
 	/**
 	 * Creates a new appropriate filesystem from the specified path.
 	 * The path is processed to initialize the proper virtual filesystem handler.
@@ -47,7 +47,7 @@ int64_t NativeFilesystem::GetFilesize(StringView path) const {
 	return Platform::File(ToString(path)).GetSize();
 }
 
-std::streambuf* NativeFilesystem::CreateInputStreambuffer(StringView path, std::ios_base::openmode mode) const {
+std::streambuf* NativeFilesystem::CreateInputStreambuffer(StringView path, std::ios_base::openmode mode, Span<const uint8_t>&) const {
 	auto* buf = new std::filebuf();
 	buf->open(
 #ifdef _MSC_VER
@@ -123,6 +123,14 @@ bool NativeFilesystem::IsFeatureSupported(Feature f) const {
 	return f == Filesystem::Feature::Write;
 }
 
+std::unique_ptr<Platform::MappedFile> NativeFilesystem::MapFile(StringView path) const {
+	auto mapping = std::make_unique<Platform::MappedFile>(ToString(path));
+	if (!*mapping) {
+		return nullptr;
+	}
+	return mapping;
+}
+
 std::string NativeFilesystem::Describe() const {
 	return fmt::format("[Native] {}", GetPath());
 }
@@ -17,6 +17,7 @@
 
 #include "filesystem_root.h"
 #include "output.h"
+#include "platform.h"
 
 constexpr const StringView root_ns = "root://";
 
@@ -64,8 +65,8 @@ int64_t RootFilesystem::GetFilesize(StringView  path) const {
 	return FilesystemForPath(path).GetFilesize(path);
 }
 
-std::streambuf* RootFilesystem::CreateInputStreambuffer(StringView path, std::ios_base::openmode mode) const {
-	return FilesystemForPath(path).CreateInputStreambuffer(path, mode);
+std::streambuf* RootFilesystem::CreateInputStreambuffer(StringView path, std::ios_base::openmode mode, Span<const uint8_t>& memory) const {
+	return FilesystemForPath(path).CreateInputStreambuffer(path, mode, memory);
 }
 
 std::streambuf* RootFilesystem::CreateOutputStreambuffer(StringView path, std::ios_base::openmode mode) const {
@@ -73,6 +74,10 @@ std::streambuf* RootFilesystem::CreateOutputStreambuffer(StringView path, std::i
 
 }
 
+std::unique_ptr<Platform::MappedFile> RootFilesystem::MapFile(StringView path) const {
+	return FilesystemForPath(path).MapFile(path);
+}
+
 bool RootFilesystem::GetDirectoryContent(StringView path, std::vector<DirectoryTree::Entry>& tree) const {
 	if (path.empty()) {
 		// Debug feature: Return all available namespaces as a directory list
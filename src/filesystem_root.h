@@ -64,10 +64,11 @@ protected:
 	bool IsDirectory(StringView path, bool follow_symlinks) const override;
 	bool Exists(StringView path) const override;
 	int64_t GetFilesize(StringView path) const override;
-	std::streambuf* CreateInputStreambuffer(StringView path, std::ios_base::openmode mode) const override;
+	std::streambuf* CreateInputStreambuffer(StringView path, std::ios_base::openmode mode, Span<const uint8_t>& memory) const override;
 	std::streambuf* CreateOutputStreambuffer(StringView path, std::ios_base::openmode mode) const override;
 	bool GetDirectoryContent(StringView path, std::vector<DirectoryTree::Entry>& entries) const override;
 	std::string Describe() const override;
+	std::unique_ptr<Platform::MappedFile> MapFile(StringView path) const override;
 	/** @} */
 
 private:
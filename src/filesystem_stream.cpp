@@ -30,6 +30,8 @@ Filesystem_Stream::InputStream::InputStream(InputStream&& is) noexcept : std::is
 	set_rdbuf(is.rdbuf());
 	is.set_rdbuf(nullptr);
 	name = std::move(is.name);
+	memory = is.memory;
+	is.memory = {};
 }
 
 Filesystem_Stream::InputStream& Filesystem_Stream::InputStream::operator=(InputStream&& is) noexcept {
@@ -37,6 +39,8 @@ Filesystem_Stream::InputStream& Filesystem_Stream::InputStream::operator=(InputS
 	set_rdbuf(is.rdbuf());
 	is.set_rdbuf(nullptr);
 	name = std::move(is.name);
+	memory = is.memory;
+	is.memory = {};
 	std::istream::operator=(std::move(is));
 	return *this;
 }
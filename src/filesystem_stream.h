@@ -38,6 +38,22 @@ namespace Filesystem_Stream {
 
 		StringView GetName() const;
 
+		/**
+		 * Returns the whole content of the file when the filesystem provides it
+		 * in memory. Reading it is faster than reading the stream.
+		 *
+		 * @return content of the file, empty when the file is not in memory
+		 */
+		Span<const uint8_t> GetMemory() const;
+
+		/**
+		 * Sets the in memory content of the file.
+		 * This is an internal function used by Filesystem::OpenInputStream.
+		 *
+		 * @param data content of the file, must stay valid while the streambuffer exists
+		 */
+		void SetMemory(Span<const uint8_t> data);
+
 		template <typename T>
 		bool ReadIntoObj(T& obj);
 
@@ -46,6 +62,7 @@ namespace Filesystem_Stream {
 		bool Read0(T& obj);
 
 		std::string name;
+		Span<const uint8_t> memory;
 	};
 
 	class OutputStream final : public std::ostream {
@@ -84,6 +101,14 @@ namespace Filesystem_Stream {
 	static constexpr int CppSeekdirToCSeekdir(std::ios_base::seekdir origin);
 };
 
+inline Span<const uint8_t> Filesystem_Stream::InputStream::GetMemory() const {
+	return memory;
+}
+
+inline void Filesystem_Stream::InputStream::SetMemory(Span<const uint8_t> data) {
+	memory = data;
+}
+
 template<typename T>
 inline bool Filesystem_Stream::InputStream::Read0(T& obj) {
 	return read(reinterpret_cast<char*>(&obj), sizeof(obj)).gcount() == sizeof(obj);
@@ -18,6 +18,7 @@
 #include "filesystem_zip.h"
 #include "filefinder.h"
 #include "output.h"
+#include "platform.h"
 #include "utils.h"
 
 #include <zlib.h>
@@ -26,6 +27,8 @@
 #include <sstream>
 #include <cassert>
 #include <algorithm>
+#include <cstring>
+#include <mutex>
 #include <fmt/core.h>
 
 constexpr uint32_t end_of_central_directory = 0x06054b50;
@@ -35,6 +38,242 @@ constexpr uint32_t central_directory_entry = 0x02014b50;
 constexpr uint32_t local_header = 0x04034b50;
 constexpr uint32_t local_header_size = 30;
 
+// Files up to this size are inflated at once and kept in the input pool,
+// bigger ones (music, movies, the database) are inflated while they are read.
+constexpr uint32_t pool_file_limit = 256 * 1024;
+constexpr size_t pool_limit = 4 * 1024 * 1024;
+
+constexpr size_t stream_chunk_size = 32 * 1024;
+
+class ZipFilesystem::Archive {
+public:
+	Archive(Filesystem_Stream::InputStream stream, std::unique_ptr<Platform::MappedFile> mapping) :
+		mapping(std::move(mapping)), stream(std::move(stream)) {}
+
+	/**
+	 * Returns a part of the zip file when it is memory mapped.
+	 *
+	 * @return the memory, empty when the file is not mapped or the range is outside of the file
+	 */
+	Span<const uint8_t> Memory(uint32_t offset, size_t size) const {
+		if (!mapping || offset > mapping->GetSize() || size > mapping->GetSize() - offset) {
+			return {};
+		}
+		return Span<const uint8_t>(mapping->GetData() + offset, size);
+	}
+
+	/**
+	 * Reads from the zip file, streams of other threads share it.
+	 *
+	 * @return number of bytes read
+	 */
+	size_t Read(uint32_t offset, void* buffer, size_t size) {
+		if (mapping) {
+			if (offset >= mapping->GetSize()) {
+				return 0;
+			}
+			size = std::min(size, mapping->GetSize() - offset);
+			std::memcpy(buffer, mapping->GetData() + offset, size);
+			return size;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		stream.clear();
+		stream.seekg(offset);
+		return static_cast<size_t>(stream.read(reinterpret_cast<char*>(buffer), size).gcount());
+	}
+
+	/** The whole zip file, the stream reads from it when it is set */
+	std::unique_ptr<Platform::MappedFile> mapping;
+	std::mutex mutex;
+	Filesystem_Stream::InputStream stream;
+};
+
+/** Reads an uncompressed file directly from the mapped archive and keeps it mapped while the stream is open */
+class ZipFilesystem::MappedStreamBuf : public Filesystem_Stream::InputMemoryStreamBuf {
+public:
+	// The memory buffer does not write, the mapping is read-only
+	MappedStreamBuf(std::shared_ptr<Archive> archive, Span<const uint8_t> data) :
+		Filesystem_Stream::InputMemoryStreamBuf(Span<uint8_t>(const_cast<uint8_t*>(data.data()), data.size())),
+		archive(std::move(archive)) {}
+
+private:
+	std::shared_ptr<Archive> archive;
+};
+
+/** Reads a file of the archive in chunks, deflated files are inflated on the fly. */
+class ZipFilesystem::EntryStreamBuf : public std::streambuf {
+public:
+	EntryStreamBuf(std::shared_ptr<Archive> archive, uint32_t offset, uint32_t compressed_size, uint32_t size, bool deflate);
+	~EntryStreamBuf() override;
+	EntryStreamBuf(EntryStreamBuf const& other) = delete;
+	EntryStreamBuf const& operator=(EntryStreamBuf const& other) = delete;
+
+protected:
+	int_type underflow() override;
+	pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode mode) override;
+	pos_type seekpos(pos_type pos, std::ios_base::openmode mode) override;
+
+private:
+	/** Replaces the buffer with the next chunk of the file, false at the end */
+	bool Fill();
+	void Restart();
+	uint32_t BufferEnd() const;
+
+	std::shared_ptr<Archive> archive;
+	uint32_t offset;
+	uint32_t compressed_size;
+	uint32_t size;
+	bool deflate;
+
+	// file position of the begin of the buffer
+	uint32_t buffer_pos = 0;
+	// compressed bytes read
+	uint32_t read_pos = 0;
+	z_stream zlib_stream = {};
+	std::vector<uint8_t> in_buffer;
+	std::vector<uint8_t> out_buffer;
+};
+
+ZipFilesystem::EntryStreamBuf::EntryStreamBuf(std::shared_ptr<Archive> archive, uint32_t offset, uint32_t compressed_size, uint32_t size, bool deflate) :
+	archive(std::move(archive)), offset(offset), compressed_size(compressed_size), size(size), deflate(deflate) {
+	out_buffer.resize(stream_chunk_size);
+	if (deflate) {
+		in_buffer.resize(stream_chunk_size);
+		inflateInit2(&zlib_stream, -MAX_WBITS);
+	}
+	Restart();
+}
+
+ZipFilesystem::EntryStreamBuf::~EntryStreamBuf() {
+	if (deflate) {
+		inflateEnd(&zlib_stream);
+	}
+}
+
+void ZipFilesystem::EntryStreamBuf::Restart() {
+	buffer_pos = 0;
+	read_pos = 0;
+	if (deflate) {
+		inflateReset(&zlib_stream);
+		zlib_stream.avail_in = 0;
+	}
+	char* out = reinterpret_cast<char*>(out_buffer.data());
+	setg(out, out, out);
+}
+
+uint32_t ZipFilesystem::EntryStreamBuf::BufferEnd() const {
+	return buffer_pos + static_cast<uint32_t>(egptr() - eback());
+}
+
+bool ZipFilesystem::EntryStreamBuf::Fill() {
+	buffer_pos = BufferEnd();
+	char* out = reinterpret_cast<char*>(out_buffer.data());
+	setg(out, out, out);
+
+	if (buffer_pos >= size) {
+		return false;
+	}
+
+	size_t produced = 0;
+	if (!deflate) {
+		produced = archive->Read(offset + buffer_pos, out, std::min<size_t>(out_buffer.size(), size - buffer_pos));
+	} else {
+		zlib_stream.next_out = out_buffer.data();
+		zlib_stream.avail_out = static_cast<uInt>(out_buffer.size());
+
+		while (zlib_stream.avail_out == out_buffer.size()) {
+			if (zlib_stream.avail_in == 0 && read_pos < compressed_size) {
+				// A mapped archive is inflated without copying the compressed data
+				auto mapped = archive->Memory(offset + read_pos, compressed_size - read_pos);
+				if (!mapped.empty()) {
+					read_pos = compressed_size;
+					zlib_stream.next_in = const_cast<Bytef*>(mapped.data());
+					zlib_stream.avail_in = static_cast<uInt>(mapped.size());
+				}
+			}
+			if (zlib_stream.avail_in == 0) {
+				size_t read = archive->Read(offset + read_pos, in_buffer.data(), std::min<size_t>(in_buffer.size(), compressed_size - read_pos));
+				if (read == 0) {
+					break;
+				}
+				read_pos += static_cast<uint32_t>(read);
+				zlib_stream.next_in = in_buffer.data();
+				zlib_stream.avail_in = static_cast<uInt>(read);
+			}
+
+			int zlib_error = inflate(&zlib_stream, Z_NO_FLUSH);
+			if (zlib_error == Z_STREAM_END) {
+				break;
+			} else if (zlib_error != Z_OK) {
+				Output::Warning("ZipFS: zlib failed: {}", zlib_stream.msg ? zlib_stream.msg : "Archive corrupted?");
+				break;
+			}
+		}
+		produced = out_buffer.size() - zlib_stream.avail_out;
+	}
+
+	setg(out, out, out + produced);
+	return produced > 0;
+}
+
+std::streambuf::int_type ZipFilesystem::EntryStreamBuf::underflow() {
+	if (gptr() == egptr() && !Fill()) {
+		return traits_type::eof();
+	}
+	return traits_type::to_int_type(*gptr());
+}
+
+std::streambuf::pos_type ZipFilesystem::EntryStreamBuf::seekoff(std::streambuf::off_type off, std::ios_base::seekdir dir, std::ios_base::openmode mode) {
+	if (dir == std::ios_base::beg) {
+		return seekpos(off, mode);
+	} else if (dir == std::ios_base::cur) {
+		return seekpos(buffer_pos + (gptr() - eback()) + off, mode);
+	} else {
+		return seekpos(size + off, mode);
+	}
+}
+
+std::streambuf::pos_type ZipFilesystem::EntryStreamBuf::seekpos(std::streambuf::pos_type pos, std::ios_base::openmode) {
+	if (pos < 0 || pos > size) {
+		return pos_type(off_type(-1));
+	}
+	uint32_t target = static_cast<uint32_t>(pos);
+
+	if (target < buffer_pos || (!deflate && target > BufferEnd())) {
+		if (deflate) {
+			// Inflating can only go forward, start again
+			Restart();
+		} else {
+			char* out = reinterpret_cast<char*>(out_buffer.data());
+			buffer_pos = target;
+			setg(out, out, out);
+		}
+	}
+
+	// Deflated data is skipped by inflating it
+	while (target > BufferEnd()) {
+		if (!Fill()) {
+			return pos_type(off_type(-1));
+		}
+	}
+
+	setg(eback(), eback() + (target - buffer_pos), egptr());
+	return pos;
+}
+
+namespace {
+	/** Reads from a file of the input pool and keeps it alive while the stream is open */
+	class PooledStreamBuf : public Filesystem_Stream::InputMemoryStreamBuf {
+	public:
+		explicit PooledStreamBuf(std::shared_ptr<std::vector<uint8_t>> data) :
+			Filesystem_Stream::InputMemoryStreamBuf(*data), data(std::move(data)) {}
+
+	private:
+		std::shared_ptr<std::vector<uint8_t>> data;
+	};
+}
+
 static std::string normalize_path(StringView path) {
 	if (path == "." || path == "/" || path == "") {
 		return "";
@@ -52,7 +291,15 @@ static std::string normalize_path(StringView path) {
 
 ZipFilesystem::ZipFilesystem(std::string base_path, FilesystemView parent_fs, StringView enc) :
 	Filesystem(base_path, parent_fs) {
-	auto zipfile = parent_fs.OpenInputStream(GetPath());
+	// The central directory and uncompressed files are read straight from a mapping
+	Filesystem_Stream::InputStream zipfile;
+	auto mapping = parent_fs.MapFile(GetPath());
+	if (mapping) {
+		Span<uint8_t> data(const_cast<uint8_t*>(mapping->GetData()), mapping->GetSize());
+		zipfile = Filesystem_Stream::InputStream(new Filesystem_Stream::InputMemoryStreamBuf(data), GetPath());
+	} else {
+		zipfile = parent_fs.OpenInputStream(GetPath());
+	}
 	if (!zipfile) {
 		return;
 	}
@@ -170,6 +417,10 @@ ZipFilesystem::ZipFilesystem(std::string base_path, FilesystemView parent_fs, St
 		std::sort(zip_entries_cp437.begin(), zip_entries_cp437.end(), [](auto& a, auto& b) {
 			return a.first < b.first;
 		});
+
+		BuildDirectoryIndex();
+
+		archive = std::make_shared<Archive>(std::move(zipfile), std::move(mapping));
 	} else {
 		Output::Warning("ZipFS: {} is not a valid archive", GetPath());
 	}
@@ -285,6 +536,18 @@ bool ZipFilesystem::ReadLocalHeader(std::istream& zipfile, uint32_t& offset, Sto
 	return true;
 }
 
+bool ZipFilesystem::ReadEntryHeader(const ZipEntry& entry, uint32_t& data_offset, StorageMethod& method, uint32_t& compressed_size) const {
+	uint32_t local_offset = 0;
+	std::lock_guard<std::mutex> lock(archive->mutex);
+	archive->stream.clear();
+	archive->stream.seekg(entry.fileoffset);
+	if (!ReadLocalHeader(archive->stream, local_offset, method, compressed_size)) {
+		return false;
+	}
+	data_offset = entry.fileoffset + local_offset;
+	return true;
+}
+
 bool ZipFilesystem::IsFile(StringView path) const {
 	std::string path_normalized = normalize_path(path);
 	auto entry = Find(path);
@@ -318,57 +581,95 @@ int64_t ZipFilesystem::GetFilesize(StringView path) const {
 	return 0;
 }
 
-std::streambuf* ZipFilesystem::CreateInputStreambuffer(StringView path, std::ios_base::openmode) const {
+std::streambuf* ZipFilesystem::CreateInputStreambuffer(StringView path, std::ios_base::openmode, Span<const uint8_t>& memory) const {
 	std::string path_normalized = normalize_path(path);
 	auto entry = Find(path);
-	if (entry && !entry->is_directory) {
-		auto pool_it = input_pool.find(path_normalized);
-		if (pool_it != input_pool.end()) {
-			return new Filesystem_Stream::InputMemoryStreamBuf(pool_it->second);
+	if (!entry || entry->is_directory || !archive) {
+		return nullptr;
+	}
+
+	auto pool_it = input_pool.find(path_normalized);
+	if (pool_it != input_pool.end()) {
+		input_pool_lru.splice(input_pool_lru.begin(), input_pool_lru, pool_it->second.lru);
+		return new PooledStreamBuf(pool_it->second.data);
+	}
+
+	StorageMethod method;
+	uint32_t data_offset = 0;
+	uint32_t compressed_size = 0;
+	if (!ReadEntryHeader(*entry, data_offset, method, compressed_size)) {
+		return nullptr;
+	}
+
+	if (method == StorageMethod::Unknown) {
+		Output::Warning("ZipFS: {} has unsupported compression format. Only Deflate is supported", path_normalized);
+		return nullptr;
+	}
+
+	if (method == StorageMethod::Plain) {
+		auto data = archive->Memory(data_offset, entry->filesize);
+		if (!data.empty()) {
+			memory = data;
+			return new MappedStreamBuf(archive, data);
 		}
+	}
 
-		auto zip_file = GetParent().OpenInputStream(GetPath());
-		zip_file.seekg(entry->fileoffset);
-		StorageMethod method;
-		uint32_t local_offset = 0;
-		uint32_t compressed_size = 0;
-		if (ReadLocalHeader(zip_file, local_offset, method, compressed_size)) {
-			zip_file.seekg(entry->fileoffset + local_offset);
-			if (method == StorageMethod::Plain) {
-				auto data = std::vector<uint8_t>(entry->filesize);
-				zip_file.read(reinterpret_cast<char*>(data.data()), data.size());
-				input_pool[path_normalized] = std::move(data);
-				return new Filesystem_Stream::InputMemoryStreamBuf(input_pool[path_normalized]);
-			} else if (method == StorageMethod::Deflate) {
-				std::vector<uint8_t> comp_buf;
-				comp_buf.resize(compressed_size);
-				zip_file.read(reinterpret_cast<char*>(comp_buf.data()), comp_buf.size());
-				auto dec_buf = std::vector<uint8_t>(entry->filesize);
-				z_stream zlib_stream = {};
-				zlib_stream.next_in = reinterpret_cast<Bytef*>(comp_buf.data());
-				zlib_stream.avail_in = static_cast<uInt>(comp_buf.size());
-				zlib_stream.next_out = reinterpret_cast<Bytef*>(dec_buf.data());
-				zlib_stream.avail_out = static_cast<uInt>(dec_buf.size());
-				inflateInit2(&zlib_stream, -MAX_WBITS);
-
-				int zlib_error = inflate(&zlib_stream, Z_NO_FLUSH);
-				if (zlib_error == Z_OK) {
-					Output::Warning("ZipFS: zlib failed for {}: More data available (Archive corrupted?)", path_normalized);
-					return nullptr;
-				}
-				else if (zlib_error != Z_STREAM_END) {
-					Output::Warning("ZipFS: zlib failed for {}: {}", path_normalized, zlib_stream.msg);
-					return nullptr;
-				}
-				input_pool[path_normalized] = std::move(dec_buf);
-				return new Filesystem_Stream::InputMemoryStreamBuf(input_pool[path_normalized]);
-			} else {
-				Output::Warning("ZipFS: {} has unsupported compression format. Only Deflate is supported", path_normalized);
-				return nullptr;
-			}
+	if (entry->filesize > pool_file_limit) {
+		return new EntryStreamBuf(archive, data_offset, compressed_size, entry->filesize, method == StorageMethod::Deflate);
+	}
+
+	return CreatePooledStreambuffer(path_normalized, *entry, data_offset, method, compressed_size);
+}
+
+std::streambuf* ZipFilesystem::CreatePooledStreambuffer(const std::string& path, const ZipEntry& entry, uint32_t data_offset,
+		StorageMethod method, uint32_t compressed_size) const {
+	auto data = std::make_shared<std::vector<uint8_t>>(entry.filesize);
+
+	if (method == StorageMethod::Plain) {
+		if (archive->Read(data_offset, data->data(), data->size()) != data->size()) {
+			Output::Warning("ZipFS: {} is truncated (Archive corrupted?)", path);
+			return nullptr;
+		}
+	} else {
+		std::vector<uint8_t> comp_buf;
+		auto comp_data = archive->Memory(data_offset, compressed_size);
+		if (comp_data.empty()) {
+			comp_buf.resize(compressed_size);
+			comp_buf.resize(archive->Read(data_offset, comp_buf.data(), comp_buf.size()));
+			comp_data = Span<const uint8_t>(comp_buf.data(), comp_buf.size());
+		}
+		z_stream zlib_stream = {};
+		zlib_stream.next_in = const_cast<Bytef*>(comp_data.data());
+		zlib_stream.avail_in = static_cast<uInt>(comp_data.size());
+		zlib_stream.next_out = reinterpret_cast<Bytef*>(data->data());
+		zlib_stream.avail_out = static_cast<uInt>(data->size());
+		inflateInit2(&zlib_stream, -MAX_WBITS);
+
+		int zlib_error = inflate(&zlib_stream, Z_NO_FLUSH);
+		inflateEnd(&zlib_stream);
+		if (zlib_error == Z_OK) {
+			Output::Warning("ZipFS: zlib failed for {}: More data available (Archive corrupted?)", path);
+			return nullptr;
+		}
+		else if (zlib_error != Z_STREAM_END) {
+			Output::Warning("ZipFS: zlib failed for {}: {}", path, zlib_stream.msg);
+			return nullptr;
 		}
 	}
-	return nullptr;
+
+	input_pool_lru.push_front(path);
+	input_pool[path] = { data, input_pool_lru.begin() };
+	input_pool_size += data->size();
+
+	// Streams still reading from a dropped file keep it until they are closed
+	while (input_pool_size > pool_limit && input_pool_lru.size() > 1) {
+		auto it = input_pool.find(input_pool_lru.back());
+		input_pool_size -= it->second.data->size();
+		input_pool.erase(it);
+		input_pool_lru.pop_back();
+	}
+
+	return new PooledStreamBuf(std::move(data));
 }
 
 bool ZipFilesystem::GetDirectoryContent(StringView path, std::vector<DirectoryTree::Entry>& entries) const {
@@ -377,36 +678,52 @@ bool ZipFilesystem::GetDirectoryContent(StringView path, std::vector<DirectoryTr
 	}
 
 	std::string path_normalized = normalize_path(path);
-	if (!path_normalized.empty() && path_normalized.back() != '/') {
-		path_normalized += "/";
+	if (!path_normalized.empty() && path_normalized.back() == '/') {
+		path_normalized.pop_back();
 	}
 
-	auto check = [&](auto& it) {
-		if (StringView(it.first).starts_with(path_normalized) &&
-			it.first.substr(path_normalized.size(), it.first.size() - path_normalized.size()).find_last_of('/') == std::string::npos) {
-			// Everything that starts with the path but isn't the path and does contain no slash
-			auto filename = it.first.substr(path_normalized.size(), it.first.size() - path_normalized.size());
-			if (filename.empty()) {
-				return;
-			}
-
-			entries.emplace_back(
-					it.first.substr(path_normalized.size(), it.first.size() - path_normalized.size()),
-					it.second.is_directory ? DirectoryTree::FileType::Directory : DirectoryTree::FileType::Regular);
-		}
-	};
-
-	for (const auto& it : zip_entries) {
-		check(it);
+	auto dir_it = directory_index.find(path_normalized);
+	if (dir_it == directory_index.end()) {
+		// empty directory
+		return true;
 	}
 
-	for (const auto& it : zip_entries_cp437) {
-		check(it);
+	entries.reserve(entries.size() + dir_it->second.size());
+	for (const auto& child : dir_it->second) {
+		entries.emplace_back(ToString(child.name),
+			child.is_directory ? DirectoryTree::FileType::Directory : DirectoryTree::FileType::Regular);
 	}
 
 	return true;
 }
 
+void ZipFilesystem::BuildDirectoryIndex() {
+	std::string parent;
+
+	// The lists are sorted, so every directory lists its content sorted, like before the index
+	auto add = [&](const std::vector<std::pair<std::string, ZipEntry>>& list) {
+		for (const auto& it : list) {
+			StringView path = it.first;
+			auto pos = path.find_last_of('/');
+			StringView name = (pos == StringView::npos) ? path : path.substr(pos + 1);
+			if (name.empty()) {
+				// the root directory
+				continue;
+			}
+
+			if (pos == StringView::npos) {
+				parent.clear();
+			} else {
+				parent.assign(path.data(), pos);
+			}
+			directory_index[parent].push_back({ name, it.second.is_directory });
+		}
+	};
+
+	add(zip_entries);
+	add(zip_entries_cp437);
+}
+
 const ZipFilesystem::ZipEntry* ZipFilesystem::Find(StringView what) const {
 	auto it = std::lower_bound(zip_entries.begin(), zip_entries.end(), what, [](const auto& e, const auto& w) {
 		return e.first < w;
@@ -21,6 +21,7 @@
 #include "filesystem.h"
 #include "filesystem_stream.h"
 #include <fstream>
+#include <list>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -48,12 +49,16 @@ protected:
 	bool IsDirectory(StringView path, bool follow_symlinks) const override;
 	bool Exists(StringView path) const override;
 	int64_t GetFilesize(StringView path) const override;
-	std::streambuf* CreateInputStreambuffer(StringView path, std::ios_base::openmode mode) const override;
+	std::streambuf* CreateInputStreambuffer(StringView path, std::ios_base::openmode mode, Span<const uint8_t>& memory) const override;
 	bool GetDirectoryContent(StringView path, std::vector<DirectoryTree::Entry>& entries) const override;
 	std::string Describe() const override;
 	/** @} */
 
 private:
+	class Archive;
+	class EntryStreamBuf;
+	class MappedStreamBuf;
+
 	enum class StorageMethod {Unknown, Plain, Deflate};
 	struct ZipEntry {
 		uint32_t filesize;
@@ -64,11 +69,41 @@ private:
 	bool FindCentralDirectory(std::istream& stream, uint32_t& offset, uint32_t& size, uint16_t& num_entries) const;
 	bool ReadCentralDirectoryEntry(std::istream& zipfile, std::string& filepath, uint32_t& offset, uint32_t& uncompressed_size, bool& is_utf8) const;
 	bool ReadLocalHeader(std::istream& zipfile, uint32_t& offset, StorageMethod& method, uint32_t& compressed_size) const;
+	bool ReadEntryHeader(const ZipEntry& entry, uint32_t& data_offset, StorageMethod& method, uint32_t& compressed_size) const;
 	const ZipEntry* Find(StringView what) const;
+	void BuildDirectoryIndex();
+
+	std::streambuf* CreatePooledStreambuffer(const std::string& path, const ZipEntry& entry, uint32_t data_offset,
+		StorageMethod method, uint32_t compressed_size) const;
+
+	/**
+	 * The zip file, opened once and shared with all streams reading from it.
+	 * Memory mapped when the parent filesystem supports it.
+	 */
+	std::shared_ptr<Archive> archive;
 
-	mutable std::unordered_map<std::string, std::vector<uint8_t>> input_pool;
+	using PoolData = std::shared_ptr<std::vector<uint8_t>>;
+	struct PoolItem {
+		PoolData data;
+		// position in input_pool_lru
+		std::list<std::string>::iterator lru;
+	};
+	/** Recently read small files, the memory is bounded, open streams keep their data */
+	mutable std::unordered_map<std::string, PoolItem> input_pool;
+	/** most recently used first */
+	mutable std::list<std::string> input_pool_lru;
+	mutable size_t input_pool_size = 0;
 	std::vector<std::pair<std::string, ZipEntry>> zip_entries;
 	std::vector<std::pair<std::string, ZipEntry>> zip_entries_cp437;
+
+	/** A file or directory directly inside of a directory of the archive */
+	struct DirectoryChild {
+		/** Filename without the directory, points into zip_entries or zip_entries_cp437 */
+		StringView name;
+		bool is_directory;
+	};
+	/** Content of every directory, the key is the directory path without trailing slash */
+	std::unordered_map<std::string, std::vector<DirectoryChild>> directory_index;
 	std::string encoding;
 	mutable std::vector<char> filename_buffer;
 };
@@ -43,6 +43,7 @@
 #include "cache.h"
 #include "player.h"
 #include "compiler.h"
+#include "glyph_atlas.h"
 
 // Static variables.
 namespace {
@@ -107,6 +108,8 @@ namespace {
 
 	struct BitmapFont : public Font {
 		enum { FULL_HEIGHT = 12, HALF_HEIGHT = 9, FULL_WIDTH = FULL_HEIGHT, HALF_WIDTH = FULL_WIDTH / 2 };
+		/** Glyphs kept expanded, enough for a screen full of CJK text */
+		enum { ATLAS_CAPACITY = 512 };
 
 		using function_type = BitmapFontGlyph const*(*)(char32_t);
 
@@ -119,7 +122,9 @@ namespace {
 
 	private:
 		function_type func;
+		/** Empty glyph for control characters */
 		BitmapRef glyph_bm;
+		GlyphAtlas atlas;
 
 		size_t getGlyphKerning(BitmapFontGlyph const* glyph) const;
 	}; // class BitmapFont
@@ -155,7 +160,15 @@ namespace {
 		std::string face_name_;
 		unsigned current_size_;
 
+		/** Rendered glyphs of the current face, size and style */
+		std::unique_ptr<GlyphAtlas> atlas_;
+		std::string atlas_name_;
+		unsigned atlas_size_ = 0;
+		bool atlas_bold_ = false;
+		bool atlas_italic_ = false;
+
 		bool check_face();
+		GlyphAtlas& get_atlas();
 	}; // class FTFont
 #endif
 
@@ -196,7 +209,7 @@ namespace {
 } // anonymous namespace
 
 BitmapFont::BitmapFont(const std::string& name, function_type func)
-	: Font(name, FULL_HEIGHT, false, false), func(func)
+	: Font(name, FULL_HEIGHT, false, false), func(func), atlas(FULL_WIDTH, FULL_HEIGHT, ATLAS_CAPACITY)
 {}
 
 size_t BitmapFont::getGlyphKerning(BitmapFontGlyph const* glyph) const {
@@ -244,24 +257,30 @@ Rect BitmapFont::GetSize(StringView txt) const {
 }
 
 Font::GlyphRet BitmapFont::Glyph(char32_t code) {
-	if (EP_UNLIKELY(!glyph_bm)) {
-		glyph_bm = Bitmap::Create(nullptr, FULL_WIDTH, FULL_HEIGHT, 0, DynamicFormat(8,8,0,8,0,8,0,8,0,PF::Alpha));
-	}
 	if (EP_UNLIKELY(Utils::IsControlCharacter(code))) {
+		if (EP_UNLIKELY(!glyph_bm)) {
+			glyph_bm = Bitmap::Create(nullptr, FULL_WIDTH, FULL_HEIGHT, 0, DynamicFormat(8,8,0,8,0,8,0,8,0,PF::Alpha));
+		}
 		return { glyph_bm, Rect(0, 0, 0, HALF_HEIGHT) };
 	}
+
+	if (auto* entry = atlas.Find(code)) {
+		return { entry->bitmap, entry->rect };
+	}
+
 	auto glyph = func(code);
 	auto width = getGlyphKerning(glyph);
 	auto height = glyph->fullHeight? FULL_HEIGHT : HALF_HEIGHT;
 
-	glyph_bm->Clear();
-	uint8_t* data = reinterpret_cast<uint8_t*>(glyph_bm->pixels());
-	int pitch = glyph_bm->pitch();
+	// Same bitmap size as before the atlas, Font::Render derives the system graphic offset from it
+	auto& entry = atlas.Insert(code, FULL_WIDTH, FULL_HEIGHT, Rect(0, 0, width, height));
+	uint8_t* data = reinterpret_cast<uint8_t*>(entry.bitmap->pixels());
+	int pitch = entry.bitmap->pitch();
 	for(size_t y_ = 0; y_ < height; ++y_)
 		for(size_t x_ = 0; x_ < width; ++x_)
 			data[y_*pitch+x_] = (glyph->data[y_] & (0x1 << x_)) ? 255 : 0;
 
-	return { glyph_bm, Rect(0, 0, width, height) };
+	return { entry.bitmap, entry.rect };
 }
 
 #ifdef HAVE_FREETYPE
@@ -301,6 +320,11 @@ Font::GlyphRet FTFont::Glyph(char32_t glyph) {
 		return Font::Default()->Glyph(glyph);
 	}
 
+	GlyphAtlas& atlas = get_atlas();
+	if (auto* entry = atlas.Find(glyph)) {
+		return { entry->bitmap, entry->rect };
+	}
+
 	if (FT_Load_Char(face_.get(), glyph, FT_LOAD_NO_BITMAP) != FT_Err_Ok) {
 		Output::Error("Couldn't load FreeType character {:#x}", uint32_t(glyph));
 	}
@@ -316,7 +340,13 @@ Font::GlyphRet FTFont::Glyph(char32_t glyph) {
 	int const width = ft_bitmap.width;
 	int const height = ft_bitmap.rows;
 
-	BitmapRef bm = Bitmap::Create(nullptr, width, height, 0, DynamicFormat(8,8,0,8,0,8,0,8,0,PF::Alpha));
+	BitmapRef bm;
+	if (EP_LIKELY(width > 0 && height > 0 && atlas.Fits(width, height))) {
+		bm = atlas.Insert(glyph, width, height, Rect(0, 0, width, height)).bitmap;
+	} else {
+		// Oversized glyphs are rare, they are not worth a larger cell for every glyph
+		bm = Bitmap::Create(nullptr, width, height, 0, DynamicFormat(8,8,0,8,0,8,0,8,0,PF::Alpha));
+	}
 	uint8_t* data = reinterpret_cast<uint8_t*>(bm->pixels());
 	int dst_pitch = bm->pitch();
 
@@ -331,6 +361,19 @@ Font::GlyphRet FTFont::Glyph(char32_t glyph) {
 	return { bm, Rect(0, 0, width, height) };
 }
 
+GlyphAtlas& FTFont::get_atlas() {
+	if (!atlas_ || atlas_name_ != name || atlas_size_ != size || atlas_bold_ != bold || atlas_italic_ != italic) {
+		// Room for glyphs up to twice the nominal size, covers the wide CJK and slanted glyphs
+		int const cell = static_cast<int>(pixel_size()) * 2;
+		atlas_ = std::make_unique<GlyphAtlas>(cell, cell, 512);
+		atlas_name_ = name;
+		atlas_size_ = size;
+		atlas_bold_ = bold;
+		atlas_italic_ = italic;
+	}
+	return *atlas_;
+}
+
 bool FTFont::check_face() {
 	if (!library_) {
 		if (library_checker_.expired()) {
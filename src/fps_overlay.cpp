@@ -15,6 +15,7 @@
  * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <sstream>
 
 #include "fps_overlay.h"
@@ -24,6 +25,8 @@
 #include "input.h"
 #include "font.h"
 #include "drawable_mgr.h"
+#include "graphics.h"
+#include "game_multiplayer_interest.h"
 
 using namespace std::chrono_literals;
 
@@ -40,6 +43,20 @@ FpsOverlay::FpsOverlay() :
 void FpsOverlay::UpdateText() {
 	auto fps = Utils::RoundTo<int>(Game_Clock::GetFPS());
 	text = "FPS: " + std::to_string(fps);
+
+	// Remote players simulated / in the room
+	const auto& mp = Game_Multiplayer::GetInterestStats();
+	if (mp.active + mp.dormant > 0) {
+		text += " MP: " + std::to_string(mp.active) + "/" + std::to_string(mp.active + mp.dormant);
+	}
+
+	// Share of the screen redrawn per frame since the last refresh
+	if (Graphics::GetDamageTracking() && repaint_frames > 0 && screen_pixels > 0) {
+		auto percent = Utils::RoundTo<int>(100.0 * repainted_pixels / repaint_frames / screen_pixels);
+		text += " Paint: " + std::to_string(percent) + "%";
+	}
+	repainted_pixels = 0;
+	repaint_frames = 0;
 	fps_dirty = true;
 }
 
@@ -50,6 +67,9 @@ bool FpsOverlay::Update() {
 		last_speed_mod = mod;
 	}
 
+	repainted_pixels += Graphics::GetRepaintedPixels();
+	++repaint_frames;
+
 	auto now = Game_Clock::GetFrameTime();
 	auto dt = now - last_refresh_time;
 	if (dt < refresh_frequency) {
@@ -62,7 +82,28 @@ bool FpsOverlay::Update() {
 	return true;
 }
 
+bool FpsOverlay::GetDamageState(DamageState& state) const {
+	// The size of changed texts is only known after drawing them
+	if ((draw_fps && fps_dirty) || (last_speed_mod > 1 && speedup_dirty)) {
+		return false;
+	}
+
+	if (draw_fps) {
+		state.bounds = Rect(1, 2, fps_rect.width, fps_rect.height);
+		state.Add(fps_bitmap);
+	}
+	if (last_speed_mod > 1) {
+		// Drawn at the right edge of the screen
+		state.bounds = Rect(0, 2, 0x8000, std::max(state.bounds.height, speedup_rect.height));
+		state.Add(speedup_bitmap);
+		state.Add(speedup_rect);
+	}
+	return true;
+}
+
 void FpsOverlay::Draw(Bitmap& dst) {
+	screen_pixels = static_cast<int64_t>(dst.GetWidth()) * dst.GetHeight();
+
 	if (draw_fps) {
 		if (fps_dirty) {
 			std::string text = GetFpsString();
@@ -27,7 +27,7 @@
 
 /**
  * FpsOverlay class.
- * Shows current FPS and the speedup indicator.
+ * Shows current FPS, the share of the screen repainted per frame and the speedup indicator.
  */
 class FpsOverlay : public Drawable {
 public:
@@ -35,6 +35,8 @@ public:
 
 	void Draw(Bitmap& dst) override;
 
+	bool GetDamageState(DamageState& state) const override;
+
 	/**
 	 * Update the fps overlay.
 	 *
@@ -69,6 +71,12 @@ private:
 
 	std::string text;
 
+	/** Pixels redrawn by the compositor in the frames since the last refresh */
+	int64_t repainted_pixels = 0;
+	int repaint_frames = 0;
+	/** Pixels of the screen the overlay was last drawn on */
+	int64_t screen_pixels = 0;
+
 	int last_speed_mod = 1;
 	bool speedup_dirty = true;
 	bool fps_dirty = true;
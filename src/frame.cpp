@@ -41,6 +41,14 @@ void Frame::Update() {
 	// no-op
 }
 
+bool Frame::GetDamageState(DamageState& state) const {
+	if (frame_bitmap) {
+		state.bounds = frame_bitmap->GetRect();
+		state.Add(frame_bitmap);
+	}
+	return true;
+}
+
 void Frame::Draw(Bitmap& dst) {
 	if (frame_bitmap) {
 		dst.Blit(0, 0, *frame_bitmap, frame_bitmap->GetRect(), 255);
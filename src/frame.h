@@ -32,6 +32,7 @@ public:
 	Frame();
 
 	void Draw(Bitmap& dst) override;
+	bool GetDamageState(DamageState& state) const override;
 	void Update();
 
 private:
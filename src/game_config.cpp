@@ -102,6 +102,14 @@ void Game_Config::LoadFromArgs(CmdlineParser& cp) {
 			video.fps_render_window.Set(false);
 			continue;
 		}
+		if (cp.ParseNext(arg, 0, "--damage-tracking")) {
+			video.damage_tracking.Set(true);
+			continue;
+		}
+		if (cp.ParseNext(arg, 0, "--no-damage-tracking")) {
+			video.damage_tracking.Set(false);
+			continue;
+		}
 		if (cp.ParseNext(arg, 0, "--window")) {
 			video.fullscreen.Set(false);
 			continue;
@@ -116,6 +124,19 @@ void Game_Config::LoadFromArgs(CmdlineParser& cp) {
 			}
 			continue;
 		}
+		if (cp.ParseNext(arg, 1, "--image-cache-size")) {
+			if (arg.ParseValue(0, li_value)) {
+				video.image_cache_size.Set(li_value);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--image-cache-policy")) {
+			std::string svalue;
+			if (arg.ParseValue(0, svalue)) {
+				video.image_cache_policy.Set(std::move(svalue));
+			}
+			continue;
+		}
 		if (cp.ParseNext(arg, 1, "--autobattle-algo")) {
 			std::string svalue;
 			if (arg.ParseValue(0, svalue)) {
@@ -174,12 +195,21 @@ void Game_Config::LoadFromConfig(const std::string& path) {
 	if (ini.HasValue("video", "fps-render-window")) {
 		video.fps_render_window.Set(ini.GetBoolean("video", "fps-render-window", false));
 	}
+	if (ini.HasValue("video", "damage-tracking")) {
+		video.damage_tracking.Set(ini.GetBoolean("video", "damage-tracking", false));
+	}
 	if (ini.HasValue("video", "fps-limit")) {
 		video.fps_limit.Set(ini.GetInteger("video", "fps-limit", 0));
 	}
 	if (ini.HasValue("video", "window-zoom")) {
 		video.window_zoom.Set(ini.GetInteger("video", "window-zoom", 0));
 	}
+	if (ini.HasValue("video", "image-cache-size")) {
+		video.image_cache_size.Set(ini.GetInteger("video", "image-cache-size", 0));
+	}
+	if (ini.HasValue("video", "image-cache-policy")) {
+		video.image_cache_policy.Set(ini.GetString("video", "image-cache-policy", "LRU"));
+	}
 
 	/** AUDIO SECTION */
 
@@ -215,12 +245,21 @@ void Game_Config::WriteToConfig(const std::string& path) const {
 	if (video.fps_render_window.Enabled()) {
 		of << "fps-render-window=" << int(video.fps_render_window.Get()) << "\n";
 	}
+	if (video.damage_tracking.Enabled()) {
+		of << "damage-tracking=" << int(video.damage_tracking.Get()) << "\n";
+	}
 	if (video.fps_limit.Enabled()) {
 		of << "fps-limit=" << video.fps_limit.Get() << "\n";
 	}
 	if (video.window_zoom.Enabled()) {
 		of << "window-zoom=" << video.window_zoom.Get() << "\n";
 	}
+	if (video.image_cache_size.Enabled()) {
+		of << "image-cache-size=" << video.image_cache_size.Get() << "\n";
+	}
+	if (video.image_cache_policy.Enabled()) {
+		of << "image-cache-policy=" << video.image_cache_policy.Get() << "\n";
+	}
 	of << "\n";
 
 	/** AUDIO SECTION */
@@ -33,8 +33,11 @@ struct Game_ConfigVideo {
 	BoolConfigParam fullscreen{ true };
 	BoolConfigParam show_fps{ false };
 	BoolConfigParam fps_render_window{ false };
+	BoolConfigParam damage_tracking{ false };
 	RangeConfigParam<int> fps_limit{ DEFAULT_FPS, 0, std::numeric_limits<int>::max() };
 	RangeConfigParam<int> window_zoom{ 2, 1, std::numeric_limits<int>::max() };
+	RangeConfigParam<int> image_cache_size{ 10, 1, std::numeric_limits<int>::max() };
+	StringConfigParam image_cache_policy{ "LRU" };
 };
 
 struct Game_ConfigAudio {
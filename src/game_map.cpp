@@ -23,6 +23,7 @@
 #include <climits>
 
 #include "async_handler.h"
+#include "async_prefetch.h"
 #include "system.h"
 #include "game_battle.h"
 #include "game_battler.h"
@@ -303,7 +304,11 @@ std::unique_ptr<lcf::rpg::Map> Game_Map::loadMapFile(int map_id) {
 			return nullptr;
 		}
 
-		map = lcf::LMU_Reader::Load(map_stream, Player::encoding);
+		// Parsed already when the teleport was reserved
+		map = AsyncPrefetch::TakeMap(map_id);
+		if (!map) {
+			map = lcf::LMU_Reader::Load(map_stream, Player::encoding);
+		}
 
 		if (Input::IsRecording()) {
 			map_stream.clear();
@@ -599,7 +604,7 @@ bool Game_Map::MakeWay(const Game_Character& self,
 	bool self_conflict = false;
 
 	for(auto& other : Game_Multiplayer::other_players) {
-		if(MakeWayCollideEvent(to_x, to_y, self, *(other.second.ch.get()), false)) {
+		if(MakeWayCollideEvent(to_x, to_y, self, *(other.ch.get()), false)) {
 			return false;
 		}
 	}
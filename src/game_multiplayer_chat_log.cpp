@@ -0,0 +1,98 @@
+#include "game_multiplayer_chat_log.h"
+#include <algorithm>
+#include <cassert>
+
+namespace Game_Multiplayer {
+
+	void ChatLayout::Wrap(int max_width) {
+		lines.clear();
+		const size_t n = glyphs.size();
+
+		int total_width = 0;
+		for (auto& glyph : glyphs) {
+			total_width += glyph.width;
+		}
+
+		int max_line_width = 0;
+		int y = 0;
+		size_t first = 0;
+		//the line starts with all glyphs left and gives them back to the next line until it fits
+		do {
+			size_t last = n;
+			int line_width = total_width;
+			auto shrink = [&](size_t new_last) {
+				for (size_t i = new_last; i < last; ++i) {
+					line_width -= glyphs[i].width;
+				}
+				last = new_last;
+			};
+
+			while (line_width > max_width && last - first > 1) {
+				size_t space = last;
+				for (size_t i = last; i > first; --i) {
+					if (glyphs[i - 1].ch == ' ') {
+						space = i - 1;
+						break;
+					}
+				}
+				if (space != last && space < last - 1) {
+					//move the word behind the last space down
+					shrink(space + 1);
+				} else {
+					//no whole word to move (no space or it ends the line), move a single glyph
+					shrink(last - 1);
+				}
+			}
+			for (size_t i = first; i < last; ++i) {
+				if (glyphs[i].ch == '\n') {
+					shrink(i + 1);
+					break;
+				}
+			}
+
+			int line_height = 0;
+			for (size_t i = first; i < last; ++i) {
+				line_height = std::max<int>(line_height, glyphs[i].height);
+			}
+			Line line;
+			line.first = first;
+			line.y = y;
+			lines.push_back(line);
+
+			max_line_width = std::max(max_line_width, line_width);
+			y += line_height;
+			total_width -= line_width;
+			first = last;
+		} while (first < n);
+
+		width = max_line_width + 1;
+		height = y + 1;
+	}
+
+	size_t ChatLayout::LineEnd(size_t line) const {
+		return line + 1 < lines.size() ? lines[line + 1].first : glyphs.size();
+	}
+
+	ChatHistory::ChatHistory(size_t capacity) : capacity(std::max<size_t>(capacity, 1)) { }
+
+	const ChatHistory::Message& ChatHistory::Push(unsigned short visibility, ChatLayout layout) {
+		Message* msg;
+		if (count < capacity) {
+			slots.emplace_back();
+			msg = &slots.back();
+			++count;
+		} else {
+			msg = &slots[head];
+			head = (head + 1) % capacity;
+		}
+		msg->id = next_id++;
+		msg->visibility = visibility;
+		msg->layout = std::move(layout);
+		return *msg;
+	}
+
+	const ChatHistory::Message& ChatHistory::FromNewest(size_t i) const {
+		assert(i < count);
+		return slots[(head + count - 1 - i) % count];
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Game_Multiplayer {
+
+	//glyph of a chat message with the size it takes in the log
+	struct ChatGlyph {
+		char32_t ch = 0;
+		uint8_t width = 0;
+		uint8_t height = 0;
+		uint8_t color = 0;
+		bool is_exfont = false;
+	};
+
+	/*
+		Wrapped lines of a chat message.
+
+		The layout only depends on the font, so it is built once per message and kept for the
+		whole history. The message graphic is drawn from it when the message scrolls into view.
+	*/
+	struct ChatLayout {
+		struct Line {
+			uint32_t first = 0; //index of the first glyph, the line ends where the next one starts
+			uint16_t y = 0;
+		};
+
+		std::vector<ChatGlyph> glyphs;
+		std::vector<Line> lines;
+		//size of the message graphic, including one pixel for the shadow
+		int width = 1;
+		int height = 1;
+
+		//breaks the glyphs into lines no wider than max_width. Words that don't fit move down to the
+		//next line, words longer than a line are split and "\n" ends a line
+		void Wrap(int max_width);
+
+		//index behind the last glyph of a line
+		size_t LineEnd(size_t line) const;
+	};
+
+	/*
+		Chat log history, a ring buffer of laid out messages. When it is full the oldest
+		message is replaced.
+	*/
+	class ChatHistory {
+	public:
+		struct Message {
+			//unique for the lifetime of the history, used to cache the message graphic
+			uint32_t id = 0;
+			unsigned short visibility = 0;
+			ChatLayout layout;
+		};
+
+		explicit ChatHistory(size_t capacity);
+
+		const Message& Push(unsigned short visibility, ChatLayout layout);
+
+		size_t Size() const { return count; }
+		size_t Capacity() const { return capacity; }
+		bool Full() const { return count == capacity; }
+
+		//0 is the newest message
+		const Message& FromNewest(size_t i) const;
+		const Message& Oldest() const { return FromNewest(count - 1); }
+
+	private:
+		size_t capacity;
+		size_t count = 0;
+		size_t head = 0; //slot of the oldest message once the buffer is full
+		uint32_t next_id = 0;
+		std::vector<Message> slots;
+	};
+}
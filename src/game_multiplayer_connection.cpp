@@ -6,28 +6,32 @@
 #include "game_multiplayer_nametags.h"
 #include "game_multiplayer_other_player.h"
 #include "game_multiplayer_my_data.h"
+#include "game_multiplayer_protocol.h"
+#include "game_multiplayer_send_queue.h"
+#include "game_multiplayer_transport.h"
 #include "game_map.h"
 #include "drawable_mgr.h"
+#include "filefinder.h"
 #include "player.h"
 
 namespace Game_Multiplayer {
 
-///////////////////////////web socket callbacks begin
-
-EM_BOOL onopen(int eventType, const EmscriptenWebSocketOpenEvent *websocketEvent, void *userData);
-EM_BOOL onclose(int eventType, const EmscriptenWebSocketCloseEvent *websocketEvent, void *userData);
-EM_BOOL onmessage(int eventType, const EmscriptenWebSocketMessageEvent *websocketEvent, void *userData);
+void onopen();
+void onclose();
 
 namespace ConnectionData {
 	std::string host = "";
 
-	EMSCRIPTEN_WEBSOCKET_T socket;
+	std::unique_ptr<Transport> transport;
 
 	time_t lastConnect = 0;
 	time_t reconnectInterval = 5;
 	bool connected = false;
 	int room_id = 0;
 
+	int protocolVersion = 0;
+	int protocolFeatures = 0;
+
 	bool roomFirstUpdate = true;
 }
 
@@ -36,15 +40,20 @@ void TrySend(const std::string& msg) {
 }
 
 void TrySend(const void* buffer, size_t size) {
-	unsigned short ready;
-	emscripten_websocket_get_ready_state(ConnectionData::socket, &ready);
-
-	if (ready == 1) { //1 means OPEN
-		emscripten_websocket_send_binary(ConnectionData::socket, (void*)buffer, size);
-	}
+	SendQueue::Push(buffer, size);
 	MyData::shouldsync = true;	
 }
 
+void SendImmediate(const void* buffer, size_t size) {
+	SendQueue::Flush();
+	SendFrame(buffer, size);
+	MyData::shouldsync = true;
+}
+
+bool SendFrame(const void* buffer, size_t size) {
+	return ConnectionData::transport && ConnectionData::transport->Send(buffer, size);
+}
+
 void ConnectToGame() {
 
 	ConnectionData::lastConnect = time(NULL);
@@ -52,18 +61,39 @@ void ConnectToGame() {
 	SetConnStatusWindowText("Disconnected");
 	ConnectionData::connected = false;
 
-	//create emscripten WS//
-	EmscriptenWebSocketCreateAttributes ws_attrs = {
-		ConnectionData::host.c_str(),
-		"binary",
-		EM_TRUE
-	};
-
-	ConnectionData::socket = emscripten_websocket_new(&ws_attrs);
-	emscripten_websocket_set_onopen_callback(ConnectionData::socket, NULL, onopen);
-	emscripten_websocket_set_onclose_callback(ConnectionData::socket, NULL, onclose);
-	emscripten_websocket_set_onmessage_callback(ConnectionData::socket, NULL, onmessage);
-	/////////////////////////
+	ConnectionData::transport = Transport::Create(ConnectionData::host);
+	if (ConnectionData::transport) {
+		ConnectionData::transport->Connect(ConnectionData::host);
+	}
+}
+
+void Disconnect() {
+	SetConnStatusWindowText("Disconnected");
+	ConnectionData::connected = false;
+	//dropping the transport discards its pending events, so no onclose for this one
+	ConnectionData::transport.reset();
+}
+
+void PollConnection() {
+	Transport::Event event;
+	//the handlers may reconnect, always poll the current transport
+	while (ConnectionData::transport && ConnectionData::transport->Poll(event)) {
+		switch (event.type) {
+			case Transport::Event::Type::Open:
+				onopen();
+				break;
+			case Transport::Event::Type::Close:
+				onclose();
+				break;
+			case Transport::Event::Type::Message:
+				if (event.text) {
+					HandleReceivedPacket((const char*)event.data);
+				} else {
+					HandleReceivedBinaryPacket(event.data, event.size);
+				}
+				break;
+		}
+	}
 }
 
 //changes the room that client is connected to
@@ -75,14 +105,17 @@ void ConnectToRoom(int map_id) {
 	//send change room packet
 	//if we're not connected yet then it would be dropped and that's fine
 	//since we call this function again in websocket onopen callback
+	//room change is an untyped packet and everything queued before it belongs to the old room
 	uint16_t room_id16[] = {(uint16_t)ConnectionData::room_id};
-	TrySend((void*)room_id16, sizeof(uint16_t));
+	SendImmediate((void*)room_id16, sizeof(uint16_t));
 
 	//connect to local chat and let JS know room id
+	#ifdef EMSCRIPTEN
 	EM_ASM({
 		ConnectToLocalChat($0);
 		SetRoomID($0);
 	}, ConnectionData::room_id);
+	#endif
 	
 	#if defined(INGAME_CHAT)
 		Chat_Multiplayer::setStatusRoom(ConnectionData::room_id);
@@ -101,43 +134,43 @@ void SetConnStatusWindowText(std::string s) {
 	#endif
 }
 
-#define RECEIVE_BUFFER_SIZE 8192
-char receiveBuffer[RECEIVE_BUFFER_SIZE];
-
-///////////////////////////web socket callbacks begin
+///////////////////////////transport events begin
 
-EM_BOOL onopen(int eventType, const EmscriptenWebSocketOpenEvent *websocketEvent, void *userData) {
+void onopen() {
 	ClearPlayers();
+	ResetUidTable();
 	SetConnStatusWindowText("Connected");
 	ConnectionData::connected = true;
+	ConnectionData::protocolVersion = 0;
+	ConnectionData::protocolFeatures = 0;
 	
+	//packets queued while disconnected are stale
+	SendQueue::Clear();
+
 	//tell server that we want to use game handler
-	TrySend(Player::emscripten_game_name + "game");
+	#ifdef EMSCRIPTEN
+	std::string handler = Player::emscripten_game_name + "game";
+	#else
+	//no --game argument outside of the browser, the game directory is named like the game
+	std::string handler = "game";
+	if(FileFinder::Game()) {
+		handler = FileFinder::GetPathAndFilename(FileFinder::Game().GetFullPath()).second + handler;
+	}
+	#endif
+	SendImmediate(handler.c_str(), handler.length());
+
+	//offer the binary protocol, json is used until the server answers with a hello frame
+	uint16_t hello[] = {PacketTypes::protocol, Protocol::version, Protocol::Features::supported};
+	SendImmediate(hello, sizeof(hello));
 	
 	ConnectToRoom(Game_Map::GetMapId());
 	SendPlayerData();
-		
-	return EM_TRUE;
 }
 
-EM_BOOL onclose(int eventType, const EmscriptenWebSocketCloseEvent *websocketEvent, void *userData) {
+void onclose() {
 	SetConnStatusWindowText("Disconnected");
 	ConnectionData::connected = false;
-		
-	emscripten_websocket_deinitialize();
-
-	return EM_TRUE;
-}
-
-
-EM_BOOL onmessage(int eventType, const EmscriptenWebSocketMessageEvent *websocketEvent, void *userData) {
-	if(websocketEvent->isText) {
-		//i might be doing some extra work here with copying received data to reveiveBuffer and ther passing it into a function that copies that buffer again
-		strcpy(receiveBuffer, (char*)websocketEvent->data);
-		HandleReceivedPacket(receiveBuffer);
-	}
-	return EM_TRUE;
 }
-///////////////////////////web callbacks end
+///////////////////////////transport events end
 
 }
\ No newline at end of file
@@ -1,12 +1,20 @@
 #pragma once
+#ifdef EMSCRIPTEN
 #include <emscripten/emscripten.h>
-#include <emscripten/websocket.h>
+#endif
+#include <memory>
 #include <string>
 #include <time.h>
 
 namespace Game_Multiplayer {
-	//creates WebSocket connection to game server
+	class Transport;
+
+	//creates connection to game server, the url scheme of ConnectionData::host selects the transport
 	void ConnectToGame();
+	//drops the connection, Update reconnects after reconnectInterval
+	void Disconnect();
+	//dispatches the events received by the transport, called once per main loop iteration
+	void PollConnection();
 	//changes room client is connected to 
 	void ConnectToRoom(int room_id);
 	
@@ -17,19 +25,31 @@ namespace Game_Multiplayer {
 	//even tho we send a string data, message format is still defined by emscripten websocket format
 	void TrySend(const std::string& msg);
 
-	//sends binary data trough game WebSocket, drops packet if socket is not connected
+	//queues binary data for the game WebSocket, the queue is flushed once per frame (see SendQueue)
+	//packet is dropped if socket is not connected at flush time
 	void TrySend(const void* buffer, size_t size);
 
+	//flushes the queue and sends binary data right away, for packets that must not be batched
+	void SendImmediate(const void* buffer, size_t size);
+
+	//writes a single frame to the socket, returns false if socket is not connected
+	bool SendFrame(const void* buffer, size_t size);
+
 	namespace ConnectionData {
 		extern std::string host;
 
-		extern EMSCRIPTEN_WEBSOCKET_T socket;
+		extern std::unique_ptr<Transport> transport;
 
 		extern time_t lastConnect;
 		extern time_t reconnectInterval;
 		extern bool connected;
 		extern int room_id;
 
+		//binary protocol version and features accepted by the server in its hello reply
+		//both stay 0 while talking to a json only server
+		extern int protocolVersion;
+		extern int protocolFeatures;
+
 		//not sure if it has in that namespace
 		//true before first update in multiplayer main loop after we connected to a new room
 		extern bool roomFirstUpdate;
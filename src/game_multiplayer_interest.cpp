@@ -0,0 +1,38 @@
+#include "game_multiplayer_interest.h"
+
+namespace Game_Multiplayer {
+
+constexpr int InterestArea::enter_margin;
+constexpr int InterestArea::leave_margin;
+
+void InterestArea::SetView(int display_x, int display_y, int view_w, int view_h, int map_w, int map_h, bool loop_h, bool loop_v) {
+	//display coordinates have 16 sub tile steps of 16 pixels
+	constexpr int sub_tiles = 256;
+
+	//a partially scrolled screen touches one more tile
+	left = display_x / sub_tiles;
+	top = display_y / sub_tiles;
+	width = view_w + (display_x % sub_tiles != 0);
+	height = view_h + (display_y % sub_tiles != 0);
+	this->map_w = map_w;
+	this->map_h = map_h;
+	this->loop_h = loop_h;
+	this->loop_v = loop_v;
+}
+
+bool InterestArea::AxisContains(int pos, int first, int size, int map_size, bool loop, int margin) const {
+	if (loop && map_size > 0) {
+		//offset from the first visible tile, wrapped around the map
+		int offset = ((pos - first) % map_size + map_size) % map_size;
+		return offset < size + margin || offset >= map_size - margin;
+	}
+	return pos >= first - margin && pos < first + size + margin;
+}
+
+bool InterestArea::Contains(int x, int y, bool active) const {
+	int margin = active ? leave_margin : enter_margin;
+	return AxisContains(x, left, width, map_w, loop_h, margin)
+		&& AxisContains(y, top, height, map_h, loop_v, margin);
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+namespace Game_Multiplayer {
+
+	/*
+		Area of interest of the local client: the tiles on screen plus a margin.
+
+		Remote players outside of it are dormant: only their position is tracked, their
+		character and sprite are not updated and their nametag is not drawn. The margin is
+		larger for leaving than for entering, so players walking along the edge don't flip
+		between both states every step.
+	*/
+	class InterestArea {
+	public:
+		//margins around the screen in tiles
+		static constexpr int enter_margin = 2;
+		static constexpr int leave_margin = 5;
+
+		//display_x/y are Game_Map::GetDisplayX/Y, view_w/h the screen size in tiles
+		void SetView(int display_x, int display_y, int view_w, int view_h, int map_w, int map_h, bool loop_h, bool loop_v);
+
+		//whether a player at tile (x, y) should be active, active is its current state
+		bool Contains(int x, int y, bool active) const;
+
+	private:
+		bool AxisContains(int pos, int first, int size, int map_size, bool loop, int margin) const;
+
+		int left = 0;
+		int top = 0;
+		int width = 0;
+		int height = 0;
+		int map_w = 0;
+		int map_h = 0;
+		bool loop_h = false;
+		bool loop_v = false;
+	};
+
+	struct InterestStats {
+		int active = 0;
+		int dormant = 0;
+	};
+
+	//players simulated (active) and only tracked (dormant) in the last Update
+	const InterestStats& GetInterestStats();
+}
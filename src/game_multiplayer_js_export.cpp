@@ -8,6 +8,7 @@
 #include "game_player.h"
 #include "scene.h"
 #include "main_data.h"
+#include "output.h"
 
 using namespace Game_Multiplayer;
 
@@ -70,7 +71,11 @@ extern "C" {
 		for(auto& swt : Game_Multiplayer::MyData::syncedswitches) {
 			liststr += std::to_string(swt) + ",";
 		}
+		#ifdef EMSCRIPTEN
 		EM_ASM({console.log(UTF8ToString($0));}, liststr.c_str());
+		#else
+		Output::Debug("{}", liststr);
+		#endif
 	}
 
 	void SwitchNpcSync() {
@@ -2,13 +2,17 @@
 
 #include "chat_multiplayer.h"
 #include "game_multiplayer_js_import.h"
+#ifdef EMSCRIPTEN
 #include <emscripten/emscripten.h>
 #include <emscripten/websocket.h>
+#endif
 
 extern "C" {
 	void SendChatMessage(const char* msg) {
+		#ifdef EMSCRIPTEN
 		EM_ASM({
 			SendMessageString(UTF8ToString($0));
 		}, msg);
+		#endif
 	};
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include "game_multiplayer_nametags.h"
 #include "game_multiplayer_my_data.h"
 #include "game_multiplayer_connection.h"
+#include "game_multiplayer_send_queue.h"
+#include "game_multiplayer_interest.h"
 #include <map>
 #include <memory>
 #include <queue>
@@ -28,10 +30,48 @@
 #include "game_variables.h"
 #include "game_switches.h"
 #include "game_map.h"
+#include "game_clock.h"
 #include "player.h"
 
 namespace Game_Multiplayer {
 
+static InterestArea interest;
+static InterestStats interest_stats;
+
+const InterestStats& GetInterestStats() {
+	return interest_stats;
+}
+
+//dormant players skip the walk, they jump to the newest position that is due
+static void UpdateDormantPlayer(size_t i, Game_Clock::time_point now) {
+	auto& p = other_players[i];
+	int posX, posY;
+	bool moved = false;
+	while (p.mvq.Pop(now, posX, posY)) {
+		moved = true;
+	}
+	if (moved) {
+		p.ch->SetX(posX);
+		p.ch->SetY(posY);
+		p.ch->SetRemainingStep(0);
+		nameTagRenderer->moveNameTag(other_players.GetHandle(i), posX, posY);
+		SetPlayerPosition(i, posX, posY);
+	}
+}
+
+//moves a player between the active and dormant state when it crossed the area of interest
+static void UpdateInterest(size_t i) {
+	auto& p = other_players[i];
+	auto& pos = other_players.GetPosition(i);
+	bool active = interest.Contains(pos.x, pos.y, !p.dormant);
+	if (active == !p.dormant) {
+		return;
+	}
+	p.dormant = !active;
+	p.sprite->SetVisible(active);
+	nameTagRenderer->setTagVisible(other_players.GetHandle(i), active);
+}
+
 //this assumes that the player is stopped
 void MovePlayerToPos(std::shared_ptr<Game_PlayerOther> &player, int x, int y) {
 	if (!player->IsStopping()) {
@@ -52,12 +92,6 @@ void MovePlayerToPos(std::shared_ptr<Game_PlayerOther> &player, int x, int y) {
 
 void Update() {
 
-
-	if(MyData::shouldsync) {
-		SyncMe();
-		MyData::shouldsync = false;
-	}
-
 	//apply weather
 	if(MyData::nextWeatherType != -1) {
 		MyData::weatherT++;
@@ -70,33 +104,42 @@ void Update() {
 		}
 	}
 
-	for (auto& p : other_players) {
-		auto& q = p.second.mvq;
-		if (!q.empty() && p.second.ch->IsStopping()) {
-			auto posX = q.front().first;
-			auto posY = q.front().second;
-			MovePlayerToPos(p.second.ch, posX, posY);
-			nameTagRenderer->moveNameTag(p.first, posX, posY);
-			if(q.size() > 8) {
-				p.second.ch->SetMoveSpeed(6);
-				while(q.size() > 16)
-						q.pop();
-			} else {
-				p.second.ch->SetMoveSpeed(p.second.moveSpeed);
-			}
-			q.pop();
+	auto now = Game_Clock::GetFrameTime();
+	interest.SetView(Game_Map::GetDisplayX(), Game_Map::GetDisplayY(), SCREEN_WIDTH / SCREEN_TILE_SIZE, SCREEN_HEIGHT / SCREEN_TILE_SIZE,
+		Game_Map::GetWidth(), Game_Map::GetHeight(), Game_Map::LoopHorizontal(), Game_Map::LoopVertical());
+	interest_stats = {};
+
+	for (size_t i = 0; i < other_players.size(); ++i) {
+		auto& p = other_players[i];
+		UpdateInterest(i);
+		if (p.dormant) {
+			UpdateDormantPlayer(i, now);
+			++interest_stats.dormant;
+			continue;
+		}
+		++interest_stats.active;
+
+		auto& q = p.mvq;
+		//backlog is measured before taking the next position, so it counts too
+		int speed = q.SuggestMoveSpeed(p.moveSpeed, now);
+		int posX, posY;
+		if (p.ch->IsStopping() && q.Pop(now, posX, posY)) {
+			MovePlayerToPos(p.ch, posX, posY);
+			nameTagRenderer->moveNameTag(other_players.GetHandle(i), posX, posY);
+			p.ch->SetMoveSpeed(speed);
 		}
-		p.second.ch->SetProcessed(false);
+		p.ch->SetProcessed(false);
 
-		Color ch_prev_flash_c = p.second.ch->GetFlashColor();
-		int ch_prev_flash_p = p.second.ch->GetFlashLevel();
-		int ch_prev_flash_t = p.second.ch->GetFlashTimeLeft();
+		Color ch_prev_flash_c = p.ch->GetFlashColor();
+		int ch_prev_flash_p = p.ch->GetFlashLevel();
+		int ch_prev_flash_t = p.ch->GetFlashTimeLeft();
 	
-		p.second.ch->Update();
-		p.second.sprite->Update();
+		p.ch->Update();
+		p.sprite->Update();
+		SetPlayerPosition(i, p.ch->GetX(), p.ch->GetY());
 
-		if(p.second.flashpause) {
-			p.second.ch->Flash(ch_prev_flash_c.red, ch_prev_flash_c.green, ch_prev_flash_c.blue, ch_prev_flash_p, ch_prev_flash_t);
+		if(p.flashpause) {
+			p.ch->Flash(ch_prev_flash_c.red, ch_prev_flash_c.green, ch_prev_flash_c.blue, ch_prev_flash_p, ch_prev_flash_t);
 		}
 	}
 
@@ -122,6 +165,14 @@ void Update() {
 		
 		ConnectionData::roomFirstUpdate = false;
 	}
+
+	if(MyData::shouldsync) {
+		SyncMe();
+		MyData::shouldsync = false;
+	}
+
+	//everything sent during this frame goes out as one message
+	SendQueue::Flush();
 }
 
 }
\ No newline at end of file
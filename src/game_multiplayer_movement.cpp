@@ -0,0 +1,89 @@
+#include "game_multiplayer_movement.h"
+#include <algorithm>
+
+namespace Game_Multiplayer {
+
+constexpr int MovementBuffer::capacity;
+constexpr MovementBuffer::duration MovementBuffer::min_delay;
+constexpr MovementBuffer::duration MovementBuffer::max_delay;
+
+void MovementBuffer::UpdateJitter(time_point arrival) {
+	if (!has_arrival) {
+		has_arrival = true;
+		last_arrival = arrival;
+		return;
+	}
+	//positions of the same packet share their arrival time
+	if (arrival == last_arrival) {
+		return;
+	}
+
+	duration ia = arrival - last_arrival;
+	last_arrival = arrival;
+
+	//exponential moving averages with gain 1/16, as in RFC 3550
+	if (interval == duration::zero()) {
+		interval = ia;
+	} else {
+		interval += (ia - interval) / 16;
+	}
+	duration deviation = ia > interval ? ia - interval : interval - ia;
+	jitter += (deviation - jitter) / 16;
+
+	playout_delay = std::min(std::max(jitter * 2, min_delay), max_delay);
+}
+
+void MovementBuffer::Push(int x, int y, time_point arrival) {
+	UpdateJitter(arrival);
+
+	if (count == capacity) {
+		head = (head + 1) % capacity;
+		--count;
+		++dropped;
+	}
+
+	//keep playout order even when the delay shrinks
+	time_point due = arrival + playout_delay;
+	if (count > 0) {
+		due = std::max(due, items[(head + count - 1) % capacity].due);
+	}
+
+	items[(head + count) % capacity] = { x, y, due };
+	++count;
+}
+
+bool MovementBuffer::Pop(time_point now, int& x, int& y) {
+	if (count == 0 || items[head].due > now) {
+		return false;
+	}
+	x = items[head].x;
+	y = items[head].y;
+	head = (head + 1) % capacity;
+	--count;
+	return true;
+}
+
+int MovementBuffer::SuggestMoveSpeed(int base_speed, time_point now) const {
+	//due times are ordered, positions still waiting for their playout time aren't backlog
+	int backlog = 0;
+	while (backlog < count && items[(head + backlog) % capacity].due <= now) {
+		++backlog;
+	}
+
+	int speed = base_speed;
+	for (; backlog > 1; backlog >>= 1) {
+		++speed;
+	}
+	return std::min(std::max(speed, 1), 6);
+}
+
+void MovementBuffer::Clear() {
+	head = 0;
+	count = 0;
+	has_arrival = false;
+	interval = {};
+	jitter = {};
+	playout_delay = min_delay;
+}
+
+}
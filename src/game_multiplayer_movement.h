@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "game_clock.h"
+
+namespace Game_Multiplayer {
+
+	/*
+		Jitter buffer for the tile positions of a remote player.
+
+		Positions are timestamped when they arrive and played out after an adaptive delay,
+		estimated from the jitter of the packet inter-arrival times (like RTP receivers do).
+		A steady stream gets a short delay, bursty delivery a longer one, so a burst is walked
+		at an even pace instead of being skipped.
+
+		Between two tiles the character walks with its own step animation. When the backlog
+		grows the suggested move speed goes up one level per doubling of the backlog instead of
+		jumping to the maximum, so the player catches up without teleporting.
+
+		Memory is bounded: when the buffer is full the oldest position is dropped.
+	*/
+	class MovementBuffer {
+	public:
+		using time_point = Game_Clock::time_point;
+		using duration = Game_Clock::duration;
+
+		static constexpr int capacity = 32;
+
+		//queues a position received at arrival
+		void Push(int x, int y, time_point arrival);
+
+		//takes the next position whose playout time has passed, false if there is none
+		bool Pop(time_point now, int& x, int& y);
+
+		//move speed (1 to 6) to walk the positions already due at now with
+		//base_speed is the speed of the remote player
+		int SuggestMoveSpeed(int base_speed, time_point now) const;
+
+		void Clear();
+
+		bool Empty() const { return count == 0; }
+		size_t Size() const { return count; }
+
+		duration GetPlayoutDelay() const { return playout_delay; }
+		duration GetJitter() const { return jitter; }
+		//positions dropped because the buffer was full
+		uint64_t GetDropped() const { return dropped; }
+
+		static constexpr duration min_delay = std::chrono::duration_cast<duration>(std::chrono::milliseconds(50));
+		static constexpr duration max_delay = std::chrono::duration_cast<duration>(std::chrono::milliseconds(400));
+
+	private:
+		struct Entry {
+			int x;
+			int y;
+			time_point due;
+		};
+
+		void UpdateJitter(time_point arrival);
+
+		Entry items[capacity];
+		int head = 0;
+		int count = 0;
+
+		time_point last_arrival = {};
+		bool has_arrival = false;
+		//smoothed inter-arrival time and its mean deviation
+		duration interval = {};
+		duration jitter = {};
+		duration playout_delay = min_delay;
+		uint64_t dropped = 0;
+	};
+}
@@ -0,0 +1,152 @@
+#include "game_multiplayer_nametag_atlas.h"
+#include <algorithm>
+#include <cassert>
+
+namespace Game_Multiplayer {
+
+	NameTagAtlas::Id NameTagAtlas::Acquire(const std::string& key, int width, int height, const RenderFn& render) {
+		auto it = by_key.find(key);
+		if (it != by_key.end()) {
+			Entry& e = entries[it->second];
+			if (e.refs++ == 0) {
+				lru.erase(e.lru);
+			}
+			return it->second;
+		}
+
+		width = std::max(1, std::min(width, page_width));
+		height = std::max(1, std::min(height, page_height));
+
+		Id id;
+		if (!free_ids.empty()) {
+			id = free_ids.back();
+			free_ids.pop_back();
+		} else {
+			id = static_cast<Id>(entries.size());
+			entries.emplace_back();
+		}
+
+		Entry e;
+		while (!Allocate(width, height, e)) {
+			if (!EvictOne()) {
+				Page page;
+				page.bitmap = Bitmap::Create(page_width, page_height, true);
+				pages.push_back(std::move(page));
+			}
+		}
+		e.key = key;
+		e.refs = 1;
+		entries[id] = std::move(e);
+		by_key.emplace(key, id);
+
+		const Entry& placed = entries[id];
+		render(*pages[placed.page].bitmap, placed.rect.x, placed.rect.y);
+		return id;
+	}
+
+	void NameTagAtlas::Release(Id id) {
+		if (id == invalid_id) {
+			return;
+		}
+		Entry& e = entries[id];
+		assert(e.refs > 0);
+		if (--e.refs == 0) {
+			lru.push_front(id);
+			e.lru = lru.begin();
+		}
+	}
+
+	void NameTagAtlas::Clear() {
+		pages.clear();
+		entries.clear();
+		free_ids.clear();
+		by_key.clear();
+		lru.clear();
+	}
+
+	bool NameTagAtlas::Allocate(int width, int height, Entry& e) {
+		for (int i = 0; i < static_cast<int>(pages.size()); ++i) {
+			if (AllocateInPage(i, width, height, e)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool NameTagAtlas::AllocateInPage(int page_index, int width, int height, Entry& e) {
+		Page& page = pages[page_index];
+
+		auto take = [&](int shelf_index, Shelf& shelf, std::vector<Span>::iterator span) {
+			e.page = page_index;
+			e.shelf = shelf_index;
+			e.rect = Rect(span->x, shelf.y, width, height);
+			span->x += width;
+			span->width -= width;
+			if (span->width == 0) {
+				shelf.free.erase(span);
+			}
+		};
+
+		//only use shelves that don't waste more than half of their height
+		for (int s = 0; s < static_cast<int>(page.shelves.size()); ++s) {
+			Shelf& shelf = page.shelves[s];
+			if (shelf.height < height || shelf.height > height * 2) {
+				continue;
+			}
+			for (auto span = shelf.free.begin(); span != shelf.free.end(); ++span) {
+				if (span->width >= width) {
+					take(s, shelf, span);
+					return true;
+				}
+			}
+		}
+
+		if (page.next_y + height > page_height) {
+			return false;
+		}
+		page.shelves.push_back({ page.next_y, height, { { 0, page_width } } });
+		page.next_y += height;
+		Shelf& shelf = page.shelves.back();
+		take(static_cast<int>(page.shelves.size()) - 1, shelf, shelf.free.begin());
+		return true;
+	}
+
+	void NameTagAtlas::Free(Entry& e) {
+		Page& page = pages[e.page];
+		Shelf& shelf = page.shelves[e.shelf];
+		page.bitmap->ClearRect(Rect(e.rect.x, shelf.y, e.rect.width, shelf.height));
+
+		//insert sorted and merge with the neighbours
+		auto next = std::lower_bound(shelf.free.begin(), shelf.free.end(), e.rect.x,
+			[](const Span& s, int x) { return s.x < x; });
+		auto span = shelf.free.insert(next, { e.rect.x, e.rect.width });
+		auto after = span + 1;
+		if (after != shelf.free.end() && span->x + span->width == after->x) {
+			span->width += after->width;
+			span = shelf.free.erase(after) - 1;
+		}
+		if (span != shelf.free.begin()) {
+			auto before = span - 1;
+			if (before->x + before->width == span->x) {
+				before->width += span->width;
+				shelf.free.erase(span);
+			}
+		}
+	}
+
+	bool NameTagAtlas::EvictOne() {
+		if (lru.empty()) {
+			return false;
+		}
+		Id id = lru.back();
+		lru.pop_back();
+
+		Entry& e = entries[id];
+		Free(e);
+		by_key.erase(e.key);
+		e = Entry();
+		free_ids.push_back(id);
+		++evicted;
+		return true;
+	}
+}
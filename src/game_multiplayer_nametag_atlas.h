@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bitmap.h"
+#include "rect.h"
+
+namespace Game_Multiplayer {
+
+	/*
+		Texture atlas for the nametag graphics.
+
+		Every distinct tag (name and system graphic) is rendered once into a shared page and
+		all tags showing it draw from there, so tags are not rebuilt or reallocated when
+		players come and go. Pages are split into shelves as high as the tags, a shelf hands
+		out horizontal spans first fit.
+
+		Entries hold a reference count. Referenced entries are never evicted, unreferenced ones
+		stay cached (the player may come back or switch back to the old system) until their space
+		is needed, least recently released first. A new page is only added when every entry on
+		the existing pages is still referenced.
+	*/
+	class NameTagAtlas {
+	public:
+		static constexpr int page_width = 256;
+		static constexpr int page_height = 256;
+
+		using Id = uint32_t;
+		static constexpr Id invalid_id = 0xFFFFFFFF;
+
+		//draws the entry into dst at (x, y), the area is transparent and of the size passed to Acquire
+		using RenderFn = std::function<void(Bitmap& dst, int x, int y)>;
+
+		//returns the entry of key and takes a reference to it, renders it if it is not cached.
+		//sizes are clamped to the page
+		Id Acquire(const std::string& key, int width, int height, const RenderFn& render);
+		//drops a reference taken by Acquire, invalid_id is ignored
+		void Release(Id id);
+
+		Bitmap& GetPage(Id id) const { return *pages[entries[id].page].bitmap; }
+		const Rect& GetRect(Id id) const { return entries[id].rect; }
+		//index of the page of the entry, entries of the same page share the source bitmap
+		int GetPageIndex(Id id) const { return entries[id].page; }
+
+		//drops every entry and page, all ids become invalid
+		void Clear();
+
+		//cached entries, referenced or not
+		size_t Size() const { return by_key.size(); }
+		size_t PageCount() const { return pages.size(); }
+		size_t GetEvicted() const { return evicted; }
+
+	private:
+		struct Span {
+			int x;
+			int width;
+		};
+		struct Shelf {
+			int y;
+			int height;
+			//free spans sorted by x
+			std::vector<Span> free;
+		};
+		struct Page {
+			BitmapRef bitmap;
+			std::vector<Shelf> shelves;
+			//top of the unused area below the last shelf
+			int next_y = 0;
+		};
+		struct Entry {
+			std::string key;
+			int page = -1;
+			int shelf = -1;
+			Rect rect;
+			int refs = 0;
+			std::list<Id>::iterator lru;
+		};
+
+		bool Allocate(int width, int height, Entry& e);
+		bool AllocateInPage(int page, int width, int height, Entry& e);
+		void Free(Entry& e);
+		//drops the least recently released entry, false if all entries are referenced
+		bool EvictOne();
+
+		std::vector<Page> pages;
+		std::vector<Entry> entries;
+		std::vector<Id> free_ids;
+		std::unordered_map<std::string, Id> by_key;
+		//unreferenced entries, most recently released first
+		std::list<Id> lru;
+		size_t evicted = 0;
+	};
+}
@@ -1,6 +1,8 @@
 
 #include "game_multiplayer_nametags.h"
 #include "game_multiplayer_my_data.h"
+#include "game_multiplayer_system_skins.h"
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <queue>
@@ -35,108 +37,221 @@ unsigned long DrawableNameTags::coordHash(int x, int y) {
 }
 
 void DrawableNameTags::buildTagGraphic(Tag* tag) {
+	// the system only changes the look of the tag while systems are synced
+	bool useSystem = tag->systemGraphic && Game_Multiplayer::MyData::systemsync;
+	std::string key = tag->name;
+	key += '\0';
+	if(useSystem) {
+		key += tag->system;
+	} else {
+		// tags drawn with the game system are cached per system graphic of the game
+		key += '\0';
+		key += std::to_string(defaultSystemGeneration);
+	}
+
 	Rect rect = Font::Tiny()->GetSize(tag->name);
-	tag->renderGraphic = Bitmap::Create(rect.width+1, rect.height+1);
-	Color shadowColor = Color(0, 0, 0, 255); // shadow color
-	Text::Draw(*tag->renderGraphic, 1, 1, *Font::Tiny(), shadowColor, tag->name); // draw black fallback shadow
-	Text::Draw(*tag->renderGraphic, 0, 0, *Font::Tiny(), (tag->system.length() && Game_Multiplayer::MyData::systemsync) ? *Cache::System(tag->system) : *Cache::SystemOrBlack(), 0, tag->name);
+	auto id = atlas.Acquire(key, rect.width+1, rect.height+1, [&](Bitmap& dst, int x, int y) {
+		Color shadowColor = Color(0, 0, 0, 255); // shadow color
+		Text::Draw(dst, x+1, y+1, *Font::Tiny(), shadowColor, tag->name); // draw black fallback shadow
+		Text::Draw(dst, x, y, *Font::Tiny(), useSystem ? *tag->systemGraphic : *Cache::SystemOrBlack(), 0, tag->name);
+	});
+	// release after acquiring, so rebuilding with the same key doesn't render again
+	atlas.Release(tag->atlasId);
+	tag->atlasId = id;
+}
+
+void DrawableNameTags::releaseTag(Tag* tag) {
+	// the graphic stays cached in the atlas until the space is needed
+	atlas.Release(tag->atlasId);
+	if(tag->requestedSystem.length()) {
+		Game_Multiplayer::system_skins.Release(tag->requestedSystem);
+	}
+}
+
+void DrawableNameTags::removeFromStack(Tag* tag) {
+	auto it = nameStacks.find(coordHash(tag->x, tag->y));
+	if(it == nameStacks.end()) return;
+	std::vector<Tag*>& stack = it->second.stack;
+	stack.erase(std::remove(stack.begin(), stack.end(), tag), stack.end());
+	if(stack.empty()) nameStacks.erase(it);
 }
 
 DrawableNameTags::DrawableNameTags() : Drawable(Priority_Window, Drawable::Flags::Global) {
 	DrawableMgr::Register(this);
 }
 
+bool DrawableNameTags::GetDamageState(DamageState& state) const {
+	return !Game_Multiplayer::MyData::rendernametags || nameStacks.empty();
+}
+
 void DrawableNameTags::Draw(Bitmap& dst) {
 	if(!Game_Multiplayer::MyData::rendernametags) return;
 
 	const unsigned int stackDelta = 8;
+	const int tagOffset = TILE_SIZE*1.75;
+	const Rect screen = dst.GetRect();
+
+	// collect the visible tags first, stacks that can't reach the screen are skipped as a whole
+	drawOps.clear();
 	for(auto& it : nameStacks) {
-		unsigned int nTags = it.second.stack.size();
+		TagStack& tagStack = it.second;
+		unsigned int nTags = tagStack.stack.size();
 		if(nTags >= 10) {
 			// swaying
-			it.second.swayAnim += 0.01;
+			tagStack.swayAnim += 0.01;
 		} else {
-			it.second.swayAnim = 0;
+			tagStack.swayAnim = 0;
 		}
-		for(int i = 0; i < nTags; i++) {
-			Tag* tag = it.second.stack[i];
-			auto rect = tag->renderGraphic->GetRect();
-			if(it.second.swayAnim == 0) {
+
+		auto first = std::find_if(tagStack.stack.begin(), tagStack.stack.end(), [](Tag* tag) { return tag->visible; });
+		if(first == tagStack.stack.end()) continue;
+
+		// tags are at most an atlas page wide and swaying bends the stack at most by its height.
+		// the anchors of a stack may be mid step, so allow one tile more.
+		int sx = (*first)->anchor->GetScreenX();
+		int sy = (*first)->anchor->GetScreenY()-tagOffset;
+		int reach = stackDelta*nTags+TILE_SIZE;
+		int halfWidth = Game_Multiplayer::NameTagAtlas::page_width/2+reach;
+		if(sx+halfWidth < 0 || sx-halfWidth > screen.width || sy+reach < 0 || sy-reach-Game_Multiplayer::NameTagAtlas::page_height > screen.height) {
+			continue;
+		}
+
+		int i = 0;
+		for(Tag* tag : tagStack.stack) {
+			if(!tag->visible) continue;
+			const Rect& rect = atlas.GetRect(tag->atlasId);
+			if(tagStack.swayAnim == 0) {
 				// steady stack
-				dst.Blit(tag->anchor->GetScreenX()-rect.width/2, tag->anchor->GetScreenY()-rect.height-TILE_SIZE*1.75-stackDelta*i, *tag->renderGraphic, rect, Opacity::Opaque());
+				int x = tag->anchor->GetScreenX()-rect.width/2;
+				int y = tag->anchor->GetScreenY()-rect.height-tagOffset-stackDelta*i;
+				if(Rect(x, y, rect.width, rect.height).IsOutOfBounds(screen)) {
+					++i;
+					continue;
+				}
+				drawOps.push_back({ tag->atlasId, x, y, 0 });
 			} else {
 				// jenga tower be like
-				float sway = sin(it.second.swayAnim);
+				float sway = sin(tagStack.swayAnim);
 				float swayRadius = 192/sway;
 				float angleStep = stackDelta/swayRadius;
 				int rx = tag->anchor->GetScreenX();
-				int ry = tag->anchor->GetScreenY()-TILE_SIZE*1.75;
+				int ry = tag->anchor->GetScreenY()-tagOffset;
 				rx = rx+(cos(i*angleStep)-1)*swayRadius;
 				ry = ry-sin(i*angleStep)*swayRadius;
-				float angle = -angleStep*i;
-				dst.RotateZoomOpacityBlit(rx, ry, rect.width/2, rect.height, *tag->renderGraphic, rect, angle, 1, 1, Opacity::Opaque());
+				drawOps.push_back({ tag->atlasId, rx, ry, -angleStep*i });
 			}
+			++i;
+		}
+	}
+
+	// all tags blit from the few atlas pages, so the source images stay the same across the batch
+	for(const DrawOp& op : drawOps) {
+		const Rect& rect = atlas.GetRect(op.atlasId);
+		Bitmap& page = atlas.GetPage(op.atlasId);
+		if(op.angle == 0) {
+			dst.Blit(op.x, op.y, page, rect, Opacity::Opaque());
+		} else {
+			dst.RotateZoomOpacityBlit(op.x, op.y, rect.width/2, rect.height, page, rect, op.angle, 1, 1, Opacity::Opaque());
 		}
 	}
 }
 
-void DrawableNameTags::createNameTag(std::string uid, Game_Character* anchor) {
-	assert(!nameTags.count(uid)); // prevent creating nametag for uid that already exists
+DrawableNameTags::Tag* DrawableNameTags::findTag(Game_Multiplayer::PlayerHandle handle) {
+	if(handle.index >= nameTags.size()) return nullptr;
+	Tag* tag = nameTags[handle.index].get();
+	return (tag && tag->handle == handle) ? tag : nullptr;
+}
+
+void DrawableNameTags::createNameTag(Game_Multiplayer::PlayerHandle handle, Game_Character* anchor) {
+	assert(!findTag(handle)); // prevent creating nametag for player that already has one
 
 	std::unique_ptr<Tag> tag = std::make_unique<Tag>();
 	tag->anchor = anchor;
+	tag->handle = handle;
 	tag->name = "";
 	tag->system = "";
 	buildTagGraphic(tag.get());
 
 	nameStacks[coordHash(tag->x, tag->y)].stack.push_back(tag.get());
-	nameTags[uid] = std::move(tag);
+	if(handle.index >= nameTags.size()) {
+		nameTags.resize(handle.index + 1);
+	}
+	nameTags[handle.index] = std::move(tag);
 }
 
-void DrawableNameTags::deleteNameTag(std::string uid) {
-	assert(nameTags.count(uid)); // prevent deleting non existent nametag
+void DrawableNameTags::deleteNameTag(Game_Multiplayer::PlayerHandle handle) {
+	Tag* tag = findTag(handle);
+	assert(tag); // prevent deleting non existent nametag
 
-	Tag* tag = nameTags[uid].get();
-	std::vector<Tag*>& stack = nameStacks[coordHash(tag->x, tag->y)].stack;
-	stack.erase(std::remove(stack.begin(), stack.end(), tag), stack.end());
-	nameTags.erase(uid);
+	removeFromStack(tag);
+	releaseTag(tag);
+	nameTags[handle.index].reset();
 }
 
 void DrawableNameTags::clearNameTags() {
+	for(auto& tag : nameTags) {
+		if(tag) releaseTag(tag.get());
+	}
 	nameTags.clear();
 	nameStacks.clear();
 }
 
-void DrawableNameTags::moveNameTag(std::string uid, int x, int y) {
-	assert(nameTags.count(uid)); // prevent moving non existent nametag
+void DrawableNameTags::moveNameTag(Game_Multiplayer::PlayerHandle handle, int x, int y) {
+	Tag* tag = findTag(handle);
+	assert(tag); // prevent moving non existent nametag
 
-	Tag* tag = nameTags[uid].get();
-	std::vector<Tag*>& stack = nameStacks[coordHash(tag->x, tag->y)].stack;
-	stack.erase(std::remove(stack.begin(), stack.end(), tag), stack.end());
+	removeFromStack(tag);
 	tag->x = x;
 	tag->y = y;
 	nameStacks[coordHash(tag->x, tag->y)].stack.push_back(tag);
 }
 
-void DrawableNameTags::setTagName(const std::string& uid, const std::string& name) {
-	assert(nameTags.count(uid)); // prevent using non existent nametag
-	nameTags[uid]->name = name;
-	buildTagGraphic(nameTags[uid].get());
+void DrawableNameTags::setTagName(Game_Multiplayer::PlayerHandle handle, const std::string& name) {
+	Tag* tag = findTag(handle);
+	assert(tag); // prevent using non existent nametag
+	tag->name = name;
+	buildTagGraphic(tag);
 }
 
-void DrawableNameTags::setTagSystem(const std::string& uid, const std::string& system) {
-	assert(nameTags.count(uid));
+void DrawableNameTags::setTagSystem(Game_Multiplayer::PlayerHandle handle, const std::string& system) {
+	Tag* tag = findTag(handle);
+	assert(tag); // prevent using non existent nametag
+	if(tag->requestedSystem == system) return;
 
-	FileRequestAsync* request = AsyncHandler::RequestFile("System", system);
-	Tag* tag = this->nameTags[uid].get();
+	// players usually share a few systems, so the skins are loaded once for all tags
+	std::string previous = std::move(tag->requestedSystem);
+	tag->requestedSystem = system;
+	if(system.length()) {
+		// the player may leave or switch again before the graphic arrived
+		Game_Multiplayer::system_skins.Acquire(system, [this, handle, system](const BitmapRef& graphic) {
+			Tag* tag = this->findTag(handle);
+			if(!tag || tag->requestedSystem != system) return;
+			tag->system = system;
+			tag->systemGraphic = graphic;
+			this->buildTagGraphic(tag);
+		});
+	} else {
+		tag->system = "";
+		tag->systemGraphic = nullptr;
+		buildTagGraphic(tag);
+	}
+	if(previous.length()) {
+		Game_Multiplayer::system_skins.Release(previous);
+	}
+}
 
-	systemRequest = request->Bind([this, tag](FileRequestResult* result) {
-		tag->system = result->file;
-		this->buildTagGraphic(tag);
-	});
+void DrawableNameTags::systemGraphicChanged() {
+	// the old entries stay cached under the old generation until their space is needed
+	++defaultSystemGeneration;
+	for(auto& tag : nameTags) {
+		if(tag) buildTagGraphic(tag.get());
+	}
+}
 
-	request->SetGraphicFile(true);
-	request->Start();
+void DrawableNameTags::setTagVisible(Game_Multiplayer::PlayerHandle handle, bool visible) {
+	Tag* tag = findTag(handle);
+	assert(tag);
+	tag->visible = visible;
 }
 
 std::unique_ptr<DrawableNameTags> nameTagRenderer; //global nametag renderer
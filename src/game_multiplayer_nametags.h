@@ -5,6 +5,8 @@
 #include "drawable.h"
 #include "drawable_mgr.h"
 #include "async_handler.h"
+#include "game_multiplayer_player_table.h"
+#include "game_multiplayer_nametag_atlas.h"
 /*
 	================
 	NAMETAG RENDERER
@@ -15,44 +17,75 @@
 // so that it can control how to render when multiple nametags intersect.
 class DrawableNameTags : public Drawable {
 	struct Tag {
-		BitmapRef renderGraphic;
+		Game_Multiplayer::NameTagAtlas::Id atlasId = Game_Multiplayer::NameTagAtlas::invalid_id;
 		Game_Character* anchor;
+		Game_Multiplayer::PlayerHandle handle;
+		// system the tag is drawn with and its graphic
 		std::string system;
+		BitmapRef systemGraphic;
+		// system the tag holds a reference to, may still be loading
+		std::string requestedSystem;
 		std::string name;
 		int x = 0;
 		int y = 0;
+		bool visible = true;
 	};
 	struct TagStack {
 		std::vector<Tag*> stack;
 		float swayAnim = 0;
 	};
-	// Store nametags indexable by UID.
+	struct DrawOp {
+		Game_Multiplayer::NameTagAtlas::Id atlasId;
+		int x;
+		int y;
+		// swaying tags are rotated around the bottom center
+		float angle;
+	};
+	// Store nametags indexable by player handle.
 	// Also store list of nametags per tile, so they're drawn stacked on each other by iterating through occupied tiles.
-	std::map<std::string, std::unique_ptr<Tag>> nameTags; // tags indexed by UID.
+	std::vector<std::unique_ptr<Tag>> nameTags; // tags indexed by player slot.
 	std::unordered_map<unsigned long, TagStack> nameStacks; // list of tags per tile.
+	// all tag graphics live in the atlas, tags with the same name and system share one entry.
+	Game_Multiplayer::NameTagAtlas atlas;
+	// tags to blit this frame, kept to reuse the storage.
+	std::vector<DrawOp> drawOps;
+	// increased when the system graphic of the game changes, part of the atlas key of tags drawn with it.
+	unsigned int defaultSystemGeneration = 0;
 
 	// key is a hash based on tile coordinates, and value is a list of nametags on that tile.
 	// perfect hash for coordinate pairs
 	unsigned long coordHash(int x, int y); 
-	FileRequestBinding systemRequest;
 
 	void buildTagGraphic(Tag* tag);
+	void removeFromStack(Tag* tag);
+	void releaseTag(Tag* tag);
+	// nullptr if the player has no nametag
+	Tag* findTag(Game_Multiplayer::PlayerHandle handle);
 public:
 	DrawableNameTags();
 
 	void Draw(Bitmap& dst);
 
-	void createNameTag(std::string uid, Game_Character* anchor);
+	// tags follow their anchors and sway, so they are drawn every frame unless there are none
+	bool GetDamageState(DamageState& state) const override;
+
+	void createNameTag(Game_Multiplayer::PlayerHandle handle, Game_Character* anchor);
 
-	void deleteNameTag(std::string uid);
+	void deleteNameTag(Game_Multiplayer::PlayerHandle handle);
 
 	void clearNameTags();
 
-	void moveNameTag(std::string uid, int x, int y);
+	void moveNameTag(Game_Multiplayer::PlayerHandle handle, int x, int y);
+
+	void setTagName(Game_Multiplayer::PlayerHandle handle, const std::string& name);
+
+	void setTagSystem(Game_Multiplayer::PlayerHandle handle, const std::string& system);
 
-	void setTagName(const std::string& uid, const std::string& name);
+	// hidden tags keep their place in the tile stacks but are not drawn
+	void setTagVisible(Game_Multiplayer::PlayerHandle handle, bool visible);
 
-	void setTagSystem(const std::string& uid, const std::string& system);
+	// renders the tags without a system of their own again, they show the system graphic of the game
+	void systemGraphicChanged();
 };
 
 extern std::unique_ptr<DrawableNameTags> nameTagRenderer; //global nametag renderer
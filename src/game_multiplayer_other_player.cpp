@@ -28,60 +28,69 @@
 
 namespace Game_Multiplayer {
 
-void GetClosestPlayerCoords(int x, int y, int& outx, int& outy) {
+//rebuilds the grid when the map changed since it was set up
+static void SyncGridToMap() {
 	int w = Game_Map::GetWidth();
 	int h = Game_Map::GetHeight();
+	bool loop_h = Game_Map::LoopHorizontal();
+	bool loop_v = Game_Map::LoopVertical();
+	if(player_grid.Covers(w, h, loop_h, loop_v))
+		return;
+
+	player_grid.Reset(w, h, loop_h, loop_v);
+	for(size_t i = 0; i < other_players.size(); ++i) {
+		auto& pos = other_players.GetPosition(i);
+		player_grid.Insert(other_players.GetHandle(i).index, pos.x, pos.y);
+	}
+}
+
+void GetClosestPlayerCoords(int x, int y, int& outx, int& outy) {
+	SyncGridToMap();
 
 	int mpx = Main_Data::game_player->GetX();
 	int mpy = Main_Data::game_player->GetY();
 
-	//calculate distance from main player
-	int mlx = std::min(abs(x - mpx), abs(x - w - mpx));
-	int mly = std::min(abs(y - mpy), abs(y - h - mpy));
-
-	//min distance found
-	int mdst = mlx + mly;
-
 	outx = mpx;
 	outy = mpy;
 
-	//calculate distance to each player and find the closest one
-	for(auto& p : other_players) {
-		int px = p.second.ch->GetX();
-		int py = p.second.ch->GetY();
-
-		int lx = std::min(abs(x - px), abs(x - w - px));
-		int ly = std::min(abs(y - py), abs(y - h - py));
-
-		int distance = lx + ly;
-
-		if(distance < mdst) {
-			mdst = distance;
-			outx = px;
-			outy = py;
-		}
+	//the main player wins ties
+	int px, py, distance;
+	if(player_grid.FindNearest(x, y, px, py, distance) && distance < player_grid.Distance(x, y, mpx, mpy)) {
+		outx = px;
+		outy = py;
 	}
 }
 
+void SetPlayerPosition(size_t i, int x, int y) {
+	auto& pos = other_players.GetPosition(i);
+	if(pos.x == x && pos.y == y)
+		return;
+	other_players.SetPosition(i, x, y);
+	player_grid.Move(other_players.GetHandle(i).index, x, y);
+}
 
-void ErasePlayer(const std::string& uid) {
+void ErasePlayer(PlayerHandle handle) {
 	auto scene_map = Scene::Find(Scene::SceneType::Map);
 	auto old_list = &DrawableMgr::GetLocalList();
 
-	DrawableMgr::SetLocalList(&scene_map->GetDrawableList());
+	//headless runs (benchmarks) have no map scene and use the current list
+	if(scene_map)
+		DrawableMgr::SetLocalList(&scene_map->GetDrawableList());
 
-	nameTagRenderer->deleteNameTag(uid);
+	nameTagRenderer->deleteNameTag(handle);
 
-	other_players.erase(uid);
+	player_grid.Remove(handle.index);
+	other_players.Erase(handle);
 	
 	DrawableMgr::SetLocalList(old_list);
 };
 
-MPPlayer& CreatePlayer(std::string uid) {
+PlayerHandle CreatePlayer(const std::string& uid) {
 	//get main player
 	auto& main_player = Main_Data::game_player;
 	//
-	MPPlayer& new_player = other_players[uid];
+	PlayerHandle handle = other_players.Insert(uid);
+	MPPlayer& new_player = *other_players.Get(handle);
 	new_player.flashpause = 0;
 
 	auto& new_player_character = new_player.ch;
@@ -98,48 +107,54 @@ MPPlayer& CreatePlayer(std::string uid) {
 	new_player_character->SetThrough(true);
 	new_player_character->SetLayer(main_player->GetLayer());
 	new_player_character->SetFacing(main_player->GetFacing());
+	other_players.SetPosition(other_players.DenseIndex(handle), main_player->GetX(), main_player->GetY());
+	SyncGridToMap();
+	player_grid.Insert(handle.index, main_player->GetX(), main_player->GetY());
 
-	nameTagRenderer->createNameTag(uid, new_player_character.get());
+	nameTagRenderer->createNameTag(handle, new_player_character.get());
 	
 	auto old_list = &DrawableMgr::GetLocalList();
 	auto scene_map = Scene::Find(Scene::SceneType::Map);
-	DrawableMgr::SetLocalList(&scene_map->GetDrawableList());
+	if(scene_map)
+		DrawableMgr::SetLocalList(&scene_map->GetDrawableList());
 	new_player.sprite = std::make_unique<Sprite_Character>(new_player_character.get());
 	new_player.sprite->SetTone(Main_Data::game_screen->GetTone());
 	DrawableMgr::SetLocalList(old_list);
 
-	return new_player;
+	return handle;
 }
 
 //clears players and nametags
 void ClearPlayers() {
-	other_players.clear();
+	other_players.Clear();
+	player_grid.Clear();
 	nameTagRenderer->clearNameTags();
 }
 
-MPPlayer& GetPlayerOrCreate(std::string uid) {
-	auto player = other_players.find(uid);
-	if(player == other_players.cend()) {
+PlayerHandle GetPlayerOrCreate(const std::string& uid) {
+	PlayerHandle handle = other_players.Find(uid);
+	if(!handle.IsValid()) {
 		return CreatePlayer(uid);
 	}
 
-	return player->second;
+	return handle;
 }
 
 
 
 void FlashAll(int r, int g, int b, int p, int t) {
 	for (auto& mpplayer : other_players) {
-		mpplayer.second.ch->Flash(r, g, b, p, t);
+		mpplayer.ch->Flash(r, g, b, p, t);
 	}
 }
 
 void TintAll() {
 	for (auto& mpplayer : other_players) {
-		mpplayer.second.sprite->SetTone(Main_Data::game_screen->GetTone());
+		mpplayer.sprite->SetTone(Main_Data::game_screen->GetTone());
 	}
 }
 
-	std::map<std::string, MPPlayer> other_players = std::map<std::string, MPPlayer>();
+	PlayerTable<MPPlayer> other_players;
+	PlayerGrid player_grid;
 
 }
\ No newline at end of file
@@ -14,6 +14,9 @@
 #include "game_map.h"
 #include "player.h"
 #include "game_character.h"
+#include "game_multiplayer_movement.h"
+#include "game_multiplayer_player_grid.h"
+#include "game_multiplayer_player_table.h"
 
 
 /**
@@ -44,23 +47,32 @@ public:
 
 namespace Game_Multiplayer {
 
+	//closest of the main player and the other players, answered by player_grid
 	void GetClosestPlayerCoords(int x, int y, int& outx, int& outy);
 
 	struct MPPlayer {
-		std::queue<std::pair<int,int>> mvq; //queue of move commands
+		MovementBuffer mvq; //positions received from the server, played out with an adaptive delay
 		std::shared_ptr<Game_PlayerOther> ch; //character
 		uint16_t typingstatus;
-		//this one is used to save player speed before setting it to max speed when move queue is too long
+		//move speed sent by the player, mvq may walk faster to catch up
 		int moveSpeed;
 		std::unique_ptr<Sprite_Character> sprite;
 		int flashpause;
+		//outside of the area of interest: position is tracked, character and sprite are not updated
+		bool dormant = false;
 	};
 
-	extern std::map<std::string, MPPlayer> other_players;
+	extern PlayerTable<MPPlayer> other_players;
+	//tile positions of other_players by handle slot, for nearest player and radius queries
+	extern PlayerGrid player_grid;
 
-	void ErasePlayer(const std::string& uid);
-	MPPlayer& CreatePlayer(std::string uid);
-	MPPlayer& GetPlayerOrCreate(std::string uid);
+	//updates the tile position of a player (dense index) in the table and the grid
+	void SetPlayerPosition(size_t i, int x, int y);
+
+	void ErasePlayer(PlayerHandle handle);
+	PlayerHandle CreatePlayer(const std::string& uid);
+	//player with this uid, it is created if the uid is new
+	PlayerHandle GetPlayerOrCreate(const std::string& uid);
 	void ClearPlayers();
 
 	void FlashAll(int r, int g, int b, int p, int t);
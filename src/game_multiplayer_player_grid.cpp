@@ -0,0 +1,182 @@
+#include "game_multiplayer_player_grid.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+namespace Game_Multiplayer {
+
+void PlayerGrid::Reset(int width, int height, bool loop_horizontal, bool loop_vertical) {
+	this->width = std::max(width, 1);
+	this->height = std::max(height, 1);
+	loop_h = loop_horizontal;
+	loop_v = loop_vertical;
+	cells_x = (this->width + cell_size - 1) >> cell_shift;
+	cells_y = (this->height + cell_size - 1) >> cell_shift;
+	seam_x = loop_h ? cells_x * cell_size - this->width : 0;
+	seam_y = loop_v ? cells_y * cell_size - this->height : 0;
+
+	cells.clear();
+	cells.resize(cells_x * cells_y);
+	entries.clear();
+	count = 0;
+}
+
+bool PlayerGrid::Covers(int width, int height, bool loop_horizontal, bool loop_vertical) const {
+	return this->width == std::max(width, 1) && this->height == std::max(height, 1)
+		&& loop_h == loop_horizontal && loop_v == loop_vertical;
+}
+
+int PlayerGrid::WrapCell(int cx, int cy) const {
+	if (loop_h) {
+		cx = ((cx % cells_x) + cells_x) % cells_x;
+	} else if (cx < 0 || cx >= cells_x) {
+		return -1;
+	}
+	if (loop_v) {
+		cy = ((cy % cells_y) + cells_y) % cells_y;
+	} else if (cy < 0 || cy >= cells_y) {
+		return -1;
+	}
+	return cy * cells_x + cx;
+}
+
+int PlayerGrid::CellOf(int x, int y) const {
+	//players standing outside of the map are kept in the nearest border cell
+	int cx = std::min(std::max(x, 0), width - 1) >> cell_shift;
+	int cy = std::min(std::max(y, 0), height - 1) >> cell_shift;
+	return cy * cells_x + cx;
+}
+
+int PlayerGrid::Distance(int x0, int y0, int x1, int y1) const {
+	int dx = std::abs(x0 - x1);
+	int dy = std::abs(y0 - y1);
+	if (loop_h) {
+		dx = std::min(dx, width - dx);
+	}
+	if (loop_v) {
+		dy = std::min(dy, height - dy);
+	}
+	return dx + dy;
+}
+
+void PlayerGrid::Link(uint32_t id, Entry& e) {
+	e.cell = CellOf(e.x, e.y);
+	auto& bucket = cells[e.cell];
+	e.slot = static_cast<uint32_t>(bucket.size());
+	bucket.push_back(id);
+}
+
+void PlayerGrid::Unlink(Entry& e) {
+	auto& bucket = cells[e.cell];
+	uint32_t moved = bucket.back();
+	bucket[e.slot] = moved;
+	entries[moved].slot = e.slot;
+	bucket.pop_back();
+	e.cell = -1;
+}
+
+bool PlayerGrid::Contains(uint32_t id) const {
+	return id < entries.size() && entries[id].cell >= 0;
+}
+
+void PlayerGrid::Insert(uint32_t id, int x, int y) {
+	if (cells.empty()) {
+		Reset(width, height, loop_h, loop_v);
+	}
+	if (id >= entries.size()) {
+		entries.resize(id + 1);
+	}
+	Entry& e = entries[id];
+	if (e.cell >= 0) {
+		Move(id, x, y);
+		return;
+	}
+	e.x = x;
+	e.y = y;
+	Link(id, e);
+	++count;
+}
+
+void PlayerGrid::Move(uint32_t id, int x, int y) {
+	if (!Contains(id)) {
+		return;
+	}
+	Entry& e = entries[id];
+	e.x = x;
+	e.y = y;
+	if (CellOf(x, y) != e.cell) {
+		Unlink(e);
+		Link(id, e);
+	}
+}
+
+void PlayerGrid::Remove(uint32_t id) {
+	if (!Contains(id)) {
+		return;
+	}
+	Unlink(entries[id]);
+	--count;
+}
+
+void PlayerGrid::Clear() {
+	for (auto& bucket : cells) {
+		bucket.clear();
+	}
+	for (auto& e : entries) {
+		e.cell = -1;
+	}
+	count = 0;
+}
+
+bool PlayerGrid::FindNearest(int x, int y, int& out_x, int& out_y, int& out_distance) const {
+	if (count == 0) {
+		return false;
+	}
+
+	int best = std::numeric_limits<int>::max();
+	int cx = std::min(std::max(x, 0), width - 1) >> cell_shift;
+	int cy = std::min(std::max(y, 0), height - 1) >> cell_shift;
+	int max_ring = std::max(cells_x, cells_y);
+	int seam = std::max(seam_x, seam_y);
+
+	auto visit = [&](int cell_x, int cell_y) {
+		int cell = WrapCell(cell_x, cell_y);
+		if (cell < 0) {
+			return;
+		}
+		for (uint32_t id : cells[cell]) {
+			const Entry& e = entries[id];
+			int d = Distance(x, y, e.x, e.y);
+			if (d < best) {
+				best = d;
+				out_x = e.x;
+				out_y = e.y;
+			}
+		}
+	};
+
+	for (int r = 0; r <= max_ring; ++r) {
+		if (r == 0) {
+			visit(cx, cy);
+		} else {
+			for (int i = -r; i <= r; ++i) {
+				visit(cx + i, cy - r);
+				visit(cx + i, cy + r);
+			}
+			for (int i = -r + 1; i <= r - 1; ++i) {
+				visit(cx - r, cy + i);
+				visit(cx + r, cy + i);
+			}
+		}
+		//every cell outside of ring r is at least r * cell_size + 1 tiles away
+		//(less the partial seam cell on looping maps)
+		if (best <= r * cell_size - seam) {
+			break;
+		}
+	}
+
+	out_distance = best;
+	return true;
+}
+
+}
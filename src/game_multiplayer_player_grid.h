@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Game_Multiplayer {
+
+	/*
+		Uniform grid over the map tiles for nearest player and radius queries.
+
+		Players are bucketed into cells of cell_size x cell_size tiles and updated incrementally
+		when they change tile. Queries only visit the cells around the query point, growing
+		ring by ring until no unvisited cell can hold a closer player.
+
+		Distances are manhattan distances in tiles. On looping maps the distance wraps around
+		the map edge, like the movement of the characters does.
+
+		Ids are small integers chosen by the caller (the slot of the player handle).
+	*/
+	class PlayerGrid {
+	public:
+		static constexpr int cell_shift = 3;
+		static constexpr int cell_size = 1 << cell_shift;
+
+		//drops all players and sets the map the grid covers
+		void Reset(int width, int height, bool loop_horizontal, bool loop_vertical);
+
+		//true if the grid was set up for a map with these properties
+		bool Covers(int width, int height, bool loop_horizontal, bool loop_vertical) const;
+
+		void Insert(uint32_t id, int x, int y);
+		//moves an inserted player, cheap when the cell does not change
+		void Move(uint32_t id, int x, int y);
+		void Remove(uint32_t id);
+		void Clear();
+
+		bool Contains(uint32_t id) const;
+		size_t Size() const { return count; }
+
+		//finds the closest player to (x, y), returns false if the grid is empty
+		bool FindNearest(int x, int y, int& out_x, int& out_y, int& out_distance) const;
+
+		//calls fn(id, x, y) for every player within radius (manhattan) of (x, y)
+		template <typename F>
+		void ForEachInRadius(int x, int y, int radius, F&& fn) const;
+
+		//manhattan distance, wrapping around on looping maps
+		int Distance(int x0, int y0, int x1, int y1) const;
+
+	private:
+		struct Entry {
+			int x = 0;
+			int y = 0;
+			int cell = -1;
+			//position inside the cell bucket
+			uint32_t slot = 0;
+		};
+
+		int CellOf(int x, int y) const;
+		//cell index of cell coordinates, -1 if outside a non looping map
+		int WrapCell(int cx, int cy) const;
+		void Unlink(Entry& e);
+		void Link(uint32_t id, Entry& e);
+
+		int width = 0;
+		int height = 0;
+		bool loop_h = false;
+		bool loop_v = false;
+		int cells_x = 0;
+		int cells_y = 0;
+		//tiles missing from the last cell of a looping axis, 0 if the axis doesn't loop
+		int seam_x = 0;
+		int seam_y = 0;
+		size_t count = 0;
+
+		std::vector<std::vector<uint32_t>> cells;
+		std::vector<Entry> entries;
+	};
+
+	template <typename F>
+	void PlayerGrid::ForEachInRadius(int x, int y, int radius, F&& fn) const {
+		if (count == 0 || radius < 0) {
+			return;
+		}
+		//the partial cell at the seam of a looping map brings cells one step closer
+		int rx = (radius >> cell_shift) + 1 + (seam_x > 0);
+		int ry = (radius >> cell_shift) + 1 + (seam_y > 0);
+		int x0 = (x >> cell_shift) - rx;
+		int x1 = (x >> cell_shift) + rx;
+		int y0 = (y >> cell_shift) - ry;
+		int y1 = (y >> cell_shift) + ry;
+		//don't visit wrapped cells twice
+		if (loop_h && x1 - x0 + 1 >= cells_x) {
+			x0 = 0;
+			x1 = cells_x - 1;
+		}
+		if (loop_v && y1 - y0 + 1 >= cells_y) {
+			y0 = 0;
+			y1 = cells_y - 1;
+		}
+		for (int cy = y0; cy <= y1; ++cy) {
+			for (int cx = x0; cx <= x1; ++cx) {
+				int cell = WrapCell(cx, cy);
+				if (cell < 0) {
+					continue;
+				}
+				for (uint32_t id : cells[cell]) {
+					const Entry& e = entries[id];
+					if (Distance(x, y, e.x, e.y) <= radius) {
+						fn(id, e.x, e.y);
+					}
+				}
+			}
+		}
+	}
+}
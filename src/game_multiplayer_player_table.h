@@ -0,0 +1,159 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Game_Multiplayer {
+
+	//stable reference to a player, stays invalid after the player left even when its slot is reused
+	struct PlayerHandle {
+		static constexpr uint32_t invalid_index = 0xFFFFFFFF;
+
+		uint32_t index = invalid_index;
+		uint32_t generation = 0;
+
+		bool IsValid() const { return index != invalid_index; }
+
+		bool operator==(const PlayerHandle& o) const { return index == o.index && generation == o.generation; }
+		bool operator!=(const PlayerHandle& o) const { return !(*this == o); }
+	};
+
+	/*
+		Slot map of the players in the room.
+
+		Players are stored densely (structure of arrays) so iterating them per frame walks
+		contiguous memory: values, uids, handles and last known tile positions share the dense
+		index. Removing a player moves the last one into its place, so dense indices are not stable,
+		use PlayerHandle to refer to a player across frames.
+
+		The uid string is looked up once per packet at most, binary packets cache the handle
+		of their interned uid (see game_multiplayer_receive_handler.cpp).
+	*/
+	template <typename T>
+	class PlayerTable {
+	public:
+		struct Position {
+			int x = 0;
+			int y = 0;
+		};
+
+		size_t size() const { return values.size(); }
+		bool empty() const { return values.empty(); }
+
+		//dense access, index < size()
+		T& operator[](size_t i) { return values[i]; }
+		const T& operator[](size_t i) const { return values[i]; }
+		const std::string& GetUid(size_t i) const { return uids[i]; }
+		PlayerHandle GetHandle(size_t i) const { return handles[i]; }
+		const Position& GetPosition(size_t i) const { return positions[i]; }
+		void SetPosition(size_t i, int x, int y) { positions[i] = { x, y }; }
+
+		typename std::vector<T>::iterator begin() { return values.begin(); }
+		typename std::vector<T>::iterator end() { return values.end(); }
+		typename std::vector<T>::const_iterator begin() const { return values.begin(); }
+		typename std::vector<T>::const_iterator end() const { return values.end(); }
+		const std::vector<Position>& Positions() const { return positions; }
+
+		//invalid handle if there is no player with this uid
+		PlayerHandle Find(const std::string& uid) const {
+			auto it = by_uid.find(uid);
+			return it != by_uid.end() ? it->second : PlayerHandle();
+		}
+
+		//nullptr if the player left
+		T* Get(PlayerHandle handle) {
+			size_t i = DenseIndex(handle);
+			return i != npos ? &values[i] : nullptr;
+		}
+
+		//dense index of the player, npos if the player left
+		size_t DenseIndex(PlayerHandle handle) const {
+			if (handle.index >= slots.size() || slots[handle.index].generation != handle.generation) {
+				return npos;
+			}
+			return slots[handle.index].dense;
+		}
+
+		//adds a default constructed player, uid must not be in the table
+		PlayerHandle Insert(const std::string& uid) {
+			assert(!Find(uid).IsValid());
+
+			uint32_t slot;
+			if (!free_slots.empty()) {
+				slot = free_slots.back();
+				free_slots.pop_back();
+			} else {
+				slot = static_cast<uint32_t>(slots.size());
+				slots.emplace_back();
+			}
+
+			slots[slot].dense = static_cast<uint32_t>(values.size());
+			PlayerHandle handle { slot, slots[slot].generation };
+
+			values.emplace_back();
+			uids.push_back(uid);
+			handles.push_back(handle);
+			positions.emplace_back();
+			by_uid.emplace(uid, handle);
+			return handle;
+		}
+
+		//removes the player, returns false if it already left
+		bool Erase(PlayerHandle handle) {
+			size_t i = DenseIndex(handle);
+			if (i == npos) {
+				return false;
+			}
+
+			by_uid.erase(uids[i]);
+
+			size_t last = values.size() - 1;
+			if (i != last) {
+				values[i] = std::move(values[last]);
+				uids[i] = std::move(uids[last]);
+				handles[i] = handles[last];
+				positions[i] = positions[last];
+				slots[handles[i].index].dense = static_cast<uint32_t>(i);
+			}
+			values.pop_back();
+			uids.pop_back();
+			handles.pop_back();
+			positions.pop_back();
+
+			++slots[handle.index].generation;
+			free_slots.push_back(handle.index);
+			return true;
+		}
+
+		void Clear() {
+			for (auto& h : handles) {
+				++slots[h.index].generation;
+				free_slots.push_back(h.index);
+			}
+			values.clear();
+			uids.clear();
+			handles.clear();
+			positions.clear();
+			by_uid.clear();
+		}
+
+		static constexpr size_t npos = static_cast<size_t>(-1);
+
+	private:
+		struct Slot {
+			uint32_t dense = 0;
+			uint32_t generation = 0;
+		};
+
+		std::vector<T> values;
+		std::vector<std::string> uids;
+		std::vector<PlayerHandle> handles;
+		std::vector<Position> positions;
+
+		std::vector<Slot> slots;
+		std::vector<uint32_t> free_slots;
+		std::unordered_map<std::string, PlayerHandle> by_uid;
+	};
+}
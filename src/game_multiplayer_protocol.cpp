@@ -0,0 +1,347 @@
+#include "game_multiplayer_protocol.h"
+
+namespace Game_Multiplayer {
+namespace Protocol {
+
+bool Reader::ReadByte(uint8_t& out) {
+	if (cur >= end) {
+		return Fail();
+	}
+	out = *cur++;
+	return true;
+}
+
+bool Reader::ReadVarint(uint32_t& out) {
+	uint32_t value = 0;
+	//5 bytes are enough for 32 bits
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (cur >= end) {
+			return Fail();
+		}
+		uint8_t b = *cur++;
+		value |= static_cast<uint32_t>(b & 0x7F) << shift;
+		if ((b & 0x80) == 0) {
+			out = value;
+			return true;
+		}
+	}
+	return Fail();
+}
+
+bool Reader::ReadVarint(int& out) {
+	uint32_t v;
+	if (!ReadVarint(v)) {
+		return false;
+	}
+	out = static_cast<int>(v);
+	return true;
+}
+
+bool Reader::ReadSigned(int& out) {
+	uint32_t v;
+	if (!ReadVarint(v)) {
+		return false;
+	}
+	//zigzag
+	out = static_cast<int>((v >> 1) ^ (~(v & 1) + 1));
+	return true;
+}
+
+bool Reader::ReadString(StringView& out) {
+	uint32_t len;
+	if (!ReadVarint(len)) {
+		return false;
+	}
+	if (static_cast<size_t>(end - cur) < len) {
+		return Fail();
+	}
+	out = StringView(reinterpret_cast<const char*>(cur), len);
+	cur += len;
+	return true;
+}
+
+bool Reader::ReadBlock(size_t len, Reader& out) {
+	if (static_cast<size_t>(end - cur) < len) {
+		return Fail();
+	}
+	out = Reader(cur, len);
+	cur += len;
+	return true;
+}
+
+void Writer::WriteVarint(uint32_t v) {
+	while (v >= 0x80) {
+		buf.push_back(static_cast<uint8_t>(v | 0x80));
+		v >>= 7;
+	}
+	buf.push_back(static_cast<uint8_t>(v));
+}
+
+void Writer::WriteSigned(int v) {
+	uint32_t u = static_cast<uint32_t>(v);
+	WriteVarint((u << 1) ^ (v < 0 ? 0xFFFFFFFFu : 0u));
+}
+
+void Writer::WriteString(StringView s) {
+	WriteVarint(static_cast<uint32_t>(s.size()));
+	buf.insert(buf.end(), s.begin(), s.end());
+}
+
+size_t Writer::BeginField(uint8_t tag) {
+	buf.push_back(tag);
+	return buf.size();
+}
+
+void Writer::EndField(size_t mark) {
+	//payload was written at mark, insert its length in front of it
+	uint32_t len = static_cast<uint32_t>(buf.size() - mark);
+	uint8_t tmp[5];
+	int n = 0;
+	do {
+		uint8_t b = len & 0x7F;
+		len >>= 7;
+		tmp[n++] = len ? (b | 0x80) : b;
+	} while (len);
+	buf.insert(buf.begin() + mark, tmp, tmp + n);
+}
+
+static bool DecodeField(uint8_t tag, Reader& r, ObjectSync& out) {
+	switch (tag) {
+		case Fields::pos: {
+			int x, y;
+			r.ReadVarint(x);
+			r.ReadVarint(y);
+			out.path_length = 0;
+			out.AddPosition(x, y);
+			break;
+		}
+		case Fields::path: {
+			uint32_t count;
+			if (!r.ReadVarint(count)) {
+				break;
+			}
+			out.path_length = 0;
+			//coordinates are delta encoded against the previous entry
+			int x = 0, y = 0;
+			for (uint32_t i = 0; i < count && r.Ok(); ++i) {
+				int dx, dy;
+				r.ReadSigned(dx);
+				r.ReadSigned(dy);
+				x += dx;
+				y += dy;
+				out.AddPosition(x, y);
+			}
+			break;
+		}
+		case Fields::sprite:
+			r.ReadVarint(out.sprite_id);
+			r.ReadString(out.sprite_sheet);
+			break;
+		case Fields::sound:
+			r.ReadVarint(out.sound_volume);
+			r.ReadVarint(out.sound_tempo);
+			r.ReadSigned(out.sound_balance);
+			r.ReadString(out.sound_name);
+			break;
+		case Fields::name:
+			r.ReadString(out.name);
+			break;
+		case Fields::weather:
+			r.ReadVarint(out.weather_type);
+			r.ReadVarint(out.weather_strength);
+			break;
+		case Fields::movementAnimationSpeed:
+			r.ReadVarint(out.move_speed);
+			break;
+		case Fields::variable:
+			r.ReadVarint(out.variable_id);
+			r.ReadSigned(out.variable_value);
+			break;
+		case Fields::switchsync:
+			r.ReadVarint(out.switch_id);
+			r.ReadSigned(out.switch_value);
+			break;
+		case Fields::animtype:
+			r.ReadVarint(out.anim_type);
+			break;
+		case Fields::animframe:
+			r.ReadVarint(out.anim_frame);
+			break;
+		case Fields::facing:
+			r.ReadVarint(out.facing);
+			break;
+		case Fields::typingstatus:
+			r.ReadVarint(out.typing_status);
+			break;
+		case Fields::flash:
+			for (auto& v : out.flash) {
+				r.ReadVarint(v);
+			}
+			break;
+		case Fields::flashpause:
+			r.ReadVarint(out.flash_pause);
+			break;
+		case Fields::npcmove:
+			r.ReadVarint(out.npc_id);
+			r.ReadVarint(out.npc_x);
+			r.ReadVarint(out.npc_y);
+			r.ReadVarint(out.npc_facing);
+			break;
+		case Fields::system:
+			r.ReadString(out.system);
+			break;
+		default:
+			//unknown field from a newer schema, its payload was already split off
+			return true;
+	}
+
+	if (r.Ok()) {
+		out.Set(tag);
+	}
+	return r.Ok();
+}
+
+bool DecodeObjectSync(Reader& reader, uint32_t& uid_index, ObjectSync& out) {
+	out.Clear();
+
+	if (!reader.ReadVarint(uid_index)) {
+		return false;
+	}
+
+	while (!reader.AtEnd()) {
+		uint8_t tag;
+		uint32_t len;
+		Reader field(nullptr, 0);
+		if (!reader.ReadByte(tag) || !reader.ReadVarint(len) || !reader.ReadBlock(len, field)) {
+			return false;
+		}
+		//tags outside of the bitmask range can only come from a newer schema, skip them
+		if (tag < 32 && !DecodeField(tag, field, out)) {
+			return false;
+		}
+	}
+
+	return reader.Ok();
+}
+
+void EncodeObjectSync(std::vector<uint8_t>& out, uint32_t uid_index, const ObjectSync& sync) {
+	Writer w(out);
+	w.WriteByte(MessageTypes::objectSync);
+	w.WriteVarint(uid_index);
+
+	size_t mark;
+	if (sync.Has(Fields::pos) && sync.path_length > 0) {
+		mark = w.BeginField(Fields::pos);
+		w.WriteVarint(sync.path[0].x);
+		w.WriteVarint(sync.path[0].y);
+		w.EndField(mark);
+	} else if (sync.Has(Fields::path)) {
+		mark = w.BeginField(Fields::path);
+		w.WriteVarint(sync.path_length);
+		int x = 0, y = 0;
+		for (int i = 0; i < sync.path_length; ++i) {
+			w.WriteSigned(sync.path[i].x - x);
+			w.WriteSigned(sync.path[i].y - y);
+			x = sync.path[i].x;
+			y = sync.path[i].y;
+		}
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::sprite)) {
+		mark = w.BeginField(Fields::sprite);
+		w.WriteVarint(sync.sprite_id);
+		w.WriteString(sync.sprite_sheet);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::sound)) {
+		mark = w.BeginField(Fields::sound);
+		w.WriteVarint(sync.sound_volume);
+		w.WriteVarint(sync.sound_tempo);
+		w.WriteSigned(sync.sound_balance);
+		w.WriteString(sync.sound_name);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::name)) {
+		mark = w.BeginField(Fields::name);
+		w.WriteString(sync.name);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::weather)) {
+		mark = w.BeginField(Fields::weather);
+		w.WriteVarint(sync.weather_type);
+		w.WriteVarint(sync.weather_strength);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::movementAnimationSpeed)) {
+		mark = w.BeginField(Fields::movementAnimationSpeed);
+		w.WriteVarint(sync.move_speed);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::variable)) {
+		mark = w.BeginField(Fields::variable);
+		w.WriteVarint(sync.variable_id);
+		w.WriteSigned(sync.variable_value);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::switchsync)) {
+		mark = w.BeginField(Fields::switchsync);
+		w.WriteVarint(sync.switch_id);
+		w.WriteSigned(sync.switch_value);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::animtype)) {
+		mark = w.BeginField(Fields::animtype);
+		w.WriteVarint(sync.anim_type);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::animframe)) {
+		mark = w.BeginField(Fields::animframe);
+		w.WriteVarint(sync.anim_frame);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::facing)) {
+		mark = w.BeginField(Fields::facing);
+		w.WriteVarint(sync.facing);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::typingstatus)) {
+		mark = w.BeginField(Fields::typingstatus);
+		w.WriteVarint(sync.typing_status);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::flash)) {
+		mark = w.BeginField(Fields::flash);
+		for (auto v : sync.flash) {
+			w.WriteVarint(v);
+		}
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::flashpause)) {
+		mark = w.BeginField(Fields::flashpause);
+		w.WriteVarint(sync.flash_pause);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::npcmove)) {
+		mark = w.BeginField(Fields::npcmove);
+		w.WriteVarint(sync.npc_id);
+		w.WriteVarint(sync.npc_x);
+		w.WriteVarint(sync.npc_y);
+		w.WriteVarint(sync.npc_facing);
+		w.EndField(mark);
+	}
+	if (sync.Has(Fields::system)) {
+		mark = w.BeginField(Fields::system);
+		w.WriteString(sync.system);
+		w.EndField(mark);
+	}
+}
+
+void EncodeUidIntern(std::vector<uint8_t>& out, uint32_t uid_index, StringView uid) {
+	Writer w(out);
+	w.WriteByte(MessageTypes::uidIntern);
+	w.WriteVarint(uid_index);
+	w.WriteString(uid);
+}
+
+}
+}
@@ -0,0 +1,203 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "string_view.h"
+
+/*
+	Binary receive protocol.
+
+	The server may send objectSync packets as compact binary frames instead of json.
+	Support is negotiated at connect time: client sends a hello packet (PacketTypes::protocol)
+	with its protocol version and feature bits, a server that understands it answers with a
+	binary hello frame holding the features it accepted. Servers that don't know about the
+	hello packet ignore it and keep talking json, which stays as the fallback.
+
+	Every binary frame starts with a message type byte, integers are LEB128 varints
+	(zigzag for signed values), strings are a varint length followed by raw bytes.
+
+	hello:      [hello] [version] [features]
+	uidIntern:  [uidIntern] [uid index] [uid string]
+	disconnect: [disconnect] [uid index]
+	rngSeed:    [rngSeed] [seed]
+	objectSync: [objectSync] [uid index] {[field tag] [payload length] [payload]}...
+
+	uid strings are only sent once per connection through uidIntern, objectSync refers to
+	players by index. Index 0 is reserved for "room" (npc sync). Fields with an unknown tag
+	are skipped using their payload length so newer servers can add fields freely.
+*/
+
+namespace Game_Multiplayer {
+namespace Protocol {
+	const uint16_t version = 1;
+
+	namespace Features {
+		const uint16_t binary_sync = 1 << 0;
+		//server accepts PacketTypes::batch frames, see game_multiplayer_send_queue.h
+		const uint16_t batch = 1 << 1;
+
+		//features this client understands, sent in hello
+		const uint16_t supported = binary_sync | batch;
+	}
+
+	namespace MessageTypes {
+		const uint8_t hello = 1;
+		const uint8_t uidIntern = 2;
+		const uint8_t disconnect = 3;
+		const uint8_t rngSeed = 4;
+		const uint8_t objectSync = 5;
+	}
+
+	//field tags of objectSync, must stay below 32 (they are stored in a bitmask)
+	namespace Fields {
+		const uint8_t pos = 1;
+		const uint8_t path = 2;
+		const uint8_t sprite = 3;
+		const uint8_t sound = 4;
+		const uint8_t name = 5;
+		const uint8_t weather = 6;
+		const uint8_t movementAnimationSpeed = 7;
+		const uint8_t variable = 8;
+		const uint8_t switchsync = 9;
+		const uint8_t animtype = 10;
+		const uint8_t animframe = 11;
+		const uint8_t facing = 12;
+		const uint8_t typingstatus = 13;
+		const uint8_t flash = 14;
+		const uint8_t flashpause = 15;
+		const uint8_t npcmove = 16;
+		const uint8_t system = 17;
+	}
+
+	const uint32_t room_uid_index = 0;
+	//uid indices are handed out per connected player, anything above is a broken or hostile frame
+	const uint32_t max_uid_index = 4096;
+
+	//decoded objectSync packet
+	//strings are views into the received frame (or json document) and are only valid while it is alive
+	struct ObjectSync {
+		static constexpr int max_path = 64;
+
+		struct Position {
+			int x;
+			int y;
+		};
+
+		uint32_t fields = 0;
+
+		//"pos" is stored as a path of length 1
+		Position path[max_path];
+		int path_length = 0;
+
+		StringView sprite_sheet;
+		int sprite_id = 0;
+
+		StringView sound_name;
+		int sound_volume = 0;
+		int sound_tempo = 0;
+		int sound_balance = 0;
+
+		StringView name;
+
+		int weather_type = 0;
+		int weather_strength = 0;
+
+		int move_speed = 0;
+
+		int variable_id = 0;
+		int variable_value = 0;
+
+		int switch_id = 0;
+		int switch_value = 0;
+
+		int anim_type = 0;
+		int anim_frame = 0;
+		int facing = 0;
+		int typing_status = 0;
+
+		int flash[5] = {};
+		int flash_pause = 0;
+
+		int npc_id = 0;
+		int npc_x = 0;
+		int npc_y = 0;
+		int npc_facing = 0;
+
+		StringView system;
+
+		bool Has(uint8_t field) const {
+			return (fields & (1u << field)) != 0;
+		}
+
+		void Set(uint8_t field) {
+			fields |= (1u << field);
+		}
+
+		void Clear() {
+			fields = 0;
+			path_length = 0;
+		}
+
+		void AddPosition(int x, int y) {
+			if (path_length < max_path) {
+				path[path_length++] = { x, y };
+			}
+		}
+	};
+
+	//reads values from a binary frame in place, never allocates
+	//once a read fails all following reads fail too, check Ok() after decoding
+	class Reader {
+	public:
+		Reader(const uint8_t* data, size_t size) : cur(data), end(data + size) {}
+
+		bool ReadByte(uint8_t& out);
+		bool ReadVarint(uint32_t& out);
+		bool ReadVarint(int& out);
+		bool ReadSigned(int& out);
+		bool ReadString(StringView& out);
+
+		//splits off the next len bytes into a sub reader
+		bool ReadBlock(size_t len, Reader& out);
+
+		bool AtEnd() const { return cur >= end; }
+		bool Ok() const { return ok; }
+
+	private:
+		bool Fail() { ok = false; cur = end; return false; }
+
+		const uint8_t* cur;
+		const uint8_t* end;
+		bool ok = true;
+	};
+
+	//encodes binary frames, used for hello replies in tests and by the benchmark load generator
+	class Writer {
+	public:
+		explicit Writer(std::vector<uint8_t>& out) : buf(out) {}
+
+		void WriteByte(uint8_t v) { buf.push_back(v); }
+		void WriteVarint(uint32_t v);
+		void WriteSigned(int v);
+		void WriteString(StringView s);
+
+		//writes a field with a length prefixed payload, the payload is produced by the caller
+		//between BeginField and EndField
+		size_t BeginField(uint8_t tag);
+		void EndField(size_t mark);
+
+	private:
+		std::vector<uint8_t>& buf;
+	};
+
+	//decodes the body of an objectSync frame (everything after the message type byte)
+	//returns false on malformed frames, out is partially filled in that case
+	bool DecodeObjectSync(Reader& reader, uint32_t& uid_index, ObjectSync& out);
+
+	//encodes a full objectSync frame including the message type byte
+	void EncodeObjectSync(std::vector<uint8_t>& out, uint32_t uid_index, const ObjectSync& sync);
+
+	void EncodeUidIntern(std::vector<uint8_t>& out, uint32_t uid_index, StringView uid);
+}
+}
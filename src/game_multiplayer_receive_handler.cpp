@@ -1,6 +1,8 @@
 
+#ifdef EMSCRIPTEN
 #include <emscripten/emscripten.h>
 #include <emscripten/websocket.h>
+#endif
 
 #include "game_multiplayer_receive_handler.h"
 #include "game_multiplayer_other_player.h"
@@ -11,6 +13,7 @@
 #include <memory>
 #include <queue>
 #include <set>
+#include <vector>
 
 #include "game_player.h"
 #include "drawable_mgr.h"
@@ -24,9 +27,41 @@
 #include "main_data.h"
 #include "game_system.h"
 #include "game_multiplayer_rng.h"
+#include "game_multiplayer_connection.h"
 
 namespace Game_Multiplayer {
 
+//uid strings sent through uidIntern, indexed by the uid index used in binary objectSync packets
+static std::vector<std::string> interned_uids = { "room" };
+//player of each interned uid, resolved on the first objectSync so later packets skip the uid lookup
+static std::vector<PlayerHandle> interned_handles = { PlayerHandle() };
+
+//uid of the json packet being handled, reused to avoid an allocation per packet
+static std::string json_uid;
+
+//reused for every binary objectSync, keeps the hot path free of allocations
+static Protocol::ObjectSync sync_packet;
+
+void ResetUidTable() {
+	interned_uids.resize(1);
+	interned_handles.resize(1);
+}
+
+//the table is grown up to the highest interned index, the slots below it stay empty until interned
+static bool IsInternedUid(uint32_t uid_index) {
+	return uid_index < interned_uids.size() && !interned_uids[uid_index].empty();
+}
+
+static PlayerHandle ResolveInternedUid(uint32_t uid_index) {
+	if(uid_index == Protocol::room_uid_index)
+		return PlayerHandle();
+
+	PlayerHandle& handle = interned_handles[uid_index];
+	if(!other_players.Get(handle))
+		handle = GetPlayerOrCreate(interned_uids[uid_index]);
+	return handle;
+}
+
 void HandleReceivedPacket(const char* data) {
 	char* data_copy = strdup(data);
 	const nx_json* json = nx_json_parse(data_copy, NULL);
@@ -47,184 +82,310 @@ void HandleReceivedPacket(const char* data) {
 
 		nx_json_free(json);
 	}
-	delete[] data_copy;
+	free(data_copy);
 }
 
-void HandleDisconnect(const nx_json* json) {
-	const nx_json* uid_json;
+void HandleReceivedBinaryPacket(const uint8_t* data, size_t size) {
+	Protocol::Reader reader(data, size);
+	uint8_t type;
+	if(!reader.ReadByte(type))
+		return;
+
+	if(type == Protocol::MessageTypes::hello) {
+		int version = 0;
+		int features = 0;
+		reader.ReadVarint(version);
+		reader.ReadVarint(features);
+		if(reader.Ok()) {
+			ConnectionData::protocolVersion = version;
+			ConnectionData::protocolFeatures = features & Protocol::Features::supported;
+		}
+		return;
+	}
 
+	//server is not supposed to send binary frames without negotiating them first
+	if(!(ConnectionData::protocolFeatures & Protocol::Features::binary_sync))
+		return;
+
+	uint32_t uid_index;
+	if(type == Protocol::MessageTypes::objectSync) {
+		if(Protocol::DecodeObjectSync(reader, uid_index, sync_packet)
+				&& (uid_index == Protocol::room_uid_index || IsInternedUid(uid_index))) {
+			ApplyObjectSync(ResolveInternedUid(uid_index), sync_packet);
+		}
+	} else if(type == Protocol::MessageTypes::uidIntern) {
+		StringView uid;
+		if(reader.ReadVarint(uid_index) && reader.ReadString(uid) && !uid.empty()
+				&& uid_index != Protocol::room_uid_index && uid_index <= Protocol::max_uid_index) {
+			if(uid_index >= interned_uids.size()) {
+				interned_uids.resize(uid_index + 1);
+				interned_handles.resize(uid_index + 1);
+			}
+			interned_uids[uid_index] = ToString(uid);
+			interned_handles[uid_index] = PlayerHandle();
+		}
+	} else if(type == Protocol::MessageTypes::disconnect) {
+		if(reader.ReadVarint(uid_index) && IsInternedUid(uid_index)) {
+			PlayerHandle handle = other_players.Find(interned_uids[uid_index]);
+			if(handle.IsValid())
+				ErasePlayer(handle);
+		}
+	} else if(type == Protocol::MessageTypes::rngSeed) {
+		uint32_t seed;
+		if(reader.ReadVarint(seed))
+			room_seed = seed;
+	}
+}
+
+void HandleDisconnect(const nx_json* json) {
 	const nx_json* uid = nx_json_get(json, "uuid");
 	if(uid->type == nx_json_type::NX_JSON_STRING) {
-		ErasePlayer(uid->text_value);
+		json_uid = uid->text_value;
+		PlayerHandle handle = other_players.Find(json_uid);
+		if(handle.IsValid())
+			ErasePlayer(handle);
 	}
 }
 
+static StringView JsonText(const nx_json* node) {
+	return StringView(node->text_value);
+}
+
 void ResolveObjectSyncPacket(const nx_json* json) {
-	if(json->type == nx_json_type::NX_JSON_OBJECT) {
-		const nx_json* pos = nx_json_get(json, "pos");
-		const nx_json* path = nx_json_get(json, "path");;
-		const nx_json* sprite = nx_json_get(json, "sprite");
-		const nx_json* sound = nx_json_get(json, "sound");
-		const nx_json* uid = nx_json_get(json, "uid");
-		const nx_json* name = nx_json_get(json, "name");
-		const nx_json* weather = nx_json_get(json, "weather");
-		const nx_json* mAnimSpd = nx_json_get(json, "movementAnimationSpeed");
-		const nx_json* variable = nx_json_get(json, "varialbe");
-		const nx_json* switchsync = nx_json_get(json, "switchsync");
-		const nx_json* animtype = nx_json_get(json, "animtype");
-		const nx_json* animframe = nx_json_get(json, "animframe");
-		const nx_json* facing = nx_json_get(json, "facing");
-		const nx_json* typingstatus = nx_json_get(json, "typingstatus");
-		const nx_json* flash = nx_json_get(json, "flash");
-		const nx_json* flashpause = nx_json_get(json, "flashpause");
-		const nx_json* npcmove = nx_json_get(json, "npcmove");
-		const nx_json* system = nx_json_get(json, "system");
-
-		if(uid->type == nx_json_type::NX_JSON_STRING) {
-	
-			std::string uid_string = std::string(uid->text_value);
-
-			if(strcmp(uid->text_value, "room")) {
-				MPPlayer& mpplayer = GetPlayerOrCreate(uid_string);
-
-				if(pos->type == nx_json_type::NX_JSON_OBJECT) {
-					mpplayer.mvq.push(std::make_pair(nx_json_get(pos, "x")->num.u_value, nx_json_get(pos, "y")->num.u_value));
-				}
-				else if(path->type == nx_json_type::NX_JSON_ARRAY) {
-					for(int i = 0; i < path->children.length; i++) {
-						pos = nx_json_item(path, i);
-						if(pos->type == nx_json_type::NX_JSON_OBJECT) {
-							mpplayer.mvq.push(std::make_pair(nx_json_get(pos, "x")->num.u_value, nx_json_get(pos, "y")->num.u_value));
+	if(json->type != nx_json_type::NX_JSON_OBJECT)
+		return;
+
+	const nx_json* uid = nx_json_get(json, "uid");
+	if(uid->type != nx_json_type::NX_JSON_STRING)
+		return;
+
+	//translate json into the same representation the binary protocol decodes into
+	using namespace Protocol;
+	ObjectSync& sync = sync_packet;
+	sync.Clear();
+
+	//fields are visited in a single pass instead of looking every key up by name
+	for(const nx_json* node = json->children.first; node; node = node->next) {
+		const char* key = node->key;
+		switch(node->type) {
+		case nx_json_type::NX_JSON_OBJECT:
+			if(strcmp(key, "pos") == 0) {
+				//"pos" takes precedence over "path"
+				sync.path_length = 0;
+				sync.AddPosition(nx_json_get(node, "x")->num.u_value, nx_json_get(node, "y")->num.u_value);
+				sync.fields &= ~(1u << Fields::path);
+				sync.Set(Fields::pos);
+			} else if(strcmp(key, "sprite") == 0) {
+				sync.sprite_sheet = JsonText(nx_json_get(node, "sheet"));
+				sync.sprite_id = nx_json_get(node, "id")->num.u_value;
+				sync.Set(Fields::sprite);
+			} else if(strcmp(key, "sound") == 0) {
+				sync.sound_volume = nx_json_get(node, "volume")->num.u_value;
+				sync.sound_tempo = nx_json_get(node, "tempo")->num.u_value;
+				sync.sound_balance = nx_json_get(node, "balance")->num.u_value;
+				sync.sound_name = JsonText(nx_json_get(node, "name"));
+				sync.Set(Fields::sound);
+			} else if(strcmp(key, "weather") == 0) {
+				sync.weather_type = nx_json_get(node, "type")->num.u_value;
+				sync.weather_strength = nx_json_get(node, "strength")->num.u_value;
+				sync.Set(Fields::weather);
+			} else if(strcmp(key, "varialbe") == 0) {
+				sync.variable_id = nx_json_get(node, "id")->num.u_value;
+				sync.variable_value = nx_json_get(node, "value")->num.s_value;
+				sync.Set(Fields::variable);
+			} else if(strcmp(key, "switchsync") == 0) {
+				sync.switch_id = nx_json_get(node, "id")->num.u_value;
+				sync.switch_value = nx_json_get(node, "value")->num.s_value;
+				sync.Set(Fields::switchsync);
+			} else if(strcmp(key, "npcmove") == 0) {
+				sync.npc_id = nx_json_get(node, "id")->num.u_value;
+				sync.npc_x = nx_json_get(node, "x")->num.u_value;
+				sync.npc_y = nx_json_get(node, "y")->num.u_value;
+				sync.npc_facing = nx_json_get(node, "facing")->num.u_value;
+				sync.Set(Fields::npcmove);
+			}
+			break;
+		case nx_json_type::NX_JSON_ARRAY:
+			if(strcmp(key, "path") == 0) {
+				if(!sync.Has(Fields::pos)) {
+					sync.path_length = 0;
+					for(const nx_json* item = node->children.first; item; item = item->next) {
+						if(item->type == nx_json_type::NX_JSON_OBJECT) {
+							sync.AddPosition(nx_json_get(item, "x")->num.u_value, nx_json_get(item, "y")->num.u_value);
 						}
 					}
+					sync.Set(Fields::path);
 				}
-
-				if(sprite->type == nx_json_type::NX_JSON_OBJECT) {
-					const nx_json* sheet = nx_json_get(sprite, "sheet");
-					const nx_json* id = nx_json_get(sprite, "id");
-					mpplayer.ch->SetSpriteGraphic(std::string(sheet->text_value), id->num.u_value);
-					mpplayer.ch->ResetAnimation();
+			} else if(strcmp(key, "flash") == 0) {
+				for(int i = 0; i < 5; i++) {
+					sync.flash[i] = nx_json_item(node, i)->num.u_value;
 				}
+				sync.Set(Fields::flash);
+			}
+			break;
+		case nx_json_type::NX_JSON_STRING:
+			if(strcmp(key, "name") == 0) {
+				sync.name = JsonText(node);
+				sync.Set(Fields::name);
+			} else if(strcmp(key, "system") == 0) {
+				sync.system = JsonText(node);
+				sync.Set(Fields::system);
+			}
+			break;
+		case nx_json_type::NX_JSON_INTEGER:
+			if(strcmp(key, "movementAnimationSpeed") == 0) {
+				sync.move_speed = node->num.u_value;
+				sync.Set(Fields::movementAnimationSpeed);
+			} else if(strcmp(key, "animtype") == 0) {
+				sync.anim_type = node->num.u_value;
+				sync.Set(Fields::animtype);
+			} else if(strcmp(key, "animframe") == 0) {
+				sync.anim_frame = node->num.u_value;
+				sync.Set(Fields::animframe);
+			} else if(strcmp(key, "facing") == 0) {
+				sync.facing = node->num.u_value;
+				sync.Set(Fields::facing);
+			} else if(strcmp(key, "typingstatus") == 0) {
+				sync.typing_status = node->num.u_value;
+				sync.Set(Fields::typingstatus);
+			} else if(strcmp(key, "flashpause") == 0) {
+				sync.flash_pause = node->num.u_value;
+				sync.Set(Fields::flashpause);
+			}
+			break;
+		default:
+			break;
+		}
+	}
 
-				if(sound->type == nx_json_type::NX_JSON_OBJECT && MyData::sfxsync) {
-					const nx_json* volume = nx_json_get(sound, "volume");
-					const nx_json* tempo = nx_json_get(sound, "tempo");
-					const nx_json* balance = nx_json_get(sound, "balance");
-					const nx_json* name = nx_json_get(sound, "name");
-
-					lcf::rpg::Sound soundStruct;
-					auto& p = mpplayer;
-					int w = Game_Map::GetWidth();
-					int h = Game_Map::GetHeight();
-					int dx = std::min(std::abs(p.ch->GetX() - Main_Data::game_player->GetX()), std::abs(p.ch->GetX() - w - Main_Data::game_player->GetX()));
-					int dy = std::min(std::abs(p.ch->GetY() - Main_Data::game_player->GetY()), std::abs(p.ch->GetY() - h - Main_Data::game_player->GetY()));
-					int distance = std::sqrt(dx * dx + dy * dy);
-					float falloffFactor = 100.0f / ((float)MyData::sfxfalloff);
-					soundStruct.volume = std::max(0, 
-					(int)
-					((100.0f - ((float)distance) * falloffFactor) * (float(MyData::playersVolume) / 100.0f) * (float(volume->num.u_value) / 100.0f))
-					);
-					soundStruct.tempo = tempo->num.u_value;
-					soundStruct.balance = balance->num.u_value;
-					soundStruct.name = std::string(name->text_value);
-
-					Main_Data::game_system->SePlay(soundStruct);
-				}
+	json_uid = uid->text_value;
+	ApplyObjectSync(json_uid == "room" ? PlayerHandle() : GetPlayerOrCreate(json_uid), sync);
+}
 
-				if(name->type == nx_json_type::NX_JSON_STRING) {
-					nameTagRenderer->setTagName(uid_string, name->text_value);
-				}
+void ApplyObjectSync(PlayerHandle player, const Protocol::ObjectSync& sync) {
+	using Protocol::Fields;
 
-				if(weather->type == nx_json_type::NX_JSON_OBJECT) {
-					const nx_json* type = nx_json_get(weather, "type");
-					const nx_json* strength = nx_json_get(weather, "strength");
-					Main_Data::game_screen.get()->SetWeatherEffect(type->num.u_value, strength->num.u_value);
-				}
+	if(player.IsValid()) {
+		MPPlayer& mpplayer = *other_players.Get(player);
 
-				if(mAnimSpd->type == nx_json_type::NX_JSON_INTEGER) {
-					mpplayer.moveSpeed = mAnimSpd->num.u_value;
-				}
+		if(sync.Has(Fields::pos) || sync.Has(Fields::path)) {
+			auto arrival = Game_Clock::GetFrameTime();
+			for(int i = 0; i < sync.path_length; i++) {
+				mpplayer.mvq.Push(sync.path[i].x, sync.path[i].y, arrival);
+			}
+		}
 
-				if(variable->type == nx_json_type::NX_JSON_OBJECT && false) {
-					const nx_json* id = nx_json_get(variable, "id");
-					const nx_json* value = nx_json_get(variable, "value");
-					Main_Data::game_variables->Set(id->num.u_value, value->num.s_value);
-					Game_Map::SetNeedRefresh(true);
-
-					std::string setvarstr = std::to_string(id->num.u_value) + " " + std::to_string(value->num.s_value);
-					std::string varstr = "var";
-					EM_ASM({
-						PrintChatInfo(UTF8ToString($0), UTF8ToString($1));
-					}, setvarstr.c_str(), varstr.c_str());
-				}
+		if(sync.Has(Fields::sprite)) {
+			mpplayer.ch->SetSpriteGraphic(ToString(sync.sprite_sheet), sync.sprite_id);
+			mpplayer.ch->ResetAnimation();
+		}
 
-				if(switchsync->type == nx_json_type::NX_JSON_OBJECT && MyData::switchsync) {
-					const nx_json* id = nx_json_get(switchsync, "id");
-					const nx_json* value = nx_json_get(switchsync, "value");
-					if(MyData::syncedswitches.find(id->num.u_value) != MyData::syncedswitches.cend()) {
-						Main_Data::game_switches->Set(id->num.u_value, value->num.s_value);
-						Game_Map::SetNeedRefresh(true);
-					}
-					std::string setswtstr = std::to_string(id->num.u_value) + " " + std::to_string(value->num.s_value);
-					if(MyData::switchlogblacklist.find(id->num.u_value) == MyData::switchlogblacklist.cend()) {
-						EM_ASM({
-							console.log("switch " + UTF8ToString($0));
-						}, setswtstr.c_str());
-					}
-				}
+		if(sync.Has(Fields::sound) && MyData::sfxsync) {
+			lcf::rpg::Sound soundStruct;
+			auto& p = mpplayer;
+			int w = Game_Map::GetWidth();
+			int h = Game_Map::GetHeight();
+			int dx = std::min(std::abs(p.ch->GetX() - Main_Data::game_player->GetX()), std::abs(p.ch->GetX() - w - Main_Data::game_player->GetX()));
+			int dy = std::min(std::abs(p.ch->GetY() - Main_Data::game_player->GetY()), std::abs(p.ch->GetY() - h - Main_Data::game_player->GetY()));
+			int distance = std::sqrt(dx * dx + dy * dy);
+			float falloffFactor = 100.0f / ((float)MyData::sfxfalloff);
+			soundStruct.volume = std::max(0, 
+			(int)
+			((100.0f - ((float)distance) * falloffFactor) * (float(MyData::playersVolume) / 100.0f) * (float(sync.sound_volume) / 100.0f))
+			);
+			soundStruct.tempo = sync.sound_tempo;
+			soundStruct.balance = sync.sound_balance;
+			soundStruct.name = ToString(sync.sound_name);
+
+			Main_Data::game_system->SePlay(soundStruct);
+		}
 
-				if(animtype->type == nx_json_type::NX_JSON_INTEGER) {
-					mpplayer.ch->SetAnimationType((lcf::rpg::EventPage::AnimType)animtype->num.u_value);
-				}
+		if(sync.Has(Fields::name)) {
+			nameTagRenderer->setTagName(player, ToString(sync.name));
+		}
 
-				if(animframe->type == nx_json_type::NX_JSON_INTEGER) {
-					mpplayer.ch->SetAnimFrame(animframe->num.u_value);
-				}
+		if(sync.Has(Fields::weather)) {
+			Main_Data::game_screen.get()->SetWeatherEffect(sync.weather_type, sync.weather_strength);
+		}
 
-				if(facing->type == nx_json_type::NX_JSON_INTEGER) {
-					if(facing->num.u_value <= 4)
-						mpplayer.ch->SetFacing(facing->num.u_value);
-				}
+		if(sync.Has(Fields::movementAnimationSpeed)) {
+			mpplayer.moveSpeed = sync.move_speed;
+		}
 
-				if(typingstatus->type == nx_json_type::NX_JSON_INTEGER) {
-					mpplayer.typingstatus = typingstatus->num.u_value;
-				}
+		if(sync.Has(Fields::variable) && false) {
+			Main_Data::game_variables->Set(sync.variable_id, sync.variable_value);
+			Game_Map::SetNeedRefresh(true);
+
+			std::string setvarstr = std::to_string(sync.variable_id) + " " + std::to_string(sync.variable_value);
+			std::string varstr = "var";
+			#ifdef EMSCRIPTEN
+			EM_ASM({
+				PrintChatInfo(UTF8ToString($0), UTF8ToString($1));
+			}, setvarstr.c_str(), varstr.c_str());
+			#endif
+		}
 
-				if(flash->type == nx_json_type::NX_JSON_ARRAY) {
-					mpplayer.ch->Flash(
-						nx_json_item(flash, 0)->num.u_value,
-						nx_json_item(flash, 1)->num.u_value,
-						nx_json_item(flash, 2)->num.u_value,
-						nx_json_item(flash, 3)->num.u_value,
-						nx_json_item(flash, 4)->num.u_value
-					);
-				}
+		if(sync.Has(Fields::switchsync) && MyData::switchsync) {
+			if(MyData::syncedswitches.find(sync.switch_id) != MyData::syncedswitches.cend()) {
+				Main_Data::game_switches->Set(sync.switch_id, sync.switch_value);
+				Game_Map::SetNeedRefresh(true);
+			}
+			if(MyData::switchlogblacklist.find(sync.switch_id) == MyData::switchlogblacklist.cend()) {
+				std::string setswtstr = std::to_string(sync.switch_id) + " " + std::to_string(sync.switch_value);
+				#ifdef EMSCRIPTEN
+				EM_ASM({
+					console.log("switch " + UTF8ToString($0));
+				}, setswtstr.c_str());
+				#endif
+			}
+		}
 
-				if(flashpause->type == nx_json_type::NX_JSON_INTEGER) {
-					mpplayer.flashpause = flashpause->num.u_value;
-				}
+		if(sync.Has(Fields::animtype)) {
+			mpplayer.ch->SetAnimationType((lcf::rpg::EventPage::AnimType)sync.anim_type);
+		}
 
-				if(system->type == nx_json_type::NX_JSON_STRING) {
-					nameTagRenderer->setTagSystem(uid_string, system->text_value);
-				}
-			}
-			if(MyData::syncnpc) {
-			if(npcmove->type == nx_json_type::NX_JSON_OBJECT) {
-				Game_Event* character = Game_Map::GetEvent(nx_json_get(npcmove, "id")->num.u_value);
-					if(character) {
-						if(character->GetX() != nx_json_get(npcmove, "x")->num.u_value || character->GetY() != nx_json_get(npcmove, "y")->num.u_value || character->GetDirection() != nx_json_get(npcmove, "facing")->num.u_value) {
-							character->SetX(nx_json_get(npcmove, "x")->num.u_value);
-							character->SetY(nx_json_get(npcmove, "y")->num.u_value);
-							character->SetDirection(nx_json_get(npcmove, "facing")->num.u_value);
-							character->UpdateFacing();
-							character->SetRemainingStep(SCREEN_TILE_SIZE);
-						}
-					}
+		if(sync.Has(Fields::animframe)) {
+			mpplayer.ch->SetAnimFrame(sync.anim_frame);
+		}
+
+		if(sync.Has(Fields::facing)) {
+			if(sync.facing >= 0 && sync.facing <= 4)
+				mpplayer.ch->SetFacing(sync.facing);
+		}
+
+		if(sync.Has(Fields::typingstatus)) {
+			mpplayer.typingstatus = sync.typing_status;
+		}
+
+		if(sync.Has(Fields::flash)) {
+			mpplayer.ch->Flash(sync.flash[0], sync.flash[1], sync.flash[2], sync.flash[3], sync.flash[4]);
+		}
+
+		if(sync.Has(Fields::flashpause)) {
+			mpplayer.flashpause = sync.flash_pause;
+		}
+
+		if(sync.Has(Fields::system)) {
+			nameTagRenderer->setTagSystem(player, ToString(sync.system));
+		}
+	}
+	if(MyData::syncnpc) {
+		if(sync.Has(Fields::npcmove)) {
+			Game_Event* character = Game_Map::GetEvent(sync.npc_id);
+			if(character) {
+				if(character->GetX() != sync.npc_x || character->GetY() != sync.npc_y || character->GetDirection() != sync.npc_facing) {
+					character->SetX(sync.npc_x);
+					character->SetY(sync.npc_y);
+					character->SetDirection(sync.npc_facing);
+					character->UpdateFacing();
+					character->SetRemainingStep(SCREEN_TILE_SIZE);
 				}
 			}
 		}
 	}
 }
 
+}
+
 
 }
\ No newline at end of file
@@ -1,10 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
 #include "nxjson.h"
+#include "game_multiplayer_protocol.h"
+#include "game_multiplayer_player_table.h"
 
 
 namespace Game_Multiplayer {
+	//json packet (text frame)
 	void HandleReceivedPacket(const char* data);
 
+	//binary packet, decoded in place
+	void HandleReceivedBinaryPacket(const uint8_t* data, size_t size);
+
 	void ResolveObjectSyncPacket(const nx_json* json);
 
+	//applies a decoded objectSync packet, shared by json and binary path
+	//an invalid handle stands for the "room" uid (npc sync)
+	void ApplyObjectSync(PlayerHandle player, const Protocol::ObjectSync& sync);
+
 	void HandleDisconnect(const nx_json* json);
-}
\ No newline at end of file
+
+	//forgets interned uids, must be called for every new connection
+	void ResetUidTable();
+}
@@ -0,0 +1,167 @@
+#include "game_multiplayer_send_queue.h"
+#include "game_multiplayer_connection.h"
+#include "game_multiplayer_senders.h"
+#include "game_multiplayer_protocol.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+namespace Game_Multiplayer {
+namespace SendQueue {
+
+namespace {
+	//the batch length prefix is an uint16_t, also keeps batch frames well below the server's read limit
+	constexpr size_t max_batch_size = 8192;
+	constexpr int max_packet_types = 32;
+
+	struct Entry {
+		uint16_t type;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	//packet bytes of the current frame, replaced packets leave dead bytes behind until the next flush
+	std::vector<uint8_t> arena;
+	//replaced packets stay in the list with size 0 and are skipped when flushing
+	std::vector<Entry> entries;
+	std::vector<uint8_t> batch;
+	//entry index + 1 of the queued packet for last-write-wins types, 0 if none
+	size_t lww_slot[max_packet_types] = {};
+	bool flushed_this_frame = false;
+
+	Stats stats;
+
+	bool IsLastWriteWins(uint16_t type) {
+		switch (type) {
+			case PacketTypes::sprite:
+			case PacketTypes::weather:
+			case PacketTypes::name:
+			case PacketTypes::movementAnimationSpeed:
+			case PacketTypes::animtype:
+			case PacketTypes::animframe:
+			case PacketTypes::facing:
+			case PacketTypes::typingstatus:
+			case PacketTypes::syncme:
+			case PacketTypes::flashpause:
+			case PacketTypes::system:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	void Send(const void* buffer, size_t size) {
+		if (SendFrame(buffer, size)) {
+			++stats.frames_sent;
+			stats.bytes_sent += size;
+		}
+	}
+
+	void SendBatch(size_t begin, size_t end) {
+		batch.clear();
+		uint16_t header = PacketTypes::batch;
+		batch.insert(batch.end(), (uint8_t*)&header, (uint8_t*)&header + sizeof(header));
+
+		for (size_t i = begin; i < end; ++i) {
+			const auto& e = entries[i];
+			if (e.size == 0) {
+				continue;
+			}
+			uint16_t len = (uint16_t)e.size;
+			batch.insert(batch.end(), (uint8_t*)&len, (uint8_t*)&len + sizeof(len));
+			batch.insert(batch.end(), arena.begin() + e.offset, arena.begin() + e.offset + e.size);
+		}
+		Send(batch.data(), batch.size());
+	}
+}
+
+void Push(const void* buffer, size_t size) {
+	if (size < sizeof(uint16_t) || size > max_batch_size - 2 * sizeof(uint16_t)) {
+		//not a typed packet or too big to be batched, don't reorder it around the queue
+		Flush();
+		Send(buffer, size);
+		return;
+	}
+
+	uint16_t type;
+	memcpy(&type, buffer, sizeof(type));
+
+	++stats.packets_queued;
+
+	Entry entry = { type, (uint32_t)arena.size(), (uint32_t)size };
+	arena.insert(arena.end(), (const uint8_t*)buffer, (const uint8_t*)buffer + size);
+
+	if (type < max_packet_types && IsLastWriteWins(type)) {
+		size_t& slot = lww_slot[type];
+		if (slot > 0) {
+			//the new state goes to the tail, so it stays ordered after the movement queued in between
+			entries[slot - 1].size = 0;
+			++stats.packets_coalesced;
+		}
+		slot = entries.size() + 1;
+	}
+	entries.push_back(entry);
+}
+
+void Flush() {
+	flushed_this_frame = true;
+
+	if (entries.empty()) {
+		return;
+	}
+
+	if (ConnectionData::protocolFeatures & Protocol::Features::batch) {
+		size_t begin = 0;
+		size_t batch_size = sizeof(uint16_t);
+		for (size_t i = 0; i < entries.size(); ++i) {
+			if (entries[i].size == 0) {
+				continue;
+			}
+			size_t entry_size = sizeof(uint16_t) + entries[i].size;
+			if (batch_size + entry_size > max_batch_size) {
+				SendBatch(begin, i);
+				begin = i;
+				batch_size = sizeof(uint16_t);
+			}
+			batch_size += entry_size;
+		}
+		SendBatch(begin, entries.size());
+	} else {
+		for (const auto& e : entries) {
+			if (e.size > 0) {
+				Send(arena.data() + e.offset, e.size);
+			}
+		}
+	}
+
+	Clear();
+}
+
+void EndFrame() {
+	if (!flushed_this_frame) {
+		Flush();
+	}
+	flushed_this_frame = false;
+}
+
+void Clear() {
+	arena.clear();
+	entries.clear();
+	std::fill(std::begin(lww_slot), std::end(lww_slot), 0);
+}
+
+bool Empty() {
+	return entries.empty();
+}
+
+const Stats& GetStats() {
+	return stats;
+}
+
+void ResetStats() {
+	stats = {};
+}
+
+}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+/*
+	Outbound packet queue.
+
+	Senders don't write to the socket directly anymore, every packet produced during a frame
+	is queued and the whole frame is flushed once at the end of Game_Multiplayer::Update.
+
+	State packets (facing, anim frame, sprite, ...) are last-write-wins: a second packet of the
+	same type in one frame drops the first one and is queued at the tail, after the packets
+	queued in between. Event packets (movement, sounds, flashes, switches, ...) are kept in order.
+
+	When the server accepted Protocol::Features::batch in its hello reply the queued packets are
+	framed into a single batch packet:
+	[PacketTypes::batch] {[uint16_t length] [packet]}...
+	otherwise every remaining packet is sent as its own frame like before.
+*/
+
+namespace Game_Multiplayer {
+namespace SendQueue {
+	struct Stats {
+		//websocket frames written to the socket
+		uint64_t frames_sent = 0;
+		//bytes written to the socket, including batch framing
+		uint64_t bytes_sent = 0;
+		//packets handed to the queue
+		uint64_t packets_queued = 0;
+		//packets that replaced an older packet of the same type in the same frame
+		uint64_t packets_coalesced = 0;
+	};
+
+	//queues a packet, buffer must start with its uint16_t packet type
+	void Push(const void* buffer, size_t size);
+
+	//sends everything queued so far and clears the queue
+	//packets are dropped when the socket is not open
+	void Flush();
+
+	//called once per main loop iteration, flushes the queue if Game_Multiplayer::Update
+	//did not run this iteration (e.g. while a menu scene is open)
+	void EndFrame();
+
+	//drops all queued packets
+	void Clear();
+
+	bool Empty();
+
+	const Stats& GetStats();
+	void ResetStats();
+}
+}
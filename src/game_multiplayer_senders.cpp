@@ -133,9 +133,11 @@ void SwitchSync(int32_t id, int32_t val) {
 		}
 		std::string setswtstr = std::to_string(id) + " " + std::to_string(val);
 		if(MyData::switchlogblacklist.find(id) == MyData::switchlogblacklist.cend()) {
+			#ifdef EMSCRIPTEN
 			EM_ASM({
 				console.log("my switch " + UTF8ToString($0));
 			}, setswtstr.c_str());
+			#endif
 		}
 	}
 }
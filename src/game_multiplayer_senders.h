@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 
 namespace lcf {
@@ -27,6 +28,8 @@ namespace Game_Multiplayer {
 		const uint16_t flashpause = 15;
 		const uint16_t npcmove = 16;
 		const uint16_t system = 17;
+		const uint16_t protocol = 18;
+		const uint16_t batch = 19;
 	};
 
 	void SendPlayerData();
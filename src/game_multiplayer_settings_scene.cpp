@@ -16,9 +16,7 @@
 namespace Game_Multiplayer {
 
 	bool Reconnect(SettingsItem* item, Input::InputButton action) {
-		SetConnStatusWindowText("Disconnected");
-		ConnectionData::connected = false;
-		emscripten_websocket_deinitialize();
+		Disconnect();
 		return true;
 	}
 
@@ -0,0 +1,65 @@
+#include "game_multiplayer_system_skins.h"
+#include "cache.h"
+
+namespace Game_Multiplayer {
+
+	SystemSkins system_skins;
+
+	void SystemSkins::Acquire(const std::string& name, Listener listener) {
+		Skin& skin = skins[name];
+		++skin.refs;
+		if (skin.loaded) {
+			listener(skin.bitmap);
+			return;
+		}
+
+		skin.waiting.push_back(std::move(listener));
+		if (skin.request) {
+			//already loading
+			return;
+		}
+
+		FileRequestAsync* request = AsyncHandler::RequestFile("System", name);
+		skin.request = request->Bind(&SystemSkins::OnLoaded, this, name);
+		request->SetGraphicFile(true);
+		//may call OnLoaded right away when the file is already there
+		request->Start();
+	}
+
+	void SystemSkins::Release(const std::string& name) {
+		auto it = skins.find(name);
+		if (it == skins.end()) {
+			return;
+		}
+		if (--it->second.refs <= 0) {
+			//dropping the binding cancels a running request
+			skins.erase(it);
+		}
+	}
+
+	BitmapRef SystemSkins::Get(const std::string& name) const {
+		auto it = skins.find(name);
+		return it != skins.end() ? it->second.bitmap : nullptr;
+	}
+
+	void SystemSkins::OnLoaded(FileRequestResult* result, std::string name) {
+		auto it = skins.find(name);
+		if (it == skins.end()) {
+			return;
+		}
+
+		Skin& skin = it->second;
+		skin.loaded = true;
+		skin.request.reset();
+		if (result->success) {
+			skin.bitmap = Cache::System(name);
+		}
+
+		//listeners may acquire or release skins, so the map can change below them
+		std::vector<Listener> waiting = std::move(skin.waiting);
+		BitmapRef bitmap = skin.bitmap;
+		for (auto& listener : waiting) {
+			listener(bitmap);
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "async_handler.h"
+#include "memory_management.h"
+
+namespace Game_Multiplayer {
+
+	/*
+		System graphics that other players announced, shared by the multiplayer UI.
+
+		Every skin is requested once no matter how many players use it. Listeners that
+		acquire a skin while it is loading wait for the same request and are all called when
+		it finished, later ones are called right away with the decoded bitmap from
+		Cache::System. The bitmap is held until the last reference is released, so the
+		cache can't free it while players still show it.
+	*/
+	class SystemSkins {
+	public:
+		//called with the loaded system graphic, nullptr if it couldn't be loaded
+		using Listener = std::function<void(const BitmapRef& system)>;
+
+		//takes a reference to the skin and calls listener once it is loaded
+		void Acquire(const std::string& name, Listener listener);
+		//drops a reference, listeners that still wait for the skin may not be called anymore
+		void Release(const std::string& name);
+
+		//nullptr if the skin isn't loaded
+		BitmapRef Get(const std::string& name) const;
+
+		size_t Size() const { return skins.size(); }
+
+	private:
+		struct Skin {
+			int refs = 0;
+			bool loaded = false;
+			BitmapRef bitmap;
+			FileRequestBinding request;
+			std::vector<Listener> waiting;
+		};
+
+		void OnLoaded(FileRequestResult* result, std::string name);
+
+		std::unordered_map<std::string, Skin> skins;
+	};
+
+	extern SystemSkins system_skins;
+}
@@ -0,0 +1,71 @@
+#include "game_multiplayer_transport.h"
+#include "game_multiplayer_transport_loopback.h"
+#include "game_multiplayer_transport_socket.h"
+#include "game_multiplayer_transport_websocket.h"
+#include "output.h"
+#include <cstring>
+
+namespace Game_Multiplayer {
+
+static bool StartsWith(const std::string& s, const char* prefix) {
+	return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+std::unique_ptr<Transport> Transport::Create(const std::string& url) {
+	if (StartsWith(url, "loopback://")) {
+		return std::make_unique<LoopbackTransport>();
+	}
+#ifdef EMSCRIPTEN
+	if (StartsWith(url, "ws://") || StartsWith(url, "wss://")) {
+		return std::make_unique<WebSocketTransport>();
+	}
+#endif
+#ifdef PLAYER_MULTIPLAYER_SOCKET
+	if (StartsWith(url, "tcp://") || StartsWith(url, "unix:")) {
+		return std::make_unique<SocketTransport>();
+	}
+#endif
+	Output::Debug("Multiplayer: Unsupported server url {}", url);
+	return nullptr;
+}
+
+void TransportEventQueue::Push(Transport::Event::Type type, bool text, const void* data, size_t size) {
+	pending.emplace_back();
+	auto& ev = pending.back();
+	ev.type = type;
+	ev.text = text;
+	if (!free_buffers.empty()) {
+		ev.data = std::move(free_buffers.back());
+		free_buffers.pop_back();
+	}
+	ev.data.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+	if (text) {
+		ev.data.push_back('\0');
+	}
+}
+
+bool TransportEventQueue::Pop(Transport::Event& event) {
+	if (current.data.capacity() > 0) {
+		free_buffers.push_back(std::move(current.data));
+		current.data = {};
+	}
+
+	if (pending.empty()) {
+		return false;
+	}
+
+	current = std::move(pending.front());
+	pending.pop_front();
+
+	event.type = current.type;
+	event.text = current.text;
+	event.data = current.data.data();
+	event.size = current.data.size() - (current.text ? 1 : 0);
+	return true;
+}
+
+void TransportEventQueue::Clear() {
+	pending.clear();
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Game_Multiplayer {
+
+	/*
+		Message based connection to the game server.
+
+		Implementations:
+		- websocket (emscripten only): ws:// and wss:// urls
+		- loopback: in-process connection, loopback://name, see game_multiplayer_transport_loopback.h
+		- socket (native only): tcp://host:port and unix:/path, frames are length prefixed
+
+		Events (open, message, close) are queued by the transport and handed out by Poll,
+		so all packet handling runs from the game loop.
+	*/
+	class Transport {
+	public:
+		//same values as the websocket readyState
+		enum class ReadyState {
+			Connecting = 0,
+			Open = 1,
+			Closing = 2,
+			Closed = 3
+		};
+
+		struct Event {
+			enum class Type {
+				Open,
+				Message,
+				Close
+			};
+
+			Type type = Type::Message;
+			bool text = false;
+			//only valid until the next Poll call, text messages are null terminated
+			const uint8_t* data = nullptr;
+			size_t size = 0;
+		};
+
+		virtual ~Transport() = default;
+
+		//starts connecting, Open or Close event is delivered through Poll
+		virtual bool Connect(const std::string& url) = 0;
+
+		//sends a binary frame, returns false if the transport is not open
+		virtual bool Send(const void* buffer, size_t size) = 0;
+
+		//fetches the next pending event, returns false if there is none
+		virtual bool Poll(Event& event) = 0;
+
+		virtual void Close() = 0;
+
+		virtual ReadyState GetReadyState() const = 0;
+
+		//creates the transport matching the url scheme, nullptr if the scheme is not supported on this platform
+		static std::unique_ptr<Transport> Create(const std::string& url);
+	};
+
+	//event queue shared by the transport implementations
+	//message buffers are recycled, so steady traffic doesn't allocate
+	class TransportEventQueue {
+	public:
+		void Push(Transport::Event::Type type, bool text = false, const void* data = nullptr, size_t size = 0);
+		bool Pop(Transport::Event& event);
+		void Clear();
+		size_t Size() const { return pending.size(); }
+
+	private:
+		struct StoredEvent {
+			Transport::Event::Type type;
+			bool text;
+			std::vector<uint8_t> data;
+		};
+
+		std::deque<StoredEvent> pending;
+		//event handed out by the last Pop, kept alive until the next one
+		StoredEvent current;
+		std::vector<std::vector<uint8_t>> free_buffers;
+	};
+}
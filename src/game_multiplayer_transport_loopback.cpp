@@ -0,0 +1,114 @@
+#include "game_multiplayer_transport_loopback.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace Game_Multiplayer {
+
+struct LoopbackChannel {
+	//index 0: events for the client, index 1: events for the server side
+	TransportEventQueue events[2];
+	bool closed = false;
+};
+
+namespace {
+	constexpr char scheme[] = "loopback://";
+
+	std::unordered_map<std::string, LoopbackListener*>& Listeners() {
+		static std::unordered_map<std::string, LoopbackListener*> listeners;
+		return listeners;
+	}
+}
+
+LoopbackListener::LoopbackListener(std::string name) : name(std::move(name)) {
+	Listeners()[this->name] = this;
+}
+
+LoopbackListener::~LoopbackListener() {
+	auto& listeners = Listeners();
+	auto it = listeners.find(name);
+	if (it != listeners.end() && it->second == this) {
+		listeners.erase(it);
+	}
+}
+
+std::unique_ptr<Transport> LoopbackListener::Accept() {
+	if (pending.empty()) {
+		return nullptr;
+	}
+	auto transport = std::move(pending.front());
+	pending.erase(pending.begin());
+	return transport;
+}
+
+LoopbackTransport::~LoopbackTransport() {
+	Close();
+}
+
+bool LoopbackTransport::Connect(const std::string& url) {
+	Close();
+	channel.reset();
+	local_events.Clear();
+	server_side = false;
+
+	auto& listeners = Listeners();
+	auto it = listeners.end();
+	if (url.compare(0, sizeof(scheme) - 1, scheme) == 0) {
+		it = listeners.find(url.substr(sizeof(scheme) - 1));
+	}
+	if (it == listeners.end()) {
+		local_events.Push(Event::Type::Close);
+		return false;
+	}
+
+	channel = std::make_shared<LoopbackChannel>();
+
+	auto server = std::make_unique<LoopbackTransport>();
+	server->channel = channel;
+	server->server_side = true;
+	it->second->pending.push_back(std::move(server));
+
+	channel->events[0].Push(Event::Type::Open);
+	channel->events[1].Push(Event::Type::Open);
+	return true;
+}
+
+bool LoopbackTransport::Send(const void* buffer, size_t size) {
+	if (!channel || channel->closed) {
+		return false;
+	}
+	channel->events[server_side ? 0 : 1].Push(Event::Type::Message, false, buffer, size);
+	return true;
+}
+
+bool LoopbackTransport::SendText(const char* text, size_t size) {
+	if (!channel || channel->closed) {
+		return false;
+	}
+	channel->events[server_side ? 0 : 1].Push(Event::Type::Message, true, text, size);
+	return true;
+}
+
+bool LoopbackTransport::Poll(Event& event) {
+	if (local_events.Pop(event)) {
+		return true;
+	}
+	return channel && channel->events[server_side ? 1 : 0].Pop(event);
+}
+
+void LoopbackTransport::Close() {
+	if (!channel || channel->closed) {
+		return;
+	}
+	channel->closed = true;
+	channel->events[0].Push(Event::Type::Close);
+	channel->events[1].Push(Event::Type::Close);
+}
+
+Transport::ReadyState LoopbackTransport::GetReadyState() const {
+	if (!channel || channel->closed) {
+		return ReadyState::Closed;
+	}
+	return ReadyState::Open;
+}
+
+}
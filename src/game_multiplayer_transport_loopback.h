@@ -0,0 +1,63 @@
+#pragma once
+#include "game_multiplayer_transport.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Game_Multiplayer {
+
+	//both directions of a loopback connection
+	struct LoopbackChannel;
+
+	/*
+		In-process transport, no sockets involved.
+
+		A LoopbackListener registered under a name accepts the clients connecting to
+		loopback://name. Every accepted client is handed out as the server side Transport,
+		frames sent on one side are delivered to the other side on its next Poll.
+		Connecting to a name without listener fails with a Close event.
+	*/
+	class LoopbackTransport : public Transport {
+	public:
+		LoopbackTransport() = default;
+		~LoopbackTransport() override;
+
+		bool Connect(const std::string& url) override;
+		bool Send(const void* buffer, size_t size) override;
+		bool Poll(Event& event) override;
+		void Close() override;
+		ReadyState GetReadyState() const override;
+
+		//sends a text frame, lets a stand-in server talk json to the client
+		bool SendText(const char* text, size_t size);
+
+	private:
+		friend class LoopbackListener;
+
+		std::shared_ptr<LoopbackChannel> channel;
+		bool server_side = false;
+		//for Connect failures, there is no channel to carry the close event
+		TransportEventQueue local_events;
+	};
+
+	class LoopbackListener {
+	public:
+		//registers the listener for loopback://name, replaces an older listener of that name
+		explicit LoopbackListener(std::string name);
+		~LoopbackListener();
+
+		LoopbackListener(const LoopbackListener&) = delete;
+		LoopbackListener& operator=(const LoopbackListener&) = delete;
+
+		//returns the server side of the next pending connection, nullptr if there is none
+		std::unique_ptr<Transport> Accept();
+
+		const std::string& GetName() const { return name; }
+
+	private:
+		friend class LoopbackTransport;
+
+		std::string name;
+		std::vector<std::unique_ptr<Transport>> pending;
+	};
+}
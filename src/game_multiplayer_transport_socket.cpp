@@ -0,0 +1,263 @@
+#include "game_multiplayer_transport_socket.h"
+
+#ifdef PLAYER_MULTIPLAYER_SOCKET
+#include "output.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Game_Multiplayer {
+
+namespace {
+	constexpr size_t header_size = sizeof(uint32_t);
+
+	bool SetNonBlocking(int fd) {
+		int flags = fcntl(fd, F_GETFL, 0);
+		return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+	}
+
+	void WriteHeader(std::vector<uint8_t>& out, uint32_t header) {
+		for (size_t i = 0; i < header_size; ++i) {
+			out.push_back((uint8_t)(header >> (i * 8)));
+		}
+	}
+
+	uint32_t ReadHeader(const uint8_t* in) {
+		return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+	}
+
+	//starts a non-blocking connect, returns the socket or -1 and the reason in error
+	int OpenTcp(const std::string& address, std::string& error) {
+		auto colon = address.rfind(':');
+		if (colon == std::string::npos) {
+			error = "missing port";
+			return -1;
+		}
+		std::string host = address.substr(0, colon);
+		std::string port = address.substr(colon + 1);
+
+		addrinfo hints = {};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* result = nullptr;
+		//getaddrinfo reports its errors through the return value, not errno
+		int rc = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+		if (rc != 0) {
+			error = gai_strerror(rc);
+			return -1;
+		}
+
+		int fd = -1;
+		for (auto* ai = result; ai; ai = ai->ai_next) {
+			fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+			if (fd == -1) {
+				continue;
+			}
+			int one = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+			if (SetNonBlocking(fd) && (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 || errno == EINPROGRESS)) {
+				break;
+			}
+			error = strerror(errno);
+			close(fd);
+			fd = -1;
+		}
+		freeaddrinfo(result);
+		return fd;
+	}
+
+	int OpenUnix(const std::string& path, std::string& error) {
+		sockaddr_un addr = {};
+		addr.sun_family = AF_UNIX;
+		if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+			error = "invalid socket path";
+			return -1;
+		}
+		memcpy(addr.sun_path, path.c_str(), path.size());
+
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd == -1) {
+			error = strerror(errno);
+			return -1;
+		}
+		if (SetNonBlocking(fd) && (connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0 || errno == EINPROGRESS)) {
+			return fd;
+		}
+		error = strerror(errno);
+		close(fd);
+		return -1;
+	}
+}
+
+SocketTransport::~SocketTransport() {
+	if (fd != -1) {
+		close(fd);
+	}
+}
+
+bool SocketTransport::Connect(const std::string& url) {
+	if (fd != -1) {
+		close(fd);
+		fd = -1;
+	}
+	events.Clear();
+	recv_buffer.clear();
+	send_buffer.clear();
+
+	std::string error = "unsupported url";
+	if (url.compare(0, 6, "tcp://") == 0) {
+		fd = OpenTcp(url.substr(6), error);
+	} else if (url.compare(0, 5, "unix:") == 0) {
+		fd = OpenUnix(url.substr(5), error);
+	}
+
+	if (fd == -1) {
+		Output::Debug("Multiplayer: Connecting to {} failed: {}", url, error);
+		state = ReadyState::Closed;
+		events.Push(Event::Type::Close);
+		return false;
+	}
+
+	state = ReadyState::Connecting;
+	return true;
+}
+
+void SocketTransport::Adopt(int new_fd) {
+	if (fd != -1) {
+		close(fd);
+	}
+	events.Clear();
+	recv_buffer.clear();
+	send_buffer.clear();
+	fd = new_fd;
+	SetNonBlocking(fd);
+	state = ReadyState::Open;
+	events.Push(Event::Type::Open);
+}
+
+bool SocketTransport::Send(const void* buffer, size_t size) {
+	if (state != ReadyState::Open || size >= max_frame_size) {
+		return false;
+	}
+	WriteHeader(send_buffer, (uint32_t)size);
+	send_buffer.insert(send_buffer.end(), (const uint8_t*)buffer, (const uint8_t*)buffer + size);
+	FlushSendBuffer();
+	return true;
+}
+
+bool SocketTransport::Poll(Event& event) {
+	Update();
+	return events.Pop(event);
+}
+
+void SocketTransport::Close() {
+	if (fd == -1) {
+		return;
+	}
+	FlushSendBuffer();
+	if (fd != -1) {
+		Fail();
+	}
+}
+
+Transport::ReadyState SocketTransport::GetReadyState() const {
+	return state;
+}
+
+void SocketTransport::Fail() {
+	close(fd);
+	fd = -1;
+	state = ReadyState::Closed;
+	send_buffer.clear();
+	events.Push(Event::Type::Close);
+}
+
+void SocketTransport::FlushSendBuffer() {
+	size_t written = 0;
+	while (fd != -1 && written < send_buffer.size()) {
+		ssize_t n = send(fd, send_buffer.data() + written, send_buffer.size() - written, MSG_NOSIGNAL);
+		if (n > 0) {
+			written += n;
+		} else if (n == -1 && errno == EINTR) {
+			continue;
+		} else {
+			if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+				Fail();
+				return;
+			}
+			break;
+		}
+	}
+	send_buffer.erase(send_buffer.begin(), send_buffer.begin() + written);
+}
+
+void SocketTransport::Update() {
+	if (fd == -1) {
+		return;
+	}
+
+	if (state == ReadyState::Connecting) {
+		pollfd pfd = { fd, POLLOUT, 0 };
+		if (poll(&pfd, 1, 0) <= 0) {
+			return;
+		}
+		int err = 0;
+		socklen_t len = sizeof(err);
+		if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+			Output::Debug("Multiplayer: Connecting failed: {}", strerror(err));
+			Fail();
+			return;
+		}
+		state = ReadyState::Open;
+		events.Push(Event::Type::Open);
+	}
+
+	FlushSendBuffer();
+
+	//frames received before the peer hung up are still delivered before the close event
+	bool lost = false;
+	uint8_t chunk[16 * 1024];
+	while (fd != -1) {
+		ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+		if (n > 0) {
+			recv_buffer.insert(recv_buffer.end(), chunk, chunk + n);
+		} else if (n == -1 && errno == EINTR) {
+			continue;
+		} else {
+			lost = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+			break;
+		}
+	}
+
+	size_t offset = 0;
+	while (recv_buffer.size() - offset >= header_size) {
+		uint32_t header = ReadHeader(recv_buffer.data() + offset);
+		uint32_t size = header & ~text_flag;
+		if (size >= max_frame_size) {
+			Output::Debug("Multiplayer: Frame of {} bytes exceeds the limit", size);
+			offset = recv_buffer.size();
+			lost = true;
+			break;
+		}
+		if (recv_buffer.size() - offset - header_size < size) {
+			break;
+		}
+		events.Push(Event::Type::Message, (header & text_flag) != 0, recv_buffer.data() + offset + header_size, size);
+		offset += header_size + size;
+	}
+	recv_buffer.erase(recv_buffer.begin(), recv_buffer.begin() + offset);
+
+	if (lost && fd != -1) {
+		Fail();
+	}
+}
+
+}
+#endif
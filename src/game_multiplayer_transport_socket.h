@@ -0,0 +1,49 @@
+#pragma once
+#include "game_multiplayer_transport.h"
+
+#ifdef PLAYER_MULTIPLAYER_SOCKET
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Game_Multiplayer {
+
+	/*
+		Native stream socket transport for tcp://host:port and unix:/path urls.
+
+		The stream carries websocket-like frames:
+		[uint32_t length] [payload]
+		length is little endian, the highest bit marks a text frame.
+		The socket is non-blocking, connecting and reading happens in Poll.
+	*/
+	class SocketTransport : public Transport {
+	public:
+		SocketTransport() = default;
+		~SocketTransport() override;
+
+		bool Connect(const std::string& url) override;
+		bool Send(const void* buffer, size_t size) override;
+		bool Poll(Event& event) override;
+		void Close() override;
+		ReadyState GetReadyState() const override;
+
+		//adopts an already connected socket, used by the benchmark server side
+		void Adopt(int fd);
+
+		//frames bigger than this close the connection
+		static constexpr uint32_t max_frame_size = 1 << 20;
+		static constexpr uint32_t text_flag = 0x80000000u;
+
+	private:
+		void Update();
+		void FlushSendBuffer();
+		void Fail();
+
+		int fd = -1;
+		ReadyState state = ReadyState::Closed;
+		std::vector<uint8_t> recv_buffer;
+		std::vector<uint8_t> send_buffer;
+		TransportEventQueue events;
+	};
+}
+#endif
@@ -0,0 +1,93 @@
+#include "game_multiplayer_transport_websocket.h"
+
+#ifdef EMSCRIPTEN
+
+namespace Game_Multiplayer {
+
+WebSocketTransport::~WebSocketTransport() {
+	Release();
+}
+
+bool WebSocketTransport::Connect(const std::string& url) {
+	Release();
+	events.Clear();
+
+	EmscriptenWebSocketCreateAttributes ws_attrs = {
+		url.c_str(),
+		"binary",
+		EM_TRUE
+	};
+
+	socket = emscripten_websocket_new(&ws_attrs);
+	if (socket <= 0) {
+		socket = 0;
+		events.Push(Event::Type::Close);
+		return false;
+	}
+	emscripten_websocket_set_onopen_callback(socket, this, OnOpen);
+	emscripten_websocket_set_onclose_callback(socket, this, OnClose);
+	emscripten_websocket_set_onmessage_callback(socket, this, OnMessage);
+	return true;
+}
+
+bool WebSocketTransport::Send(const void* buffer, size_t size) {
+	if (GetReadyState() != ReadyState::Open) {
+		return false;
+	}
+	emscripten_websocket_send_binary(socket, (void*)buffer, size);
+	return true;
+}
+
+bool WebSocketTransport::Poll(Event& event) {
+	return events.Pop(event);
+}
+
+void WebSocketTransport::Close() {
+	if (socket) {
+		emscripten_websocket_close(socket, 1000, "");
+	}
+}
+
+Transport::ReadyState WebSocketTransport::GetReadyState() const {
+	unsigned short ready = (unsigned short)ReadyState::Closed;
+	if (socket) {
+		emscripten_websocket_get_ready_state(socket, &ready);
+	}
+	return (ReadyState)ready;
+}
+
+void WebSocketTransport::Release() {
+	if (socket) {
+		//callbacks point to this object, they must not fire anymore
+		emscripten_websocket_set_onopen_callback(socket, nullptr, nullptr);
+		emscripten_websocket_set_onclose_callback(socket, nullptr, nullptr);
+		emscripten_websocket_set_onmessage_callback(socket, nullptr, nullptr);
+		emscripten_websocket_close(socket, 1000, "");
+		emscripten_websocket_delete(socket);
+		socket = 0;
+	}
+}
+
+EM_BOOL WebSocketTransport::OnOpen(int eventType, const EmscriptenWebSocketOpenEvent* websocketEvent, void* userData) {
+	static_cast<WebSocketTransport*>(userData)->events.Push(Event::Type::Open);
+	return EM_TRUE;
+}
+
+EM_BOOL WebSocketTransport::OnClose(int eventType, const EmscriptenWebSocketCloseEvent* websocketEvent, void* userData) {
+	static_cast<WebSocketTransport*>(userData)->events.Push(Event::Type::Close);
+	return EM_TRUE;
+}
+
+EM_BOOL WebSocketTransport::OnMessage(int eventType, const EmscriptenWebSocketMessageEvent* websocketEvent, void* userData) {
+	auto* self = static_cast<WebSocketTransport*>(userData);
+	//text frames are null terminated by emscripten, the terminator is not part of the message
+	size_t size = websocketEvent->numBytes;
+	if (websocketEvent->isText && size > 0 && websocketEvent->data[size - 1] == '\0') {
+		--size;
+	}
+	self->events.Push(Event::Type::Message, websocketEvent->isText, websocketEvent->data, size);
+	return EM_TRUE;
+}
+
+}
+#endif
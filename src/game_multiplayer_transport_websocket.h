@@ -0,0 +1,32 @@
+#pragma once
+#include "game_multiplayer_transport.h"
+
+#ifdef EMSCRIPTEN
+#include <emscripten/websocket.h>
+
+namespace Game_Multiplayer {
+
+	//browser websocket, the emscripten callbacks only queue events for Poll
+	class WebSocketTransport : public Transport {
+	public:
+		WebSocketTransport() = default;
+		~WebSocketTransport() override;
+
+		bool Connect(const std::string& url) override;
+		bool Send(const void* buffer, size_t size) override;
+		bool Poll(Event& event) override;
+		void Close() override;
+		ReadyState GetReadyState() const override;
+
+	private:
+		static EM_BOOL OnOpen(int eventType, const EmscriptenWebSocketOpenEvent* websocketEvent, void* userData);
+		static EM_BOOL OnClose(int eventType, const EmscriptenWebSocketCloseEvent* websocketEvent, void* userData);
+		static EM_BOOL OnMessage(int eventType, const EmscriptenWebSocketMessageEvent* websocketEvent, void* userData);
+
+		void Release();
+
+		EMSCRIPTEN_WEBSOCKET_T socket = 0;
+		TransportEventQueue events;
+	};
+}
+#endif
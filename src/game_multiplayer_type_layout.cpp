@@ -0,0 +1,104 @@
+#include "game_multiplayer_type_layout.h"
+#include <algorithm>
+
+namespace Game_Multiplayer {
+
+	namespace {
+		//same rule as Utils::ExFontNext
+		bool IsExFontLetter(char32_t ch) {
+			return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+		}
+
+		bool IsTail(const std::u32string& text, size_t i) {
+			return i > 0 && i < text.size() && text[i - 1] == '$' && IsExFontLetter(text[i]);
+		}
+	}
+
+	TypeLayout::TypeLayout(AdvanceFn advance, int exfont_width)
+		: advance_fn(std::move(advance)), exfont_width(exfont_width) { }
+
+	TypeLayout::Edit TypeLayout::SetText(std::u32string new_text) {
+		const size_t old_size = text.size();
+		const size_t new_size = new_text.size();
+
+		size_t prefix = 0;
+		const size_t common = std::min(old_size, new_size);
+		while (prefix < common && text[prefix] == new_text[prefix]) {
+			++prefix;
+		}
+		size_t suffix = 0;
+		while (suffix < common - prefix && text[old_size - 1 - suffix] == new_text[new_size - 1 - suffix]) {
+			++suffix;
+		}
+
+		Edit edit;
+		//a "$" in front of the change may start or stop being an exfont glyph
+		edit.first = (prefix > 0 && text[prefix - 1] == '$') ? prefix - 1 : prefix;
+		edit.new_last = new_size - suffix;
+		edit.old_last = old_size - suffix;
+		//the same for a letter behind it, checked in both texts as its "$" may be gone
+		if (suffix > 0 && (IsTail(text, edit.old_last) || IsTail(new_text, edit.new_last))) {
+			++edit.new_last;
+			++edit.old_last;
+		}
+
+		text = std::move(new_text);
+		if (edit.first == edit.new_last && edit.first == edit.old_last) {
+			return edit;
+		}
+
+		std::vector<int> middle;
+		middle.reserve(edit.new_last - edit.first);
+		int x = offsets[edit.first];
+		for (size_t i = edit.first; i < edit.new_last; ++i) {
+			x += Advance(i);
+			middle.push_back(x);
+		}
+		edit.delta = x - offsets[edit.old_last];
+
+		offsets.erase(offsets.begin() + edit.first + 1, offsets.begin() + edit.old_last + 1);
+		offsets.insert(offsets.begin() + edit.first + 1, middle.begin(), middle.end());
+		if (edit.delta != 0) {
+			for (size_t i = edit.new_last + 1; i < offsets.size(); ++i) {
+				offsets[i] += edit.delta;
+			}
+		}
+		return edit;
+	}
+
+	bool TypeLayout::IsExFontTail(size_t i) const {
+		return IsTail(text, i);
+	}
+
+	size_t TypeLayout::GlyphStart(size_t i) const {
+		return IsTail(text, i) ? i - 1 : i;
+	}
+
+	size_t TypeLayout::NextGlyph(size_t i) const {
+		return (i + 1 < text.size() && IsTail(text, i + 1)) ? i + 2 : i + 1;
+	}
+
+	int TypeLayout::GetExFont(size_t i) const {
+		if (!IsTail(text, i + 1)) {
+			return -1;
+		}
+		char32_t ch = text[i + 1];
+		return (ch >= 'a' && ch <= 'z') ? ch - 'a' + 26 : ch - 'A';
+	}
+
+	int TypeLayout::Advance(size_t i) {
+		if (IsTail(text, i)) {
+			//the "$" in front was counted as a normal glyph
+			return exfont_width - GlyphAdvance('$');
+		}
+		return GlyphAdvance(text[i]);
+	}
+
+	int TypeLayout::GlyphAdvance(char32_t ch) {
+		auto it = advances.find(ch);
+		if (it == advances.end()) {
+			it = advances.emplace(ch, advance_fn(ch)).first;
+		}
+		return it->second;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Game_Multiplayer {
+
+	/*
+		Caret offsets of the chat type box text.
+
+		The text comes in whole on every keystroke, SetText compares it with the previous one and
+		only measures the span that changed, the offsets behind it are shifted. Glyph widths are
+		cached per character, so nothing is re-encoded or measured twice.
+
+		Offsets are the same as measuring every prefix with Font::GetSize: "$" followed by a
+		letter is an exfont glyph, while the prefix only holds the "$" it counts as a normal glyph.
+	*/
+	class TypeLayout {
+	public:
+		//width of a normal glyph
+		using AdvanceFn = std::function<int(char32_t ch)>;
+
+		//characters [first, old_last) of the old text were replaced by [first, new_last) of the new one.
+		//both ends are glyph boundaries, offsets behind new_last moved by delta
+		struct Edit {
+			size_t first = 0;
+			size_t old_last = 0;
+			size_t new_last = 0;
+			int delta = 0;
+
+			bool IsEmpty() const { return first == old_last && first == new_last; }
+		};
+
+		TypeLayout(AdvanceFn advance, int exfont_width);
+
+		Edit SetText(std::u32string text);
+
+		const std::u32string& GetText() const { return text; }
+		//x offset of the caret in front of every character, plus one behind the last
+		const std::vector<int>& GetOffsets() const { return offsets; }
+		int GetWidth() const { return offsets.back(); }
+
+		//whether character i is the letter of an exfont glyph, it is drawn together with the "$" before
+		bool IsExFontTail(size_t i) const;
+		//first character of the glyph at i and of the following glyph
+		size_t GlyphStart(size_t i) const;
+		size_t NextGlyph(size_t i) const;
+		//exfont index of the glyph starting at i, -1 for normal glyphs
+		int GetExFont(size_t i) const;
+
+	private:
+		int Advance(size_t i);
+		int GlyphAdvance(char32_t ch);
+
+		AdvanceFn advance_fn;
+		int exfont_width;
+		std::unordered_map<char32_t, int> advances;
+
+		std::u32string text;
+		std::vector<int> offsets = { 0 };
+	};
+}
@@ -18,6 +18,7 @@
 // Headers
 #include "game_player.h"
 #include "async_handler.h"
+#include "async_prefetch.h"
 #include "game_actor.h"
 #include "game_map.h"
 #include "game_message.h"
@@ -75,6 +76,8 @@ void Game_Player::ReserveTeleport(int map_id, int x, int y, int direction, Telep
 	FileRequestAsync* request = Game_Map::RequestMap(map_id);
 	request->SetImportantFile(true);
 	request->Start();
+
+	AsyncPrefetch::PrefetchMap(map_id);
 }
 
 void Game_Player::ReserveTeleport(const lcf::rpg::SaveTarget& target) {
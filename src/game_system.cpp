@@ -35,6 +35,7 @@
 #include "scene_map.h"
 #include "utils.h"
 #include "game_multiplayer.h"
+#include "game_multiplayer_nametags.h"
 #include "chat_multiplayer.h"
 #include "audio_secache.h"
 
@@ -196,6 +197,10 @@ void Game_System::OnChangeSystemGraphicReady(FileRequestResult* result) {
 	Cache::SetSystemName(result->file);
 	bg_color = Cache::SystemOrBlack()->GetBackgroundColor();
 
+	if (nameTagRenderer) {
+		nameTagRenderer->systemGraphicChanged();
+	}
+
 	Scene_Map* scene = (Scene_Map*)Scene::Find(Scene::Map).get();
 
 	if (!scene)
@@ -0,0 +1,97 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "glyph_atlas.h"
+#include "bitmap.h"
+#include "pixel_format.h"
+
+namespace {
+	constexpr int max_columns = 32;
+}
+
+GlyphAtlas::GlyphAtlas(int cell_width, int cell_height, int capacity)
+	: cell_width((std::max(cell_width, 1) + 3) & ~3)
+	, cell_height(std::max(cell_height, 1))
+	, columns(std::min(std::max(capacity, 1), max_columns))
+	, cells(std::max(capacity, 1))
+{
+}
+
+const GlyphAtlas::Entry* GlyphAtlas::Find(char32_t code) {
+	auto it = by_code.find(code);
+	if (it == by_code.end()) {
+		return nullptr;
+	}
+
+	Cell& cell = cells[it->second];
+	if (cell.lru != lru.begin()) {
+		lru.splice(lru.begin(), lru, cell.lru);
+	}
+	return &cell.entry;
+}
+
+const GlyphAtlas::Entry& GlyphAtlas::Insert(char32_t code, int width, int height, Rect rect) {
+	assert(by_code.find(code) == by_code.end());
+	assert(Fits(width, height));
+
+	const int pitch = columns * cell_width;
+	if (pixels.empty()) {
+		const int rows = (GetCapacity() + columns - 1) / columns;
+		pixels.resize(static_cast<size_t>(pitch) * rows * cell_height);
+	}
+
+	int index;
+	if (next_free < GetCapacity()) {
+		index = next_free++;
+	} else {
+		index = lru.back();
+		lru.pop_back();
+		by_code.erase(cells[index].code);
+		++evicted;
+	}
+
+	Cell& cell = cells[index];
+	uint8_t* origin = pixels.data()
+		+ static_cast<size_t>(index / columns) * cell_height * pitch
+		+ (index % columns) * cell_width;
+	for (int y = 0; y < cell_height; ++y) {
+		memset(origin + y * pitch, 0, cell_width);
+	}
+
+	BitmapRef& bitmap = cell.entry.bitmap;
+	if (!bitmap || bitmap->width() != width || bitmap->height() != height) {
+		bitmap = Bitmap::Create(origin, width, height, pitch, DynamicFormat(8,8,0,8,0,8,0,8,0,PF::Alpha));
+	}
+	cell.entry.rect = rect;
+	cell.code = code;
+
+	lru.push_front(index);
+	cell.lru = lru.begin();
+	by_code[code] = index;
+
+	return cell.entry;
+}
+
+void GlyphAtlas::Clear() {
+	by_code.clear();
+	lru.clear();
+	next_free = 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_GLYPH_ATLAS_H
+#define EP_GLYPH_ATLAS_H
+
+// Headers
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "memory_management.h"
+#include "rect.h"
+
+/**
+ * Cache of the rendered glyph masks of one font.
+ *
+ * Glyphs are stored in fixed size cells of one 8 bit alpha bitmap. Every cached glyph
+ * gets a bitmap sharing the memory of its cell, so drawing it is a single MaskedBlit
+ * and the glyph is only rasterized once.
+ * When all cells are taken the least recently used glyph is replaced, this keeps the
+ * memory bounded for the large CJK fonts.
+ */
+class GlyphAtlas {
+public:
+	struct Entry {
+		/** Mask of the glyph, shares the memory of the cell */
+		BitmapRef bitmap;
+		/** Part of bitmap containing the glyph */
+		Rect rect;
+	};
+
+	/**
+	 * @param cell_width width of a cell, rounded up to 4 to keep the cells aligned
+	 * @param cell_height height of a cell
+	 * @param capacity number of cells
+	 */
+	GlyphAtlas(int cell_width, int cell_height, int capacity);
+
+	/**
+	 * Looks up a cached glyph and marks it as used.
+	 *
+	 * @param code glyph code
+	 * @return the glyph or nullptr when it's not cached
+	 */
+	const Entry* Find(char32_t code);
+
+	/**
+	 * Reserves a cell for a glyph, replacing the least recently used glyph when the atlas is full.
+	 * The caller draws the glyph into the returned bitmap.
+	 *
+	 * @param code glyph code, must not be cached
+	 * @param width width of the glyph bitmap, at most the cell width
+	 * @param height height of the glyph bitmap, at most the cell height
+	 * @param rect part of the glyph bitmap containing the glyph
+	 * @return the cleared glyph
+	 */
+	const Entry& Insert(char32_t code, int width, int height, Rect rect);
+
+	/** @return whether a glyph of this size fits into a cell */
+	bool Fits(int width, int height) const;
+
+	/** Drops all glyphs, keeps the memory */
+	void Clear();
+
+	/** @return number of cached glyphs */
+	int GetSize() const;
+	/** @return number of cells */
+	int GetCapacity() const;
+	/** @return number of glyphs replaced so far */
+	int GetEvicted() const;
+
+private:
+	struct Cell {
+		Entry entry;
+		char32_t code = 0;
+		std::list<int>::iterator lru;
+	};
+
+	int cell_width = 0;
+	int cell_height = 0;
+	int columns = 0;
+	int evicted = 0;
+
+	/** Backing store of all cells, allocated with the first glyph */
+	std::vector<uint8_t> pixels;
+	std::vector<Cell> cells;
+	std::unordered_map<char32_t, int> by_code;
+	/** Used cells, most recently used first */
+	std::list<int> lru;
+	/** Cells from here on were not taken since the last Clear */
+	int next_free = 0;
+};
+
+inline bool GlyphAtlas::Fits(int width, int height) const {
+	return width <= cell_width && height <= cell_height;
+}
+
+inline int GlyphAtlas::GetSize() const {
+	return static_cast<int>(by_code.size());
+}
+
+inline int GlyphAtlas::GetCapacity() const {
+	return static_cast<int>(cells.size());
+}
+
+inline int GlyphAtlas::GetEvicted() const {
+	return evicted;
+}
+
+#endif
@@ -30,6 +30,10 @@
 #include "drawable_mgr.h"
 #include "baseui.h"
 #include "game_clock.h"
+#include "game_screen.h"
+#include "game_system.h"
+#include "main_data.h"
+#include "compositor.h"
 
 using namespace std::chrono_literals;
 
@@ -42,6 +46,11 @@ namespace Graphics {
 	std::unique_ptr<FpsOverlay> fps_overlay;
 
 	std::string window_title_key;
+
+	Compositor compositor;
+	// Surface of the last frame and its state after drawing, to notice when something else drew to it
+	const Bitmap* last_surface = nullptr;
+	uint32_t last_surface_generation = 0;
 }
 
 void Graphics::Init() {
@@ -117,7 +126,33 @@ void Graphics::Draw(Bitmap& dst) {
 		min_z = transition.GetZ() + 1;
 		dst.Clear();
 	}
-	LocalDraw(dst, min_z, max_z);
+
+	// Transitions and screen shaking change the whole screen
+	bool force_full = min_z != std::numeric_limits<int>::min() ||
+		&dst != last_surface || dst.GetGeneration() != last_surface_generation;
+	if (Main_Data::game_screen) {
+		force_full |= Main_Data::game_screen->GetShakeOffsetX() != 0 || Main_Data::game_screen->GetShakeOffsetY() != 0;
+	}
+
+	Drawable::DamageState frame;
+	frame.Add(reinterpret_cast<uintptr_t>(current_scene.get()));
+	if (Main_Data::game_system) {
+		frame.Add(Main_Data::game_system->GetBackgroundColor());
+	}
+
+	if (compositor.Collect(DrawableMgr::GetLocalList(), dst.GetRect(), frame.key, force_full)) {
+		auto& damage = compositor.GetDamage();
+		if (!damage.empty()) {
+			dst.SetClipRects(damage);
+			LocalDraw(dst, min_z, max_z);
+			dst.SetClipRects({});
+		}
+	} else {
+		LocalDraw(dst, min_z, max_z);
+	}
+
+	last_surface = &dst;
+	last_surface_generation = dst.GetGeneration();
 }
 
 void Graphics::LocalDraw(Bitmap& dst, int min_z, int max_z) {
@@ -151,3 +186,15 @@ MessageOverlay& Graphics::GetMessageOverlay() {
 	return *message_overlay;
 }
 
+void Graphics::SetDamageTracking(bool enabled) {
+	compositor.SetEnabled(enabled);
+}
+
+bool Graphics::GetDamageTracking() {
+	return compositor.IsEnabled();
+}
+
+int64_t Graphics::GetRepaintedPixels() {
+	return compositor.GetRepaintedPixels();
+}
+
@@ -61,6 +61,21 @@ namespace Graphics {
 	 * @return message overlay
 	 */
 	MessageOverlay& GetMessageOverlay();
+
+	/**
+	 * Enables redrawing only the parts of the screen that changed since the
+	 * last frame. The whole screen is still redrawn during transitions, screen
+	 * shaking and while drawables are visible that don't track their damage.
+	 *
+	 * @param enabled whether to track damage
+	 */
+	void SetDamageTracking(bool enabled);
+
+	/** @return whether damage is tracked */
+	bool GetDamageTracking();
+
+	/** @return number of pixels redrawn in the last frame */
+	int64_t GetRepaintedPixels();
 }
 
 #endif
@@ -0,0 +1,210 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <algorithm>
+#include <deque>
+#include "image_decoder.h"
+#include "bitmap.h"
+#include "output.h"
+#include "system.h"
+
+#ifdef EP_DECODE_THREAD
+#  include <condition_variable>
+#  include <mutex>
+#  include <thread>
+#endif
+
+namespace {
+	struct Job {
+		int id;
+		std::vector<uint8_t> data;
+		bool transparent;
+		uint32_t flags;
+		ImageDecoder::Callback done;
+		BitmapRef bitmap;
+		// guarded by the mutex when there are workers
+		bool decoded = false;
+	};
+	using JobRef = std::shared_ptr<Job>;
+
+	// all unfinished jobs in the order they were started, only used by the main thread
+	std::deque<JobRef> jobs;
+	int next_id = 0;
+
+	void DecodeJob(Job& job) {
+		job.bitmap = Bitmap::Create(job.data.data(), job.data.size(), job.transparent, job.flags);
+		job.data = {};
+	}
+
+#ifdef EP_DECODE_THREAD
+	std::mutex mutex;
+	std::condition_variable work_cv;
+	std::condition_variable done_cv;
+	// jobs no worker picked up yet
+	std::deque<JobRef> queue;
+	std::vector<std::thread> workers;
+	bool quit = false;
+
+	void WorkerMain() {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			work_cv.wait(lock, []() { return quit || !queue.empty(); });
+			if (quit) {
+				return;
+			}
+
+			JobRef job = std::move(queue.front());
+			queue.pop_front();
+
+			lock.unlock();
+			DecodeJob(*job);
+			lock.lock();
+
+			job->decoded = true;
+			done_cv.notify_all();
+		}
+	}
+
+	void StartWorkers() {
+		if (!workers.empty()) {
+			return;
+		}
+
+		// The main thread still needs a core, but one worker is always started
+		unsigned cores = std::thread::hardware_concurrency();
+		unsigned count = std::max(1u, std::min(2u, cores > 1 ? cores - 1 : 1u));
+
+		quit = false;
+		for (unsigned i = 0; i < count; ++i) {
+			workers.emplace_back(WorkerMain);
+		}
+	}
+
+	bool IsDecoded(const Job& job) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return job.decoded;
+	}
+
+	void WaitForJob(Job& job) {
+		std::unique_lock<std::mutex> lock(mutex);
+		auto it = std::find_if(queue.begin(), queue.end(), [&job](const JobRef& j) { return j.get() == &job; });
+		if (it != queue.end()) {
+			// Not started yet, faster to decode it here than to wait for the others
+			queue.erase(it);
+			lock.unlock();
+			DecodeJob(job);
+			return;
+		}
+		done_cv.wait(lock, [&job]() { return job.decoded; });
+	}
+#else
+	bool IsDecoded(const Job&) {
+		// decoded by FinishJob
+		return true;
+	}
+#endif
+
+	void FinishJob(std::deque<JobRef>::iterator it) {
+		JobRef job = std::move(*it);
+		jobs.erase(it);
+
+#ifndef EP_DECODE_THREAD
+		DecodeJob(*job);
+#endif
+
+		// messages of the decoders, e.g. about broken images
+		Output::WriteQueued();
+
+		job->done(std::move(job->bitmap));
+	}
+}
+
+int ImageDecoder::Decode(std::vector<uint8_t> data, bool transparent, uint32_t flags, Callback done) {
+	auto job = std::make_shared<Job>();
+	job->id = next_id++;
+	job->data = std::move(data);
+	job->transparent = transparent;
+	job->flags = flags;
+	job->done = std::move(done);
+	jobs.push_back(job);
+
+#ifdef EP_DECODE_THREAD
+	StartWorkers();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(job);
+	}
+	work_cv.notify_one();
+#endif
+
+	return job->id;
+}
+
+void ImageDecoder::Finish(int id) {
+	auto it = std::find_if(jobs.begin(), jobs.end(), [id](const JobRef& job) { return job->id == id; });
+	if (it == jobs.end()) {
+		return;
+	}
+
+#ifdef EP_DECODE_THREAD
+	WaitForJob(**it);
+#endif
+	FinishJob(it);
+}
+
+void ImageDecoder::Update(Game_Clock::duration budget) {
+	const auto start = Game_Clock::now();
+
+	for (auto it = jobs.begin(); it != jobs.end();) {
+		if (!IsDecoded(**it)) {
+			++it;
+			continue;
+		}
+
+		// callbacks can start new jobs, continue from the front
+		FinishJob(it);
+		it = jobs.begin();
+
+		if (Game_Clock::now() - start >= budget) {
+			break;
+		}
+	}
+
+	Output::WriteQueued();
+}
+
+bool ImageDecoder::IsPending() {
+	return !jobs.empty();
+}
+
+void ImageDecoder::Quit() {
+#ifdef EP_DECODE_THREAD
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+		queue.clear();
+	}
+	work_cv.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+#endif
+
+	jobs.clear();
+}
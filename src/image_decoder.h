@@ -0,0 +1,76 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_IMAGE_DECODER_H
+#define EP_IMAGE_DECODER_H
+
+// Headers
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "game_clock.h"
+#include "memory_management.h"
+
+/**
+ * Decodes images away from the frame.
+ *
+ * When built with EP_DECODE_THREAD the images are decoded by worker threads,
+ * otherwise they are decoded on the main thread by Update, a few per frame.
+ * The finished bitmaps are already converted to the display format and their
+ * opacity is known, they are handed over on the main thread by Update.
+ */
+namespace ImageDecoder {
+	using Callback = std::function<void(BitmapRef)>;
+
+	/** Time per frame Update spends on finished images by default */
+	constexpr Game_Clock::duration default_budget = std::chrono::milliseconds(3);
+
+	/**
+	 * Starts decoding an image.
+	 *
+	 * @param data content of a PNG, BMP or XYZ file
+	 * @param transparent whether the image has a transparent color
+	 * @param flags Bitmap::Flag values passed to the bitmap
+	 * @param done called on the main thread with the bitmap, or nullptr when the image is invalid
+	 * @return id of the image for Finish
+	 */
+	int Decode(std::vector<uint8_t> data, bool transparent, uint32_t flags, Callback done);
+
+	/**
+	 * Finishes an image right now, waiting for it when it is being decoded,
+	 * and calls its callback. Does nothing when it is already finished.
+	 *
+	 * @param id id returned by Decode
+	 */
+	void Finish(int id);
+
+	/**
+	 * Calls the callbacks of the finished images until the budget is used up.
+	 * At least one image is finished per call.
+	 *
+	 * @param budget time to spend
+	 */
+	void Update(Game_Clock::duration budget = default_budget);
+
+	/** @return whether images are waiting to be finished */
+	bool IsPending();
+
+	/** Stops the workers and drops all images that are not finished yet. */
+	void Quit();
+}
+
+#endif
@@ -25,10 +25,21 @@
 #include "output.h"
 #include "image_png.h"
 
+namespace {
+	struct MemoryReader {
+		const uint8_t* data;
+		size_t size;
+	};
+}
+
 static void read_data(png_structp png_ptr, png_bytep data, png_size_t length) {
-    png_bytep* bufp = (png_bytep*) png_get_io_ptr(png_ptr);
-	memcpy(data, *bufp, length);
-	*bufp += length;
+	auto* reader = reinterpret_cast<MemoryReader*>(png_get_io_ptr(png_ptr));
+	if (length > reader->size) {
+		png_error(png_ptr, "Read error: Unexpected end of file");
+	}
+	memcpy(data, reader->data, length);
+	reader->data += length;
+	reader->size -= length;
 }
 
 static void read_data_istream(png_structp png_ptr, png_bytep data, png_size_t length) {
@@ -53,9 +64,10 @@ static void ReadGrayAlphaData(png_struct*, png_info*, png_uint_32, png_uint_32,
 static void ReadRGBData(png_struct*, png_info*, png_uint_32, png_uint_32, uint32_t*);
 static void ReadRGBAData(png_struct*, png_info*, png_uint_32, png_uint_32, uint32_t*);
 
-bool ImagePNG::ReadPNG(const void* buffer, bool transparent,
+bool ImagePNG::ReadPNG(const void* buffer, size_t size, bool transparent,
 	int& width, int& height, void*& pixels) {
-	return ReadPNGWithReadFunction((png_voidp)&buffer, read_data, transparent, width, height, pixels);
+	MemoryReader reader = { static_cast<const uint8_t*>(buffer), size };
+	return ReadPNGWithReadFunction(&reader, read_data, transparent, width, height, pixels);
 }
 
 bool ImagePNG::ReadPNG(Filesystem_Stream::InputStream& stream, bool transparent,
@@ -29,6 +29,19 @@ MessageOverlay::MessageOverlay() : Drawable(Priority_Overlay, Drawable::Flags::G
 	// Graphics::RegisterDrawable is in the Update function
 }
 
+bool MessageOverlay::GetDamageState(DamageState& state) const {
+	if (!IsAnyMessageVisible() && !show_all) {
+		return true;
+	}
+
+	// The messages are drawn to the bitmap after it was blitted, the new
+	// generation of the bitmap shows them in the next frame
+	state.bounds = Rect(ox, oy, bitmap->GetWidth(), bitmap->GetHeight());
+	state.Add(bitmap);
+	state.Add(dirty);
+	return true;
+}
+
 void MessageOverlay::Draw(Bitmap& dst) {
 	if (!IsAnyMessageVisible() && !show_all) {
 		// Don't render overlay when no message visible
@@ -24,6 +24,7 @@
 #include <iostream>
 #include <fstream>
 #include <thread>
+#include <mutex>
 #include <chrono>
 
 #include "graphics.h"
@@ -91,6 +92,16 @@ namespace {
 
 	bool ignore_pause = false;
 
+	// Only the main thread writes the log, messages of other threads wait here
+	struct QueuedMessage {
+		LogLevel lvl;
+		std::string msg;
+		Color color;
+	};
+	const std::thread::id main_thread_id = std::this_thread::get_id();
+	std::mutex queued_mutex;
+	std::vector<QueuedMessage> queued_messages;
+
 	std::vector<std::string> log_buffer;
 	// pair of repeat count + message
 	struct {
@@ -145,6 +156,12 @@ void Output::IgnorePause(bool const val) {
 }
 
 static void WriteLog(LogLevel lvl, std::string const& msg, Color const& c = Color()) {
+	if (std::this_thread::get_id() != main_thread_id) {
+		std::lock_guard<std::mutex> lock(queued_mutex);
+		queued_messages.push_back({ lvl, msg, c });
+		return;
+	}
+
 #ifdef EMSCRIPTEN
 
 // Allow pretty log output and filtering in browser console
@@ -262,6 +279,18 @@ static void HandleErrorOutput(const std::string& err) {
 	}
 }
 
+void Output::WriteQueued() {
+	std::vector<QueuedMessage> messages;
+	{
+		std::lock_guard<std::mutex> lock(queued_mutex);
+		messages.swap(queued_messages);
+	}
+
+	for (auto& message : messages) {
+		WriteLog(message.lvl, message.msg, message.color);
+	}
+}
+
 void Output::Quit() {
 	if (LOG_FILE) {
 		LOG_FILE.clear();
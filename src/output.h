@@ -66,6 +66,12 @@ namespace Output {
 	 */
 	void Quit();
 
+	/**
+	 * Writes the messages logged by other threads since the last call.
+	 * Other threads can't write the log themselves.
+	 */
+	void WriteQueued();
+
 	/**
 	 * Takes screenshot and save it in the save directory.
 	 *
@@ -29,6 +29,26 @@ Plane::Plane() : Drawable(0)
 	DrawableMgr::Register(this);
 }
 
+bool Plane::GetDamageState(DamageState& state) const {
+	if (!bitmap) {
+		return true;
+	}
+
+	state.SetFullScreen();
+	state.Add(bitmap);
+	state.Add(tone_effect);
+	state.Add(ox);
+	state.Add(oy);
+	state.Add(Main_Data::game_screen->GetShakeOffsetX());
+	state.Add(Main_Data::game_screen->GetShakeOffsetY());
+	state.Add(Game_Map::LoopHorizontal());
+	if (!Game_Map::LoopHorizontal()) {
+		state.Add(Game_Map::GetDisplayX());
+		state.Add(Game_Map::GetWidth());
+	}
+	return true;
+}
+
 void Plane::Draw(Bitmap& dst) {
 	if (!bitmap) return;
 
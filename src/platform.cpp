@@ -22,6 +22,12 @@
 #include <cassert>
 #include <utility>
 
+#if defined(__linux__) || defined(__APPLE__)
+#  define EP_HAVE_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#endif
+
 #ifndef DT_UNKNOWN
 #define DT_UNKNOWN 0
 #endif
@@ -266,3 +272,34 @@ void Platform::Directory::Close() {
 
 	valid_entry = false;
 }
+
+Platform::MappedFile::MappedFile(const std::string& name) {
+#ifdef EP_HAVE_MMAP
+	int fd = ::open(name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return;
+	}
+
+	struct stat sb;
+	if (::fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0) {
+		void* mapping = ::mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED) {
+			data = mapping;
+			size = static_cast<size_t>(sb.st_size);
+		}
+	}
+
+	// The mapping stays valid without the descriptor
+	::close(fd);
+#else
+	(void)name;
+#endif
+}
+
+Platform::MappedFile::~MappedFile() {
+#ifdef EP_HAVE_MMAP
+	if (data) {
+		::munmap(data, size);
+	}
+#endif
+}
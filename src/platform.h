@@ -159,6 +159,47 @@ namespace Platform {
 		bool valid_entry = false;
 	};
 
+	/** Read-only mapping of a whole file into memory, only supported on Linux and macOS */
+	class MappedFile {
+	public:
+		explicit MappedFile() = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(const MappedFile&) = delete;
+
+		/**
+		 * Maps a file into memory.
+		 *
+		 * @param name File to map
+		 */
+		explicit MappedFile(const std::string& name);
+		~MappedFile();
+
+		/** @return Content of the file */
+		const uint8_t* GetData() const;
+
+		/** @return Size of the file */
+		size_t GetSize() const;
+
+		/** @return true if mapping the file was successful */
+		explicit operator bool() const noexcept;
+
+	private:
+		void* data = nullptr;
+		size_t size = 0;
+	};
+
+	inline const uint8_t* MappedFile::GetData() const {
+		return static_cast<const uint8_t*>(data);
+	}
+
+	inline size_t MappedFile::GetSize() const {
+		return size;
+	}
+
+	inline MappedFile::operator bool() const noexcept {
+		return data != nullptr;
+	}
+
 	inline Directory::operator bool() const noexcept {
 #ifdef PSP2
 		return dir_handle >= 0;
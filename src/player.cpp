@@ -66,6 +66,7 @@
 #include "game_variables.h"
 #include "game_targets.h"
 #include "graphics.h"
+#include "image_decoder.h"
 #include <lcf/inireader.h>
 #include "input.h"
 #include <lcf/ldb/reader.h>
@@ -89,6 +90,8 @@
 #include "baseui.h"
 #include "game_clock.h"
 #include "chat_multiplayer.h"
+#include "game_multiplayer_connection.h"
+#include "game_multiplayer_send_queue.h"
 
 #ifndef EMSCRIPTEN
 // This is not used on Emscripten.
@@ -226,6 +229,14 @@ void Player::Init(int argc, char *argv[]) {
 	Input::Init(std::move(buttons), std::move(directions), replay_input_path, record_input_path);
 	Input::AddRecordingData(Input::RecordingData::CommandLine, command_line);
 
+	Graphics::SetDamageTracking(cfg.video.damage_tracking.Get());
+
+	Cache::Eviction eviction = Cache::Eviction::LRU;
+	if (!Cache::ParseEviction(cfg.video.image_cache_policy.Get(), eviction)) {
+		Output::Warning("Unknown image cache policy {}, using LRU", cfg.video.image_cache_policy.Get());
+	}
+	Cache::SetEvictionPolicy(static_cast<size_t>(cfg.video.image_cache_size.Get()) * 1024 * 1024, eviction);
+
 	player_config = std::move(cfg.player);
 }
 
@@ -281,6 +292,12 @@ void Player::MainLoop() {
 
 	Player::UpdateInput();
 
+	// Handle packets received since the last frame
+	Game_Multiplayer::PollConnection();
+
+	// Hand over images decoded since the last frame
+	ImageDecoder::Update();
+
 	int num_updates = 0;
 	while (Game_Clock::NextGameTimeStep()) {
 
@@ -301,6 +318,9 @@ void Player::MainLoop() {
 		Input::UpdateSystem();
 	}
 
+	// Send packets queued while the map was not updating (menus, ...)
+	Game_Multiplayer::SendQueue::EndFrame();
+
 	Player::Draw();
 
 	Scene::old_instances.clear();
@@ -453,6 +473,7 @@ int Player::GetFrames() {
 
 void Player::Exit() {
 	Graphics::UpdateSceneCallback();
+	ImageDecoder::Quit();
 #ifdef EMSCRIPTEN
 	BitmapRef surface = DisplayUi->GetDisplaySurface();
 	std::string message = "It's now safe to turn off\n      your browser.";
@@ -1370,6 +1391,13 @@ Options:
       --fullscreen         Start in fullscreen mode.
       --show-fps           Enable frames per second counter.
       --fps-render-window  Render the frames per second counter in windowed mode.
+      --damage-tracking    Only redraw the parts of the screen that changed.
+      --image-cache-size N Keep up to N MiB of images in memory. The default is 10.
+      --image-cache-policy P
+                           Which unused images are freed first when the image
+                           cache is full. Possible options:
+                            LRU - The least recently used ones (default)
+                            LFU - The least often used ones, big images first
       --fps-limit          Set a custom frames per second limit. The default is 60 FPS.
                            Set to 0 to run with unlimited frames per second.
                            This option is not supported on all platforms.
@@ -18,6 +18,7 @@
 // Headers
 #include "scene_gameover.h"
 #include "scene_map.h"
+#include "async_prefetch.h"
 #include "scene_menu.h"
 #include "scene_save.h"
 #include "scene_debug.h"
@@ -230,6 +231,8 @@ void Scene_Map::PreUpdateForegroundEvents(MapUpdateAsyncContext& actx) {
 }
 
 void Scene_Map::Update() {
+	AsyncPrefetch::Update();
+
 	if (activate_inn) {
 		UpdateInn();
 		return;
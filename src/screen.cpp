@@ -29,6 +29,15 @@ Screen::Screen() : Drawable(Priority_Screen)
 	DrawableMgr::Register(this);
 }
 
+bool Screen::GetDamageState(DamageState& state) const {
+	auto flash_color = Main_Data::game_screen->GetFlashColor();
+	if (flash_color.alpha > 0) {
+		state.bounds = Rect(0, 0, SCREEN_TARGET_WIDTH, SCREEN_TARGET_HEIGHT);
+		state.Add(flash_color);
+	}
+	return true;
+}
+
 void Screen::Draw(Bitmap& dst) {
 	auto flash_color = Main_Data::game_screen->GetFlashColor();
 	if (flash_color.alpha > 0) {
@@ -38,6 +38,8 @@ public:
 
 	void Draw(Bitmap& dst) override;
 
+	bool GetDamageState(DamageState& state) const override;
+
 private:
 	BitmapRef flash;
 };
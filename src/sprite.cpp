@@ -16,6 +16,8 @@
  */
 
 // Headers
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include "sprite.h"
 #include "player.h"
@@ -37,6 +39,60 @@ void Sprite::Draw(Bitmap& dst) {
 	BlitScreen(dst);
 }
 
+bool Sprite::GetDamageState(DamageState& state) const {
+	const int width = GetWidth();
+	const int height = GetHeight();
+	if (width <= 0 || height <= 0 || !bitmap || (opacity_top_effect <= 0 && opacity_bottom_effect <= 0)) {
+		return true;
+	}
+
+	if (angle_effect != 0.0) {
+		// Rotated around (x, y), the sprite stays in the circle through its farthest corner
+		double dx = std::max(std::abs(ox), std::abs(width - ox)) * std::abs(zoom_x_effect);
+		double dy = std::max(std::abs(oy), std::abs(height - oy)) * std::abs(zoom_y_effect);
+		int radius = static_cast<int>(std::ceil(std::sqrt(dx * dx + dy * dy))) + 1;
+		state.bounds = Rect(x - radius, y - radius, radius * 2, radius * 2);
+	} else if (zoom_x_effect != 1.0 || zoom_y_effect != 1.0 || waver_effect_depth != 0) {
+		double x0 = x - ox * zoom_x_effect;
+		double x1 = x + (width - ox) * zoom_x_effect;
+		double y0 = y - oy * zoom_y_effect;
+		double y1 = y + (height - oy) * zoom_y_effect;
+		// Rounding of the scaled position, plus the horizontal offset of the waver effect
+		int margin = 1 + static_cast<int>(std::ceil(2 * std::abs(zoom_x_effect * waver_effect_depth)));
+		int left = static_cast<int>(std::floor(std::min(x0, x1))) - margin;
+		int right = static_cast<int>(std::ceil(std::max(x0, x1))) + margin;
+		int top = static_cast<int>(std::floor(std::min(y0, y1))) - 1;
+		int bottom = static_cast<int>(std::ceil(std::max(y0, y1))) + 1;
+		state.bounds = Rect(left, top, right - left, bottom - top);
+	} else {
+		state.bounds = Rect(x - ox, y - oy, width, height);
+	}
+
+	state.Add(bitmap);
+	state.Add(src_rect);
+	state.Add(src_rect_effect);
+	state.Add(x);
+	state.Add(y);
+	state.Add(ox);
+	state.Add(oy);
+	state.Add(opacity_top_effect);
+	state.Add(opacity_bottom_effect);
+	state.Add(bush_effect);
+	state.Add(tone_effect);
+	state.Add(zoom_x_effect);
+	state.Add(zoom_y_effect);
+	state.Add(angle_effect);
+	state.Add(blend_type_effect);
+	state.Add(waver_effect_depth);
+	if (waver_effect_depth != 0) {
+		state.Add(waver_effect_phase);
+	}
+	state.Add(flash_effect);
+	state.Add(flipx_effect);
+	state.Add(flipy_effect);
+	return true;
+}
+
 void Sprite::BlitScreen(Bitmap& dst) {
 	if (!bitmap || (opacity_top_effect <= 0 && opacity_bottom_effect <= 0))
 		return;
@@ -271,6 +271,11 @@ void Sprite_Actor::OnBattlercharsetReady(FileRequestResult* result, int32_t batt
 	SetSrcRect(Rect((battler->IsDirectionFlipped() ? 96 : 0), battler_index * 48, 48, 48));
 }
 
+bool Sprite_Actor::GetDamageState(DamageState&) const {
+	// Drawn once per afterimage
+	return false;
+}
+
 void Sprite_Actor::Draw(Bitmap& dst) {
 	auto* battler = GetBattler();
 	// "do_not_draw" is set to true if the CBA battler name is empty, this
@@ -90,6 +90,8 @@ public:
 
 	void Draw(Bitmap& dst) override;
 
+	bool GetDamageState(DamageState& state) const override;
+
 	Game_Actor* GetBattler() const;
 
 	void UpdatePosition();
@@ -81,6 +81,11 @@ void Sprite_Enemy::OnMonsterSpriteReady(FileRequestResult* result) {
 	SetBitmap(graphic);
 }
 
+bool Sprite_Enemy::GetDamageState(DamageState&) const {
+	// Blinking, dying and exploding are applied while drawing
+	return false;
+}
+
 void Sprite_Enemy::Draw(Bitmap& dst) {
 
 	auto alpha = 255;
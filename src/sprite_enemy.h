@@ -42,6 +42,8 @@ public:
 
 	void Draw(Bitmap& dst) override;
 
+	bool GetDamageState(DamageState& state) const override;
+
 	Game_Enemy* GetBattler() const;
 
 	void Refresh();
@@ -63,6 +63,13 @@ void Sprite_Picture::OnPictureShow() {
 }
 
 
+bool Sprite_Picture::GetDamageState(DamageState&) const {
+	const auto& pic = Main_Data::game_pictures->GetPicture(pic_id);
+
+	// The picture data is only applied to the sprite while drawing
+	return !GetBitmap() || !(Game_Battle::IsBattleRunning() ? pic.IsOnBattle() : pic.IsOnMap());
+}
+
 void Sprite_Picture::Draw(Bitmap& dst) {
 	const auto& pic = Main_Data::game_pictures->GetPicture(pic_id);
 	const auto& data = pic.data;
@@ -36,6 +36,8 @@ public:
 
 	void Draw(Bitmap& dst) override;
 
+	bool GetDamageState(DamageState& state) const override;
+
 	void OnPictureShow();
 
 private:
@@ -59,6 +59,11 @@ Sprite_Timer::Sprite_Timer(int which) :
 Sprite_Timer::~Sprite_Timer() {
 }
 
+bool Sprite_Timer::GetDamageState(DamageState&) const {
+	// Hidden timers draw nothing, the digits of visible ones are set while drawing
+	return !Main_Data::game_party->GetTimerVisible(which, Game_Battle::IsBattleRunning()) || !Cache::System();
+}
+
 void Sprite_Timer::Draw(Bitmap& dst) {
 	if (!Main_Data::game_party->GetTimerVisible(which, Game_Battle::IsBattleRunning())) {
 		return;
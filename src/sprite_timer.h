@@ -38,6 +38,8 @@ public:
 protected:
 	void Draw(Bitmap& dst) override;
 
+	bool GetDamageState(DamageState& state) const override;
+
 	int which = 0;
 
 	Rect digits[5];
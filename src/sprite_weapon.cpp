@@ -130,6 +130,11 @@ void Sprite_Weapon::OnBattleWeaponReady(FileRequestResult* result, int32_t weapo
 	SetSrcRect(Rect((flip ? 128 : 0), weapon_index * 64, 64, 64));
 }
 
+bool Sprite_Weapon::GetDamageState(DamageState&) const {
+	// Follows the battler while attacking
+	return !attacking;
+}
+
 void Sprite_Weapon::Draw(Bitmap& dst) {
 	if (!attacking) {
 		return;
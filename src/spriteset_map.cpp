@@ -41,6 +41,7 @@ Spriteset_Map::Spriteset_Map() {
 	panorama->SetZ(Priority_Background);
 
 	ChipsetUpdated();
+	PinMapImages();
 
 	need_x_clone = Game_Map::LoopHorizontal();
 	need_y_clone = Game_Map::LoopVertical();
@@ -110,6 +111,19 @@ void Spriteset_Map::Update() {
 	DynRpg::Update();
 }
 
+void Spriteset_Map::PinMapImages() {
+	// Events switch between the charsets of their pages, keep the unused ones for the next switch
+	Cache::UnpinAll();
+	for (Game_Event& ev : Game_Map::GetEvents()) {
+		for (int i = 1; i <= ev.GetNumPages(); ++i) {
+			const auto* page = ev.GetPage(i);
+			if (!page->character_name.empty()) {
+				Cache::Pin("CharSet", ToString(page->character_name));
+			}
+		}
+	}
+}
+
 // Finds the sprite for a specific character
 Sprite_Character* Spriteset_Map::FindCharacter(Game_Character* character) const
 {
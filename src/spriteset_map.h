@@ -87,6 +87,7 @@ protected:
 
 	void CreateSprite(Game_Character* character, bool create_x_clone, bool create_y_clone);
 	void CreateAirshipShadowSprite(bool create_x_clone, bool create_y_clone);
+	void PinMapImages();
 
 	void OnTilemapSpriteReady(FileRequestResult*);
 	void OnPanoramaSpriteReady(FileRequestResult* result);
@@ -16,6 +16,7 @@
  */
 
 // Headers
+#include <algorithm>
 #include <cstring>
 #include <cmath>
 #include "tilemap_layer.h"
@@ -156,14 +157,15 @@ TilemapLayer::TilemapLayer(int ilayer) :
 // was created intentionally. Inlining the transparency check was measured and shown
 // to provide a performance improvement
 EP_ALWAYS_INLINE
-void TilemapLayer::DrawTile(Bitmap& dst, Bitmap& tileset, Bitmap& tone_tileset, int x, int y, int row, int col, uint32_t tone_hash, bool allow_fast_blit) {
+bool TilemapLayer::DrawTile(Bitmap& dst, Bitmap& tileset, Bitmap& tone_tileset, int x, int y, int row, int col, uint32_t tone_hash, bool allow_fast_blit) {
 	auto op = tileset.GetTileOpacity(col, row);
-	if (op != ImageOpacity::Transparent) {
-		DrawTileImpl(dst, tileset, tone_tileset, x, y, row, col, tone_hash, op, allow_fast_blit);
+	if (op == ImageOpacity::Transparent) {
+		return false;
 	}
+	return DrawTileImpl(dst, tileset, tone_tileset, x, y, row, col, tone_hash, op, allow_fast_blit);
 }
 
-void TilemapLayer::DrawTileImpl(Bitmap& dst, Bitmap& tileset, Bitmap& tone_tileset, int x, int y, int row, int col, uint32_t tone_hash, ImageOpacity op, bool allow_fast_blit) {
+bool TilemapLayer::DrawTileImpl(Bitmap& dst, Bitmap& tileset, Bitmap& tone_tileset, int x, int y, int row, int col, uint32_t tone_hash, ImageOpacity op, bool allow_fast_blit) {
 
 	auto rect = Rect{ col * TILE_SIZE, row * TILE_SIZE, TILE_SIZE, TILE_SIZE };
 
@@ -180,9 +182,11 @@ void TilemapLayer::DrawTileImpl(Bitmap& dst, Bitmap& tileset, Bitmap& tone_tiles
 	bool use_fast_blit = fast_blit && allow_fast_blit;
 	if (op == ImageOpacity::Opaque || use_fast_blit) {
 		dst.BlitFast(x, y, *src, rect, 255);
-	} else {
-		dst.Blit(x, y, *src, rect, 255);
+		return true;
 	}
+
+	dst.Blit(x, y, *src, rect, 255);
+	return false;
 }
 
 static uint32_t MakeFTileHash(int id) {
@@ -205,6 +209,21 @@ static uint32_t MakeAbTileHash(int id, int anim_step) {
 	return static_cast<uint32_t>((id + (anim_step << 12)) | (4 << 24));
 }
 
+static int DivRoundingDown(int n, int m) {
+	if (n >= 0) return n / m;
+	return (n - m + 1) / m;
+}
+
+static int Mod(int n, int m) {
+	int rem = n % m;
+	return rem >= 0 ? rem : m + rem;
+}
+
+static int GetFrameCounter() {
+	// FIXME: When Game_Map singleton is made an object we can remove this null check
+	return Main_Data::game_system ? Main_Data::game_system->GetFrameCounter() : 0;
+}
+
 void TilemapLayer::Draw(Bitmap& dst, int z_order) {
 
 
@@ -227,42 +246,32 @@ void TilemapLayer::Draw(Bitmap& dst, int z_order) {
 	const bool loop_h = Game_Map::LoopHorizontal();
 	const bool loop_v = Game_Map::LoopVertical();
 
-	auto div_rounding_down = [](int n, int m) {
-		if (n >= 0) return n / m;
-		return (n - m + 1) / m;
-	};
-	auto mod = [](int n, int m) {
-		int rem = n % m;
-		return rem >= 0 ? rem : m + rem;
-	};
+	const auto frames = GetFrameCounter();
+	int animation_step_c;
+	int animation_step_ab;
+	GetAnimationSteps(frames, animation_step_c, animation_step_ab);
 
-	// FIXME: When Game_Map singleton is made an object we can remove this null check
-	const auto frames = Main_Data::game_system ? Main_Data::game_system->GetFrameCounter() : 0;
-	auto animation_step_c = (frames / 6) % 4;
-	auto animation_step_ab = frames / animation_speed;
-	if (animation_type) {
-		animation_step_ab %= 3;
-	} else {
-		animation_step_ab %= 4;
-		if (animation_step_ab == 3) {
-			animation_step_ab = 1;
-		}
-	}
+	const int div_ox = DivRoundingDown(ox, TILE_SIZE);
+	const int div_oy = DivRoundingDown(oy, TILE_SIZE);
 
-	const int div_ox = div_rounding_down(ox, TILE_SIZE);
-	const int div_oy = div_rounding_down(oy, TILE_SIZE);
+	const int mod_ox = Mod(ox, TILE_SIZE);
+	const int mod_oy = Mod(oy, TILE_SIZE);
 
-	const int mod_ox = mod(ox, TILE_SIZE);
-	const int mod_oy = mod(oy, TILE_SIZE);
+	if (frames - chunks_invalidated_frame >= CHUNK_SETTLE_FRAMES || frames < chunks_invalidated_frame) {
+		DrawChunks(dst, z_order, frames, div_ox, div_oy, mod_ox, mod_oy, tiles_x, tiles_y, animation_step_c, animation_step_ab);
+		return;
+	}
 
+	// The chunks were just invalidated and may be again in the next frame (e.g. tone changes),
+	// draw tile by tile until the tilemap settles
 	for (int y = 0; y < tiles_y; y++) {
 		for (int x = 0; x < tiles_x; x++) {
 
 			// Get the real maps tile coordinates
 			int map_x = div_ox + x;
 			int map_y = div_oy + y;
-			if (loop_h) map_x = mod(map_x, width);
-			if (loop_v) map_y = mod(map_y, height);
+			if (loop_h) map_x = Mod(map_x, width);
+			if (loop_v) map_y = Mod(map_y, height);
 
 			int map_draw_x = x * TILE_SIZE - mod_ox;
 			int map_draw_y = y * TILE_SIZE - mod_oy;
@@ -280,88 +289,289 @@ void TilemapLayer::Draw(Bitmap& dst, int z_order) {
 
 			// Draw the sublayer if its z is being draw now
 			if (z_order == tile.z) {
-				if (layer == 0) {
-					// If lower layer
-					bool allow_fast_blit = (tile.z == Priority_TilesetBelow);
-
-					if (tile.ID >= BLOCK_E && tile.ID < BLOCK_E + BLOCK_E_TILES) {
-						int id = substitutions[tile.ID - BLOCK_E];
-						// If Block E
-
-						int row, col;
-
-						// Get the tile coordinates from chipset
-						if (id < 96) {
-							// If from first column of the block
-							col = 12 + id % 6;
-							row = id / 6;
-						} else {
-							// If from second column of the block
-							col = 18 + (id - 96) % 6;
-							row = (id - 96) / 6;
-						}
-
-						auto tone_hash = MakeETileHash(id);
-						DrawTile(dst, *chipset, *chipset_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					} else if (tile.ID >= BLOCK_C && tile.ID < BLOCK_D) {
-						// If Block C
-
-						// Get the tile coordinates from chipset
-						int col = 3 + (tile.ID - BLOCK_C) / 50;
-						int row = 4 + animation_step_c;
-
-						auto tone_hash = MakeCTileHash(tile.ID, animation_step_c);
-						DrawTile(dst, *chipset, *chipset_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					} else if (tile.ID < BLOCK_C) {
-						// If Blocks A1, A2, B
-
-						// Draw the tile from autotile cache
-						TileXY pos = GetCachedAutotileAB(tile.ID, animation_step_ab);
-
-						int col = pos.x;
-						int row = pos.y;
-
-						// Create tone changed tile
-						auto tone_hash = MakeAbTileHash(tile.ID,  animation_step_ab);
-						DrawTile(dst, *autotiles_ab_screen, *autotiles_ab_screen_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					} else {
-						// If blocks D1-D12
-
-						// Draw the tile from autotile cache
-						TileXY pos = GetCachedAutotileD(tile.ID);
-
-						int col = pos.x;
-						int row = pos.y;
-
-						auto tone_hash = MakeDTileHash(tile.ID);
-						DrawTile(dst, *autotiles_d_screen, *autotiles_d_screen_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					}
+				DrawTileData(dst, tile, map_draw_x, map_draw_y, animation_step_c, animation_step_ab);
+			}
+		}
+	}
+}
+
+bool TilemapLayer::DrawTileData(Bitmap& dst, const TileData& tile, int x, int y, int animation_step_c, int animation_step_ab) {
+	if (layer == 0) {
+		// If lower layer
+		bool allow_fast_blit = (tile.z == Priority_TilesetBelow);
+
+		if (tile.ID >= BLOCK_E && tile.ID < BLOCK_E + BLOCK_E_TILES) {
+			int id = substitutions[tile.ID - BLOCK_E];
+			// If Block E
+
+			int row, col;
+
+			// Get the tile coordinates from chipset
+			if (id < 96) {
+				// If from first column of the block
+				col = 12 + id % 6;
+				row = id / 6;
+			} else {
+				// If from second column of the block
+				col = 18 + (id - 96) % 6;
+				row = (id - 96) / 6;
+			}
+
+			auto tone_hash = MakeETileHash(id);
+			return DrawTile(dst, *chipset, *chipset_effect, x, y, row, col, tone_hash, allow_fast_blit);
+		} else if (tile.ID >= BLOCK_C && tile.ID < BLOCK_D) {
+			// If Block C
+
+			// Get the tile coordinates from chipset
+			int col = 3 + (tile.ID - BLOCK_C) / 50;
+			int row = 4 + animation_step_c;
+
+			auto tone_hash = MakeCTileHash(tile.ID, animation_step_c);
+			return DrawTile(dst, *chipset, *chipset_effect, x, y, row, col, tone_hash, allow_fast_blit);
+		} else if (tile.ID < BLOCK_C) {
+			// If Blocks A1, A2, B
+
+			// Draw the tile from autotile cache
+			TileXY pos = GetCachedAutotileAB(tile.ID, animation_step_ab);
+
+			int col = pos.x;
+			int row = pos.y;
+
+			// Create tone changed tile
+			auto tone_hash = MakeAbTileHash(tile.ID,  animation_step_ab);
+			return DrawTile(dst, *autotiles_ab_screen, *autotiles_ab_screen_effect, x, y, row, col, tone_hash, allow_fast_blit);
+		} else {
+			// If blocks D1-D12
+
+			// Draw the tile from autotile cache
+			TileXY pos = GetCachedAutotileD(tile.ID);
+
+			int col = pos.x;
+			int row = pos.y;
+
+			auto tone_hash = MakeDTileHash(tile.ID);
+			return DrawTile(dst, *autotiles_d_screen, *autotiles_d_screen_effect, x, y, row, col, tone_hash, allow_fast_blit);
+		}
+	} else {
+		// If upper layer
+
+		// Check that block F is being drawn
+		if (tile.ID >= BLOCK_F && tile.ID < BLOCK_F + BLOCK_F_TILES) {
+			int id = substitutions[tile.ID - BLOCK_F];
+			int row, col;
+
+			// Get the tile coordinates from chipset
+			if (id < 48) {
+				// If from first column of the block
+				col = 18 + id % 6;
+				row = 8 + id / 6;
+			} else {
+				// If from second column of the block
+				col = 24 + (id - 48) % 6;
+				row = (id - 48) / 6;
+			}
+
+			auto tone_hash = MakeFTileHash(id);
+			return DrawTile(dst, *chipset, *chipset_effect, x, y, row, col, tone_hash);
+		}
+	}
+
+	return false;
+}
+
+void TilemapLayer::GetAnimationSteps(int frames, int& animation_step_c, int& animation_step_ab) const {
+	animation_step_c = (frames / 6) % 4;
+	animation_step_ab = frames / animation_speed;
+	if (animation_type) {
+		animation_step_ab %= 3;
+	} else {
+		animation_step_ab %= 4;
+		if (animation_step_ab == 3) {
+			animation_step_ab = 1;
+		}
+	}
+}
+
+void TilemapLayer::GetDamageState(Drawable::DamageState& state) const {
+	// The tiles of the last column and row are only partly on the screen
+	state.bounds = Rect(0, 0, SCREEN_TARGET_WIDTH + TILE_SIZE, SCREEN_TARGET_HEIGHT + TILE_SIZE);
+	state.Add(chipset);
+	state.Add(chunks_generation);
+	state.Add(ox);
+	state.Add(oy);
+
+	if (layer == 0) {
+		int animation_step_c;
+		int animation_step_ab;
+		GetAnimationSteps(GetFrameCounter(), animation_step_c, animation_step_ab);
+		state.Add(animation_step_c);
+		state.Add(animation_step_ab);
+	}
+}
+
+bool TilemapLayer::IsAnimatedTile(const TileData& tile) const {
+	// Blocks A, B and C of the lower layer
+	return layer == 0 && tile.ID < BLOCK_D;
+}
+
+void TilemapLayer::DrawChunks(Bitmap& dst, int z_order, int frames, int div_ox, int div_oy, int mod_ox, int mod_oy,
+		int tiles_x, int tiles_y, int animation_step_c, int animation_step_ab) {
+	if (width <= 0 || height <= 0) {
+		return;
+	}
+
+	const bool loop_h = Game_Map::LoopHorizontal();
+	const bool loop_v = Game_Map::LoopVertical();
+	const int sublayer = (z_order == lower_layer.GetZ()) ? 0 : 1;
+
+	// Visible tiles in map coordinates, not wrapped yet
+	int first_x = div_ox;
+	int last_x = div_ox + tiles_x - 1;
+	int first_y = div_oy;
+	int last_y = div_oy + tiles_y - 1;
+	if (!loop_h) {
+		first_x = std::max(first_x, 0);
+		last_x = std::min(last_x, width - 1);
+	}
+	if (!loop_v) {
+		first_y = std::max(first_y, 0);
+		last_y = std::min(last_y, height - 1);
+	}
+
+	// Walk the visible area in runs that stay inside one chunk and don't cross the map edge
+	for (int y = first_y; y <= last_y;) {
+		int map_y = loop_v ? Mod(y, height) : y;
+		int cy = map_y / CHUNK_TILES;
+		int cell_y = map_y % CHUNK_TILES;
+		int rows = std::min({ CHUNK_TILES - cell_y, height - map_y, last_y - y + 1 });
+		int draw_y = (y - div_oy) * TILE_SIZE - mod_oy;
+
+		for (int x = first_x; x <= last_x;) {
+			int map_x = loop_h ? Mod(x, width) : x;
+			int cx = map_x / CHUNK_TILES;
+			int cell_x = map_x % CHUNK_TILES;
+			int cols = std::min({ CHUNK_TILES - cell_x, width - map_x, last_x - x + 1 });
+			int draw_x = (x - div_ox) * TILE_SIZE - mod_ox;
+
+			Chunk& chunk = GetChunk(sublayer, cx, cy, z_order, frames);
+			if (!chunk.empty) {
+				Rect rect(cell_x * TILE_SIZE, cell_y * TILE_SIZE, cols * TILE_SIZE, rows * TILE_SIZE);
+				if (chunk.solid) {
+					dst.BlitFast(draw_x, draw_y, *chunk.bitmap, rect, 255);
 				} else {
-					// If upper layer
-
-					// Check that block F is being drawn
-					if (tile.ID >= BLOCK_F && tile.ID < BLOCK_F + BLOCK_F_TILES) {
-						int id = substitutions[tile.ID - BLOCK_F];
-						int row, col;
-
-						// Get the tile coordinates from chipset
-						if (id < 48) {
-							// If from first column of the block
-							col = 18 + id % 6;
-							row = 8 + id / 6;
-						} else {
-							// If from second column of the block
-							col = 24 + (id - 48) % 6;
-							row = (id - 48) / 6;
-						}
-
-						auto tone_hash = MakeFTileHash(id);
-						DrawTile(dst, *chipset, *chipset_effect, map_draw_x, map_draw_y, row, col, tone_hash);
-					}
+					dst.Blit(draw_x, draw_y, *chunk.bitmap, rect, 255);
 				}
 			}
+
+			for (uint16_t cell : chunk.animated) {
+				int ax = cell % CHUNK_TILES - cell_x;
+				int ay = cell / CHUNK_TILES - cell_y;
+				if (ax < 0 || ax >= cols || ay < 0 || ay >= rows) {
+					continue;
+				}
+				const TileData& tile = GetDataCache(map_x + ax, map_y + ay);
+				DrawTileData(dst, tile, draw_x + ax * TILE_SIZE, draw_y + ay * TILE_SIZE, animation_step_c, animation_step_ab);
+			}
+
+			x += cols;
 		}
+		y += rows;
+	}
+
+	EvictChunks(sublayer, frames);
+}
+
+TilemapLayer::Chunk& TilemapLayer::GetChunk(int sublayer, int cx, int cy, int z_order, int frames) {
+	const int chunks_x = (width + CHUNK_TILES - 1) / CHUNK_TILES;
+	auto& layer_chunks = chunks[sublayer];
+
+	auto it = layer_chunks.find(cx + cy * chunks_x);
+	if (it == layer_chunks.end()) {
+		it = layer_chunks.emplace(cx + cy * chunks_x, Chunk()).first;
+		RenderChunk(it->second, cx, cy, z_order);
 	}
+	it->second.last_used = frames;
+	return it->second;
+}
+
+bool TilemapLayer::IsChunkSolid(int z_order, int cx, int cy) {
+	const int sublayer = (z_order == lower_layer.GetZ()) ? 0 : 1;
+	return GetChunk(sublayer, cx, cy, z_order, GetFrameCounter()).solid;
+}
+
+void TilemapLayer::RenderChunk(Chunk& chunk, int cx, int cy, int z_order) {
+	const int x0 = cx * CHUNK_TILES;
+	const int y0 = cy * CHUNK_TILES;
+	const int cols = std::min(CHUNK_TILES, width - x0);
+	const int rows = std::min(CHUNK_TILES, height - y0);
+
+	// Cells outside of the map stay empty
+	chunk.solid = cols == CHUNK_TILES && rows == CHUNK_TILES;
+
+	for (int y = 0; y < rows; ++y) {
+		for (int x = 0; x < cols; ++x) {
+			const TileData& tile = GetDataCache(x0 + x, y0 + y);
+			if (tile.z != z_order) {
+				chunk.solid = false;
+				continue;
+			}
+			if (IsAnimatedTile(tile)) {
+				chunk.animated.push_back(static_cast<uint16_t>(x + y * CHUNK_TILES));
+				chunk.solid = false;
+				continue;
+			}
+
+			if (!chunk.bitmap) {
+				if (!chunk_pool.empty()) {
+					chunk.bitmap = std::move(chunk_pool.back());
+					chunk_pool.pop_back();
+				} else {
+					chunk.bitmap = Bitmap::Create(CHUNK_TILES * TILE_SIZE, CHUNK_TILES * TILE_SIZE);
+				}
+				chunk.bitmap->Clear();
+			}
+
+			// Static tiles look the same in every animation step
+			bool covered = DrawTileData(*chunk.bitmap, tile, x * TILE_SIZE, y * TILE_SIZE, 0, 0);
+			chunk.solid = chunk.solid && covered;
+			chunk.empty = false;
+		}
+	}
+}
+
+void TilemapLayer::EvictChunks(int sublayer, int frames) {
+	auto& layer_chunks = chunks[sublayer];
+
+	// Drop the chunks that weren't visible for the longest time
+	while (static_cast<int>(layer_chunks.size()) > MAX_CHUNKS) {
+		auto oldest = std::min_element(layer_chunks.begin(), layer_chunks.end(), [](const auto& a, const auto& b) {
+			return a.second.last_used < b.second.last_used;
+		});
+		if (oldest->second.last_used == frames) {
+			// All of them are on the screen
+			break;
+		}
+		ReleaseChunkBitmap(std::move(oldest->second.bitmap));
+		layer_chunks.erase(oldest);
+	}
+}
+
+void TilemapLayer::ReleaseChunkBitmap(BitmapRef bitmap) {
+	// Enough to render a whole sublayer again, the rest is freed
+	if (bitmap && static_cast<int>(chunk_pool.size()) < MAX_CHUNKS) {
+		chunk_pool.push_back(std::move(bitmap));
+	}
+}
+
+void TilemapLayer::InvalidateChunks() {
+	for (auto& layer_chunks : chunks) {
+		for (auto& chunk : layer_chunks) {
+			ReleaseChunkBitmap(std::move(chunk.second.bitmap));
+		}
+		layer_chunks.clear();
+	}
+	chunks_invalidated_frame = GetFrameCounter();
+	++chunks_generation;
 }
 
 TilemapLayer::TileXY TilemapLayer::GetCachedAutotileAB(short ID, short animID) {
@@ -610,6 +820,7 @@ BitmapRef TilemapLayer::GenerateAutotiles(int count, const std::unordered_map<ui
 }
 
 void TilemapLayer::SetChipset(BitmapRef const& nchipset) {
+	InvalidateChunks();
 	chipset = nchipset;
 	chipset_effect = Bitmap::Create(chipset->width(), chipset->height());
 	chipset_tone_tiles.clear();
@@ -624,6 +835,8 @@ void TilemapLayer::SetChipset(BitmapRef const& nchipset) {
 }
 
 void TilemapLayer::SetMapData(std::vector<short> nmap_data) {
+	InvalidateChunks();
+
 	// Create the tiles data cache
 	CreateTileCache(nmap_data);
 	memset(autotiles_ab, 0, sizeof(autotiles_ab));
@@ -667,11 +880,13 @@ void TilemapLayer::SetPassable(std::vector<unsigned char> npassable) {
 
 	// Recalculate z values of all tiles
 	CreateTileCache(map_data);
+	InvalidateChunks();
 }
 
 void TilemapLayer::OnSubstitute() {
 	// Recalculate z values of all tiles
 	CreateTileCache(map_data);
+	InvalidateChunks();
 }
 
 TilemapSubLayer::TilemapSubLayer(TilemapLayer* tilemap, int z) :
@@ -681,6 +896,13 @@ TilemapSubLayer::TilemapSubLayer(TilemapLayer* tilemap, int z) :
 	DrawableMgr::Register(this);
 }
 
+bool TilemapSubLayer::GetDamageState(DamageState& state) const {
+	if (tilemap->GetChipset()) {
+		tilemap->GetDamageState(state);
+	}
+	return true;
+}
+
 void TilemapSubLayer::Draw(Bitmap& dst) {
 	if (!tilemap->GetChipset()) {
 		return;
@@ -695,6 +917,7 @@ void TilemapLayer::SetTone(Tone tone) {
 	}
 
 	this->tone = tone;
+	InvalidateChunks();
 
 	if (autotiles_d_screen_effect) {
 		autotiles_d_screen_effect->Clear();
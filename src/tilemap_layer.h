@@ -40,6 +40,8 @@ public:
 
 	void Draw(Bitmap& dst) override;
 
+	bool GetDamageState(DamageState& state) const override;
+
 private:
 	TilemapLayer* tilemap = nullptr;
 };
@@ -53,6 +55,13 @@ public:
 
 	void Draw(Bitmap& dst, int z_order);
 
+	/**
+	 * Fills the damage state shared by both sub layers.
+	 *
+	 * @param state damage state of a sub layer
+	 */
+	void GetDamageState(Drawable::DamageState& state) const;
+
 	BitmapRef const& GetChipset() const;
 	void SetChipset(BitmapRef const& nchipset);
 	const std::vector<short>& GetMapData() const;
@@ -85,6 +94,17 @@ public:
 
 	void SetTone(Tone tone);
 
+	/**
+	 * Whether a chunk covers all of its cells and is blitted without alpha.
+	 * The chunk is rendered when it is not cached yet.
+	 *
+	 * @param z_order z of the sublayer
+	 * @param cx chunk x index
+	 * @param cy chunk y index
+	 * @return chunk is solid
+	 */
+	bool IsChunkSolid(int z_order, int cx, int cy);
+
 private:
 	BitmapRef chipset;
 	BitmapRef chipset_effect;
@@ -104,8 +124,8 @@ private:
 	void CreateTileCache(const std::vector<short>& nmap_data);
 	void GenerateAutotileAB(short ID, short animID);
 	void GenerateAutotileD(short ID);
-	void DrawTile(Bitmap& dst, Bitmap& tile, Bitmap& tone_tile, int x, int y, int row, int col, uint32_t tone_hash, bool allow_fast_blit = true);
-	void DrawTileImpl(Bitmap& dst, Bitmap& tile, Bitmap& tone_tile, int x, int y, int row, int col, uint32_t tone_hash, ImageOpacity op, bool allow_fast_blit);
+	bool DrawTile(Bitmap& dst, Bitmap& tile, Bitmap& tone_tile, int x, int y, int row, int col, uint32_t tone_hash, bool allow_fast_blit = true);
+	bool DrawTileImpl(Bitmap& dst, Bitmap& tile, Bitmap& tone_tile, int x, int y, int row, int col, uint32_t tone_hash, ImageOpacity op, bool allow_fast_blit);
 
 	static const int TILES_PER_ROW = 64;
 
@@ -144,6 +164,57 @@ private:
 
 	std::vector<TileData> data_cache_vec;
 
+	/**
+	 * Draws a single tile of the map data.
+	 *
+	 * @return whether the tile covers the whole cell (drawn without alpha)
+	 */
+	bool DrawTileData(Bitmap& dst, const TileData& tile, int x, int y, int animation_step_c, int animation_step_ab);
+
+	/** Whether the graphic of the tile changes with the animation step */
+	bool IsAnimatedTile(const TileData& tile) const;
+
+	void GetAnimationSteps(int frames, int& animation_step_c, int& animation_step_ab) const;
+
+	/** Width and height of a pre-rendered chunk in tiles */
+	static constexpr int CHUNK_TILES = 16;
+	/** Chunks kept per sublayer, enough for the screen and the tiles scrolled in next */
+	static constexpr int MAX_CHUNKS = 12;
+	/** Frames to draw tile by tile after the chunks were invalidated (e.g. during a tone change) */
+	static constexpr int CHUNK_SETTLE_FRAMES = 2;
+
+	/**
+	 * Static tiles of a CHUNK_TILES x CHUNK_TILES area of one sublayer rendered into one bitmap.
+	 * Animated tiles are left out and drawn every frame over the chunk.
+	 */
+	struct Chunk {
+		BitmapRef bitmap;
+		/** Cells (x + y * CHUNK_TILES) of the animated tiles */
+		std::vector<uint16_t> animated;
+		int last_used = 0;
+		/** No static tile, bitmap is not allocated */
+		bool empty = true;
+		/** Every cell is covered, the chunk can be blitted without alpha */
+		bool solid = false;
+	};
+
+	void DrawChunks(Bitmap& dst, int z_order, int frames, int div_ox, int div_oy, int mod_ox, int mod_oy,
+			int tiles_x, int tiles_y, int animation_step_c, int animation_step_ab);
+	Chunk& GetChunk(int sublayer, int cx, int cy, int z_order, int frames);
+	void RenderChunk(Chunk& chunk, int cx, int cy, int z_order);
+	void EvictChunks(int sublayer, int frames);
+	/** Keeps the bitmap of a dropped chunk for reuse while the pool has room */
+	void ReleaseChunkBitmap(BitmapRef bitmap);
+	void InvalidateChunks();
+
+	/** Chunks of the lower and the upper sublayer by chunk index */
+	std::unordered_map<int, Chunk> chunks[2];
+	/** Bitmaps of dropped chunks for reuse, at most MAX_CHUNKS */
+	std::vector<BitmapRef> chunk_pool;
+	int chunks_invalidated_frame = 0;
+	/** Increased whenever the chunks are invalidated, the tiles look different then */
+	uint32_t chunks_generation = 0;
+
 	TilemapSubLayer lower_layer;
 	TilemapSubLayer upper_layer;
 
@@ -194,6 +265,7 @@ inline int TilemapLayer::GetWidth() const {
 
 inline void TilemapLayer::SetWidth(int nwidth) {
 	width = nwidth;
+	InvalidateChunks();
 }
 
 inline int TilemapLayer::GetHeight() const {
@@ -202,6 +274,7 @@ inline int TilemapLayer::GetHeight() const {
 
 inline void TilemapLayer::SetHeight(int nheight) {
 	height = nheight;
+	InvalidateChunks();
 }
 
 inline int TilemapLayer::GetAnimationSpeed() const {
@@ -221,7 +294,10 @@ inline void TilemapLayer::SetAnimationType(int type) {
 }
 
 inline void TilemapLayer::SetFastBlit(bool fast) {
-	fast_blit = fast;
+	if (fast != fast_blit) {
+		fast_blit = fast;
+		InvalidateChunks();
+	}
 }
 
 inline TilemapLayer::TileData& TilemapLayer::GetDataCache(int x, int y) {
@@ -184,6 +184,11 @@ void Transition::SetAttributesTransitions() {
 	}
 }
 
+bool Transition::GetDamageState(DamageState&) const {
+	// Graphics::Draw redraws the whole screen anyway while the screen is transitioning or erased
+	return !IsActive() && !IsErasedNotActive();
+}
+
 void Transition::Draw(Bitmap& dst) {
 	if (!IsActive())
 		return;
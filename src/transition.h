@@ -107,6 +107,7 @@ public:
 	void PrependFlashes(int r, int g, int b, int power, int duration, int iterations);
 
 	void Draw(Bitmap& dst) override;
+	bool GetDamageState(DamageState& state) const override;
 	void Update();
 
 	bool IsActive() const;
@@ -41,6 +41,11 @@ Weather::Weather() :
 void Weather::Update() {
 }
 
+bool Weather::GetDamageState(DamageState&) const {
+	// The particles move every frame
+	return Main_Data::game_screen->GetWeatherType() == Game_Screen::Weather_None;
+}
+
 void Weather::Draw(Bitmap& dst) {
 	SetTone(Main_Data::game_screen->GetTone());
 
@@ -33,6 +33,7 @@ public:
 	Weather();
 
 	void Draw(Bitmap& dst) override;
+	bool GetDamageState(DamageState& state) const override;
 	void Update();
 
 	Tone GetTone() const;
@@ -58,6 +58,38 @@ void Window::SetCloseAnimation(int frames) {
 	}
 }
 
+bool Window::GetDamageState(DamageState& state) const {
+	if (width <= 0 || height <= 0) {
+		return true;
+	}
+
+	// The rotated left and right arrows can reach outside of small windows
+	state.bounds = Rect(x - 16, y - 16, width + 32, height + 32);
+
+	state.Add(windowskin);
+	state.Add(contents);
+	state.Add(stretch);
+	state.Add(cursor_rect);
+	state.Add(up_arrow);
+	state.Add(down_arrow);
+	state.Add(left_arrow);
+	state.Add(right_arrow);
+	state.Add(state.bounds);
+	state.Add(ox);
+	state.Add(oy);
+	state.Add(border_x);
+	state.Add(border_y);
+	state.Add(opacity);
+	state.Add(back_opacity);
+	state.Add(contents_opacity);
+	state.Add(pause);
+	state.Add(pause_frame);
+	state.Add(cursor_frame <= 10);
+	state.Add(animation_frames);
+	state.Add(animation_count);
+	return true;
+}
+
 void Window::Draw(Bitmap& dst) {
 	if (!IsVisible()) return;
 	if (width <= 0 || height <= 0) return;
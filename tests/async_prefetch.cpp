@@ -0,0 +1,73 @@
+#include "async_prefetch.h"
+#include "doctest.h"
+#include <lcf/data.h>
+#include <lcf/rpg/map.h>
+
+TEST_SUITE_BEGIN("AsyncPrefetch");
+
+namespace {
+	using Cmd = lcf::rpg::EventCommand::Code;
+
+	lcf::rpg::EventCommand MakeCommand(Cmd code, const char* string) {
+		lcf::rpg::EventCommand com;
+		com.code = static_cast<int>(code);
+		com.string = lcf::DBString(string);
+		return com;
+	}
+
+	std::vector<std::string> Paths(const std::vector<AsyncPrefetch::File>& files) {
+		std::vector<std::string> paths;
+		for (auto& file : files) {
+			paths.push_back(file.folder + "/" + file.name);
+		}
+		return paths;
+	}
+}
+
+TEST_CASE("CollectMapFiles") {
+	lcf::Data::chipsets.resize(1);
+	lcf::Data::chipsets[0].ID = 1;
+	lcf::Data::chipsets[0].chipset_name = lcf::DBString("Tiles");
+
+	// Map 2 inherits the BGM of map 1
+	lcf::Data::treemap = {};
+	lcf::Data::treemap.maps.resize(3);
+	lcf::Data::treemap.maps[1].ID = 1;
+	lcf::Data::treemap.maps[1].music_type = 2;
+	lcf::Data::treemap.maps[1].music.name = "Theme";
+	lcf::Data::treemap.maps[2].ID = 2;
+	lcf::Data::treemap.maps[2].parent_map = 1;
+	lcf::Data::treemap.maps[2].music_type = 0;
+
+	lcf::rpg::Map map;
+	map.chipset_id = 1;
+	map.parallax_flag = true;
+	map.parallax_name = lcf::DBString("Sky");
+	map.events.resize(2);
+	map.events[0].pages.resize(2);
+	map.events[0].pages[0].character_name = lcf::DBString("Hero");
+	map.events[0].pages[1].character_name = lcf::DBString("Hero");
+	map.events[0].pages[1].event_commands.push_back(MakeCommand(Cmd::ShowPicture, "Door"));
+	map.events[0].pages[1].event_commands.push_back(MakeCommand(Cmd::PlayBGM, "(OFF)"));
+	map.events[1].pages.resize(1);
+	map.events[1].pages[0].event_commands.push_back(MakeCommand(Cmd::PlayBGM, "Battle"));
+	map.events[1].pages[0].event_commands.push_back(MakeCommand(Cmd::ShowPicture, ""));
+
+	auto paths = Paths(AsyncPrefetch::CollectMapFiles(2, map));
+	std::vector<std::string> expected = {
+		"ChipSet/Tiles", "Panorama/Sky", "Music/Theme", "CharSet/Hero", "Picture/Door", "Music/Battle"
+	};
+	CHECK(paths == expected);
+
+	// The panorama is only used when enabled
+	map.parallax_flag = false;
+	lcf::Data::treemap.maps[1].music_type = 1;
+	paths = Paths(AsyncPrefetch::CollectMapFiles(2, map));
+	expected = { "ChipSet/Tiles", "CharSet/Hero", "Picture/Door", "Music/Battle" };
+	CHECK(paths == expected);
+
+	lcf::Data::chipsets.clear();
+	lcf::Data::treemap = {};
+}
+
+TEST_SUITE_END();
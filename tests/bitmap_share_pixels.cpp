@@ -0,0 +1,85 @@
+#include "bitmap.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("BitmapSharePixels");
+
+namespace {
+	const Color red(255, 0, 0, 255);
+	const Color blue(0, 0, 255, 255);
+
+	uint32_t FirstPixel(const Bitmap& bmp) {
+		return *static_cast<const uint32_t*>(bmp.pixels());
+	}
+}
+
+TEST_CASE("Share") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	auto a = Bitmap::Create(16, 16, red);
+	auto b = Bitmap::Create(16, 16, red);
+
+	REQUIRE(b->SharePixels(*a));
+	REQUIRE_EQ(a->pixels(), b->pixels());
+	REQUIRE(a->IsSharingPixels());
+	REQUIRE(b->IsSharingPixels());
+
+	// the pixels stay valid without the bitmap they came from
+	const uint32_t pixel = FirstPixel(*a);
+	a.reset();
+	REQUIRE_FALSE(b->IsSharingPixels());
+	REQUIRE_EQ(FirstPixel(*b), pixel);
+}
+
+TEST_CASE("CopyOnWrite") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	auto a = Bitmap::Create(16, 16, red);
+	auto b = Bitmap::Create(16, 16, red);
+	auto c = Bitmap::Create(16, 16, red);
+	REQUIRE(b->SharePixels(*a));
+	REQUIRE(c->SharePixels(*b));
+	const uint32_t pixel = FirstPixel(*a);
+
+	b->Fill(blue);
+	REQUIRE_NE(a->pixels(), b->pixels());
+	REQUIRE_NE(FirstPixel(*b), pixel);
+	REQUIRE_EQ(FirstPixel(*a), pixel);
+	REQUIRE_EQ(a->pixels(), c->pixels());
+
+	a->Fill(blue);
+	REQUIRE_NE(a->pixels(), c->pixels());
+	REQUIRE_EQ(FirstPixel(*c), pixel);
+	REQUIRE_FALSE(a->IsSharingPixels());
+	REQUIRE_FALSE(c->IsSharingPixels());
+}
+
+TEST_CASE("PixelsOwner") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	auto a = Bitmap::Create(16, 16, red);
+	auto b = Bitmap::Create(16, 16, red);
+	auto owner = a->GetPixelsOwner();
+	std::owner_less<std::weak_ptr<pixman_image_t>> less;
+
+	REQUIRE(b->SharePixels(*a));
+	auto shared = b->GetPixelsOwner();
+	REQUIRE_FALSE(less(owner, shared));
+	REQUIRE_FALSE(less(shared, owner));
+
+	// a written bitmap gets a new owner, the old one is never handed out again
+	b->Fill(blue);
+	auto written = b->GetPixelsOwner();
+	REQUIRE((less(owner, written) || less(written, owner)));
+
+	a.reset();
+	REQUIRE(b->GetPixelsOwner().lock());
+}
+
+TEST_CASE("Incompatible") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	auto a = Bitmap::Create(16, 16, red);
+	auto b = Bitmap::Create(16, 8, red);
+
+	REQUIRE_FALSE(b->SharePixels(*a));
+	REQUIRE_FALSE(a->IsSharingPixels());
+	REQUIRE_NE(a->pixels(), b->pixels());
+}
+
+TEST_SUITE_END();
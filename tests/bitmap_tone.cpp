@@ -0,0 +1,95 @@
+#include "bitmap_tone.h"
+#include <random>
+#include <vector>
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("BitmapTone");
+
+namespace {
+	struct Shifts {
+		int rs, gs, bs, as;
+	};
+
+	// RGBA, BGRA, ARGB and ABGR as stored in a little endian word
+	constexpr Shifts shifts[] = {
+		{ 0, 8, 16, 24 },
+		{ 16, 8, 0, 24 },
+		{ 8, 16, 24, 0 },
+		{ 24, 16, 8, 0 },
+	};
+
+	void RequireSameAsScalar(const Tone& tone, bool check_alpha, const std::vector<uint32_t>& input) {
+		for (auto& s : shifts) {
+			auto params = BitmapTone::MakeParams(tone, check_alpha, s.rs, s.gs, s.bs, s.as);
+
+			auto expected = input;
+			BitmapTone::ApplyScalar(expected.data(), expected.size(), params);
+			auto actual = input;
+			BitmapTone::Apply(actual.data(), actual.size(), params);
+
+			REQUIRE_EQ(expected, actual);
+		}
+	}
+
+	std::vector<uint32_t> RandomPixels(int count) {
+		std::mt19937 rng(1234);
+		std::vector<uint32_t> pixels(count);
+		for (auto& p : pixels) {
+			p = rng();
+			// plenty of transparent pixels for check_alpha
+			if (rng() % 4 == 0) {
+				p &= 0x00FFFFFF;
+				p &= (rng() % 2) ? 0xFFFFFF00 : 0xFFFFFFFF;
+			}
+		}
+		return pixels;
+	}
+}
+
+TEST_CASE("AllChannelValues") {
+	// every byte value on every channel position, an odd count leaves a tail for the scalar code
+	std::vector<uint32_t> pixels;
+	for (uint32_t v = 0; v < 256; ++v) {
+		pixels.push_back(v * 0x01010101u);
+		pixels.push_back(v | ((255 - v) << 8) | ((v * 7 & 0xFF) << 16) | (0xFFu << 24));
+		pixels.push_back((v << 8) | ((v * 13 & 0xFF) << 16) | ((255 - v) << 24) | 0x80);
+	}
+	pixels.push_back(0x12345678);
+
+	for (int gray : { 0, 1, 64, 127, 128, 129, 200, 255 }) {
+		for (int color : { 0, 1, 100, 127, 128, 129, 200, 254, 255 }) {
+			RequireSameAsScalar(Tone(color, 255 - color, color, gray), false, pixels);
+			RequireSameAsScalar(Tone(color, color, 128, gray), true, pixels);
+		}
+	}
+}
+
+TEST_CASE("RandomTones") {
+	auto pixels = RandomPixels(1021);
+	std::mt19937 rng(42);
+	for (int i = 0; i < 200; ++i) {
+		Tone tone(rng() % 256, rng() % 256, rng() % 256, rng() % 256);
+		RequireSameAsScalar(tone, i % 2 == 0, pixels);
+	}
+}
+
+TEST_CASE("ShortRows") {
+	auto pixels = RandomPixels(16);
+	for (int n = 0; n < 16; ++n) {
+		std::vector<uint32_t> row(pixels.begin(), pixels.begin() + n);
+		RequireSameAsScalar(Tone(255, 0, 128, 64), true, row);
+	}
+}
+
+TEST_CASE("NeutralToneKeepsPixels") {
+	auto pixels = RandomPixels(100);
+	auto params = BitmapTone::MakeParams(Tone(), false, 0, 8, 16, 24);
+	REQUIRE_FALSE(params.saturation);
+	REQUIRE_FALSE(params.color);
+
+	auto actual = pixels;
+	BitmapTone::Apply(actual.data(), actual.size(), params);
+	REQUIRE_EQ(actual, pixels);
+}
+
+TEST_SUITE_END();
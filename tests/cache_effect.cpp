@@ -0,0 +1,64 @@
+#include "cache.h"
+#include "bitmap.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("CacheEffect");
+
+namespace {
+	const Tone dark(64, 64, 64, 128);
+	const Tone darker(32, 32, 32, 128);
+}
+
+TEST_CASE("Shared") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	Cache::Clear();
+	auto src = Bitmap::Create(32, 32, true);
+	const auto stats = Cache::GetEffectStats();
+
+	auto a = Cache::SpriteEffect(src, src->GetRect(), false, false, dark, Color());
+	auto b = Cache::SpriteEffect(src, src->GetRect(), false, false, dark, Color());
+	REQUIRE_EQ(a, b);
+	REQUIRE_EQ(Cache::GetEffectStats().misses, stats.misses + 1);
+	REQUIRE_EQ(Cache::GetEffectStats().hits, stats.hits + 1);
+	REQUIRE_EQ(Cache::GetEffectStats().entries, 1);
+	REQUIRE_EQ(Cache::GetEffectStats().bytes, a->GetSize());
+
+	auto c = Cache::SpriteEffect(src, src->GetRect(), true, false, dark, Color());
+	REQUIRE_NE(a, c);
+	REQUIRE_EQ(Cache::GetEffectStats().entries, 2);
+}
+
+TEST_CASE("ReuseUnused") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	Cache::Clear();
+	auto src = Bitmap::Create(32, 32, true);
+	const auto stats = Cache::GetEffectStats();
+
+	auto a = Cache::SpriteEffect(src, src->GetRect(), false, false, dark, Color());
+	const Bitmap* old = a.get();
+
+	// a sprite drops its effect bitmap before asking for the next tone
+	a.reset();
+	auto b = Cache::SpriteEffect(src, src->GetRect(), false, false, darker, Color());
+	REQUIRE_EQ(b.get(), old);
+	REQUIRE_EQ(Cache::GetEffectStats().reused, stats.reused + 1);
+	REQUIRE_EQ(Cache::GetEffectStats().entries, 1);
+
+	// still in use, a new bitmap is needed
+	auto c = Cache::SpriteEffect(src, src->GetRect(), false, false, dark, Color());
+	REQUIRE_NE(c, b);
+	REQUIRE_EQ(Cache::GetEffectStats().reused, stats.reused + 1);
+}
+
+TEST_CASE("SourceChanged") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	Cache::Clear();
+	auto src = Bitmap::Create(32, 32, true);
+
+	auto a = Cache::SpriteEffect(src, src->GetRect(), false, false, dark, Color());
+	src->Fill(Color(255, 0, 0, 255));
+	auto b = Cache::SpriteEffect(src, src->GetRect(), false, false, dark, Color());
+	REQUIRE_NE(a, b);
+}
+
+TEST_SUITE_END();
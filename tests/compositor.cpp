@@ -0,0 +1,180 @@
+#include "compositor.h"
+#include "drawable_list.h"
+#include "drawable_mgr.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("Compositor");
+
+namespace {
+
+class TestDrawable : public Drawable {
+	public:
+		TestDrawable(Rect bounds) : Drawable(0, Drawable::Flags::Global), bounds(bounds) {}
+		void Draw(Bitmap&) override {}
+		bool GetDamageState(DamageState& state) const override {
+			if (!tracked) {
+				return false;
+			}
+			state.bounds = bounds;
+			state.Add(value);
+			return true;
+		}
+
+		Rect bounds;
+		int value = 0;
+		bool tracked = true;
+};
+
+const Rect screen(0, 0, 320, 240);
+
+}
+
+TEST_CASE("MergeRects") {
+	std::vector<Rect> rects = {
+		Rect(0, 0, 10, 10),
+		Rect(100, 100, 10, 10),
+		Rect(5, 5, 10, 10),
+		Rect(-20, -20, 10, 10),
+		Rect(310, 230, 20, 20)
+	};
+	Compositor::MergeRects(rects, screen);
+
+	REQUIRE_EQ(rects.size(), 3);
+	REQUIRE_EQ(rects[0], Rect(0, 0, 15, 15));
+	REQUIRE_EQ(rects[1], Rect(100, 100, 10, 10));
+	REQUIRE_EQ(rects[2], Rect(310, 230, 10, 10));
+}
+
+TEST_CASE("MergeRectsChain") {
+	// the union of the first two overlaps the third one
+	std::vector<Rect> rects = {
+		Rect(0, 0, 10, 10),
+		Rect(20, 20, 10, 10),
+		Rect(5, 0, 20, 25)
+	};
+	Compositor::MergeRects(rects, screen);
+
+	REQUIRE_EQ(rects.size(), 1);
+	REQUIRE_EQ(rects[0], Rect(0, 0, 30, 30));
+}
+
+TEST_CASE("MergeRectsCollapse") {
+	std::vector<Rect> rects;
+	for (size_t i = 0; i <= Compositor::max_rects; ++i) {
+		rects.push_back(Rect(i * 10, 0, 5, 5));
+	}
+	Compositor::MergeRects(rects, screen);
+
+	REQUIRE_EQ(rects.size(), 1);
+	REQUIRE_EQ(rects[0], Rect(0, 0, Compositor::max_rects * 10 + 5, 5));
+}
+
+TEST_CASE("Disabled") {
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+	TestDrawable d(Rect(0, 0, 10, 10));
+	list.Append(&d);
+
+	Compositor compositor;
+	REQUIRE_FALSE(compositor.Collect(list, screen, 0));
+	REQUIRE_FALSE(compositor.Collect(list, screen, 0));
+	REQUIRE_EQ(compositor.GetRepaintedPixels(), 320 * 240);
+}
+
+TEST_CASE("Damage") {
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+	TestDrawable d1(Rect(0, 0, 10, 10));
+	TestDrawable d2(Rect(100, 100, 20, 20));
+	list.Append(&d1);
+	list.Append(&d2);
+
+	Compositor compositor;
+	compositor.SetEnabled(true);
+
+	// the first frame is always full
+	REQUIRE_FALSE(compositor.Collect(list, screen, 0));
+
+	REQUIRE(compositor.Collect(list, screen, 0));
+	REQUIRE(compositor.GetDamage().empty());
+	REQUIRE_EQ(compositor.GetRepaintedPixels(), 0);
+
+	SUBCASE("changed") {
+		d2.value = 1;
+		REQUIRE(compositor.Collect(list, screen, 0));
+		REQUIRE_EQ(compositor.GetDamage(), std::vector<Rect>{ Rect(100, 100, 20, 20) });
+		REQUIRE_EQ(compositor.GetRepaintedPixels(), 400);
+	}
+
+	SUBCASE("moved") {
+		d1.bounds = Rect(50, 0, 10, 10);
+		REQUIRE(compositor.Collect(list, screen, 0));
+		REQUIRE_EQ(compositor.GetDamage(), std::vector<Rect>{ Rect(0, 0, 10, 10), Rect(50, 0, 10, 10) });
+	}
+
+	SUBCASE("hidden") {
+		d1.SetVisible(false);
+		REQUIRE(compositor.Collect(list, screen, 0));
+		REQUIRE_EQ(compositor.GetDamage(), std::vector<Rect>{ Rect(0, 0, 10, 10) });
+
+		d1.SetVisible(true);
+		REQUIRE(compositor.Collect(list, screen, 0));
+		REQUIRE_EQ(compositor.GetDamage(), std::vector<Rect>{ Rect(0, 0, 10, 10) });
+	}
+
+	SUBCASE("z") {
+		d1.SetZ(1);
+		REQUIRE(compositor.Collect(list, screen, 0));
+		REQUIRE_EQ(compositor.GetDamage(), std::vector<Rect>{ Rect(0, 0, 10, 10) });
+	}
+
+	SUBCASE("frame key") {
+		REQUIRE_FALSE(compositor.Collect(list, screen, 1));
+		REQUIRE(compositor.Collect(list, screen, 1));
+	}
+
+	SUBCASE("untracked") {
+		d1.tracked = false;
+		REQUIRE_FALSE(compositor.Collect(list, screen, 0));
+		REQUIRE_FALSE(compositor.Collect(list, screen, 0));
+
+		d1.tracked = true;
+		REQUIRE_FALSE(compositor.Collect(list, screen, 0));
+		REQUIRE(compositor.Collect(list, screen, 0));
+	}
+
+	SUBCASE("large area") {
+		d2.bounds = Rect(0, 0, 320, 200);
+		REQUIRE_FALSE(compositor.Collect(list, screen, 0));
+		REQUIRE(compositor.Collect(list, screen, 0));
+	}
+
+	SUBCASE("invalidate") {
+		compositor.Invalidate();
+		REQUIRE_FALSE(compositor.Collect(list, screen, 0));
+		REQUIRE(compositor.Collect(list, screen, 0));
+	}
+}
+
+TEST_CASE("Removed") {
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+	TestDrawable d1(Rect(0, 0, 10, 10));
+	list.Append(&d1);
+
+	Compositor compositor;
+	compositor.SetEnabled(true);
+	REQUIRE_FALSE(compositor.Collect(list, screen, 0));
+
+	{
+		TestDrawable d2(Rect(20, 20, 10, 10));
+		list.Append(&d2);
+		REQUIRE(compositor.Collect(list, screen, 0));
+		REQUIRE_EQ(compositor.GetDamage(), std::vector<Rect>{ Rect(20, 20, 10, 10) });
+	}
+
+	REQUIRE(compositor.Collect(list, screen, 0));
+	REQUIRE_EQ(compositor.GetDamage(), std::vector<Rect>{ Rect(20, 20, 10, 10) });
+}
+
+TEST_SUITE_END();
@@ -88,4 +88,31 @@ TEST_CASE("FindFile") {
 	Player::escape_symbol = "";
 }
 
+TEST_CASE("AddFileToCache") {
+	// Only the cache is modified, the files do not exist
+	auto fs = FileFinder::Root().Subtree(EP_TEST_PATH "/game");
+	auto charset = fs.ListDirectory("Charset");
+	REQUIRE(charset->size() == 1);
+	REQUIRE(fs.ListDirectory()->size() == 4);
+
+	fs.AddFileToCache("Charset/New.png");
+	CHECK(charset->size() == 2);
+	CHECK(charset->find("new.png")->second.name == "New.png");
+	CHECK(std::get<1>(FileFinder::GetPathAndFilename(fs.FindFile("charset/new.PNG"))) == "New.png");
+
+	// listed directories stay cached
+	CHECK(fs.ListDirectory("Charset") == charset);
+
+	// a new directory is added to the parent
+	fs.AddFileToCache("Music/song.ogg");
+	auto root = fs.ListDirectory();
+	CHECK(root->size() == 5);
+	CHECK(root->find("music")->second.type == DirectoryTree::FileType::Directory);
+
+	fs.Subtree("Charset").ClearCache();
+	fs.ClearCache();
+	CHECK(fs.ListDirectory("Charset")->size() == 1);
+	CHECK(fs.ListDirectory()->size() == 4);
+}
+
 TEST_SUITE_END();
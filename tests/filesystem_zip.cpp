@@ -3,9 +3,11 @@
 #include "main_data.h"
 #include "doctest.h"
 #include "player.h"
+#include <fmt/core.h>
 
 #define ZIP_PATH EP_TEST_PATH "/filesystem/test.zip"
 #define ZIP_FOLDER_PATH EP_TEST_PATH "/filesystem/folder.zip"
+#define ZIP_STREAM_PATH EP_TEST_PATH "/filesystem/stream.zip"
 
 TEST_SUITE_BEGIN("Filesystem ZIP");
 
@@ -59,6 +61,60 @@ TEST_CASE("File reading") {
 	CHECK(line_out == "lo");
 }
 
+// "big" has 70000 lines with the numbers 0 to 4095 repeating, too big to be inflated at once
+TEST_CASE("Streamed file reading") {
+	auto fs = FileFinder::Root().Create(ZIP_STREAM_PATH);
+	CHECK(fs.GetFilesize("big") == 350000);
+
+	auto is = fs.OpenInputStream("big");
+	CHECK(is);
+
+	std::string line_out;
+	int lines = 0;
+	while (Utils::ReadLine(is, line_out)) {
+		if (lines < 70000 && line_out != fmt::format("{:04d}", lines % 4096)) {
+			break;
+		}
+		++lines;
+	}
+	CHECK(lines == 70000);
+
+	is.clear();
+	is.seekg(5 * 60000, std::ios_base::beg);
+	CHECK(is.tellg() == 5 * 60000);
+	CHECK(Utils::ReadLine(is, line_out));
+	CHECK(line_out == fmt::format("{:04d}", 60000 % 4096));
+
+	// backwards inflates again from the start
+	is.seekg(5 * 100 + 2, std::ios_base::beg);
+	CHECK(Utils::ReadLine(is, line_out));
+	CHECK(line_out == "00");
+
+	is.seekg(-5, std::ios_base::end);
+	CHECK(Utils::ReadLine(is, line_out));
+	CHECK(line_out == fmt::format("{:04d}", 69999 % 4096));
+	CHECK(!Utils::ReadLine(is, line_out));
+}
+
+TEST_CASE("Stored file in memory") {
+	auto fs = FileFinder::Root().Create(ZIP_PATH);
+	auto is = fs.OpenInputStream("text");
+	REQUIRE(is);
+
+	auto memory = is.GetMemory();
+#if defined(__linux__) || defined(__APPLE__)
+	// the archive is mapped, the stored file is read without copying
+	REQUIRE(memory.size() == 16);
+	CHECK(std::string(reinterpret_cast<const char*>(memory.data()), 5) == "hello");
+#endif
+
+	std::string line_out;
+	CHECK(Utils::ReadLine(is, line_out));
+	CHECK(line_out == "hello");
+
+	CHECK(fs.OpenInputStream("1kb").GetMemory().empty());
+}
+
 TEST_CASE("File IO error") {
 	auto fs = FileFinder::Root().Create(ZIP_PATH);
 	CHECK(!fs.OpenInputStream("game"));
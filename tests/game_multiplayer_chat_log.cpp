@@ -0,0 +1,107 @@
+#include "game_multiplayer_chat_log.h"
+#include <random>
+#include <string>
+#include "doctest.h"
+
+using namespace Game_Multiplayer;
+
+TEST_SUITE_BEGIN("Game_Multiplayer_ChatLog");
+
+namespace {
+	ChatLayout MakeLayout(const std::u32string& text) {
+		ChatLayout layout;
+		for (char32_t ch : text) {
+			ChatGlyph glyph;
+			glyph.ch = ch;
+			glyph.width = ch == '\n' ? 0 : (ch < 0x80 ? 4 : 8);
+			glyph.height = ch < 0x80 ? 6 : 8;
+			layout.glyphs.push_back(glyph);
+		}
+		return layout;
+	}
+
+	std::vector<std::u32string> Lines(const ChatLayout& layout) {
+		std::vector<std::u32string> lines;
+		for (size_t l = 0; l < layout.lines.size(); ++l) {
+			std::u32string line;
+			for (size_t i = layout.lines[l].first; i < layout.LineEnd(l); ++i) {
+				line += layout.glyphs[i].ch;
+			}
+			lines.push_back(line);
+		}
+		return lines;
+	}
+}
+
+TEST_CASE("SingleLine") {
+	auto layout = MakeLayout(U"hello");
+	layout.Wrap(100);
+	REQUIRE_EQ(Lines(layout), std::vector<std::u32string>{ U"hello" });
+	REQUIRE_EQ(layout.width, 21);
+	REQUIRE_EQ(layout.height, 7);
+}
+
+TEST_CASE("Empty") {
+	ChatLayout layout;
+	layout.Wrap(100);
+	REQUIRE_EQ(layout.lines.size(), 1);
+	REQUIRE_EQ(layout.width, 1);
+	REQUIRE_EQ(layout.height, 1);
+}
+
+TEST_CASE("WordWrap") {
+	// 10 glyphs per line
+	auto layout = MakeLayout(U"aaa bbb ccc ddd");
+	layout.Wrap(40);
+	REQUIRE_EQ(Lines(layout), std::vector<std::u32string>{ U"aaa bbb ", U"ccc ddd" });
+	REQUIRE_EQ(layout.lines[1].y, 6);
+	REQUIRE_EQ(layout.height, 13);
+}
+
+TEST_CASE("LongWordIsSplit") {
+	auto layout = MakeLayout(U"abcdefghijklmnopqrstuvwxy");
+	layout.Wrap(40);
+	REQUIRE_EQ(Lines(layout), std::vector<std::u32string>{ U"abcdefghij", U"klmnopqrst", U"uvwxy" });
+	REQUIRE_EQ(layout.width, 41);
+}
+
+TEST_CASE("LineBreak") {
+	auto layout = MakeLayout(U"ab\ncd\n\nef");
+	layout.Wrap(100);
+	REQUIRE_EQ(Lines(layout), std::vector<std::u32string>{ U"ab\n", U"cd\n", U"\n", U"ef" });
+}
+
+TEST_CASE("LineHeight") {
+	auto layout = MakeLayout(U"ab下 cd");
+	layout.Wrap(20);
+	REQUIRE_EQ(Lines(layout), std::vector<std::u32string>{ U"ab下 ", U"cd" });
+	REQUIRE_EQ(layout.lines[1].y, 8);
+	REQUIRE_EQ(layout.height, 15);
+}
+
+TEST_CASE("HistoryDropsOldest") {
+	ChatHistory history(3);
+	REQUIRE_EQ(history.Size(), 0);
+
+	for (int i = 0; i < 3; ++i) {
+		ChatLayout layout;
+		layout.height = i;
+		history.Push(1, layout);
+	}
+	REQUIRE(history.Full());
+	REQUIRE_EQ(history.FromNewest(0).layout.height, 2);
+	REQUIRE_EQ(history.Oldest().layout.height, 0);
+
+	for (int i = 3; i < 8; ++i) {
+		ChatLayout layout;
+		layout.height = i;
+		auto& msg = history.Push(2, layout);
+		REQUIRE_EQ(msg.id, i);
+		REQUIRE_EQ(history.Size(), 3);
+		REQUIRE_EQ(history.FromNewest(0).layout.height, i);
+		REQUIRE_EQ(history.FromNewest(1).layout.height, i - 1);
+		REQUIRE_EQ(history.Oldest().layout.height, i - 2);
+	}
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,54 @@
+#include "game_multiplayer_interest.h"
+#include "doctest.h"
+
+using namespace Game_Multiplayer;
+
+TEST_SUITE_BEGIN("Game_Multiplayer_Interest");
+
+TEST_CASE("ScreenAndMargin") {
+	InterestArea area;
+	// screen shows tiles 10..29 x 5..19
+	area.SetView(10 * 256, 5 * 256, 20, 15, 100, 100, false, false);
+
+	REQUIRE(area.Contains(10, 5, false));
+	REQUIRE(area.Contains(29, 19, false));
+	REQUIRE(area.Contains(8, 5, false));
+	REQUIRE_FALSE(area.Contains(7, 5, false));
+	REQUIRE_FALSE(area.Contains(32, 5, false));
+	REQUIRE_FALSE(area.Contains(20, 50, true));
+}
+
+TEST_CASE("Hysteresis") {
+	InterestArea area;
+	area.SetView(0, 0, 20, 15, 100, 100, false, false);
+
+	// entering needs to be closer than leaving
+	REQUIRE_FALSE(area.Contains(23, 0, false));
+	REQUIRE(area.Contains(23, 0, true));
+	REQUIRE(area.Contains(24, 0, true));
+	REQUIRE_FALSE(area.Contains(25, 0, true));
+}
+
+TEST_CASE("PartialScroll") {
+	InterestArea area;
+	area.SetView(10 * 256 + 128, 0, 20, 15, 100, 100, false, false);
+	// tile 30 is half visible
+	REQUIRE(area.Contains(30, 0, false));
+	REQUIRE(area.Contains(32, 0, false));
+	REQUIRE_FALSE(area.Contains(33, 0, false));
+}
+
+TEST_CASE("Wraparound") {
+	InterestArea area;
+	// screen shows tiles 35..39 and 0..14 of a looping 40 wide map
+	area.SetView(35 * 256, 0, 20, 15, 40, 30, true, false);
+
+	REQUIRE(area.Contains(0, 0, false));
+	REQUIRE(area.Contains(14, 0, false));
+	REQUIRE(area.Contains(16, 0, false));
+	REQUIRE_FALSE(area.Contains(17, 0, false));
+	REQUIRE(area.Contains(33, 0, false));
+	REQUIRE_FALSE(area.Contains(32, 0, false));
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,93 @@
+#include "game_multiplayer_movement.h"
+#include "doctest.h"
+
+using namespace Game_Multiplayer;
+using ms = std::chrono::milliseconds;
+
+namespace {
+MovementBuffer::time_point At(int millis) {
+	return MovementBuffer::time_point() + std::chrono::duration_cast<MovementBuffer::duration>(ms(millis));
+}
+}
+
+TEST_SUITE_BEGIN("Game_Multiplayer_Movement");
+
+TEST_CASE("PlayoutDelay") {
+	MovementBuffer buf;
+	buf.Push(1, 2, At(1000));
+
+	int x, y;
+	REQUIRE_FALSE(buf.Pop(At(1000), x, y));
+	REQUIRE(buf.Pop(At(1000) + MovementBuffer::min_delay, x, y));
+	REQUIRE_EQ(x, 1);
+	REQUIRE_EQ(y, 2);
+	REQUIRE(buf.Empty());
+}
+
+TEST_CASE("PathKeepsOrder") {
+	MovementBuffer buf;
+	for (int i = 0; i < 4; ++i) {
+		buf.Push(i, 0, At(0));
+	}
+
+	int x, y;
+	for (int i = 0; i < 4; ++i) {
+		REQUIRE(buf.Pop(At(1000), x, y));
+		REQUIRE_EQ(x, i);
+	}
+	REQUIRE_FALSE(buf.Pop(At(1000), x, y));
+}
+
+TEST_CASE("AdaptiveDelay") {
+	MovementBuffer steady;
+	for (int i = 0; i < 100; ++i) {
+		steady.Push(i, 0, At(i * 100));
+		int x, y;
+		while (steady.Pop(At(i * 100 + 1000), x, y)) {}
+	}
+	REQUIRE_EQ(steady.GetPlayoutDelay(), MovementBuffer::min_delay);
+
+	// same average rate, delivered in bursts
+	MovementBuffer bursty;
+	for (int i = 0; i < 100; ++i) {
+		bursty.Push(i, 0, At((i / 5) * 500 + (i % 5)));
+		int x, y;
+		while (bursty.Pop(At(i * 100 + 1000), x, y)) {}
+	}
+	REQUIRE_GT(bursty.GetPlayoutDelay(), steady.GetPlayoutDelay());
+	REQUIRE_LE(bursty.GetPlayoutDelay(), MovementBuffer::max_delay);
+}
+
+TEST_CASE("Bounded") {
+	MovementBuffer buf;
+	for (int i = 0; i < MovementBuffer::capacity + 5; ++i) {
+		buf.Push(i, 0, At(0));
+	}
+	REQUIRE_EQ(buf.Size(), MovementBuffer::capacity);
+	REQUIRE_EQ(buf.GetDropped(), 5);
+
+	int x, y;
+	REQUIRE(buf.Pop(At(1000), x, y));
+	REQUIRE_EQ(x, 5);
+}
+
+TEST_CASE("CatchUpSpeed") {
+	MovementBuffer buf;
+	REQUIRE_EQ(buf.SuggestMoveSpeed(4, At(1000)), 4);
+
+	buf.Push(0, 0, At(0));
+	REQUIRE_EQ(buf.SuggestMoveSpeed(4, At(1000)), 4);
+
+	buf.Push(1, 0, At(0));
+	REQUIRE_EQ(buf.SuggestMoveSpeed(4, At(1000)), 5);
+	// not due yet, no backlog
+	REQUIRE_EQ(buf.SuggestMoveSpeed(4, At(0)), 4);
+
+	for (int i = 0; i < 10; ++i) {
+		buf.Push(i, 1, At(0));
+	}
+	REQUIRE_EQ(buf.SuggestMoveSpeed(4, At(1000)), 6);
+	REQUIRE_EQ(buf.SuggestMoveSpeed(1, At(1000)), 4);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,125 @@
+#include "game_multiplayer_nametag_atlas.h"
+#include "pixel_format.h"
+#include "bitmap.h"
+#include "doctest.h"
+
+using namespace Game_Multiplayer;
+
+TEST_SUITE_BEGIN("Game_Multiplayer_NameTagAtlas");
+
+namespace {
+	int renders = 0;
+
+	NameTagAtlas::Id Acquire(NameTagAtlas& atlas, const std::string& key, int width = 40, int height = 13) {
+		return atlas.Acquire(key, width, height, [](Bitmap& dst, int x, int y) {
+			++renders;
+			dst.FillRect(Rect(x, y, 1, 1), Color(255, 255, 255, 255));
+		});
+	}
+
+	bool Overlaps(const Rect& a, const Rect& b) {
+		return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+	}
+}
+
+TEST_CASE("SharedEntries") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	NameTagAtlas atlas;
+	renders = 0;
+
+	auto a = Acquire(atlas, "alice");
+	auto b = Acquire(atlas, "alice");
+	auto c = Acquire(atlas, "bob");
+	REQUIRE_EQ(a, b);
+	REQUIRE_NE(a, c);
+	REQUIRE_EQ(renders, 2);
+	REQUIRE_EQ(atlas.Size(), 2);
+	REQUIRE_EQ(atlas.PageCount(), 1);
+	REQUIRE_FALSE(Overlaps(atlas.GetRect(a), atlas.GetRect(c)));
+	REQUIRE_EQ(atlas.GetRect(a).width, 40);
+	REQUIRE_EQ(atlas.GetRect(a).height, 13);
+}
+
+TEST_CASE("ReleasedEntriesStayCached") {
+	NameTagAtlas atlas;
+	renders = 0;
+
+	auto a = Acquire(atlas, "alice");
+	atlas.Release(a);
+	REQUIRE_EQ(Acquire(atlas, "alice"), a);
+	REQUIRE_EQ(renders, 1);
+	REQUIRE_EQ(atlas.GetEvicted(), 0);
+}
+
+TEST_CASE("LeastRecentlyReleasedIsEvicted") {
+	NameTagAtlas atlas;
+
+	// 4 tags per shelf and 19 shelves fill the page
+	const int width = NameTagAtlas::page_width / 4;
+	const int per_page = 4 * (NameTagAtlas::page_height / 13);
+	std::vector<NameTagAtlas::Id> ids;
+	for (int i = 0; i < per_page; ++i) {
+		ids.push_back(Acquire(atlas, std::to_string(i), width));
+	}
+	REQUIRE_EQ(atlas.PageCount(), 1);
+
+	atlas.Release(ids[5]);
+	atlas.Release(ids[7]);
+
+	renders = 0;
+	auto n = Acquire(atlas, "new", width);
+	REQUIRE_EQ(renders, 1);
+	REQUIRE_EQ(atlas.PageCount(), 1);
+	REQUIRE_EQ(atlas.GetEvicted(), 1);
+	// 5 was released first
+	REQUIRE_EQ(atlas.GetRect(n), Rect(width, 13, width, 13));
+
+	renders = 0;
+	REQUIRE_EQ(Acquire(atlas, "7", width), ids[7]);
+	REQUIRE_EQ(renders, 0);
+}
+
+TEST_CASE("ReferencedEntriesGrowPages") {
+	NameTagAtlas atlas;
+
+	const int per_page = NameTagAtlas::page_height / 13;
+	for (int i = 0; i < per_page + 1; ++i) {
+		Acquire(atlas, std::to_string(i), NameTagAtlas::page_width);
+	}
+	REQUIRE_EQ(atlas.PageCount(), 2);
+	REQUIRE_EQ(atlas.GetEvicted(), 0);
+}
+
+TEST_CASE("FreedSpansMerge") {
+	NameTagAtlas atlas;
+
+	const int width = NameTagAtlas::page_width / 4;
+	std::vector<NameTagAtlas::Id> ids;
+	for (int i = 0; i < 4; ++i) {
+		ids.push_back(Acquire(atlas, std::to_string(i), width));
+	}
+	for (auto id : ids) {
+		atlas.Release(id);
+	}
+	// fill the rest of the page so the wide tag needs the freed spans
+	const int shelves = NameTagAtlas::page_height / 13;
+	for (int i = 1; i < shelves; ++i) {
+		Acquire(atlas, "full" + std::to_string(i), NameTagAtlas::page_width);
+	}
+
+	auto wide = Acquire(atlas, "wide", NameTagAtlas::page_width);
+	REQUIRE_EQ(atlas.PageCount(), 1);
+	REQUIRE_EQ(atlas.GetRect(wide), Rect(0, 0, NameTagAtlas::page_width, 13));
+	REQUIRE_EQ(atlas.GetEvicted(), 4);
+}
+
+TEST_CASE("SizesAreClamped") {
+	NameTagAtlas atlas;
+
+	auto id = Acquire(atlas, "empty", 0, 13);
+	REQUIRE_EQ(atlas.GetRect(id).width, 1);
+	id = Acquire(atlas, "long", 1000, 13);
+	REQUIRE_EQ(atlas.GetRect(id).width, NameTagAtlas::page_width);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,113 @@
+#include "game_multiplayer_player_grid.h"
+#include "doctest.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace Game_Multiplayer;
+
+namespace {
+struct Pos {
+	int x;
+	int y;
+};
+
+int BruteNearest(const PlayerGrid& grid, const std::vector<Pos>& players, int x, int y) {
+	int best = -1;
+	for (auto& p : players) {
+		int d = grid.Distance(x, y, p.x, p.y);
+		if (best < 0 || d < best) {
+			best = d;
+		}
+	}
+	return best;
+}
+
+void CheckRandom(int w, int h, bool loop_h, bool loop_v) {
+	std::mt19937 rng(w * 31 + h + loop_h * 7 + loop_v * 13);
+	PlayerGrid grid;
+	grid.Reset(w, h, loop_h, loop_v);
+
+	std::vector<Pos> players;
+	for (uint32_t i = 0; i < 40; ++i) {
+		players.push_back({ int(rng() % w), int(rng() % h) });
+		grid.Insert(i, players.back().x, players.back().y);
+	}
+	// move some players around, including across cells
+	for (uint32_t i = 0; i < 40; i += 3) {
+		players[i] = { int(rng() % w), int(rng() % h) };
+		grid.Move(i, players[i].x, players[i].y);
+	}
+	REQUIRE_EQ(grid.Size(), 40);
+
+	for (int q = 0; q < 200; ++q) {
+		int x = rng() % w;
+		int y = rng() % h;
+		int ox, oy, od;
+		REQUIRE(grid.FindNearest(x, y, ox, oy, od));
+		REQUIRE_EQ(od, BruteNearest(grid, players, x, y));
+		REQUIRE_EQ(grid.Distance(x, y, ox, oy), od);
+
+		int radius = rng() % 12;
+		size_t expected = std::count_if(players.begin(), players.end(), [&](const Pos& p) {
+			return grid.Distance(x, y, p.x, p.y) <= radius;
+		});
+		size_t found = 0;
+		grid.ForEachInRadius(x, y, radius, [&](uint32_t, int, int) { ++found; });
+		REQUIRE_EQ(found, expected);
+	}
+}
+}
+
+TEST_SUITE_BEGIN("Game_Multiplayer_PlayerGrid");
+
+TEST_CASE("Empty") {
+	PlayerGrid grid;
+	grid.Reset(20, 15, false, false);
+	int x, y, d;
+	REQUIRE_FALSE(grid.FindNearest(0, 0, x, y, d));
+}
+
+TEST_CASE("InsertRemove") {
+	PlayerGrid grid;
+	grid.Reset(20, 15, false, false);
+	grid.Insert(3, 1, 1);
+	grid.Insert(5, 18, 13);
+	REQUIRE(grid.Contains(3));
+	REQUIRE_FALSE(grid.Contains(4));
+
+	int x, y, d;
+	REQUIRE(grid.FindNearest(17, 12, x, y, d));
+	REQUIRE_EQ(x, 18);
+	REQUIRE_EQ(y, 13);
+	REQUIRE_EQ(d, 2);
+
+	grid.Remove(5);
+	REQUIRE_EQ(grid.Size(), 1);
+	REQUIRE(grid.FindNearest(17, 12, x, y, d));
+	REQUIRE_EQ(x, 1);
+	REQUIRE_EQ(y, 1);
+}
+
+TEST_CASE("Wraparound") {
+	PlayerGrid grid;
+	grid.Reset(40, 30, true, true);
+	grid.Insert(0, 39, 29);
+	grid.Insert(1, 20, 15);
+
+	int x, y, d;
+	REQUIRE(grid.FindNearest(0, 0, x, y, d));
+	REQUIRE_EQ(x, 39);
+	REQUIRE_EQ(y, 29);
+	REQUIRE_EQ(d, 2);
+}
+
+TEST_CASE("MatchesLinearScan") {
+	CheckRandom(20, 15, false, false);
+	CheckRandom(40, 30, true, false);
+	CheckRandom(25, 17, true, true);
+	CheckRandom(100, 100, false, true);
+	CheckRandom(9, 9, true, true);
+}
+
+TEST_SUITE_END();
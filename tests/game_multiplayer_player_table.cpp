@@ -0,0 +1,75 @@
+#include "game_multiplayer_player_table.h"
+#include "doctest.h"
+
+using namespace Game_Multiplayer;
+
+TEST_SUITE_BEGIN("Game_Multiplayer_PlayerTable");
+
+TEST_CASE("InsertFind") {
+	PlayerTable<int> table;
+	REQUIRE(table.empty());
+	REQUIRE_FALSE(table.Find("a").IsValid());
+
+	auto a = table.Insert("a");
+	auto b = table.Insert("b");
+	*table.Get(a) = 1;
+	*table.Get(b) = 2;
+
+	REQUIRE_EQ(table.size(), 2);
+	REQUIRE(table.Find("a") == a);
+	REQUIRE(table.Find("b") == b);
+	REQUIRE_EQ(*table.Get(a), 1);
+	REQUIRE_EQ(*table.Get(b), 2);
+	REQUIRE_EQ(table.GetUid(table.DenseIndex(b)), "b");
+	REQUIRE(table.GetHandle(table.DenseIndex(a)) == a);
+}
+
+TEST_CASE("EraseKeepsHandles") {
+	PlayerTable<int> table;
+	auto a = table.Insert("a");
+	auto b = table.Insert("b");
+	auto c = table.Insert("c");
+	*table.Get(a) = 1;
+	*table.Get(b) = 2;
+	*table.Get(c) = 3;
+	table.SetPosition(table.DenseIndex(c), 5, 6);
+
+	REQUIRE(table.Erase(a));
+	REQUIRE_FALSE(table.Erase(a));
+	REQUIRE_EQ(table.size(), 2);
+	REQUIRE_EQ(table.Get(a), nullptr);
+	REQUIRE_FALSE(table.Find("a").IsValid());
+
+	// c was moved into the hole, its handle and position still match
+	REQUIRE_EQ(*table.Get(b), 2);
+	REQUIRE_EQ(*table.Get(c), 3);
+	REQUIRE_EQ(table.GetPosition(table.DenseIndex(c)).x, 5);
+	REQUIRE_EQ(table.GetPosition(table.DenseIndex(c)).y, 6);
+	REQUIRE_EQ(table.GetUid(table.DenseIndex(c)), "c");
+
+	int sum = 0;
+	for (int v : table) {
+		sum += v;
+	}
+	REQUIRE_EQ(sum, 5);
+}
+
+TEST_CASE("SlotReuse") {
+	PlayerTable<int> table;
+	auto a = table.Insert("a");
+	table.Erase(a);
+
+	// the slot is reused but the old handle stays dead
+	auto d = table.Insert("d");
+	REQUIRE_EQ(d.index, a.index);
+	REQUIRE(d != a);
+	REQUIRE_EQ(table.Get(a), nullptr);
+	REQUIRE_NE(table.Get(d), nullptr);
+
+	table.Clear();
+	REQUIRE(table.empty());
+	REQUIRE_EQ(table.Get(d), nullptr);
+	REQUIRE_FALSE(table.Find("d").IsValid());
+}
+
+TEST_SUITE_END();
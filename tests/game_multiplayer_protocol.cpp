@@ -0,0 +1,133 @@
+#include "game_multiplayer_protocol.h"
+#include "doctest.h"
+
+using namespace Game_Multiplayer::Protocol;
+
+TEST_SUITE_BEGIN("Game_Multiplayer_Protocol");
+
+TEST_CASE("Varint") {
+	std::vector<uint8_t> buf;
+	Writer w(buf);
+	w.WriteVarint(0);
+	w.WriteVarint(127);
+	w.WriteVarint(128);
+	w.WriteVarint(0xFFFFFFFF);
+	w.WriteSigned(-1);
+	w.WriteSigned(1);
+	w.WriteSigned(-100000);
+
+	REQUIRE_EQ(buf.size(), 1 + 1 + 2 + 5 + 1 + 1 + 3);
+
+	Reader r(buf.data(), buf.size());
+	uint32_t u;
+	int s;
+	REQUIRE(r.ReadVarint(u));
+	REQUIRE_EQ(u, 0);
+	REQUIRE(r.ReadVarint(u));
+	REQUIRE_EQ(u, 127);
+	REQUIRE(r.ReadVarint(u));
+	REQUIRE_EQ(u, 128);
+	REQUIRE(r.ReadVarint(u));
+	REQUIRE_EQ(u, 0xFFFFFFFF);
+	REQUIRE(r.ReadSigned(s));
+	REQUIRE_EQ(s, -1);
+	REQUIRE(r.ReadSigned(s));
+	REQUIRE_EQ(s, 1);
+	REQUIRE(r.ReadSigned(s));
+	REQUIRE_EQ(s, -100000);
+	REQUIRE(r.AtEnd());
+	REQUIRE(r.Ok());
+
+	REQUIRE_FALSE(r.ReadVarint(u));
+	REQUIRE_FALSE(r.Ok());
+}
+
+TEST_CASE("ObjectSyncRoundTrip") {
+	ObjectSync in;
+	in.AddPosition(10, 20);
+	in.AddPosition(11, 19);
+	in.AddPosition(3, 400);
+	in.Set(Fields::path);
+	in.sprite_sheet = "charset";
+	in.sprite_id = 3;
+	in.Set(Fields::sprite);
+	in.sound_name = "bell";
+	in.sound_volume = 80;
+	in.sound_tempo = 100;
+	in.sound_balance = 50;
+	in.Set(Fields::sound);
+	in.facing = 2;
+	in.Set(Fields::facing);
+	in.flash[0] = 31;
+	in.flash[4] = 12;
+	in.Set(Fields::flash);
+	in.switch_id = 7;
+	in.switch_value = -1;
+	in.Set(Fields::switchsync);
+
+	std::vector<uint8_t> buf;
+	EncodeObjectSync(buf, 42, in);
+	REQUIRE_EQ(buf[0], MessageTypes::objectSync);
+
+	Reader r(buf.data() + 1, buf.size() - 1);
+	ObjectSync out;
+	uint32_t uid;
+	REQUIRE(DecodeObjectSync(r, uid, out));
+
+	REQUIRE_EQ(uid, 42);
+	REQUIRE_EQ(out.fields, in.fields);
+	REQUIRE_EQ(out.path_length, 3);
+	REQUIRE_EQ(out.path[2].x, 3);
+	REQUIRE_EQ(out.path[2].y, 400);
+	REQUIRE_EQ(out.sprite_sheet, "charset");
+	REQUIRE_EQ(out.sprite_id, 3);
+	REQUIRE_EQ(out.sound_name, "bell");
+	REQUIRE_EQ(out.sound_volume, 80);
+	REQUIRE_EQ(out.sound_balance, 50);
+	REQUIRE_EQ(out.facing, 2);
+	REQUIRE_EQ(out.flash[0], 31);
+	REQUIRE_EQ(out.flash[4], 12);
+	REQUIRE_EQ(out.switch_value, -1);
+
+	// Strings point into the frame
+	REQUIRE_GE(out.sprite_sheet.data(), reinterpret_cast<const char*>(buf.data()));
+	REQUIRE_LT(out.sprite_sheet.data(), reinterpret_cast<const char*>(buf.data() + buf.size()));
+}
+
+TEST_CASE("ObjectSyncSkipsUnknownFields") {
+	std::vector<uint8_t> buf;
+	Writer w(buf);
+	w.WriteVarint(1);
+	auto mark = w.BeginField(30);
+	w.WriteString("from the future");
+	w.EndField(mark);
+	mark = w.BeginField(Fields::facing);
+	w.WriteVarint(4);
+	w.WriteVarint(99);
+	w.EndField(mark);
+
+	Reader r(buf.data(), buf.size());
+	ObjectSync out;
+	uint32_t uid;
+	REQUIRE(DecodeObjectSync(r, uid, out));
+	REQUIRE_EQ(out.fields, 1u << Fields::facing);
+	REQUIRE_EQ(out.facing, 4);
+}
+
+TEST_CASE("ObjectSyncTruncated") {
+	ObjectSync in;
+	in.name = "somebody";
+	in.Set(Fields::name);
+
+	std::vector<uint8_t> buf;
+	EncodeObjectSync(buf, 1, in);
+	buf.pop_back();
+
+	Reader r(buf.data() + 1, buf.size() - 1);
+	ObjectSync out;
+	uint32_t uid;
+	REQUIRE_FALSE(DecodeObjectSync(r, uid, out));
+	REQUIRE_FALSE(out.Has(Fields::name));
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,165 @@
+#include "game_multiplayer_send_queue.h"
+#include "game_multiplayer_connection.h"
+#include "game_multiplayer_protocol.h"
+#include "game_multiplayer_senders.h"
+#include "game_multiplayer_transport_loopback.h"
+#include "doctest.h"
+#include <cstring>
+#include <utility>
+#include <vector>
+
+using namespace Game_Multiplayer;
+using Type = Transport::Event::Type;
+
+TEST_SUITE_BEGIN("Game_Multiplayer_SendQueue");
+
+namespace {
+	//packet type and a tag telling the writes of one type apart
+	using Packet = std::pair<uint16_t, uint8_t>;
+
+	void Push(uint16_t type, uint8_t tag) {
+		uint8_t buffer[3];
+		memcpy(buffer, &type, sizeof(type));
+		buffer[2] = tag;
+		SendQueue::Push(buffer, sizeof(buffer));
+	}
+
+	Packet ReadPacket(const uint8_t* data) {
+		uint16_t type;
+		memcpy(&type, data, sizeof(type));
+		return { type, data[2] };
+	}
+
+	//installs a loopback connection as the game socket and collects what arrives on the server side
+	class Server {
+	public:
+		explicit Server(int features) {
+			ConnectionData::transport = Transport::Create("loopback://sendqueue");
+			ConnectionData::transport->Connect("loopback://sendqueue");
+			ConnectionData::protocolFeatures = features;
+			conn = listener.Accept();
+			SendQueue::Clear();
+			SendQueue::ResetStats();
+
+			Transport::Event ev;
+			while (ConnectionData::transport->Poll(ev)) {}
+			while (conn->Poll(ev)) {}
+		}
+
+		~Server() {
+			SendQueue::Clear();
+			ConnectionData::protocolFeatures = 0;
+			ConnectionData::transport.reset();
+		}
+
+		//packets in the order the server received them, batches are unpacked
+		std::vector<Packet> Receive() {
+			std::vector<Packet> packets;
+			Transport::Event ev;
+			while (conn->Poll(ev)) {
+				if (ev.type != Type::Message) {
+					continue;
+				}
+				auto* data = static_cast<const uint8_t*>(ev.data);
+				if (ReadPacket(data).first != PacketTypes::batch) {
+					packets.push_back(ReadPacket(data));
+					continue;
+				}
+				for (size_t i = sizeof(uint16_t); i < ev.size;) {
+					uint16_t len;
+					memcpy(&len, data + i, sizeof(len));
+					packets.push_back(ReadPacket(data + i + sizeof(len)));
+					i += sizeof(len) + len;
+				}
+				++batches;
+			}
+			return packets;
+		}
+
+		int batches = 0;
+
+	private:
+		LoopbackListener listener { "sendqueue" };
+		std::unique_ptr<Transport> conn;
+	};
+}
+
+TEST_CASE("FlushKeepsOrder") {
+	Server server(0);
+	Push(PacketTypes::movement, 1);
+	Push(PacketTypes::sound, 2);
+	Push(PacketTypes::movement, 3);
+	REQUIRE_FALSE(SendQueue::Empty());
+	REQUIRE(server.Receive().empty());
+
+	SendQueue::Flush();
+	REQUIRE(SendQueue::Empty());
+	std::vector<Packet> expected = {
+		{ PacketTypes::movement, 1 }, { PacketTypes::sound, 2 }, { PacketTypes::movement, 3 } };
+	REQUIRE_EQ(server.Receive(), expected);
+	REQUIRE_EQ(SendQueue::GetStats().frames_sent, 3);
+}
+
+TEST_CASE("CoalesceMovesToTail") {
+	Server server(0);
+	Push(PacketTypes::facing, 1);
+	Push(PacketTypes::movement, 2);
+	Push(PacketTypes::facing, 3);
+	Push(PacketTypes::movement, 4);
+	SendQueue::Flush();
+
+	// the facing of the second write must not overtake the movement queued before it
+	std::vector<Packet> expected = {
+		{ PacketTypes::movement, 2 }, { PacketTypes::facing, 3 }, { PacketTypes::movement, 4 } };
+	REQUIRE_EQ(server.Receive(), expected);
+	REQUIRE_EQ(SendQueue::GetStats().packets_queued, 4);
+	REQUIRE_EQ(SendQueue::GetStats().packets_coalesced, 1);
+}
+
+TEST_CASE("CoalescePerType") {
+	Server server(0);
+	Push(PacketTypes::sprite, 1);
+	Push(PacketTypes::facing, 2);
+	Push(PacketTypes::sprite, 3);
+	Push(PacketTypes::sprite, 4);
+	SendQueue::Flush();
+
+	std::vector<Packet> expected = { { PacketTypes::facing, 2 }, { PacketTypes::sprite, 4 } };
+	REQUIRE_EQ(server.Receive(), expected);
+
+	// a new frame starts without slots
+	Push(PacketTypes::sprite, 5);
+	SendQueue::Flush();
+	expected = { { PacketTypes::sprite, 5 } };
+	REQUIRE_EQ(server.Receive(), expected);
+}
+
+TEST_CASE("Batch") {
+	Server server(Protocol::Features::batch);
+	Push(PacketTypes::facing, 1);
+	Push(PacketTypes::movement, 2);
+	Push(PacketTypes::facing, 3);
+	SendQueue::Flush();
+
+	std::vector<Packet> expected = { { PacketTypes::movement, 2 }, { PacketTypes::facing, 3 } };
+	REQUIRE_EQ(server.Receive(), expected);
+	REQUIRE_EQ(server.batches, 1);
+	REQUIRE_EQ(SendQueue::GetStats().frames_sent, 1);
+}
+
+TEST_CASE("Clear") {
+	Server server(0);
+	Push(PacketTypes::facing, 1);
+	Push(PacketTypes::movement, 2);
+	SendQueue::Clear();
+	REQUIRE(SendQueue::Empty());
+
+	// the slot of the dropped facing is gone too
+	Push(PacketTypes::facing, 3);
+	SendQueue::Flush();
+	std::vector<Packet> expected = { { PacketTypes::facing, 3 } };
+	REQUIRE_EQ(server.Receive(), expected);
+	REQUIRE_EQ(SendQueue::GetStats().packets_coalesced, 0);
+}
+
+TEST_SUITE_END();
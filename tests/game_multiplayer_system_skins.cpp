@@ -0,0 +1,100 @@
+#include "game_multiplayer_system_skins.h"
+#include "bitmap.h"
+#include "cache.h"
+#include "output.h"
+#include "doctest.h"
+
+using namespace Game_Multiplayer;
+
+TEST_SUITE_BEGIN("Game_Multiplayer_SystemSkins");
+
+namespace {
+	// the embedded system graphic, its request finishes right away
+	const std::string default_skin = CACHE_DEFAULT_BITMAP;
+
+	struct Calls {
+		int count = 0;
+		BitmapRef bitmap;
+	};
+
+	SystemSkins::Listener Record(Calls& calls) {
+		return [&calls](const BitmapRef& bitmap) {
+			++calls.count;
+			calls.bitmap = bitmap;
+		};
+	}
+}
+
+TEST_CASE("Acquire") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	SystemSkins skins;
+	Calls calls;
+
+	skins.Acquire(default_skin, Record(calls));
+	REQUIRE_EQ(calls.count, 1);
+	REQUIRE(calls.bitmap);
+	REQUIRE_EQ(skins.Get(default_skin), calls.bitmap);
+	REQUIRE_EQ(skins.Size(), 1);
+}
+
+TEST_CASE("Shared") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	SystemSkins skins;
+	Calls a, b;
+
+	skins.Acquire(default_skin, Record(a));
+	skins.Acquire(default_skin, Record(b));
+	REQUIRE_EQ(a.count, 1);
+	REQUIRE_EQ(b.count, 1);
+	REQUIRE_EQ(a.bitmap, b.bitmap);
+	REQUIRE_EQ(skins.Size(), 1);
+
+	// the skin is held until the last reference is gone
+	skins.Release(default_skin);
+	REQUIRE_EQ(skins.Get(default_skin), a.bitmap);
+	skins.Release(default_skin);
+	REQUIRE_FALSE(skins.Get(default_skin));
+	REQUIRE_EQ(skins.Size(), 0);
+
+	// released names are ignored
+	skins.Release(default_skin);
+	REQUIRE_EQ(skins.Size(), 0);
+}
+
+TEST_CASE("Missing") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	auto lvl = Output::GetLogLevel();
+	Output::SetLogLevel(LogLevel::Error);
+	SystemSkins skins;
+	Calls calls;
+
+	// a placeholder is shown for skins that aren't in the game
+	skins.Acquire("missing_skin", Record(calls));
+	REQUIRE_EQ(calls.count, 1);
+	REQUIRE(calls.bitmap);
+	REQUIRE_EQ(skins.Size(), 1);
+
+	Output::SetLogLevel(lvl);
+}
+
+TEST_CASE("ListenerChangesSkins") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	auto lvl = Output::GetLogLevel();
+	Output::SetLogLevel(LogLevel::Error);
+	SystemSkins skins;
+	Calls other;
+
+	// a listener may acquire another skin and drop its own
+	skins.Acquire(default_skin, [&](const BitmapRef&) {
+		skins.Acquire("other_skin", Record(other));
+		skins.Release(default_skin);
+	});
+	REQUIRE_EQ(other.count, 1);
+	REQUIRE_FALSE(skins.Get(default_skin));
+	REQUIRE(skins.Get("other_skin"));
+	REQUIRE_EQ(skins.Size(), 1);
+
+	Output::SetLogLevel(lvl);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,104 @@
+#include "game_multiplayer_transport_loopback.h"
+#include "game_multiplayer_transport_socket.h"
+#include "doctest.h"
+#include <cstring>
+
+#ifdef PLAYER_MULTIPLAYER_SOCKET
+#include <sys/socket.h>
+#endif
+
+using namespace Game_Multiplayer;
+using Type = Transport::Event::Type;
+
+TEST_SUITE_BEGIN("Game_Multiplayer_Transport");
+
+TEST_CASE("LoopbackNoListener") {
+	auto client = Transport::Create("loopback://nobody");
+	REQUIRE(client);
+	REQUIRE_FALSE(client->Connect("loopback://nobody"));
+
+	Transport::Event ev;
+	REQUIRE(client->Poll(ev));
+	REQUIRE_EQ(ev.type, Type::Close);
+	REQUIRE_EQ(client->GetReadyState(), Transport::ReadyState::Closed);
+	REQUIRE_FALSE(client->Send("a", 1));
+}
+
+TEST_CASE("LoopbackExchange") {
+	LoopbackListener listener("test");
+	auto client = Transport::Create("loopback://test");
+	REQUIRE(client->Connect("loopback://test"));
+	auto server = listener.Accept();
+	REQUIRE(server);
+	REQUIRE_FALSE(listener.Accept());
+
+	Transport::Event ev;
+	REQUIRE(client->Poll(ev));
+	REQUIRE_EQ(ev.type, Type::Open);
+	REQUIRE(server->Poll(ev));
+	REQUIRE_EQ(ev.type, Type::Open);
+
+	REQUIRE(client->Send("ping", 4));
+	REQUIRE(server->Poll(ev));
+	REQUIRE_EQ(ev.type, Type::Message);
+	REQUIRE_EQ(ev.size, 4);
+	REQUIRE_EQ(memcmp(ev.data, "ping", 4), 0);
+	REQUIRE_FALSE(server->Poll(ev));
+
+	REQUIRE(server->Send("pong", 4));
+	REQUIRE(client->Poll(ev));
+	REQUIRE_EQ(memcmp(ev.data, "pong", 4), 0);
+
+	server->Close();
+	REQUIRE_EQ(client->GetReadyState(), Transport::ReadyState::Closed);
+	REQUIRE(client->Poll(ev));
+	REQUIRE_EQ(ev.type, Type::Close);
+}
+
+TEST_CASE("EventQueueText") {
+	TransportEventQueue queue;
+	queue.Push(Type::Message, true, "abc", 3);
+	queue.Push(Type::Message, false, "de", 2);
+
+	Transport::Event ev;
+	REQUIRE(queue.Pop(ev));
+	REQUIRE(ev.text);
+	REQUIRE_EQ(ev.size, 3);
+	REQUIRE_EQ(ev.data[3], '\0');
+	REQUIRE(queue.Pop(ev));
+	REQUIRE_FALSE(ev.text);
+	REQUIRE_EQ(ev.size, 2);
+	REQUIRE_FALSE(queue.Pop(ev));
+}
+
+#ifdef PLAYER_MULTIPLAYER_SOCKET
+TEST_CASE("SocketFrames") {
+	int fds[2];
+	REQUIRE_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+	SocketTransport a, b;
+	a.Adopt(fds[0]);
+	b.Adopt(fds[1]);
+
+	Transport::Event ev;
+	REQUIRE(a.Poll(ev));
+	REQUIRE_EQ(ev.type, Type::Open);
+	REQUIRE(b.Poll(ev));
+	REQUIRE_EQ(ev.type, Type::Open);
+
+	REQUIRE(a.Send("hello", 5));
+	REQUIRE(a.Send("x", 1));
+	REQUIRE(b.Poll(ev));
+	REQUIRE_EQ(ev.size, 5);
+	REQUIRE_EQ(memcmp(ev.data, "hello", 5), 0);
+	REQUIRE(b.Poll(ev));
+	REQUIRE_EQ(ev.size, 1);
+
+	a.Close();
+	REQUIRE(b.Poll(ev));
+	REQUIRE_EQ(ev.type, Type::Close);
+	REQUIRE_EQ(b.GetReadyState(), Transport::ReadyState::Closed);
+}
+#endif
+
+TEST_SUITE_END();
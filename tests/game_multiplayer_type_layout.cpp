@@ -0,0 +1,132 @@
+#include "game_multiplayer_type_layout.h"
+#include <random>
+#include "doctest.h"
+
+using namespace Game_Multiplayer;
+
+TEST_SUITE_BEGIN("Game_Multiplayer_TypeLayout");
+
+namespace {
+	constexpr int exfont_width = 12;
+
+	int Width(char32_t ch) {
+		if (ch < 32) return 0;
+		return ch < 0x80 ? 6 : 12;
+	}
+
+	//measures every prefix like the type box did before
+	std::vector<int> PrefixOffsets(const std::u32string& text) {
+		std::vector<int> offsets;
+		for (size_t k = 0; k <= text.size(); ++k) {
+			int width = 0;
+			for (size_t i = 0; i < k; ++i) {
+				bool exfont = text[i] == '$' && i + 1 < k &&
+					((text[i + 1] >= 'a' && text[i + 1] <= 'z') || (text[i + 1] >= 'A' && text[i + 1] <= 'Z'));
+				if (exfont) {
+					width += exfont_width;
+					++i;
+				} else {
+					width += Width(text[i]);
+				}
+			}
+			offsets.push_back(width);
+		}
+		return offsets;
+	}
+
+	TypeLayout MakeLayout(int* calls = nullptr) {
+		return TypeLayout([calls](char32_t ch) {
+			if (calls) ++*calls;
+			return Width(ch);
+		}, exfont_width);
+	}
+}
+
+TEST_CASE("Typing") {
+	TypeLayout layout = MakeLayout();
+	REQUIRE_EQ(layout.GetOffsets(), std::vector<int>{ 0 });
+
+	layout.SetText(U"a");
+	layout.SetText(U"ab");
+	auto edit = layout.SetText(U"ab下");
+	REQUIRE_EQ(edit.first, 2);
+	REQUIRE_EQ(edit.old_last, 2);
+	REQUIRE_EQ(edit.new_last, 3);
+	REQUIRE_EQ(layout.GetOffsets(), std::vector<int>{ 0, 6, 12, 24 });
+}
+
+TEST_CASE("EditInTheMiddle") {
+	TypeLayout layout = MakeLayout();
+	layout.SetText(U"hello world");
+
+	auto edit = layout.SetText(U"hello big world");
+	REQUIRE_EQ(edit.first, 6);
+	REQUIRE_EQ(edit.old_last, 6);
+	REQUIRE_EQ(edit.new_last, 10);
+	REQUIRE_EQ(edit.delta, 24);
+	REQUIRE_EQ(layout.GetOffsets(), PrefixOffsets(U"hello big world"));
+
+	edit = layout.SetText(U"hello world");
+	REQUIRE_EQ(edit.delta, -24);
+	REQUIRE_EQ(layout.GetOffsets(), PrefixOffsets(U"hello world"));
+}
+
+TEST_CASE("ExFont") {
+	TypeLayout layout = MakeLayout();
+
+	layout.SetText(U"x$");
+	REQUIRE_EQ(layout.GetOffsets(), std::vector<int>{ 0, 6, 12 });
+
+	// typing the letter turns the "$" into an exfont glyph
+	auto edit = layout.SetText(U"x$A");
+	REQUIRE_EQ(edit.first, 1);
+	REQUIRE_EQ(layout.GetOffsets(), std::vector<int>{ 0, 6, 12, 18 });
+	REQUIRE(layout.IsExFontTail(2));
+	REQUIRE_EQ(layout.GetExFont(1), 0);
+	REQUIRE_EQ(layout.NextGlyph(1), 3);
+	REQUIRE_EQ(layout.GlyphStart(2), 1);
+
+	// removing the "$" in front of a letter makes it normal again
+	edit = layout.SetText(U"xA");
+	REQUIRE_EQ(edit.first, 1);
+	REQUIRE_EQ(edit.old_last, 3);
+	REQUIRE_EQ(edit.new_last, 2);
+	REQUIRE_EQ(layout.GetOffsets(), std::vector<int>{ 0, 6, 12 });
+	REQUIRE_EQ(layout.GetExFont(1), -1);
+}
+
+TEST_CASE("GlyphsAreMeasuredOnce") {
+	int calls = 0;
+	TypeLayout layout = MakeLayout(&calls);
+	std::u32string text;
+	for (int i = 0; i < 200; ++i) {
+		text += U'a' + (i % 3);
+		layout.SetText(text);
+	}
+	REQUIRE_EQ(calls, 3);
+	REQUIRE_EQ(layout.GetWidth(), 200 * 6);
+}
+
+TEST_CASE("RandomEdits") {
+	std::mt19937 rng(7);
+	const std::u32string alphabet = U"$aZ 下\n";
+	TypeLayout layout = MakeLayout();
+	std::u32string text;
+
+	for (int i = 0; i < 2000; ++i) {
+		size_t pos = text.empty() ? 0 : rng() % (text.size() + 1);
+		size_t erase = std::min<size_t>(rng() % 3, text.size() - pos);
+		std::u32string insert;
+		for (int n = rng() % 3; n > 0; --n) {
+			insert += alphabet[rng() % alphabet.size()];
+		}
+		text.replace(pos, erase, insert);
+
+		auto edit = layout.SetText(text);
+		REQUIRE_EQ(layout.GetOffsets(), PrefixOffsets(text));
+		REQUIRE_FALSE(layout.IsExFontTail(edit.first));
+		REQUIRE_FALSE(layout.IsExFontTail(edit.new_last));
+	}
+}
+
+TEST_SUITE_END();
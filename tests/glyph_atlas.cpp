@@ -0,0 +1,100 @@
+#include "glyph_atlas.h"
+#include "bitmap.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("GlyphAtlas");
+
+namespace {
+	void Fill(const GlyphAtlas::Entry& entry, uint8_t value) {
+		auto* data = reinterpret_cast<uint8_t*>(entry.bitmap->pixels());
+		for (int y = 0; y < entry.bitmap->height(); ++y) {
+			for (int x = 0; x < entry.bitmap->width(); ++x) {
+				data[y * entry.bitmap->pitch() + x] = value;
+			}
+		}
+	}
+
+	uint8_t At(const GlyphAtlas::Entry& entry, int x, int y) {
+		auto* data = reinterpret_cast<uint8_t*>(entry.bitmap->pixels());
+		return data[y * entry.bitmap->pitch() + x];
+	}
+}
+
+TEST_CASE("InsertAndFind") {
+	GlyphAtlas atlas(12, 12, 4);
+
+	REQUIRE(atlas.Find(U'A') == nullptr);
+
+	auto& entry = atlas.Insert(U'A', 12, 12, Rect(0, 0, 6, 9));
+	REQUIRE_EQ(entry.bitmap->width(), 12);
+	REQUIRE_EQ(entry.bitmap->height(), 12);
+	REQUIRE_EQ(entry.rect, Rect(0, 0, 6, 9));
+	Fill(entry, 255);
+
+	auto* found = atlas.Find(U'A');
+	REQUIRE(found != nullptr);
+	REQUIRE_EQ(found->bitmap, entry.bitmap);
+	REQUIRE_EQ(At(*found, 11, 11), 255);
+	REQUIRE_EQ(atlas.GetSize(), 1);
+}
+
+TEST_CASE("CellsDoNotOverlap") {
+	GlyphAtlas atlas(10, 8, 40);
+
+	for (int i = 0; i < 40; ++i) {
+		Fill(atlas.Insert(i, 10, 8, Rect(0, 0, 10, 8)), i + 1);
+	}
+	for (int i = 0; i < 40; ++i) {
+		auto* entry = atlas.Find(i);
+		REQUIRE(entry != nullptr);
+		REQUIRE_EQ(At(*entry, 0, 0), i + 1);
+		REQUIRE_EQ(At(*entry, 9, 7), i + 1);
+	}
+}
+
+TEST_CASE("EvictsLeastRecentlyUsed") {
+	GlyphAtlas atlas(12, 12, 3);
+
+	Fill(atlas.Insert(U'A', 12, 12, Rect(0, 0, 12, 12)), 255);
+	atlas.Insert(U'B', 12, 12, Rect(0, 0, 12, 12));
+	atlas.Insert(U'C', 12, 12, Rect(0, 0, 12, 12));
+	REQUIRE(atlas.Find(U'A') != nullptr);
+
+	auto& entry = atlas.Insert(U'D', 12, 12, Rect(0, 0, 12, 12));
+	REQUIRE_EQ(atlas.GetEvicted(), 1);
+	REQUIRE_EQ(atlas.GetSize(), 3);
+	REQUIRE(atlas.Find(U'B') == nullptr);
+	REQUIRE(atlas.Find(U'A') != nullptr);
+	REQUIRE(atlas.Find(U'C') != nullptr);
+	REQUIRE(atlas.Find(U'D') != nullptr);
+	// the reused cell starts empty
+	REQUIRE_EQ(At(entry, 0, 0), 0);
+}
+
+TEST_CASE("GlyphSmallerThanCell") {
+	GlyphAtlas atlas(24, 24, 2);
+
+	REQUIRE(atlas.Fits(24, 20));
+	REQUIRE_FALSE(atlas.Fits(25, 20));
+	REQUIRE_FALSE(atlas.Fits(20, 25));
+
+	auto& entry = atlas.Insert(U'X', 7, 13, Rect(0, 0, 7, 13));
+	REQUIRE_EQ(entry.bitmap->width(), 7);
+	REQUIRE_EQ(entry.bitmap->height(), 13);
+}
+
+TEST_CASE("Clear") {
+	GlyphAtlas atlas(12, 12, 2);
+
+	atlas.Insert(U'A', 12, 12, Rect(0, 0, 12, 12));
+	atlas.Insert(U'B', 12, 12, Rect(0, 0, 12, 12));
+	atlas.Clear();
+	REQUIRE_EQ(atlas.GetSize(), 0);
+	REQUIRE(atlas.Find(U'A') == nullptr);
+
+	atlas.Insert(U'C', 12, 12, Rect(0, 0, 12, 12));
+	atlas.Insert(U'D', 12, 12, Rect(0, 0, 12, 12));
+	REQUIRE_EQ(atlas.GetEvicted(), 0);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,82 @@
+#include "image_decoder.h"
+#include "bitmap.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("ImageDecoder");
+
+namespace {
+	void Put4(std::vector<uint8_t>& data, uint32_t value) {
+		for (int i = 0; i < 4; ++i) {
+			data.push_back((value >> (i * 8)) & 0xFF);
+		}
+	}
+
+	// 2x1 pixels, 8 bit with a palette of two colors
+	std::vector<uint8_t> MakeBMP() {
+		std::vector<uint8_t> data = { 'B', 'M' };
+		Put4(data, 66);
+		Put4(data, 0);
+		Put4(data, 62);
+
+		Put4(data, 40);
+		Put4(data, 2);
+		Put4(data, 1);
+		data.insert(data.end(), { 1, 0, 8, 0 });
+		Put4(data, 0);
+		Put4(data, 0);
+		Put4(data, 0);
+		Put4(data, 0);
+		Put4(data, 2);
+		Put4(data, 0);
+
+		data.insert(data.end(), { 0, 0, 0, 0, 255, 255, 255, 0 });
+		data.insert(data.end(), { 0, 1, 0, 0 });
+		return data;
+	}
+}
+
+TEST_CASE("Finish") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+
+	BitmapRef result;
+	int calls = 0;
+	int id = ImageDecoder::Decode(MakeBMP(), true, 0, [&](BitmapRef bmp) {
+		++calls;
+		result = bmp;
+	});
+	REQUIRE(ImageDecoder::IsPending());
+
+	ImageDecoder::Finish(id);
+	REQUIRE_EQ(calls, 1);
+	REQUIRE(result);
+	REQUIRE_EQ(result->width(), 2);
+	REQUIRE_EQ(result->height(), 1);
+	REQUIRE_FALSE(ImageDecoder::IsPending());
+
+	ImageDecoder::Finish(id);
+	REQUIRE_EQ(calls, 1);
+}
+
+TEST_CASE("Update") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+
+	std::vector<BitmapRef> results;
+	for (int i = 0; i < 4; ++i) {
+		ImageDecoder::Decode(i % 2 ? MakeBMP() : std::vector<uint8_t>{ 'x', 'y' }, true, 0, [&](BitmapRef bmp) {
+			results.push_back(bmp);
+		});
+	}
+
+	while (ImageDecoder::IsPending()) {
+		ImageDecoder::Update();
+	}
+
+	REQUIRE_EQ(results.size(), 4);
+	int valid = 0;
+	for (auto& bmp : results) {
+		valid += bmp ? 1 : 0;
+	}
+	REQUIRE_EQ(valid, 2);
+}
+
+TEST_SUITE_END();
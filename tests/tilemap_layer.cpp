@@ -0,0 +1,59 @@
+#include "tilemap_layer.h"
+#include "drawable_list.h"
+#include "drawable_mgr.h"
+#include "map_data.h"
+#include "mock_game.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("TilemapLayer");
+
+namespace {
+	const Color red(255, 0, 0, 255);
+
+	// Block F tile 0 is fully opaque, tile 1 only on its left half
+	BitmapRef MakeChipset() {
+		auto chipset = Bitmap::Create(480, 256, true);
+		chipset->FillRect(Rect(18 * TILE_SIZE, 8 * TILE_SIZE, TILE_SIZE, TILE_SIZE), red);
+		chipset->FillRect(Rect(19 * TILE_SIZE, 8 * TILE_SIZE, TILE_SIZE / 2, TILE_SIZE), red);
+		chipset->CheckPixels(Bitmap::Flag_Chipset);
+		return chipset;
+	}
+
+	void SetupUpperLayer(TilemapLayer& layer, std::vector<short> map_data) {
+		layer.SetWidth(16);
+		layer.SetHeight(16);
+		layer.SetChipset(MakeChipset());
+		layer.SetMapData(std::move(map_data));
+		// Nothing is Above, all tiles are in the lower sublayer
+		layer.SetPassable(std::vector<unsigned char>(144, 0));
+	}
+}
+
+TEST_CASE("ChunkSolid") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	const MockGame mg(MockMap::ePass40x30);
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+
+	TilemapLayer layer(1);
+	SetupUpperLayer(layer, std::vector<short>(16 * 16, BLOCK_F));
+
+	REQUIRE(layer.IsChunkSolid(Priority_TilesetBelow + 1, 0, 0));
+}
+
+TEST_CASE("ChunkPartial") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	const MockGame mg(MockMap::ePass40x30);
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+
+	std::vector<short> map_data(16 * 16, BLOCK_F);
+	map_data[5 + 7 * 16] = BLOCK_F + 1;
+
+	TilemapLayer layer(1);
+	SetupUpperLayer(layer, std::move(map_data));
+
+	REQUIRE_FALSE(layer.IsChunkSolid(Priority_TilesetBelow + 1, 0, 0));
+}
+
+TEST_SUITE_END();